@@ -3,6 +3,16 @@
 #include "nsvr/nsvr_player.hpp"
 #include "nsvr/nsvr_player_client.hpp"
 #include "nsvr/nsvr_player_server.hpp"
+#include "nsvr/nsvr_frame_store.hpp"
+#include "nsvr/nsvr_frame_view.hpp"
+#include "nsvr/nsvr_image_sequence.hpp"
+#include "nsvr/nsvr_shared_decode.hpp"
+#include "nsvr/nsvr_compositor.hpp"
+#include "nsvr/nsvr_batch_discoverer.hpp"
+#include "nsvr/nsvr_startup.hpp"
+#include "nsvr/nsvr_task_pool.hpp"
+#include "nsvr/nsvr_frame_change.hpp"
+#include "nsvr/nsvr_cue_scheduler.hpp"
 
 #define NSVR_VERSION_MAJOR 1
 #define NSVR_VERSION_MINOR 0
@@ -20,4 +30,7 @@ void addPluginPath(const std::string& path);
 //! Utility that prints all loaded DLLs on Windows
 void listModules();
 
+//! Registers elements of NSVR (nsvrfilesrc) for pipelines built by hand, Player does on its own
+bool registerElements();
+
 }
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "nsvr/nsvr_discoverer.hpp"
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  BatchDiscoveryStats
+ * @brief   Progress of a BatchDiscoverer run.
+ */
+struct BatchDiscoveryStats
+{
+    guint64     files           = 0;    //!< Files given to start()
+    guint64     done            = 0;    //!< Files answered so far
+    guint64     succeeded       = 0;    //!< Files discovered
+    guint64     failed          = 0;    //!< Files not discovered, timed out ones included
+    guint64     timedOut        = 0;    //!< Files given up on after the timeout
+    guint64     cached          = 0;    //!< Files answered from the discovery cache
+    gdouble     elapsed         = 0.;   //!< Seconds since start(), until the last file was answered
+    gdouble     filesPerSecond  = 0.;   //!< Files answered per second of elapsed
+};
+
+/*!
+ * @class   BatchDiscoverer
+ * @brief   Discovers many files at once, for scanning media libraries.
+ * @details Runs one asynchronous GstDiscoverer per worker thread, each on its
+ *          own main context, taking the next file once done with the last.
+ *          Files held by the discovery cache are answered without a pipeline,
+ *          successful discoveries are stored in it, so Discoverer::open() and
+ *          Player::open() of scanned files skip discovery.
+ */
+class BatchDiscoverer
+{
+public:
+    //! Called on a worker thread as every file is answered, "discoverer" holds what was found if "success"
+    typedef std::function<void(const std::string& path, const Discoverer& discoverer, bool success)> Callback;
+
+    BatchDiscoverer();
+    ~BatchDiscoverer();
+
+    //! sets number of files discovered at once, from next start() on. Default: number of processors
+    void                setWorkerCount(guint count);
+
+    //! answers number of files discovered at once
+    guint               getWorkerCount() const;
+
+    //! sets seconds after which discovery of a file is given up on, from next start() on. Default: 10
+    void                setTimeout(gdouble seconds);
+
+    //! answers seconds after which discovery of a file is given up on
+    gdouble             getTimeout() const;
+
+    //! starts discovering "paths" (or URIs) in the background, calling "callback" for each. Returns false if already running
+    bool                start(const std::vector<std::string>& paths, const Callback& callback);
+
+    //! blocks until every file was answered or the run was cancelled
+    void                wait();
+
+    //! stops discovering, aborting files in flight. They and files not started are not answered
+    void                cancel();
+
+    //! answers true if files are left to be answered
+    bool                isRunning() const;
+
+    //! answers progress of the current or last run
+    BatchDiscoveryStats getStats() const;
+
+private:
+    struct Worker;
+
+    //! loop of one worker thread
+    void                work(Worker* worker);
+
+    //! answers next file to discover and its URI, answering the ones cached on the way. Returns false if none is left
+    bool                claim(std::string& path, std::string& uri);
+
+    //! counts "path" as answered and hands it to the callback
+    void                answer(const std::string& path, const Discoverer& discoverer, bool success, bool timed_out, bool cached);
+
+    BatchDiscoverer(const BatchDiscoverer&) = delete;
+    BatchDiscoverer& operator=(const BatchDiscoverer&) = delete;
+
+    guint                   mWorkerCount;   //!< Files discovered at once
+    gdouble                 mTimeout;       //!< Seconds a file may take
+    std::vector<std::string> mPaths;        //!< Files of the current run
+    Callback                mCallback;      //!< Called for every file answered
+    std::atomic<gsize>      mNext;          //!< Index of the file claimed next
+    std::atomic<bool>       mCancelled;     //!< Flag, telling workers to quit
+    std::vector<std::unique_ptr<Worker>> mWorkers;  //!< Threads of the current run
+
+    mutable std::mutex      mMutex;         //!< Guards everything below
+    BatchDiscoveryStats     mStats;         //!< Progress of the current run
+    gint64                  mStarted;       //!< Monotonic time of start()
+    guint                   mActive;        //!< Workers still running
+};
+
+}
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <gio/gio.h>
 
+#include <memory>
+
 namespace nsvr {
 
+namespace internal { class SocketWatch; }
+
 /*!
  * @class Client
  * @brief Implements a UDP client. It can also
@@ -32,6 +37,15 @@ public:
     //! processes pending events received from Server
     void iterate();
 
+    //! processes pending events until monotonic time "deadline" (microseconds) passes
+    void iterate(gint64 deadline);
+
+    //! answers the context events are dispatched from by iterate()
+    GMainContext* getContext() const;
+
+    //! answers a descriptor readable once iterate() has events to process, valid for the lifetime of the Client
+    GPollFD getPollFd() const;
+
     //! returns the address of last server passed to connect
     const std::string& getServerAddress() const;
     
@@ -52,6 +66,7 @@ private:
     GSocketAddress  *mListenAddress;
     GMainContext    *mContext;
     GSource         *mSource;
+    std::unique_ptr<internal::SocketWatch> mWatch;  //!< Signaled once mReceiveSocket is readable
     short           mServerPort;
     bool            mConnected;
 };
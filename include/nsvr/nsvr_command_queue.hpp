@@ -0,0 +1,71 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  PlayerCommand
+ * @brief   A Player API call, posted from any thread and executed later on
+ *          the thread driving Player::update().
+ */
+struct PlayerCommand
+{
+    enum Type
+    {
+        PLAY,       //!< Player::play()
+        PAUSE,      //!< Player::pause()
+        STOP,       //!< Player::stop()
+        REPLAY,     //!< Player::replay()
+        SEEK,       //!< Player::setTime(value)
+        VOLUME,     //!< Player::setVolume(value)
+        MUTE,       //!< Player::setMute(value != 0)
+        LOOP        //!< Player::setLoop(value != 0)
+    };
+
+    Type            type        = PLAY;     //!< Call to be made
+    gdouble         value       = 0.;       //!< Argument of the call, if any
+    gint64          timestamp   = 0;        //!< Monotonic time (microseconds) the command was posted at
+};
+
+/*!
+ * @class   CommandQueue
+ * @brief   Lock-free, unbounded, multiple producer single consumer queue
+ *          of PlayerCommands (intrusive Vyukov queue).
+ * @note    push() is MT safe and wait-free. pop() MUST only be called by
+ *          a single thread at a time.
+ */
+class CommandQueue
+{
+public:
+    CommandQueue();
+    ~CommandQueue();
+
+    //! enqueues a copy of "command". Callable from any thread
+    void    push(const PlayerCommand& command);
+
+    //! dequeues the oldest command into "command". Answers false if empty
+    bool    pop(PlayerCommand& command);
+
+private:
+    struct Node
+    {
+        std::atomic<Node*>  next;
+        PlayerCommand       command;
+    };
+
+    //! links "node" at the head of the queue
+    void    link(Node* node);
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    std::atomic<Node*>  mHead;          //!< Most recently pushed node, producers side
+    Node                *mTail;         //!< Oldest node, consumer side
+    Node                mStub;          //!< Sentinel node, keeps the queue never empty
+};
+
+}
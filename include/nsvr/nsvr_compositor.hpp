@@ -0,0 +1,234 @@
+#pragma once
+
+#include "nsvr/nsvr_player.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  CompositorStats
+ * @brief   Cost of Compositor::compose() calls, in seconds.
+ */
+struct CompositorStats
+{
+    gdouble                 last        = 0.;   //!< Wall time of the last compose()
+    gdouble                 average     = 0.;   //!< Wall time averaged over all compose() calls
+    gdouble                 maximum     = 0.;   //!< Wall time of the slowest compose()
+    std::vector<gdouble>    layers;             //!< Processor time each layer took to blend in the last compose(), summed over threads
+    guint64                 frames      = 0;    //!< compose() calls so far
+};
+
+/*!
+ * @class   CompositorLayer
+ * @brief   Player whose frames a Compositor blends. Open and drive it like
+ *          any Player, in 32bit BGRA (blended by its alpha) or BGRx (opaque).
+ * @details Keeps a reference to the last frame handed off, no copy is made
+ *          unless it was served from the frame cache. Scaling samples the
+ *          nearest pixel, open the layer at the size it is shown at for
+ *          filtered scaling.
+ */
+class CompositorLayer : public Player
+{
+public:
+    CompositorLayer();
+    ~CompositorLayer();
+
+    //! sets position of the top left corner within the output, in pixels (may lie outside)
+    void            setPosition(gint x, gint y);
+
+    //! answers horizontal position within the output
+    gint            getX() const;
+
+    //! answers vertical position within the output
+    gint            getY() const;
+
+    //! sets horizontal and vertical scale of frames
+    void            setScale(gdouble x, gdouble y);
+
+    //! answers horizontal scale of frames
+    gdouble         getScaleX() const;
+
+    //! answers vertical scale of frames
+    gdouble         getScaleY() const;
+
+    //! sets opacity of the layer between [ 0. , 1. ], multiplied with the alpha of frames
+    void            setAlpha(gdouble alpha);
+
+    //! answers opacity of the layer
+    gdouble         getAlpha() const;
+
+    //! sets if the layer is blended (true) or skipped (false)
+    void            setVisible(bool on);
+
+    //! answers true if the layer is blended
+    bool            getVisible() const;
+
+protected:
+    void            onVideoFrame(guchar* buf, gsize size) const override;
+
+private:
+    friend class Compositor;
+
+    /*!
+     * @struct  Frame
+     * @brief   Last frame, mapped for the duration of a compose().
+     */
+    struct Frame
+    {
+        const guint8    *data   = nullptr;
+        gint            width   = 0;
+        gint            height  = 0;
+        gint            stride  = 0;
+        bool            alpha   = false;    //!< BGRA if true, BGRx otherwise
+    };
+
+    //! maps the last frame into "frame". Returns false if there is none or it is neither BGRA nor BGRx
+    bool            map(Frame& frame);
+
+    //! unmaps the frame mapped last
+    void            unmap();
+
+    gint            mX          = 0;        //!< Horizontal position within the output
+    gint            mY          = 0;        //!< Vertical position within the output
+    gdouble         mScaleX     = 1.;       //!< Horizontal scale of frames
+    gdouble         mScaleY     = 1.;       //!< Vertical scale of frames
+    gdouble         mAlpha      = 1.;       //!< Opacity of the layer
+    bool            mVisible    = true;     //!< Flag, indicating the layer is blended
+
+    mutable GstSample           *mFrame     = nullptr;  //!< Last frame handed off, nullptr if copied or none
+    mutable std::vector<guint8> mCopy;                  //!< Last frame handed off from the frame cache
+    mutable bool                mCopyAlpha  = true;     //!< Flag, indicating cached frames are BGRA rather than BGRx, as decoded
+    GstBuffer                   *mMapped    = nullptr;  //!< Buffer of mFrame while mapped
+    GstMapInfo                  mMapInfo;               //!< Mapping of mMapped
+    bool                        mWarned     = false;    //!< Flag, indicating an unsupported format was logged
+};
+
+/*!
+ * @class   Compositor
+ * @brief   Blends the frames of several CompositorLayers into one 32bit BGRA
+ *          output on the CPU, for nodes without a GPU.
+ * @details Layers are blended bottom to top with SIMD kernels (SSE2, NEON,
+ *          scalar elsewhere), positioned, scaled and faded per layer. The
+ *          output is tiled into bands of rows, blended by a pool of workers
+ *          and the calling thread; each band goes through every layer while
+ *          it is hot in cache. Not MT safe, use from the thread updating the
+ *          layers.
+ */
+class Compositor
+{
+public:
+    Compositor();
+    ~Compositor();
+
+    //! sets size of the output in pixels. Returns false if empty
+    bool            setSize(gint width, gint height);
+
+    //! answers width of the output
+    gint            getWidth() const;
+
+    //! answers height of the output
+    gint            getHeight() const;
+
+    //! sets color the output is cleared with before blending, 0xAARRGGBB. Default: opaque black
+    void            setBackground(guint32 argb);
+
+    //! answers color the output is cleared with
+    guint32         getBackground() const;
+
+    //! sets number of worker threads besides the calling one. Default: number of processors - 1
+    void            setWorkerCount(guint count);
+
+    //! answers number of worker threads besides the calling one
+    guint           getWorkerCount() const;
+
+    //! adds a layer on top of the others and answers it, for the caller to open and play
+    std::shared_ptr<CompositorLayer> addLayer();
+
+    //! removes "layer", closing it if no one else holds it
+    void            removeLayer(const std::shared_ptr<CompositorLayer>& layer);
+
+    //! answers layers, bottom first
+    const std::vector<std::shared_ptr<CompositorLayer>>& getLayers() const;
+
+    //! calls update() of every layer
+    void            update();
+
+    //! blends the last frame of every visible layer into the output and answers it (nullptr if sized empty).
+    //! Valid until next compose() or setSize()
+    const guint8*   compose();
+
+    //! answers the output blended last
+    const guint8*   getOutput() const;
+
+    //! answers bytes between rows of the output
+    gsize           getStride() const;
+
+    //! answers cost of compose() calls so far
+    const CompositorStats& getStats() const;
+
+private:
+    /*!
+     * @struct  Job
+     * @brief   One layer as blended by the current compose().
+     */
+    struct Job
+    {
+        CompositorLayer::Frame  frame;          //!< Mapped frame of the layer
+        gint                    left;           //!< Position of the frame within the output
+        gint                    top;
+        gint                    x0;             //!< Columns [ x0 , x1 ) and rows [ y0 , y1 ) covered, clipped to the output
+        gint                    x1;
+        gint                    y0;
+        gint                    y1;
+        gdouble                 scaleY;         //!< Vertical scale
+        guint                   alpha;          //!< Opacity between [ 0 , 256 ]
+        bool                    direct;         //!< Flag, indicating columns map one to one
+        std::vector<gint>       columns;        //!< Frame column of every output column from x0 on, unless direct
+        gsize                   index;          //!< Index of the layer in mLayers
+    };
+
+    //! blends bands until none is left, run by workers and the calling thread
+    void            blendBands();
+
+    //! blends rows of "band" through every job
+    void            blendBand(guint band);
+
+    //! loop of one worker thread, started before compose() number "generation" + 1
+    void            work(guint64 generation);
+
+    //! stops and joins worker threads
+    void            stopWorkers();
+
+    Compositor(const Compositor&) = delete;
+    Compositor& operator=(const Compositor&) = delete;
+
+    gint                        mWidth;         //!< Width of the output
+    gint                        mHeight;        //!< Height of the output
+    guint32                     mBackground;    //!< Color the output is cleared with
+    std::vector<guint8>         mOutput;        //!< Blended pixels
+    std::vector<std::shared_ptr<CompositorLayer>> mLayers;  //!< Layers, bottom first
+    CompositorStats             mStats;         //!< Cost of compose() calls so far
+
+    std::vector<Job>            mJobs;          //!< Layers blended by the current compose()
+    std::vector<gint64>         mCosts;         //!< Microseconds per band and job of the current compose()
+    guint                       mBandCount;     //!< Bands of the current compose()
+    std::atomic<guint>          mNextBand;      //!< Band claimed next
+
+    guint                       mWorkerCount;   //!< Worker threads to run
+    std::mutex                  mMutex;         //!< Guards everything below
+    std::condition_variable     mWork;          //!< Notified when a compose() starts or workers should stop
+    std::condition_variable     mDone;          //!< Notified when a worker ran out of bands
+    guint64                     mGeneration;    //!< Bumped by every compose()
+    guint                       mBusy;          //!< Workers still blending the current compose()
+    bool                        mStopping;      //!< Flag, telling workers to quit
+    std::vector<std::thread>    mWorkers;       //!< Blending threads
+};
+
+}
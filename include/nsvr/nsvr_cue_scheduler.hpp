@@ -0,0 +1,116 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  Cue
+ * @brief   Media time an event fires at.
+ */
+struct Cue
+{
+    std::string     id;                     //!< Name the cue fires with, unique
+    gdouble         time        = 0.;       //!< Media time in seconds (stream time, as getTime() answers)
+};
+
+/*!
+ * @struct  CueEvent
+ * @brief   A cue firing, timed on the clock it was scheduled on.
+ */
+struct CueEvent
+{
+    std::string     id;                     //!< Name of the cue
+    gdouble         time        = 0.;       //!< Media time of the cue, in seconds
+    GstClockTime    target      = GST_CLOCK_TIME_NONE;//!< Clock time the cue was due at
+    GstClockTime    fired       = GST_CLOCK_TIME_NONE;//!< Clock time the callback ran at
+    gdouble         lateness    = 0.;       //!< Seconds the callback ran after target
+};
+
+/*!
+ * @struct  CueStats
+ * @brief   Lateness of cues fired so far, in seconds.
+ */
+struct CueStats
+{
+    guint64         fired       = 0;        //!< Cues fired
+    gdouble         last        = 0.;       //!< Lateness of the last cue
+    gdouble         average     = 0.;       //!< Lateness averaged over all cues
+    gdouble         maximum     = 0.;       //!< Lateness of the cue fired latest
+};
+
+/*!
+ * @class   CueScheduler
+ * @brief   Fires cues the moment their media time is due on a clock, from
+ *          the clock's own thread, through gst_clock_id_wait_async(...).
+ * @details schedule() maps every cue to a clock time and arms a single shot
+ *          clock id for it, re-arming those whose time moved (seeks, loops,
+ *          a new base time) and dropping those no longer reached. A cue
+ *          fires once per clock time it maps to, so it fires again on every
+ *          pass over its media time. Cues passed more than 10 milliseconds
+ *          ago when mapped are not fired.
+ */
+class CueScheduler
+{
+public:
+    using Callback = std::function<void(const CueEvent&)>;
+
+    //! "callback" is called on the clock thread for every cue firing
+    explicit CueScheduler(const Callback& callback);
+    ~CueScheduler();
+
+    //! adds a cue firing "id" at media time "time" (seconds), replacing a cue of the same id. Answers false if "id" is empty or "time" negative
+    bool            add(gdouble time, const std::string& id);
+
+    //! removes the cue of "id". Answers false if there is none
+    bool            remove(const std::string& id);
+
+    //! replaces every cue with "cues"
+    void            set(const std::vector<Cue>& cues);
+
+    //! removes every cue
+    void            clear();
+
+    //! answers cues ordered by time
+    std::vector<Cue> getCues() const;
+
+    //! answers a number changed by every add(), remove(), set() and clear()
+    guint64         getVersion() const;
+
+    //! sets seconds cues fire before (positive) or after (negative) their time, to make up for the output chain
+    void            setOffset(gdouble offset);
+
+    //! answers seconds cues fire ahead of their time
+    gdouble         getOffset() const;
+
+    //! (re)arms cues on "clock", "map" answering the clock time of a media time (nanoseconds), NONE if not reached
+    void            schedule(GstClock* clock, const std::function<GstClockTime(GstClockTime)>& map);
+
+    //! disarms every cue, until schedule() is called again
+    void            unschedule();
+
+    //! disarms every cue and waits for callbacks running, until schedule() is called again. Not callable from the callback
+    void            quiesce();
+
+    //! disarms every cue and waits for callbacks running, none fires afterwards
+    void            shutdown();
+
+    //! answers lateness of cues fired so far
+    CueStats        getStats() const;
+
+private:
+    CueScheduler(const CueScheduler&) = delete;
+    CueScheduler& operator=(const CueScheduler&) = delete;
+
+    struct State;
+
+    std::shared_ptr<State> mState;          //!< Cues and their clock ids, shared with callbacks in flight
+};
+
+}
@@ -2,14 +2,16 @@
 
 #include <string>
 
+typedef struct _GstDiscovererInfo GstDiscovererInfo;
+
 namespace nsvr
 {
 
 class Discoverer
 {
 public:
-    //! Attempts to open a media for discovery.
-    bool open(const std::string& path);
+    //! Attempts to open a media for discovery, giving up after "timeout" seconds. Answered from the cache if there
+    bool open(const std::string& path, double timeout = 10.);
     
     //! Returns width of the media if it contains video (0 otherwise)
     int getWidth() const;
@@ -44,7 +46,27 @@ public:
     //! Resets the internal state
     void reset();
 
+    //! Enables process wide cache of successful discoveries of local files, dropped once their size or modification time changes. Default: on
+    static void setCacheEnabled(bool on);
+
+    //! Answers true if successful discoveries are cached
+    static bool getCacheEnabled();
+
+    //! Drops all cached discoveries
+    static void clearCache();
+
 private:
+    friend class BatchDiscoverer;
+
+    //! Reads streams of discovered "info" for mMediaUri. Returns true if discovery succeeded
+    bool read(GstDiscovererInfo* info);
+
+    //! Fills from the cache if it holds a discovery of mMediaUri. Returns true if so
+    bool lookup();
+
+    //! Stores this discovery in the cache if enabled and of a local file
+    void store() const;
+
     std::string mMediaUri;              //!< URI to the discovered media
     int         mWidth      = 0;        //!< Width of the discovered media
     int         mHeight     = 0;        //!< Height of the discovered media
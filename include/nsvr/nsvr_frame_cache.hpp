@@ -0,0 +1,88 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <mutex>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @class   FrameCache
+ * @brief   Keeps decoded video frames of one full pass of a media in RAM,
+ *          up to a memory budget, so that later loops can be served from
+ *          memory while the decoder sits idle.
+ * @note    record() is called on GStreamer's streaming thread while the
+ *          rest is called from the thread driving Player::update().
+ * @details Frames are stored in whatever format and size the Player was
+ *          opened with. Opening with a smaller size or a cheaper format
+ *          (e.g. RGB16) is the way to fit longer loops into the budget.
+ */
+class FrameCache
+{
+public:
+    //! constructs a cache that never holds more than "budget" bytes of frames
+    explicit FrameCache(gsize budget);
+
+    //! starts recording a fresh pass from the beginning of the media
+    void            arm();
+
+    //! drops a pass being recorded and stops recording (e.g. after a seek). No-op once sealed
+    void            invalidate();
+
+    //! stores a copy of frame "index" (as Player::getFrameIndex() answers it) with the given presentation time. Answers false once the budget is exceeded
+    bool            record(GstClockTime pts, guint64 index, const guint8* data, gsize size);
+
+    //! closes the pass being recorded. Answers true if the pass is complete and can be served
+    bool            seal(GstClockTime duration);
+
+    //! answers index of the frame covering "position" within the pass, -1 if the cache is not sealed
+    gint            find(GstClockTime position) const;
+
+    //! answers data of the frame at "index". Only valid while the cache is sealed
+    const guint8*   getData(gint index) const;
+
+    //! answers size in bytes of the frame at "index". Only valid while the cache is sealed
+    gsize           getSize(gint index) const;
+
+    //! answers frame index recorded with the frame at "index". Only valid while the cache is sealed
+    guint64         getFrameIndex(gint index) const;
+
+    //! answers duration of the sealed pass (GST_CLOCK_TIME_NONE if not sealed)
+    GstClockTime    getDuration() const;
+
+    //! answers amount of memory currently held by frames, in bytes
+    gsize           getBytes() const;
+
+    //! answers the memory budget passed at construction, in bytes
+    gsize           getBudget() const;
+
+    //! answers true if a pass did not fit into the budget
+    bool            getOverflow() const;
+
+    //! answers true if a complete pass is sealed and can be served
+    bool            getSealed() const;
+
+private:
+    //! drops all frames. mGuard MUST be held by the caller
+    void            clear();
+
+    struct Frame
+    {
+        GstClockTime        pts;            //!< Presentation time of the frame within the pass
+        guint64             index;          //!< Frame index the frame was handed off with
+        std::vector<guint8> data;           //!< Copy of the decoded frame
+    };
+
+    mutable std::mutex  mGuard;             //!< Guards everything below, shared with the streaming thread
+    std::vector<Frame>  mFrames;            //!< Recorded frames, sorted by presentation time
+    gsize               mBudget;            //!< Maximum number of bytes frames can take
+    gsize               mBytes;             //!< Number of bytes frames are currently taking
+    GstClockTime        mDuration;          //!< Duration of the sealed pass
+    bool                mRecording;         //!< Flag, indicating frames passed to record() are stored
+    bool                mOverflow;          //!< Flag, indicating a pass exceeded the budget
+    bool                mSealed;            //!< Flag, indicating a complete pass is recorded
+};
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  FrameRegion
+ * @brief   Rectangle of a frame, in pixels.
+ */
+struct FrameRegion
+{
+    gint            x           = 0;        //!< Left edge
+    gint            y           = 0;        //!< Top edge
+    gint            width       = 0;        //!< Width, clipped to the frame
+    gint            height      = 0;        //!< Height, clipped to the frame
+};
+
+/*!
+ * @struct  FrameChange
+ * @brief   What changed in a frame since the one handed off before it.
+ *          Tiles are empty if not known, the whole frame is then changed.
+ */
+struct FrameChange
+{
+    bool                changed         = true;     //!< Flag, indicating anything changed (always set if tiles are not known)
+    gint                width           = 0;        //!< Width of the frame, 0 if not known
+    gint                height          = 0;        //!< Height of the frame, 0 if not known
+    guint               tileSize        = 0;        //!< Side of a tile in pixels, 0 if tiles are not known
+    guint               columns         = 0;        //!< Tiles across
+    guint               rows            = 0;        //!< Tiles down
+    guint               changedTiles    = 0;        //!< Tiles changed
+    std::vector<guint8> tiles;                      //!< 1 for every changed tile, row after row
+
+    //! answers true if tile at "column", "row" changed, always true if tiles are not known
+    bool            isTileChanged(guint column, guint row) const;
+
+    //! answers changed areas as rectangles, runs of changed tiles within a row merged. Whole frame if tiles are not known
+    std::vector<FrameRegion> getRegions() const;
+
+    //! adds changes of "other", a frame never handed off in between
+    void            merge(const FrameChange& other);
+};
+
+/*!
+ * @struct  FrameChangeStats
+ * @brief   Outcome of frame change detection since open().
+ */
+struct FrameChangeStats
+{
+    guint64         hashed      = 0;        //!< Frames hashed
+    guint64         unchanged   = 0;        //!< Frames found equal to the one before
+    guint64         skipped     = 0;        //!< Unchanged frames never handed off
+    gdouble         tiles       = 0.;       //!< Changed tiles per tile of changed frames, averaged
+    gdouble         last        = 0.;       //!< Seconds hashing the last frame
+    gdouble         average     = 0.;       //!< Seconds hashing a frame, averaged
+    gdouble         maximum     = 0.;       //!< Seconds hashing the slowest frame
+};
+
+/*!
+ * @class   FrameChangeDetector
+ * @brief   Finds which tiles of a raw video frame changed since the frame
+ *          accepted before, by hashing every tile of every plane.
+ * @details Tiles are hashed with SSE2 or NEON multiply-accumulate, 64 bytes
+ *          at a time, a 1080p BGRA frame in about a millisecond on one core.
+ *          Hashes are compared, not pixels, so a change may go unnoticed
+ *          once in 2^64 tiles. Planes are mapped through GstVideoMeta, so
+ *          padded or pooled frames hash the same as packed ones.
+ */
+class FrameChangeDetector
+{
+public:
+    //! tiles are "tile_size" pixels square (rounded up to a multiple of 4)
+    explicit FrameChangeDetector(guint tile_size = 64);
+    ~FrameChangeDetector();
+
+    //! answers side of a tile in pixels
+    guint           getTileSize() const;
+
+    //! hashes "sample" and compares it with the frame accepted last, filling "change". Answers false if not raw video
+    bool            detect(GstSample* sample, FrameChange& change);
+
+    //! makes the frame detected last the one following frames are compared with
+    void            accept();
+
+    //! forgets the frame accepted last, the next one is changed as a whole. MT safe, callable from any thread
+    void            reset();
+
+    //! answers outcome so far. MT safe
+    FrameChangeStats getStats() const;
+
+private:
+    FrameChangeDetector(const FrameChangeDetector&) = delete;
+    FrameChangeDetector& operator=(const FrameChangeDetector&) = delete;
+
+    //! hashes every tile of "frame" into mHashes
+    void            hash(const GstVideoFrame& frame);
+
+    guint           mTileSize;                  //!< Side of a tile in pixels
+    GstCaps         *mCaps          = nullptr;  //!< Caps mInfo was parsed from
+    GstVideoInfo    mInfo;                      //!< Layout of frames hashed
+    bool            mValid          = false;    //!< Flag, indicating mCaps are raw video
+    guint           mColumns        = 0;        //!< Tiles across frames of mInfo
+    guint           mRows           = 0;        //!< Tiles down frames of mInfo
+    std::vector<guint64> mHashes;               //!< Two 64bit lanes per tile of the frame detected last
+    std::vector<guint64> mReference;            //!< Hashes of the frame accepted last, empty if none
+    std::atomic<bool> mResetPending;            //!< Set by reset(), mReference is cleared by the next detect()
+
+    mutable std::mutex mStatsMutex;             //!< Guards mStats
+    FrameChangeStats mStats;                    //!< Outcome so far (skipped left to the caller)
+};
+
+}
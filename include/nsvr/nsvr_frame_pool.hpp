@@ -0,0 +1,76 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <mutex>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  FramePoolStats
+ * @brief   Outcome of a FramePool since it was installed.
+ */
+struct FramePoolStats
+{
+    gsize           slotSize    = 0;        //!< Bytes of one slot of the arena (frame size rounded up to pages)
+    guint           slotCount   = 0;        //!< Slots of the arena
+    bool            hugePages   = false;    //!< Arena is backed by huge pages (explicit, or transparent ones advised)
+    gint            numaNode    = -1;       //!< NUMA node the arena is bound to, -1 if unknown
+    guint64         served      = 0;        //!< Frame memories handed out of the arena
+    guint64         fallbacks   = 0;        //!< Frame memories handed out of system memory, arena being full or too small
+    guint           arenas      = 0;        //!< Arenas built so far, one per negotiated frame size
+};
+
+/*!
+ * @class   FramePool
+ * @brief   Recycles fixed-size frame buffers out of one hugepage-backed
+ *          arena, bound to the NUMA node of the thread constructing it.
+ * @details Once installed on an appsink, allocation queries reaching it are
+ *          answered with a GstBufferPool whose GstAllocator hands out arena
+ *          slots, so upstream elements (videoconvert, decoders) write frames
+ *          straight into it. The arena is sized for the negotiated frame and
+ *          rebuilt if caps change. It is pre-faulted when built, so frames
+ *          never page fault while streaming. Memories outlive the FramePool.
+ * @note    Allocation queries are only answered by GStreamer 1.6+, older
+ *          versions let the appsink answer them (without a pool).
+ */
+class FramePool
+{
+public:
+    //! "slots" frames are recycled out of the arena, more are served from system memory
+    explicit FramePool(guint slots = 8);
+    ~FramePool();
+
+    //! answers allocation queries reaching "app_sink". Replaces the previous installation
+    bool            install(GstElement* app_sink);
+
+    //! stops answering allocation queries. Buffers handed out remain valid
+    void            uninstall();
+
+    //! answers an allocator of "size" bytes frames (new reference), rebuilding the arena if size changed
+    GstAllocator*   getAllocator(gsize size);
+
+    //! answers outcome of the pool so far
+    FramePoolStats  getStats() const;
+
+    //! answers NUMA node the calling thread runs on, -1 if unknown
+    static gint     getCurrentNumaNode();
+
+private:
+    //! Called by GStreamer on the streaming thread for queries reaching the appsink
+    static GstPadProbeReturn onQuery(GstPad* pad, GstPadProbeInfo* info, FramePool* pool);
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    mutable std::mutex  mMutex;             //!< Guards mAllocator and mStats
+    GstAllocator        *mAllocator;        //!< Allocator of the current arena, nullptr until the first query
+    GstPad              *mPad;              //!< Sink pad of the appsink the pool is installed on
+    gulong              mProbe;             //!< Probe answering queries on mPad
+    guint               mSlots;             //!< Slots of every arena
+    gint                mNode;              //!< NUMA node of the thread constructing the pool
+    FramePoolStats      mStats;             //!< Outcome so far, counters of past arenas included
+};
+
+}
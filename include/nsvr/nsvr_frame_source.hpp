@@ -0,0 +1,70 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <string>
+
+namespace nsvr
+{
+
+/*!
+ * @class   FrameSource
+ * @brief   Provider of already decoded video frames, random accessible by
+ *          their index. Player::open(...) can play one instead of a media
+ *          file, in which case no decoder runs in the pipeline at all.
+ * @note    getFrame() and prefetch() are called on GStreamer's streaming
+ *          thread. Frames are assumed to be of a constant frame rate.
+ */
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    //! answers width of the frames
+    virtual gint                getWidth() const = 0;
+
+    //! answers height of the frames
+    virtual gint                getHeight() const = 0;
+
+    //! answers GStreamer's raw video format of the frames (BGRA, etc.)
+    virtual const std::string&  getFormat() const = 0;
+
+    //! answers numerator of the frame rate
+    virtual gint                getFrameRateNum() const = 0;
+
+    //! answers denominator of the frame rate
+    virtual gint                getFrameRateDenom() const = 0;
+
+    //! answers total number of frames
+    virtual guint64             getFrameCount() const = 0;
+
+    //! answers a new reference to frame at "index", nullptr on failure
+    virtual GstBuffer*          getFrame(guint64 index) = 0;
+
+    //! hints that frames from "index" onward are about to be requested
+    virtual void                prefetch(guint64 index) {}
+
+    //! answers presentation time of frame at "index"
+    GstClockTime                getFrameTime(guint64 index) const
+    {
+        return getFrameRateNum() > 0
+            ? gst_util_uint64_scale(index, GST_SECOND * getFrameRateDenom(), getFrameRateNum())
+            : 0;
+    }
+
+    //! answers index of the frame being presented at "time"
+    guint64                     getFrameIndex(GstClockTime time) const
+    {
+        return getFrameRateDenom() > 0
+            ? gst_util_uint64_scale(time, getFrameRateNum(), GST_SECOND * getFrameRateDenom())
+            : 0;
+    }
+
+    //! answers duration of the whole source in seconds
+    gdouble                     getDuration() const
+    {
+        return getFrameTime(getFrameCount()) / gdouble(GST_SECOND);
+    }
+};
+
+}
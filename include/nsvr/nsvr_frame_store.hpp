@@ -0,0 +1,76 @@
+#pragma once
+
+#include "nsvr/nsvr_frame_source.hpp"
+
+#include <memory>
+#include <string>
+
+namespace nsvr
+{
+
+/*!
+ * @class   FrameStore
+ * @brief   Memory-mapped file of raw, pre-decoded video frames. Trades
+ *          disk space for zero decoding cost and constant time seeks.
+ * @details A store starts with a header page holding frame format, size,
+ *          rate and count. Frames follow, each starting on a page boundary
+ *          and a frame index (offset and presentation time of each frame)
+ *          closes the file. Frames handed out by getFrame() point directly
+ *          at mapped pages, nothing is copied. Use build() (or the
+ *          nsvr.framestore tool) to produce a store out of any media file.
+ */
+class FrameStore : public FrameSource
+{
+public:
+    FrameStore();
+    ~FrameStore();
+
+    //! decodes "media" into a store at "store" path in given size and format. Returns true on success
+    static bool         build(const std::string& media, const std::string& store, gint width, gint height, const std::string& fmt);
+
+    //! decodes "media" into a store at "store" path in its own size, as 32bit BGRA. Returns true on success
+    static bool         build(const std::string& media, const std::string& store);
+
+    //! maps a store built by build(). Returns true on success
+    bool                open(const std::string& store);
+
+    //! unmaps the current store. Frames already handed out remain valid
+    void                close();
+
+    //! answers true if a store is mapped
+    bool                isOpen() const;
+
+    //! sets how many frames ahead of the playhead are paged in. Default: 8
+    void                setReadahead(guint frames);
+
+    //! answers how many frames ahead of the playhead are paged in
+    guint               getReadahead() const;
+
+    virtual gint                getWidth() const override;
+    virtual gint                getHeight() const override;
+    virtual const std::string&  getFormat() const override;
+    virtual gint                getFrameRateNum() const override;
+    virtual gint                getFrameRateDenom() const override;
+    virtual guint64             getFrameCount() const override;
+    virtual GstBuffer*          getFrame(guint64 index) override;
+    virtual void                prefetch(guint64 index) override;
+
+private:
+    struct Mapping;
+
+    std::shared_ptr<Mapping>    mMapping;       //!< Mapped file, shared with every frame handed out
+    std::string                 mFormat;        //!< Raw video format of frames
+    const guint64               *mIndex;        //!< Frame index: offset and time of every frame
+    gint                        mWidth;         //!< Width of frames
+    gint                        mHeight;        //!< Height of frames
+    gint                        mFrameRateNum;  //!< Numerator of frame rate
+    gint                        mFrameRateDenom;//!< Denominator of frame rate
+    guint64                     mFrameCount;    //!< Number of frames in the store
+    guint64                     mFrameSize;     //!< Size of one frame in bytes
+    guint64                     mFrameStride;   //!< Distance between two frames, multiple of page size
+    guint64                     mAdvisedBegin;  //!< First frame of the window paged in last
+    guint64                     mAdvisedEnd;    //!< One past the last frame of the window paged in last
+    guint                       mReadahead;     //!< Number of frames paged in ahead of the playhead
+};
+
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include "nsvr/nsvr_player.hpp"
+
+#include <gst/video/video.h>
+
+#include <type_traits>
+
+namespace nsvr
+{
+
+/*!
+ * @namespace   format
+ * @brief       Compile-time tags of raw video formats, laid out the way
+ *              GStreamer lays out frames without padding (rows aligned to
+ *              4 bytes, chroma planes of 4:2:0 formats rounded up).
+ * @details     Every tag carries its GStreamer name, number of planes, the
+ *              type of a sample of each plane, the row alignment and
+ *              constexpr column/stride/row/offset arithmetic per plane.
+ */
+namespace format
+{
+
+//! rounds "value" up to the next multiple of "align" (a power of two)
+constexpr gsize roundUp(gsize value, gsize align) { return (value + align - 1) & ~(align - 1); }
+
+//! 4 bytes per pixel, one plane
+template<typename Pixel>
+struct Packed32
+{
+    template<guint Plane>
+    using Sample                    = Pixel;
+
+    static constexpr guint  planes      = 1;
+    static constexpr gsize  alignment   = 4;
+
+    static constexpr gsize  getColumns(guint, gint width)           { return gsize(width); }
+    static constexpr gsize  getStride(guint, gint width)            { return roundUp(gsize(width) * 4, alignment); }
+    static constexpr gsize  getRows(guint, gint height)             { return gsize(height); }
+    static constexpr gsize  getOffset(guint, gint, gint)            { return 0; }
+    static constexpr gsize  getSize(gint width, gint height)        { return getStride(0, width) * getRows(0, height); }
+};
+
+//! 8 bits luma plane followed by chroma plane(s) of half width and height
+template<guint ChromaPlanes, typename Chroma>
+struct Planar420
+{
+    template<guint Plane>
+    using Sample                    = typename std::conditional<Plane == 0, guint8, Chroma>::type;
+
+    static constexpr guint  planes      = 1 + ChromaPlanes;
+    static constexpr gsize  alignment   = 4;
+
+    static constexpr gsize  getColumns(guint plane, gint width)
+    {
+        return plane == 0 ? gsize(width) : roundUp(gsize(width), 2) / 2;
+    }
+
+    static constexpr gsize  getStride(guint plane, gint width)
+    {
+        return plane == 0
+            ? roundUp(gsize(width), alignment)
+            : roundUp(roundUp(gsize(width), 2) / 2 * sizeof(Chroma), alignment);
+    }
+
+    static constexpr gsize  getRows(guint plane, gint height)
+    {
+        return plane == 0 ? gsize(height) : roundUp(gsize(height), 2) / 2;
+    }
+
+    static constexpr gsize  getOffset(guint plane, gint width, gint height)
+    {
+        return plane == 0 ? 0
+            : plane == 1 ? getStride(0, width) * roundUp(gsize(height), 2)
+            : getOffset(plane - 1, width, height) + getStride(plane - 1, width) * getRows(plane - 1, height);
+    }
+
+    static constexpr gsize  getSize(gint width, gint height)
+    {
+        return getOffset(planes - 1, width, height) + getStride(planes - 1, width) * getRows(planes - 1, height);
+    }
+};
+
+struct PixelBGRA { guint8 b, g, r, a; };   //!< Sample of BGRA frames
+struct PixelRGBA { guint8 r, g, b, a; };   //!< Sample of RGBA frames
+struct ChromaUV  { guint8 u, v; };         //!< Interleaved chroma sample of NV12 frames
+
+struct BGRA : Packed32<PixelBGRA>           { static constexpr const gchar* getName() { return "BGRA"; } };
+struct RGBA : Packed32<PixelRGBA>           { static constexpr const gchar* getName() { return "RGBA"; } };
+struct NV12 : Planar420<1, ChromaUV>        { static constexpr const gchar* getName() { return "NV12"; } };
+struct I420 : Planar420<2, guint8>          { static constexpr const gchar* getName() { return "I420"; } };
+
+}
+
+/*!
+ * @struct  FrameLayout
+ * @brief   Row stride and offset of every plane of a frame of "Format", as
+ *          the tag computes them or as a decoder padded the frame.
+ */
+template<typename Format>
+struct FrameLayout
+{
+    gsize           stride[Format::planes];     //!< Bytes in between two rows, by plane
+    gsize           offset[Format::planes];     //!< First byte of every plane within the frame
+
+    //! answers the layout of "Format" frames without padding, out of the tag
+    static FrameLayout fromFormat(gint width, gint height)
+    {
+        FrameLayout layout;
+
+        for (guint plane = 0; plane < Format::planes; ++plane)
+        {
+            layout.stride[plane] = Format::getStride(plane, width);
+            layout.offset[plane] = Format::getOffset(plane, width, height);
+        }
+
+        return layout;
+    }
+
+    //! fills "layout" out of "info", strides and offsets of "meta" win if any. Answers false if "info" is not of "Format"
+    static bool     fromVideo(const GstVideoInfo& info, const GstVideoMeta* meta, FrameLayout& layout)
+    {
+        if (GST_VIDEO_INFO_FORMAT(&info) != gst_video_format_from_string(Format::getName()) ||
+            GST_VIDEO_INFO_N_PLANES(&info) != Format::planes ||
+            (meta != nullptr && meta->n_planes != Format::planes))
+        {
+            return false;
+        }
+
+        for (guint plane = 0; plane < Format::planes; ++plane)
+        {
+            const gint stride = meta != nullptr ? meta->stride[plane] : GST_VIDEO_INFO_PLANE_STRIDE(&info, plane);
+
+            // Bottom-up frames are not walked by row
+            if (stride <= 0)
+                return false;
+
+            layout.stride[plane] = gsize(stride);
+            layout.offset[plane] = meta != nullptr ? meta->offset[plane] : GST_VIDEO_INFO_PLANE_OFFSET(&info, plane);
+        }
+
+        return true;
+    }
+};
+
+/*!
+ * @class   FrameView
+ * @brief   Typed, non-owning view of one raw frame of "Format" (a tag out of
+ *          nsvr::format). Planes and their sample types are known at compile
+ *          time, so loops over rows specialize per format. Strides and plane
+ *          offsets are the tag's unless a FrameLayout of the frame is given.
+ */
+template<typename Format>
+class FrameView
+{
+public:
+    template<guint Plane>
+    using Sample = typename Format::template Sample<Plane>;
+
+    FrameView(guchar* data, gsize size, gint width, gint height)
+        : FrameView(data, size, width, height, FrameLayout<Format>::fromFormat(width, height))
+    {}
+
+    FrameView(guchar* data, gsize size, gint width, gint height, const FrameLayout<Format>& layout)
+        : mData(data), mSize(size), mWidth(width), mHeight(height), mLayout(layout)
+    {}
+
+    //! answers true if every plane lies within the bytes of the frame
+    bool                isValid() const
+    {
+        if (mData == nullptr)
+            return false;
+
+        for (guint plane = 0; plane < Format::planes; ++plane)
+        {
+            const gsize rows = Format::getRows(plane, mHeight);
+
+            if (mLayout.offset[plane] > mSize || (rows > 0 && mLayout.stride[plane] > (mSize - mLayout.offset[plane]) / rows))
+                return false;
+        }
+
+        return true;
+    }
+
+    gint                getWidth() const        { return mWidth; }
+    gint                getHeight() const       { return mHeight; }
+    gsize               getSize() const         { return mSize; }
+    guchar*             getData() const         { return mData; }
+
+    //! answers bytes in between two rows of "Plane"
+    template<guint Plane = 0>
+    gsize               getStride() const       { static_assert(Plane < Format::planes, "No such plane"); return mLayout.stride[Plane]; }
+
+    //! answers number of rows of "Plane"
+    template<guint Plane = 0>
+    gsize               getRows() const         { static_assert(Plane < Format::planes, "No such plane"); return Format::getRows(Plane, mHeight); }
+
+    //! answers number of samples in a row of "Plane"
+    template<guint Plane = 0>
+    gsize               getColumns() const      { static_assert(Plane < Format::planes, "No such plane"); return Format::getColumns(Plane, mWidth); }
+
+    //! answers first sample of "Plane"
+    template<guint Plane = 0>
+    Sample<Plane>*      getPlane() const
+    {
+        static_assert(Plane < Format::planes, "No such plane");
+        return reinterpret_cast<Sample<Plane>*>(mData + mLayout.offset[Plane]);
+    }
+
+    //! answers first sample of row "y" of "Plane"
+    template<guint Plane = 0>
+    Sample<Plane>*      getRow(gsize y) const
+    {
+        static_assert(Plane < Format::planes, "No such plane");
+        return reinterpret_cast<Sample<Plane>*>(mData + mLayout.offset[Plane] + y * mLayout.stride[Plane]);
+    }
+
+private:
+    guchar      *mData;     //!< First byte of the frame
+    gsize       mSize;      //!< Bytes of the frame
+    gint        mWidth;     //!< Width of the frame
+    gint        mHeight;    //!< Height of the frame
+    FrameLayout<Format> mLayout;    //!< Strides and offsets of planes
+};
+
+/*!
+ * @class   TypedPlayer
+ * @brief   Player decoding to "Format", handing off frames as FrameView.
+ *          Override onVideoFrame(const FrameView<Format>&) instead of the
+ *          raw onVideoFrame(guchar*, gsize). Frames of another format are
+ *          not handed off.
+ */
+template<typename Format>
+class TypedPlayer : public Player
+{
+public:
+    //! opens a media file and auto detects its meta data, outputs "Format". Returns true on success
+    bool            open(const std::string& path) { return Player::open(path, Format::getName()); }
+
+    //! opens a media file resized to "width" x "height", outputs "Format". Returns true on success
+    bool            open(const std::string& path, gint width, gint height) { return Player::open(path, width, height, Format::getName()); }
+
+protected:
+    //! Typed video frame callback
+    virtual void    onVideoFrame(const FrameView<Format>& frame) const {}
+
+    void            onVideoFrame(guchar* buf, gsize size) const override
+    {
+        // Decoded frames may be padded, cached copies keep the layout of those decoded
+        if (mCurrentSample != nullptr)
+        {
+            GstVideoInfo info;
+
+            mLayoutKnown =
+                gst_video_info_from_caps(&info, gst_sample_get_caps(mCurrentSample)) != FALSE &&
+                FrameLayout<Format>::fromVideo(info, mCurrentBuffer ? gst_buffer_get_video_meta(mCurrentBuffer) : nullptr, mLayout);
+
+            if (!mLayoutKnown)
+                return;
+        }
+
+        const FrameView<Format> frame(buf, size, getWidth(), getHeight(),
+            mLayoutKnown ? mLayout : FrameLayout<Format>::fromFormat(getWidth(), getHeight()));
+
+        if (frame.isValid())
+            onVideoFrame(frame);
+    }
+
+private:
+    mutable FrameLayout<Format> mLayout;                //!< Layout of the frame decoded last
+    mutable bool                mLayoutKnown = false;   //!< Flag, indicating mLayout is of the frames handed off
+};
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "nsvr/nsvr_frame_source.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @class   ImageSequence
+ * @brief   Numbered still images (PNG, JPEG, anything GStreamer decodes)
+ *          played as one video. Open it and hand it to Player::open(...)
+ *          to get a seekable stream, synchronized like any other media.
+ * @details Frames are named after a printf-like pattern such as
+ *          "shot_%05d.png", numbered from 0 or 1 without gaps. Workers
+ *          decode frames ahead of the playhead in parallel, as many as fit
+ *          the memory budget. Frames behind the playhead are evicted.
+ */
+class ImageSequence : public FrameSource
+{
+public:
+    ImageSequence();
+    ~ImageSequence();
+
+    //! opens frames named after "pattern" played at "fps_num"/"fps_denom", in their own size as 32bit BGRA. Returns true on success
+    bool                open(const std::string& pattern, gint fps_num, gint fps_denom = 1);
+
+    //! opens frames named after "pattern" played at "fps_num"/"fps_denom", resized and reformatted. Returns true on success
+    bool                open(const std::string& pattern, gint fps_num, gint fps_denom, gint width, gint height, const std::string& fmt);
+
+    //! stops decoding and drops decoded frames. Frames already handed out remain valid
+    void                close();
+
+    //! answers true if a sequence is open
+    bool                isOpen() const;
+
+    //! sets number of decoding threads. Default: number of processors. Takes effect on next open()
+    void                setWorkerCount(guint count);
+
+    //! answers number of decoding threads
+    guint               getWorkerCount() const;
+
+    //! sets bytes of decoded frames kept ahead of the playhead. Default: 256 MiB
+    void                setMemoryBudget(gsize bytes);
+
+    //! answers bytes of decoded frames kept ahead of the playhead
+    gsize               getMemoryBudget() const;
+
+    //! answers number in the file name of the first frame
+    guint64             getFirstNumber() const;
+
+    virtual gint                getWidth() const override;
+    virtual gint                getHeight() const override;
+    virtual const std::string&  getFormat() const override;
+    virtual gint                getFrameRateNum() const override;
+    virtual gint                getFrameRateDenom() const override;
+    virtual guint64             getFrameCount() const override;
+    virtual GstBuffer*          getFrame(guint64 index) override;
+    virtual void                prefetch(guint64 index) override;
+
+private:
+    struct Decoder;
+
+    //! answers file name of frame at "index"
+    std::string         getPath(guint64 index) const;
+
+    //! queues frames of the window starting at "index" for decoding. mMutex must be held
+    void                schedule(guint64 index);
+
+    //! decoding loop of one worker thread
+    void                work(Decoder& decoder);
+
+    ImageSequence(const ImageSequence&) = delete;
+    ImageSequence& operator=(const ImageSequence&) = delete;
+
+    std::string                 mPattern;       //!< printf-like pattern of file names
+    std::string                 mFormat;        //!< Raw video format of frames
+    gint                        mWidth;         //!< Width of frames
+    gint                        mHeight;        //!< Height of frames
+    gint                        mFrameRateNum;  //!< Numerator of frame rate
+    gint                        mFrameRateDenom;//!< Denominator of frame rate
+    guint64                     mFirstNumber;   //!< Number in the file name of frame 0
+    guint64                     mFrameCount;    //!< Number of frames in the sequence
+    guint64                     mWindow;        //!< Number of frames decoded ahead of the playhead
+    guint                       mWorkerCount;   //!< Number of decoding threads
+    gsize                       mMemoryBudget;  //!< Bytes of decoded frames kept ahead of the playhead
+
+    mutable std::mutex          mMutex;         //!< Guards everything below
+    std::condition_variable     mWork;          //!< Notified when frames are queued or workers should stop
+    std::condition_variable     mDone;          //!< Notified when a frame is decoded (or failed to)
+    std::map<guint64, GstBuffer*> mFrames;      //!< Decoded frames by index
+    std::set<guint64>           mPending;       //!< Frames queued or being decoded
+    std::set<guint64>           mFailed;        //!< Frames which could not be decoded
+    std::deque<guint64>         mQueue;         //!< Frames waiting for a worker, nearest first
+    guint64                     mPlayhead;      //!< Index the window starts at
+    guint64                     mScheduledEnd;  //!< Index past the last frame scheduled, 0 if none
+    bool                        mStopping;      //!< Flag, telling workers to quit
+    std::vector<std::thread>    mWorkers;       //!< Decoding threads
+    std::vector<std::unique_ptr<Decoder>> mDecoders; //!< Pipeline of each worker
+};
+
+}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "nsvr/nsvr_cue_scheduler.hpp"
+
 #include <gst/gst.h>
 #include <string>
+#include <vector>
 
 namespace nsvr
 {
@@ -15,11 +18,25 @@ struct Packet
     GstClockTime    base    = GST_CLOCK_TIME_NONE;
 };
 
+struct CuePacket
+{
+    guint64             version = 0;
+    guint               index   = 0;    //!< Chunk of the version this packet carries
+    guint               total   = 1;    //!< Chunks the version is split into
+    std::vector<Cue>    cues;
+};
+
 class PacketHandler
 {
 public:
     static bool parse(const std::string& buffer, Packet& packet);
     static std::string serialize(const Packet& packet);
+
+    static bool parse(const std::string& buffer, CuePacket& packet);
+    static std::string serialize(const CuePacket& packet);
+
+    //! serializes cues of "packet" into chunks small enough for a datagram, every chunk tagged with its index and their total
+    static std::vector<std::string> serializeChunks(const CuePacket& packet);
 };
 
 }
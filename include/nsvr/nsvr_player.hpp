@@ -1,20 +1,119 @@
 #pragma once
 
+#include "nsvr/nsvr_command_queue.hpp"
+#include "nsvr/nsvr_cue_scheduler.hpp"
+#include "nsvr/nsvr_frame_change.hpp"
+#include "nsvr/nsvr_frame_pool.hpp"
+#include "nsvr/nsvr_qos_controller.hpp"
+#include "nsvr/nsvr_read_ahead.hpp"
+#include "nsvr/nsvr_task_pool.hpp"
+#include "nsvr/nsvr_wakeup.hpp"
+
 #include <gst/gst.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace nsvr
 {
 
+class Discoverer;
+class FrameCache;
+class FrameSource;
+class SharedDecode;
+
+/*!
+ * @struct  PresentationStats
+ * @brief   Outcome of Player::updateAt(...) calls since open().
+ */
+struct PresentationStats
+{
+    guint64         presented   = 0;        //!< Frames handed off to onVideoFrame(...)
+    guint64         repeated    = 0;        //!< Calls handing off no new frame, previous one stays on display
+    guint64         early       = 0;        //!< Calls where the next queued frame was not due yet
+    guint64         late        = 0;        //!< Frames handed off after their presentation window ended
+    guint64         dropped     = 0;        //!< Frames never handed off, superseded or queue overflown
+};
+
+/*!
+ * @struct  LatencyStats
+ * @brief   Latency of live media since open(), in seconds. Frames are timed
+ *          from capture (their timestamp on the pipeline clock) to hand off,
+ *          glass to glass if sender and receiver share the clock.
+ */
+struct LatencyStats
+{
+    gdouble         pipeline    = 0.;       //!< Latency the pipeline compensates for (sources, jitter buffers, sinks)
+    gdouble         last        = 0.;       //!< Capture to hand off of the last frame
+    gdouble         average     = 0.;       //!< Capture to hand off, averaged over all frames
+    gdouble         maximum     = 0.;       //!< Capture to hand off of the worst frame
+    guint64         frames      = 0;        //!< Frames measured
+};
+
+/*!
+ * @enum    AudioSlaveMethod
+ * @brief   How audio sinks follow a pipeline clock other than their own
+ *          (a network clock), see GstAudioBaseSinkSlaveMethod.
+ */
+enum class AudioSlaveMethod
+{
+    RESAMPLE    = 0,                        //!< Resamples to the rate of the pipeline clock, never skips
+    SKEW        = 1,                        //!< Skips or repeats samples once drift exceeds a tolerance (sink default)
+    NONE        = 2                         //!< Drifts freely
+};
+
+/*!
+ * @enum    SeekResult
+ * @brief   Outcome of a seek, by the ticket setTime() recorded for it.
+ */
+enum class SeekResult
+{
+    PENDING     = 0,                        //!< Not finished yet
+    DONE        = 1,                        //!< Finished, or replaced by a later seek that finished
+    FAILED      = 2                         //!< Not issued (live media, media not pre-rolled, closed) or refused by the pipeline
+};
+
+/*!
+ * @struct  AudioSinkSettings
+ * @brief   Settings applied to the audio sink of media opened, times of 0
+ *          keep the sink's own defaults (200ms and 10ms for most).
+ */
+struct AudioSinkSettings
+{
+    gdouble             bufferTime  = 0.;                           //!< Seconds held by the ring buffer of the sink
+    gdouble             latencyTime = 0.;                           //!< Seconds of one segment of the ring buffer
+    AudioSlaveMethod    slaveMethod = AudioSlaveMethod::SKEW;       //!< How the sink follows a foreign clock
+};
+
+/*!
+ * @struct  AudioDriftStats
+ * @brief   Audio sink clock against the pipeline clock (the network clock of
+ *          a PlayerClient), measured once a second while playing. Empty if
+ *          the audio sink clocks the pipeline itself.
+ */
+struct AudioDriftStats
+{
+    gdouble         drift       = 0.;       //!< Rate of the audio device against the pipeline clock, in parts per million
+    gdouble         offset      = 0.;       //!< Seconds the audio clock is ahead of the pipeline clock (negative if behind)
+    gdouble         maximum     = 0.;       //!< Largest offset in either direction so far
+    guint64         samples     = 0;        //!< Measurements taken
+};
+
 /*!
  * @class   Player
  * @brief   Media player class. Designed to play audio through system's
  *          default audio output (speakers) and hand of video frames to
  *          the user of the library.
  * @note    API of this class is not MT safe. Designed to be exclusively
- *          used in one thread and embedded in other game engines.
+ *          used in one thread and embedded in other game engines. Other
+ *          threads can post(...) calls, executed within the next update().
  * @details To obtain video frames, you need to subclass and override
  *          onVideoFrame(...) method. Same goes for receiving events. To get
  *          event callbacks, on[name of function] should be overridden.
@@ -36,6 +135,12 @@ public:
     //! opens a media file and auto detects its meta data and outputs 32bit BGRA. Returns true on success
     bool            open(const std::string& path);
 
+    //! opens an already discovered media. If "wait" is false, returns before pre-roll is done (reaching PAUSED)
+    bool            open(const Discoverer& discoverer, gint width, gint height, const std::string& fmt, bool wait = true);
+
+    //! opens a source of decoded frames (e.g. a FrameStore). No decoder runs. Returns true on success
+    bool            open(std::shared_ptr<FrameSource> source);
+
     //! closes the current media file and its associated resources (no op if no media)
     void            close();
 
@@ -54,6 +159,54 @@ public:
     //! update loop logic, MUST be called often in your engine's update loop
     void            update();
 
+    //! update() bound to "budget" seconds: frame hand off first, then bus and network work until
+    //! the budget is spent, rest is deferred to the next call. Answers seconds overrun (0 if none)
+    gdouble         update(gdouble budget);
+
+    //! update() for display locked output: hands off the queued frame whose presentation window
+    //! covers "display_time", the predicted scan-out time in pipeline clock terms. See setDisplayQueue()
+    void            updateAt(GstClockTime display_time);
+
+    //! queues up to "depth" frames delivered "lookahead" seconds ahead for updateAt() (0 disables). Takes effect on next open()
+    void            setDisplayQueue(guint depth, gdouble lookahead);
+
+    //! answers how many frames are queued for updateAt() at most (0 if disabled)
+    guint           getDisplayQueueDepth() const;
+
+    //! answers outcome of updateAt() calls since open()
+    const PresentationStats& getPresentationStats() const;
+
+    //! answers a descriptor readable while a frame, a bus message or a posted call waits for update()
+    GPollFD         getPollFd() const;
+
+    //! blocks until a frame is ready to be handed off or "timeout" seconds pass (negative waits forever).
+    //! Answers true if a frame is ready. Frames served from the cache are always ready
+    bool            waitForFrame(gdouble timeout);
+
+    //! posts a call to be executed at the start of next update(). MT safe, callable from any thread
+    void            post(PlayerCommand::Type type, gdouble value = 0.);
+
+    //! executes calls posted so far, latest seek and volume win. Called by update()
+    void            drainCommands();
+
+    //! answers how long (seconds) the last executed posted call waited for execution
+    gdouble         getCommandLatency() const;
+
+    //! runs "task" at the end of every update() until it answers true (see nsvr_player_async.hpp)
+    void            schedule(std::function<bool()> task);
+
+    //! answers how many seek operations finished so far (times onSeekFinished() was called)
+    guint           getSeekCount() const;
+
+    //! answers the ticket of the latest setTime(), shared by seeks replacing one still pending
+    guint           getSeekTicket() const;
+
+    //! answers the outcome of the seek of "ticket"
+    SeekResult      getSeekResult(guint ticket) const;
+
+    //! answers true while tasks scheduled with schedule() are not done
+    bool            hasScheduledTasks() const;
+
     //! answers duration of the media file. Valid after call to open()
     gdouble         getDuration() const;
 
@@ -96,6 +249,160 @@ public:
     //! answers height of the video, 0 if audio is being played. Valid after open()
     gint            getHeight() const;
 
+    //! caches decoded frames of looping video up to "budget" bytes (0 disables). Takes effect on next open()
+    void            setFrameCacheBudget(gsize budget);
+
+    //! answers the frame cache budget in bytes (0 if disabled)
+    gsize           getFrameCacheBudget() const;
+
+    //! answers true while looped playback is served from the frame cache with the decoder shut down. Pausing keeps serving it
+    bool            getServingFromCache() const;
+
+    //! sets if videos opened next share one decode with other Players of the process opening the same URI, unless options of their own are set
+    void            setDecodeSharing(bool on);
+
+    //! answers true if videos opened next share their decode (see SharedDecode)
+    bool            getDecodeSharing() const;
+
+    //! crops pixels off the decoded video before it is scaled. Takes effect on next open() of a shared decode
+    void            setCrop(gint left, gint top, gint right, gint bottom);
+
+    //! lets the player degrade down to "max_level" under sustained overload (QOS_NONE disables, default).
+    //! @note levels past QOS_HALF_RESOLUTION flush the pipeline, which network synchronized players should avoid
+    void            setQosControl(QosLevel max_level);
+
+    //! answers the current degradation level of the player
+    QosLevel        getQosLevel() const;
+
+    //! sets if media opened next runs offline: unsynchronized, as fast as decoding allows, every frame
+    //! handed off in order as the streaming thread waits for update() to consume it. Takes effect on next open()
+    //! @note audio is discarded, display queue, QoS controller and decode sharing are not used offline
+    void            setOffline(bool on);
+
+    //! answers true if media opened next runs offline
+    bool            getOffline() const;
+
+    //! answers index of the frame being handed off (from its timestamp and the frame rate), ONLY valid inside onVideoFrame(...)
+    guint64         getFrameIndex() const;
+
+    //! answers tiles of the frame being handed off changed since the one handed off before, ONLY valid inside onVideoFrame(...).
+    //! Whole frame if change detection is disabled or the frame is served from the cache
+    const FrameChange& getFrameChange() const;
+
+    //! answers frames decoded per second, averaged from the first frame since open()
+    gdouble         getDecodeRate() const;
+
+    //! recycles up to "slots" decoded frames out of a hugepage-backed, NUMA-local arena (0 disables).
+    //! The arena is bound to the NUMA node of the thread calling open(). Takes effect on next open()
+    void            setFramePool(guint slots);
+
+    //! answers how many frames the frame pool recycles (0 if disabled)
+    guint           getFramePool() const;
+
+    //! answers outcome of the frame pool of the opened media (empty if none)
+    FramePoolStats  getFramePoolStats() const;
+
+    //! hashes frames in "tile_size" pixels tiles as they are decoded to tell what changed (0 disables), see getFrameChange().
+    //! If "skip_unchanged", frames equal to the one before are not handed off. Takes effect on next open()
+    //! @note offline every frame is handed off, unchanged or not
+    void            setChangeDetection(guint tile_size, bool skip_unchanged = false);
+
+    //! answers side of tiles hashed by change detection (0 if disabled)
+    guint           getChangeDetection() const;
+
+    //! answers true if unchanged frames are not handed off
+    bool            getSkipUnchanged() const;
+
+    //! answers outcome of change detection of the opened media (empty if none)
+    FrameChangeStats getFrameChangeStats() const;
+
+    //! sets if media opened next is a live source (udp://, rtsp://, capture devices): opened without discovery
+    //! nor pre-roll, sources and jitter buffers hold "latency" seconds at most. Takes effect on next open()
+    //! @note live media cannot be seeked, display queue, frame cache, QoS trick modes and decode sharing are not used live
+    void            setLive(bool on, gdouble latency = 0.1);
+
+    //! answers true if media opened next is a live source
+    bool            getLive() const;
+
+    //! answers seconds of latency live media is opened with
+    gdouble         getLiveLatency() const;
+
+    //! answers latency of the opened live media (empty if not live)
+    const LatencyStats& getLatencyStats() const;
+
+    //! sets if network media opened next is downloaded into an on-disk ring of "ring_size" bytes,
+    //! rather than buffered in memory. Takes effect on next open()
+    void            setDownload(bool on, guint64 ring_size = 64 * 1024 * 1024);
+
+    //! answers true if network media opened next is downloaded
+    bool            getDownload() const;
+
+    //! answers buffering level of network media between [ 0 , 100 ], 100 if buffered enough (or not buffered)
+    gint            getBufferingPercent() const;
+
+    //! answers true while playback is held until enough network media is buffered
+    bool            getBuffering() const;
+
+    //! reads local media opened next on a thread prefetching "window" bytes ahead of the demuxer (0 disables).
+    //! Seek targets are prefetched before seeking. Takes effect on next open()
+    void            setReadAhead(gsize window);
+
+    //! answers bytes prefetched ahead of the demuxer (0 if disabled)
+    gsize           getReadAhead() const;
+
+    //! answers outcome of read-ahead of the opened media (empty if none)
+    ReadAheadStats  getReadAheadStats() const;
+
+    //! reads local media opened next through io_uring, keeping "depth" aligned reads in flight (0 disables).
+    //! "direct" bypasses the page cache (O_DIRECT). Takes precedence over setReadAhead() where io_uring is
+    //! available (Linux 5.1+). Takes effect on next open()
+    void            setIoUring(guint depth, bool direct = false);
+
+    //! answers io_uring reads kept in flight (0 if disabled)
+    guint           getIoUring() const;
+
+    //! sets buffer and latency times and slave method of the audio sink of media opened next.
+    //! GStreamer 1.10+, takes effect on next open()
+    void            setAudioSink(const AudioSinkSettings& settings);
+
+    //! answers settings of the audio sink of media opened next
+    const AudioSinkSettings& getAudioSink() const;
+
+    //! answers drift of the audio sink of the opened media against the pipeline clock
+    const AudioDriftStats& getAudioDriftStats() const;
+
+    //! runs streaming threads of media opened next on "pool", shared with other Players (nullptr for GStreamer's own).
+    //! Takes effect on next open()
+    void            setTaskPool(const std::shared_ptr<TaskPool>& pool);
+
+    //! answers pool streaming threads of media opened next run on, nullptr if GStreamer's own
+    const std::shared_ptr<TaskPool>& getTaskPool() const;
+
+    //! fires onCue(...) the moment media time "time" (seconds) is displayed, timed on the pipeline (or network) clock.
+    //! Replaces the cue of the same "id". Cues are kept across open() and fire on every pass over their time
+    bool            addCue(gdouble time, const std::string& id);
+
+    //! removes the cue of "id". Answers false if there is none
+    bool            removeCue(const std::string& id);
+
+    //! replaces every cue with "cues"
+    void            setCues(const std::vector<Cue>& cues);
+
+    //! removes every cue
+    void            clearCues();
+
+    //! answers cues ordered by time
+    std::vector<Cue> getCues() const;
+
+    //! sets seconds cues fire ahead of their frame, making up for latency of the display (or of the devices cued)
+    void            setCueOffset(gdouble offset);
+
+    //! answers seconds cues fire ahead of their frame
+    gdouble         getCueOffset() const;
+
+    //! answers lateness of cues fired so far, measured on the clock they were scheduled on
+    CueStats        getCueStats() const;
+
 protected:
     //! Video frame callback, video buffer data and its size are passed in
     virtual void    onVideoFrame(guchar* buf, gsize size) const {}
@@ -109,12 +416,21 @@ protected:
     //! Called by whenever pipeline clock needs to be (re)constructed
     virtual void    setupClock() {}
 
+    //! answers true if setupClock() replaces the pipeline clock, such players do not share their decode
+    virtual bool    getOwnsClock() const { return false; }
+
     //! Called when seeking operation is finished
     virtual void    onSeekFinished() {}
 
     //! Called before open() is called
     virtual void    onBeforeOpen() {}
 
+    //! Prefetches media around "time" if read ahead, called before seeking there
+    void            warmSeekTarget(gdouble time);
+
+    //! Called when buffering level of network media changes, see getBufferingPercent()
+    virtual void    onBuffering(gint percent) {}
+
     //! Called before close() is called
     virtual void    onBeforeClose() {}
 
@@ -124,22 +440,160 @@ protected:
     //! Called before setState() is called. target state is passed in.
     virtual void    onBeforeSetState(GstState state) {}
 
+    //! Called when quality is degraded or recovered. Old level and cause passed in, obtain new level with getQosLevel()
+    virtual void    onQosLevelChanged(QosLevel old, const std::string& reason) {}
+
+    //! Called on the clock thread the moment a cue is due, keep it short. MT: may run alongside update()
+    virtual void    onCue(const CueEvent& event) {}
+
+    //! Called when cues are added, removed or replaced
+    virtual void    onCuesChanged() {}
+
+    //! answers a number changed by every change of cues
+    guint64         getCueVersion() const;
+
+    //! Stops serving frames from the cache and hands playback back to the pipeline (left in READY)
+    void            leaveFrameCache();
+
+    //! Set around flushing seeks and state changes to READY or below: the held frame is dropped and offline hand off does not wait
+    void            setHandoffFlushing(bool on);
+
+    //! answers the ticket of a seek about to be issued, the pending seek's if there is one
+    guint           issueSeekTicket();
+
+    //! records the seek of "ticket" finished or failed, earlier seeks pending are replaced by it
+    void            resolveSeekTicket(guint ticket, bool succeeded);
+
+    //! Restarts or drops the pass of the frame cache being recorded after a seek to "time"
+    void            seekFrameCache(gdouble time);
+
+    //! Answers true if the current update() has not spent its budget yet
+    bool            hasTimeLeft() const;
+
+    //! Answers monotonic time (microseconds) the current update() should be done by
+    gint64          getUpdateDeadline() const;
+
 private:
     //! Resets internal state of the Player (does not free any memories!)
     void            reset();
 
+    //! Opens an already discovered media through a decode shared with other Players
+    bool            openShared(const Discoverer& discoverer, gint width, gint height, const std::string& fmt, bool wait);
+
+    //! Hands samples of "app_sink" over to this Player
+    void            setupAppSink(GstElement* app_sink);
+
+    //! Answers properties of the appsink handing frames off, depending on offline mode
+    std::string     getAppSinkProperties() const;
+
+    //! Hooks up "app_sink" (nullptr if no video) to a freshly launched pipeline and pre-rolls it (waits for it if "wait")
+    bool            launch(GstElement* app_sink, bool wait = true);
+
+    //! Called by GStreamer on the posting thread for every bus message
+    static GstBusSyncReply onBusMessage(GstBus* bus, GstMessage* msg, Player* player);
+
+    //! Wakes up waitForFrame() and pollers of getPollFd() once a frame is ready
+    void notifyFrame();
+
+    //! Takes over "bus" of the pipeline, signaling the wakeup descriptor on every message
+    void watchBus(GstBus* bus);
+
     //! Called by GStreamer on streaming thread when a rolled sample is ready
     static GstFlowReturn onPreroll(GstElement* appsink, Player* player);
 
     //! Called by GStreamer on streaming thread when a new sample is ready
     static GstFlowReturn onSample(GstElement* appsink, Player* player);
 
+    //! Called by GStreamer on streaming thread when the frame source should push a frame
+    static void onNeedData(GstElement* appsrc, guint length, Player* player);
+
+    //! Called by GStreamer when the frame source is seeked to "offset" (stream time)
+    static gboolean onSeekData(GstElement* appsrc, guint64 offset, Player* player);
+
+    //! Called by GStreamer on streaming thread for every event leaving the frame source
+    static GstPadProbeReturn onSourceEvent(GstPad* pad, GstPadProbeInfo* info, Player* player);
+
     //! Called inside onPreroll() or onSample() to consume the new video frame
     void processSample(GstSample* const sample);
 
+    //! Called by processSample() to tell what changed in "sample". Answers false if it is not handed off, being unchanged
+    bool detectChange(GstSample* sample, FrameChange& change);
+
+    //! Called within update() to arm cues on the clock frames are displayed by
+    void processCues();
+
     //! Called within update() to query media duration when it is possible
     void queryDuration();
 
+    //! answers why media of "discoverer" cannot share its decode, nullptr if it can
+    const char* getSharingConflict(const Discoverer& discoverer) const;
+
+    //! Called on EOS of a looping media to start serving frames from the cache
+    bool enterFrameCache();
+
+    //! Called within update() to hand off the cached frame due on the pipeline clock
+    void processCachedFrame();
+
+    //! answers position within the cached loop, the one paused at while paused
+    GstClockTime getCachePosition() const;
+
+    //! Pauses or resumes serving the cached loop where it is, the decoder stays shut down
+    void setCachePaused(bool paused);
+
+    //! Called at the end of update() to run scheduled tasks
+    void processTasks();
+
+    //! Called within update() to hand off the latest video frame
+    void processFrame();
+
+    //! Called within update() to pop bus messages until the budget is spent
+    void processBus();
+
+    //! Called within update() for every message popped from the bus
+    void processMessage(GstMessage* msg);
+
+    //! Called at the end of update() to feed the QoS controller and apply its decisions
+    void processQos(bool overrun);
+
+    //! Applies the current QoS level to the pipeline, "old" being the level applied so far
+    void applyQosLevel(QosLevel old);
+
+    //! Answers seek flags needed by the current QoS level
+    GstSeekFlags getQosSeekFlags() const;
+
+    //! Called within update() by followers of a shared decode to follow the state of its pipeline
+    void mirrorState();
+
+    //! Called within updateAt() to pick the queued frame due at "display_time" and hand it off
+    void processQueuedFrame(GstClockTime display_time);
+
+    //! Releases every frame queued for updateAt()
+    void flushDisplayQueue();
+
+    //! Opens "path" as a live source, skipping discovery and pre-roll
+    bool openLive(const std::string& path, gint width, gint height, const std::string& fmt);
+
+    //! Called by playbin for sources and (GStreamer 1.10+) every element it adds, bounds their latency
+    static void onLiveElement(GstBin* bin, GstBin* sub_bin, GstElement* element, Player* player);
+
+    //! Called within update() to recompute and record latency of a live pipeline
+    void processLatency();
+
+    //! Called within update() to time the frame about to be handed off, from capture on
+    void measureLatency();
+
+    //! Called within update() for every buffering message, holds or resumes playback
+    void processBuffering(GstMessage* msg);
+
+    //! Called by playbin when it created its source, keeps it if it reads ahead
+    static void onSourceSetup(GstElement* bin, GstElement* source, Player* player);
+
+    //! Called by playbin (GStreamer 1.10+) for every element it adds, configures and keeps audio sinks
+    static void onAudioElement(GstBin* bin, GstBin* sub_bin, GstElement* element, Player* player);
+
+    //! Called within update() to compare the audio sink clock against the pipeline clock, once a second
+    void measureAudioDrift();
+
 protected:
     GstState        mState;                 //!< Current state of the player (playing, paused, etc.)
     GstMapInfo      mCurrentMapInfo;        //!< Mapped Buffer info, ONLY valid inside onVideoFrame(...)
@@ -149,6 +603,8 @@ protected:
     GstBus          *mGstBus;               //!< Bus associated with mPipeline
     mutable gdouble mPendingSeek;           //!< Value of the seek operation pending to be executed
     mutable bool    mSeekingLock;           //!< Boolean flag, indicating a seek operation is pending to be executed
+    guint           mPendingSeekTicket  = 0;//!< Ticket of the seek pending, 0 if none
+    guint           mSeekInFlight       = 0;//!< Ticket of the seek the next ASYNC_DONE finishes, 0 if none
 
 private:
     mutable gint    mWidth      = 0;        //!< Width of the video being played. Valid after a call to open(...)
@@ -160,6 +616,110 @@ private:
     std::atomic<bool>   mBufferDirty;       //!< Atomic boolean, representing a new frame is ready by GStreamer
     bool                mLoop   = false;    //!< Flag, indicating whether the player is looping or not
     bool                mMute   = false;    //!< Flag, indicating whether the player is muted or not
+
+    std::unique_ptr<FrameCache> mFrameCache;        //!< Cache of decoded frames, only present if enabled and cache-able
+    gsize           mFrameCacheBudget   = 0;        //!< Memory budget of the frame cache in bytes, 0 if disabled
+    GstClock        *mCacheClock        = nullptr;  //!< Pipeline clock held while frames are served from the cache
+    GstClockTime    mCacheEpoch         = 0;        //!< Clock time at which the first cached loop started
+    gint            mCacheIndex         = -1;       //!< Index of the cached frame handed off last
+    GstClockTime    mCachePausedAt      = GST_CLOCK_TIME_NONE; //!< Position within the cached loop paused at, NONE while playing
+
+    CommandQueue    mCommands;                      //!< Calls posted by other threads, drained by update()
+    gdouble         mCommandLatency     = 0.;       //!< Time the last executed posted call waited in mCommands
+
+    std::shared_ptr<FrameSource> mFrameSource;      //!< Source of decoded frames, only present if opened with one
+    std::atomic<guint64> mFrameSourceIndex;         //!< Index of the next frame to push from mFrameSource
+
+    std::vector<std::function<bool()>> mTasks;      //!< Tasks scheduled to run within update() until done
+    guint           mSeekCount          = 0;        //!< Number of seek operations finished so far
+    guint           mSeekTicket         = 0;        //!< Ticket of the latest seek
+    guint           mSeekResolved       = 0;        //!< Latest ticket finished or failed, earlier ones are too
+    guint           mSeekFailed         = 0;        //!< Latest ticket failed, 0 if none
+    gint64          mUpdateDeadline     = G_MAXINT64;//!< Monotonic time the current update() should be done by
+
+    struct QueuedFrame
+    {
+        GstSample       *sample;                    //!< Decoded frame
+        GstClockTime    begin;                      //!< Running time its presentation window starts at
+        GstClockTime    end;                        //!< Running time its presentation window ends at (NONE if open)
+        FrameChange     change;                     //!< Tiles changed since the frame queued before
+    };
+
+    std::deque<QueuedFrame> mDisplayQueue;          //!< Frames waiting for updateAt(), oldest first
+    std::mutex      mDisplayMutex;                  //!< Guards mDisplayQueue against the streaming thread
+    std::atomic<guint64> mDisplayOverflow;          //!< Frames dropped by the streaming thread on a full queue
+    guint           mDisplayQueueDepth  = 0;        //!< Maximum number of queued frames, 0 if disabled
+    gdouble         mDisplayLookahead   = 0.;       //!< Seconds frames are delivered ahead of their time
+    PresentationStats mPresentationStats;           //!< Outcome of updateAt() calls since open()
+
+    std::shared_ptr<SharedDecode> mSharedDecode;    //!< Decode shared with other Players, only present if opened shared
+    bool            mDecodeSharing      = false;    //!< Flag, indicating whether next open() shares its decode
+    gint            mCropLeft           = 0;        //!< Pixels cropped off the left of a shared decode
+    gint            mCropTop            = 0;        //!< Pixels cropped off the top of a shared decode
+    gint            mCropRight          = 0;        //!< Pixels cropped off the right of a shared decode
+    gint            mCropBottom         = 0;        //!< Pixels cropped off the bottom of a shared decode
+
+    QosController   mQos;                           //!< Decides when to degrade or recover quality
+    std::atomic<guint64> mQosFrames;                //!< Frames handed off by the streaming thread since last update()
+    std::atomic<guint64> mQosDrops;                 //!< Frames dropped since last update()
+    std::map<std::string, guint64> mQosDropped;     //!< Frames dropped so far by the video sink and decoder, as their QoS messages report, by element name
+    GstElement      *mAppSink           = nullptr;  //!< Sink handing frames off to this Player, nullptr if no video
+    GstCaps         *mQosCaps           = nullptr;  //!< Caps mAppSink was opened with, restored on recovery
+    bool            mQosSeeking         = false;    //!< Flag, indicating a seek of the QoS controller is in flight
+
+    Wakeup          mWakeup;                        //!< Signaled when a frame, a bus message or a posted call is pending
+    std::mutex      mWaitMutex;                     //!< Guards waiting in waitForFrame()
+    std::condition_variable mWaitCondition;         //!< Notified by the streaming thread once a frame is ready
+
+    bool            mOffline            = false;    //!< Flag, indicating whether next open() runs offline
+    bool            mRunOffline         = false;    //!< Flag, indicating the opened media runs offline
+    std::condition_variable mHandoffCondition;      //!< Notified once an offline frame is consumed or released
+    bool            mHandoffFlushing    = false;    //!< Flag, indicating a flushing seek or state change is under way, guarded by mWaitMutex
+    guint64         mFrameIndex         = 0;        //!< Index of the frame held for hand off
+    std::atomic<guint64> mDecodedFrames;            //!< Frames reaching the appsink since open()
+    std::atomic<gint64> mDecodeStart;               //!< Monotonic time the first frame since open() was decoded at
+    std::atomic<gint64> mDecodeLast;                //!< Monotonic time the last frame was decoded at
+
+    std::unique_ptr<FramePool> mFramePool;          //!< Answers allocation queries of mAppSink, only present if enabled
+    guint           mFramePoolSlots     = 0;        //!< Frames recycled by the frame pool, 0 if disabled
+
+    std::unique_ptr<FrameChangeDetector> mChangeDetector;//!< Hashes frames on the streaming thread, only present if enabled
+    guint           mChangeTileSize     = 0;        //!< Side of tiles hashed, 0 if change detection is disabled
+    bool            mChangeSkip         = false;    //!< Flag, indicating unchanged frames are not handed off
+    FrameChange     mFrameChange;                   //!< Tiles changed in the frame held for hand off
+    std::atomic<guint64> mChangeSkipped;            //!< Unchanged frames never handed off since open()
+
+    CueScheduler    mCues;                          //!< Cues fired on the clock thread through onCue(...)
+    GstSegment      mCueSegment;                    //!< Segment of the last frame decoded, maps cue times to running time
+    GstClockTime    mLastFrameEnd;                  //!< Running time the last frame decoded ends at, NONE if not known
+    std::mutex      mCueMutex;                      //!< Guards mCueSegment and mLastFrameEnd against the streaming thread
+
+    bool            mLive               = false;    //!< Flag, indicating whether next open() is a live source
+    gdouble         mLiveLatency        = 0.1;      //!< Seconds of latency live media is opened with
+    bool            mRunLive            = false;    //!< Flag, indicating the opened media is live (opened so, or not pre-rolling)
+    LatencyStats    mLatencyStats;                  //!< Latency of the opened live media
+
+    bool            mDownload           = false;    //!< Flag, indicating whether network media opened next is downloaded
+    guint64         mDownloadRing       = 0;        //!< Bytes of the on-disk ring network media is downloaded into
+    gint            mBufferingPercent   = 100;      //!< Buffering level last reported by the pipeline
+    bool            mBuffering          = false;    //!< Flag, indicating playback is held for buffering
+    bool            mBufferingResume    = false;    //!< Flag, indicating playback resumes once buffering is done
+
+    gsize           mReadAheadWindow    = 0;        //!< Bytes local media opened next is prefetched ahead, 0 if disabled
+    GstElement      *mFileSource        = nullptr;  //!< Source of playbin reading ahead, nullptr if none
+    guint           mIoUringDepth       = 0;        //!< io_uring reads in flight for local media opened next, 0 if disabled
+    bool            mIoUringDirect      = false;    //!< Flag, indicating io_uring reads bypass the page cache
+
+    AudioSinkSettings mAudioSinkSettings;           //!< Settings of the audio sink of media opened next
+    GstElement      *mAudioSink         = nullptr;  //!< Audio sink of the opened media, nullptr if none (yet)
+    std::mutex      mAudioMutex;                    //!< Guards mAudioSink against the thread adding elements
+    AudioDriftStats mAudioDriftStats;               //!< Drift of the audio sink of the opened media
+    gint64          mAudioDriftNext     = 0;        //!< Monotonic time drift is measured next
+    GstClockTime    mAudioDriftInternal = GST_CLOCK_TIME_NONE;//!< Internal time of the audio clock last measured
+    GstClockTime    mAudioDriftMaster   = GST_CLOCK_TIME_NONE;//!< Pipeline clock time last measured
+
+    std::shared_ptr<TaskPool> mTaskPool;            //!< Pool streaming threads of media opened next run on, nullptr if none
+    std::shared_ptr<TaskPool> mBusTaskPool;         //!< Pool of the watched bus, read by its sync handler
 };
 
 }
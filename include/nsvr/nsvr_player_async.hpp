@@ -0,0 +1,307 @@
+#pragma once
+
+/*!
+ * Optional C++20 coroutine layer on top of Player. The library itself is
+ * C++11, include this header only from code built with coroutine support.
+ *
+ *     nsvr::Task run(nsvr::Player& player)
+ *     {
+ *         if (!co_await nsvr::openAsync(player, "video.mp4"))
+ *             co_return;
+ *
+ *         co_await nsvr::seek(player, 5.);
+ *         player.play();
+ *         co_await nsvr::waitState(player, GST_STATE_PLAYING);
+ *     }
+ *
+ * Awaiting coroutines are resumed within Player::update(), on the thread
+ * driving it. attach() lets a GMainContext drive update() instead, woken
+ * by the player's own descriptor.
+ */
+
+#if !defined(__cpp_impl_coroutine)
+#   error "nsvr_player_async.hpp requires a compiler with C++20 coroutines enabled."
+#endif
+
+#include "nsvr/nsvr_player.hpp"
+#include "nsvr/nsvr_discoverer.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  Task
+ * @brief   Fire and forget coroutine type. Starts eagerly and frees itself
+ *          once done. Exceptions escaping the coroutine terminate.
+ */
+struct Task
+{
+    struct promise_type
+    {
+        Task                get_return_object() { return {}; }
+        std::suspend_never  initial_suspend() noexcept { return {}; }
+        std::suspend_never  final_suspend() noexcept { return {}; }
+        void                return_void() {}
+        void                unhandled_exception() { std::terminate(); }
+    };
+};
+
+/*!
+ * @struct  OpenAwaiter
+ * @brief   Discovers a media on a worker thread, then opens it without
+ *          blocking and resumes once it is pre-rolled. Yields true on success.
+ */
+struct OpenAwaiter
+{
+    struct State
+    {
+        Discoverer          discoverer;
+        std::thread         worker;
+        std::atomic<bool>   discovered{ false };
+        bool                found   = false;
+        bool                result  = false;
+        gint64              started = 0;
+
+        ~State() { if (worker.joinable()) worker.join(); }
+    };
+
+    Player                  &player;
+    std::string             path;
+    gint                    width;
+    gint                    height;
+    std::string             fmt;
+    gdouble                 timeout;
+    std::shared_ptr<State>  state;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        state = std::make_shared<State>();
+
+        auto st = state;
+        st->worker = std::thread([st, path = path]
+        {
+            st->found = st->discoverer.open(path);
+            st->discovered = true;
+        });
+
+        player.schedule([st, handle, this]
+        {
+            if (!st->discovered)
+                return false;
+
+            if (st->started == 0)
+            {
+                st->worker.join();
+                st->started = g_get_monotonic_time();
+
+                if (!st->found || !player.open(st->discoverer,
+                    width > 0 ? width : st->discoverer.getWidth(),
+                    height > 0 ? height : st->discoverer.getHeight(),
+                    fmt, false))
+                {
+                    handle.resume();
+                    return true;
+                }
+            }
+
+            if (player.getState() < GST_STATE_PAUSED)
+            {
+                if (g_get_monotonic_time() - st->started < gint64(timeout * G_USEC_PER_SEC))
+                    return false;
+
+                g_warning("Timed out while waiting for media to pre-roll.");
+            }
+            else
+            {
+                st->result = true;
+            }
+
+            handle.resume();
+            return true;
+        });
+    }
+
+    bool await_resume() const noexcept { return state && state->result; }
+};
+
+/*!
+ * @struct  SeekAwaiter
+ * @brief   Seeks the player and resumes once that seek is finished, by the
+ *          ticket setTime() recorded for it. Yields true if it finished,
+ *          false if it failed or was never issued.
+ */
+struct SeekAwaiter
+{
+    Player                  &player;
+    gdouble                 time;
+    guint                   ticket  = 0;
+    bool                    issued  = false;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        const guint before = player.getSeekTicket();
+        player.setTime(time);
+        ticket = player.getSeekTicket();
+
+        // A seek coalescing into the one pending shares its ticket
+        issued = ticket != before || player.getSeekResult(ticket) == SeekResult::PENDING;
+
+        // Seeks within the frame cache are immediate, live media or media not pre-rolled never seek
+        if (!issued || player.getSeekResult(ticket) != SeekResult::PENDING)
+            return false;
+
+        player.schedule([this, handle]
+        {
+            if (player.getSeekResult(ticket) == SeekResult::PENDING)
+                return false;
+
+            handle.resume();
+            return true;
+        });
+
+        return true;
+    }
+
+    bool await_resume() const noexcept { return issued && player.getSeekResult(ticket) == SeekResult::DONE; }
+};
+
+/*!
+ * @struct  StateAwaiter
+ * @brief   Resumes once the player reaches a given state.
+ */
+struct StateAwaiter
+{
+    Player                  &player;
+    GstState                state;
+
+    bool await_ready() const noexcept { return player.getState() == state; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        player.schedule([this, handle]
+        {
+            if (player.getState() != state)
+                return false;
+
+            handle.resume();
+            return true;
+        });
+    }
+
+    void await_resume() const noexcept {}
+};
+
+//! awaitable opening a media, auto detecting size and outputting 32bit BGRA. Yields true on success
+inline OpenAwaiter  openAsync(Player& player, const std::string& path, gdouble timeout = 10.)
+{
+    return OpenAwaiter{ player, path, 0, 0, "BGRA", timeout, nullptr };
+}
+
+//! awaitable opening a media, can resize and reformat the video (if any). Yields true on success
+inline OpenAwaiter  openAsync(Player& player, const std::string& path, gint width, gint height, const std::string& fmt, gdouble timeout = 10.)
+{
+    return OpenAwaiter{ player, path, width, height, fmt, timeout, nullptr };
+}
+
+//! awaitable seeking the media to a given time. Yields true once finished, false if failed
+inline SeekAwaiter  seek(Player& player, gdouble time)
+{
+    return SeekAwaiter{ player, time };
+}
+
+//! awaitable waiting for the player to reach "state"
+inline StateAwaiter waitState(Player& player, GstState state)
+{
+    return StateAwaiter{ player, state };
+}
+
+/*!
+ * @struct  PlayerSource
+ * @brief   GSource dispatching Player::update() once the player's descriptor
+ *          is readable (a frame, a bus message or a posted call). Frames of
+ *          the frame cache and awaiters polling signal nothing, those are
+ *          driven every "interval" milliseconds while there are any.
+ */
+struct PlayerSource
+{
+    GSource                 source;
+    Player                  *player;
+    GPollFD                 fd;
+    guint                   interval;
+    gint64                  deadline;   //!< Monotonic time of the next timed update(), 0 if none
+
+    //! answers true if "self" is driven by time now
+    static bool isTimed(const PlayerSource* self)
+    {
+        return self->player->getServingFromCache() || self->player->hasScheduledTasks();
+    }
+
+    static gboolean prepare(GSource* source, gint* timeout)
+    {
+        auto            *self   = reinterpret_cast<PlayerSource*>(source);
+        const gint64    now     = g_source_get_time(source);
+
+        if (!isTimed(self))
+        {
+            self->deadline  = 0;
+            *timeout        = -1;
+            return FALSE;
+        }
+
+        if (self->deadline == 0)
+            self->deadline = now + gint64(self->interval) * 1000;
+
+        *timeout = self->deadline > now ? gint((self->deadline - now + 999) / 1000) : 0;
+        return self->deadline <= now;
+    }
+
+    static gboolean check(GSource* source)
+    {
+        auto *self = reinterpret_cast<PlayerSource*>(source);
+
+        return (self->fd.revents & G_IO_IN) != 0 ||
+            (self->deadline != 0 && self->deadline <= g_source_get_time(source));
+    }
+
+    static gboolean dispatch(GSource* source, GSourceFunc, gpointer)
+    {
+        auto *self = reinterpret_cast<PlayerSource*>(source);
+
+        self->deadline = 0;
+        self->player->update();
+
+        return G_SOURCE_CONTINUE;
+    }
+};
+
+//! drives player.update() from "context" as events arrive (see PlayerSource). Destroy the returned source to stop
+inline GSource*     attach(Player& player, GMainContext* context, guint interval = 5)
+{
+    static GSourceFuncs funcs = { &PlayerSource::prepare, &PlayerSource::check, &PlayerSource::dispatch, nullptr };
+
+    GSource         *source = g_source_new(&funcs, sizeof(PlayerSource));
+    PlayerSource    *self   = reinterpret_cast<PlayerSource*>(source);
+
+    self->player    = &player;
+    self->fd        = player.getPollFd();
+    self->interval  = interval;
+    self->deadline  = 0;
+
+    g_source_add_poll(source, &self->fd);
+    g_source_attach(source, context);
+
+    return source;
+}
+
+}
@@ -2,6 +2,7 @@
 
 #include "nsvr/nsvr_player.hpp"
 #include "nsvr/nsvr_client.hpp"
+#include "nsvr/nsvr_packet_handler.hpp"
 
 namespace nsvr
 {
@@ -14,17 +15,28 @@ public:
     //! Constructs a client player with its clock listening from "address" and "port"
     PlayerClient(const std::string& address, short port);
 
+    //! Closes the player while overrides of its hooks are still reachable
+    virtual         ~PlayerClient();
+
 protected:
     virtual void    onBeforeOpen() override;
     virtual void    onBeforeClose() override;
     virtual void    onBeforeUpdate() override;
     virtual void    onMessage(const std::string& message) override;
     virtual void    setupClock() override;
+    virtual bool    getOwnsClock() const override;
     void            clearClock();
 
 private:
+    //! Collects chunk "packet", applying cues once every chunk of its version arrived
+    void            receiveCues(const CuePacket& packet);
+
     GstClock*       mNetClock;
     GstClockTime    mBaseTime;
+    guint64         mCueVersion;
+    guint64         mCueChunksVersion;              //!< Version of chunks collected, 0 if none
+    std::vector<std::vector<Cue>> mCueChunks;       //!< Cues of every chunk collected, by index
+    std::vector<bool> mCueChunksReceived;           //!< Flags, indicating chunks collected, by index
 };
 
 }
@@ -14,6 +14,9 @@ public:
     //! Constructs a server player with its clock dispatched at "address" and "port"
     PlayerServer(const std::string& address, short port);
 
+    //! Closes the player while overrides of its hooks are still reachable
+    virtual         ~PlayerServer();
+
     //! Sets the heartbeat frequency of server. Default: 30 seconds
     void setHeartbeatFrequency(unsigned freq);
 
@@ -27,9 +30,12 @@ protected:
     virtual void    onBeforeUpdate() override;
     virtual void    onBeforeClose() override;
     virtual void    setupClock() override;
+    virtual bool    getOwnsClock() const override;
     virtual void    onBeforeSetState(GstState) override;
     virtual void    onStateChanged(GstState) override;
+    virtual void    onCuesChanged() override;
     void            dispatchHeartbeat();
+    void            dispatchCues();
     void            clearClock();
 
 private:
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <string>
+
+namespace nsvr
+{
+
+//! Degradation levels of a Player under sustained overload, mildest first
+enum QosLevel
+{
+    QOS_NONE,                   //!< Full quality, nothing degraded
+    QOS_HALF_RESOLUTION,        //!< Video is output at half its width and height
+    QOS_SKIP_NON_REFERENCE,     //!< Decoder may skip frames no other frame refers to
+    QOS_KEY_UNITS               //!< Only key frames are decoded
+};
+
+//! answers a human readable name of "level"
+const char* getQosLevelName(QosLevel level);
+
+/*!
+ * @class   QosController
+ * @brief   Decides when a Player degrades or recovers its quality out of
+ *          frames handed off, frames dropped and update() overruns seen in
+ *          one second windows.
+ * @details A level is lowered after 2 consecutive overloaded windows and
+ *          raised back after 5 consecutive clean ones, so the Player does
+ *          not flap between levels. A window is overloaded if 5% or more of
+ *          its frames are dropped or a quarter of its updates overrun.
+ * @note    Not MT safe. Player feeds and evaluates it within update().
+ */
+class QosController
+{
+public:
+    QosController();
+
+    //! sets the lowest level the controller may degrade to (QOS_NONE disables it)
+    void            setMaxLevel(QosLevel level);
+
+    //! answers the lowest level the controller may degrade to
+    QosLevel        getMaxLevel() const;
+
+    //! sets if "level" can be applied at all. Unavailable levels are skipped
+    void            setAvailable(QosLevel level, bool on);
+
+    //! answers the current level
+    QosLevel        getLevel() const;
+
+    //! accounts "count" frames handed off
+    void            addFrames(guint64 count);
+
+    //! accounts "count" frames dropped (late, or not consumed in time)
+    void            addDrops(guint64 count);
+
+    //! accounts one update() call, "overrun" if it went over its budget
+    void            addUpdate(bool overrun);
+
+    //! closes the window if it lasted a second by "now" (monotonic microseconds).
+    //! Answers true if the level changed, with the cause of the change in "reason"
+    bool            evaluate(gint64 now, std::string& reason);
+
+    //! goes back to QOS_NONE and forgets every window so far
+    void            reset();
+
+private:
+    //! answers the next available level below (step > 0) or above (step < 0) the current one
+    QosLevel        next(gint step) const;
+
+    QosLevel        mLevel;             //!< Current level
+    QosLevel        mMaxLevel;          //!< Lowest level allowed
+    bool            mAvailable[QOS_KEY_UNITS + 1];  //!< Levels which can be applied
+    gint64          mWindowStart;       //!< Monotonic time the current window started at
+    guint64         mFrames;            //!< Frames handed off in the current window
+    guint64         mDrops;             //!< Frames dropped in the current window
+    guint64         mUpdates;           //!< update() calls in the current window
+    guint64         mOverruns;          //!< update() calls over budget in the current window
+    guint           mOverloaded;        //!< Consecutive overloaded windows
+    guint           mClean;             //!< Consecutive clean windows
+};
+
+}
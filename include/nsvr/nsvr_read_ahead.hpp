@@ -0,0 +1,89 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  ReadAheadStats
+ * @brief   Outcome of a ReadAheadFile since it was opened.
+ */
+struct ReadAheadStats
+{
+    guint64         prefetched  = 0;        //!< Bytes brought into the page cache ahead of the reader
+    guint64         warmed      = 0;        //!< Bytes brought in around seek targets
+    guint64         hits        = 0;        //!< Reads served entirely from prefetched bytes
+    guint64         misses      = 0;        //!< Reads which had to wait on storage
+    gdouble         stalled     = 0.;       //!< Seconds readers spent on missed reads
+};
+
+/*!
+ * @class   ReadAheadFile
+ * @brief   File read by one reader (a demuxer), with a thread of its own
+ *          bringing "window" bytes past the last read into the page cache.
+ * @details Prefetching follows sequential reads and restarts wherever the
+ *          reader jumps to. Seek targets can be warmed before the seek is
+ *          issued. On Linux prefetching uses readahead(), elsewhere
+ *          posix_fadvise() or plain reads which populate the system cache.
+ */
+class ReadAheadFile
+{
+public:
+    ReadAheadFile();
+    ~ReadAheadFile();
+
+    //! opens file at "path", prefetching "window" bytes ahead of reads. Returns true on success
+    bool                open(const std::string& path, gsize window);
+
+    //! stops prefetching and closes the file
+    void                close();
+
+    //! answers true if a file is open
+    bool                isOpen() const;
+
+    //! answers size of the file in bytes
+    guint64             getSize() const;
+
+    //! reads up to "size" bytes at "offset" into "data". Answers bytes read, 0 at the end, -1 on failure
+    gssize              read(guint64 offset, guint8* data, gsize size);
+
+    //! prefetches the window from "offset" on, ahead of a seek the reader is about to follow
+    void                warm(guint64 offset);
+
+    //! answers outcome so far
+    ReadAheadStats      getStats() const;
+
+private:
+    //! prefetching loop of the thread
+    void                run();
+
+    //! brings "size" bytes at "offset" into the page cache, blocking until read. Returns false on failure
+    bool                prefetch(guint64 offset, gsize size);
+
+    ReadAheadFile(const ReadAheadFile&) = delete;
+    ReadAheadFile& operator=(const ReadAheadFile&) = delete;
+
+    gintptr                 mFile;          //!< Descriptor (HANDLE on Windows) of the file, -1 if closed
+    guint64                 mSize;          //!< Size of the file in bytes
+    gsize                   mWindow;        //!< Bytes prefetched ahead of the reader
+
+    mutable std::mutex      mMutex;         //!< Guards everything below
+    std::condition_variable mWake;          //!< Notified when the reader moved or the thread should stop
+    guint64                 mBegin;         //!< First byte of the prefetched range
+    guint64                 mEnd;           //!< Past the last byte of the prefetched range
+    guint64                 mTarget;        //!< Byte the thread prefetches up to
+    guint64                 mWarmBegin;     //!< First byte of the warmed range around a seek target
+    guint64                 mWarmNext;      //!< Past the last byte warmed so far
+    guint64                 mWarmTarget;    //!< Byte the thread warms up to
+    bool                    mStopping;      //!< Flag, telling the thread to quit
+    ReadAheadStats          mStats;         //!< Outcome so far
+    std::thread             mThread;        //!< Prefetching thread
+};
+
+}
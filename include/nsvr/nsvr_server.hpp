@@ -1,12 +1,17 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <unordered_map>
 
 #include <gio/gio.h>
 
+#include <memory>
+
 namespace nsvr {
 
+namespace internal { class SocketWatch; }
+
 /*!
  * @class Server
  * @brief Implements a TCP server. It can also
@@ -18,12 +23,21 @@ public:
     explicit Server();
     virtual ~Server();
 
-    //! start listening for TCP packets on given ports
+    //! start listening for TCP packets on given ports, from the calling thread's thread-default context
     bool listen(const std::string& listen_address, short listen_port);
 
     //! processes pending events received from Clients
     void iterate();
 
+    //! processes pending events until monotonic time "deadline" (microseconds) passes
+    void iterate(gint64 deadline);
+
+    //! answers the context events are dispatched from by iterate()
+    GMainContext* getContext() const;
+
+    //! answers a descriptor readable once iterate() has events to process, valid for the lifetime of the Server
+    GPollFD getPollFd() const;
+
     //! answers true if underlying TCP listener is running
     bool isListening();
 
@@ -74,6 +88,9 @@ private:
     EndpointMap         mEndpoints;
     std::string         mListenAddress;
     GSocketService*     mSocketService;
+    GSocket*            mListenSocket;  //!< Socket mSocketService accepts connections of
+    std::unique_ptr<internal::SocketWatch> mWatch;  //!< Signaled once mListenSocket has a connection pending
+    GMainContext*       mContext;
     short               mListenPort;
 };
 
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  DecodeBranch
+ * @brief   Output of one consumer of a SharedDecode: region of the decoded
+ *          video to keep and the size and format it is converted to.
+ */
+struct DecodeBranch
+{
+    gint            width       = 0;        //!< Output width
+    gint            height      = 0;        //!< Output height
+    std::string     format      = "BGRA";   //!< Output raw video format
+    gint            cropLeft    = 0;        //!< Pixels cropped off the left of the decoded video
+    gint            cropTop     = 0;        //!< Pixels cropped off the top of the decoded video
+    gint            cropRight   = 0;        //!< Pixels cropped off the right of the decoded video
+    gint            cropBottom  = 0;        //!< Pixels cropped off the bottom of the decoded video
+};
+
+/*!
+ * @class   SharedDecode
+ * @brief   One demux and decode of a media, teed into as many appsink
+ *          branches as there are consumers (Players), each one cropping,
+ *          scaling and converting on its own.
+ * @note    Decodes are shared per process and per URI through acquire(),
+ *          by Players setting no option of their own on the pipeline.
+ *          Consumers all control the same pipeline. The first one to
+ *          attach leads: it owns the pipeline bus and clock while others
+ *          mirror its state. Leadership moves on when the leader detaches.
+ */
+class SharedDecode
+{
+public:
+    ~SharedDecode();
+
+    //! answers the decode of "uri" running in this process, launches a new one if none. nullptr on failure
+    static std::shared_ptr<SharedDecode> acquire(const std::string& uri);
+
+    //! adds a branch for "owner", answers its appsink (new reference, not linked yet). nullptr on failure
+    GstElement*     attach(const DecodeBranch& branch, const void* owner);
+
+    //! links the branch of "owner" to the decode and brings it to the state of the pipeline
+    bool            link(const void* owner);
+
+    //! unlinks and drops the branch of "owner"
+    void            detach(const void* owner);
+
+    //! answers true if "owner" leads the decode, taking over leadership if nobody does
+    bool            lead(const void* owner);
+
+    //! answers the decoding pipeline (play-bin)
+    GstElement*     getPipeline() const;
+
+    //! answers the number of attached consumers
+    gsize           getConsumerCount() const;
+
+    //! answers the URI being decoded
+    const std::string& getUri() const;
+
+private:
+    struct Consumer
+    {
+        const void  *owner;                 //!< Player the branch belongs to
+        GstElement  *branch;                //!< Bin of the branch, from queue to appsink
+        GstPad      *teePad;                //!< Request pad of the tee feeding the branch, nullptr if unlinked
+    };
+
+    SharedDecode();
+
+    //! builds the play-bin decoding "uri" into a tee
+    bool            launch(const std::string& uri);
+
+    //! answers the consumer attached by "owner", nullptr if none
+    Consumer*       find(const void* owner);
+
+    //! Called by GStreamer once the tee pad of a branch being detached is idle
+    static GstPadProbeReturn onUnlink(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+
+    SharedDecode(const SharedDecode&) = delete;
+    SharedDecode& operator=(const SharedDecode&) = delete;
+
+    mutable std::mutex      mMutex;         //!< Guards mConsumers and mLeader
+    std::vector<Consumer>   mConsumers;     //!< Attached branches
+    std::string             mUri;           //!< URI being decoded
+    GstElement              *mPipeline;     //!< Play-bin decoding mUri
+    GstElement              *mVideoBin;     //!< Video sink of mPipeline, holds the tee and branches
+    GstElement              *mTee;          //!< Tee feeding every branch
+    const void              *mLeader;       //!< Consumer owning bus and clock, nullptr if none
+};
+
+}
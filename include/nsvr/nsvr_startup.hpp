@@ -0,0 +1,76 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <string>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  StartupSettings
+ * @brief   How GStreamer is initialized, see setStartup(...).
+ */
+struct StartupSettings
+{
+    //! Registry file to keep. Empty keeps GStreamer's own registry and plugin paths
+    std::string                 registry;
+
+    //! Plugins the registry holds, by name (file "libgst<name>.so" or "gst<name>.dll")
+    std::vector<std::string>    plugins     =
+    {
+        "coreelements", "app", "playback", "typefindfunctions", "pbtypes",
+        "videoconvert", "videoscale", "audioconvert", "audioresample", "volume", "autodetect",
+        "isomp4", "matroska", "libav", "videoparsersbad", "audioparsers", "png", "jpeg",
+        "udp", "rtp", "rtpmanager", "rtsp", "soup",
+        "alsa", "pulseaudio", "osxaudio", "wasapi", "directsound"
+    };
+
+    //! Directories plugins are looked up in. Empty for GStreamer's environment, its SDK and the usual system ones
+    std::vector<std::string>    pluginPaths;
+
+    //! Element factories left in the registry. Empty keeps all of the plugins held
+    std::vector<std::string>    features;
+
+    //! Flag, indicating the registry may be scanned in a forked process
+    bool                        fork        = false;
+};
+
+/*!
+ * @struct  StartupStats
+ * @brief   Breakdown of the time GStreamer took to initialize, in seconds.
+ */
+struct StartupStats
+{
+    gdouble     prepare     = 0.;       //!< Looking up plugins and linking them next to the registry
+    gdouble     init        = 0.;       //!< gst_init(), loading (and scanning unless pinned) the registry
+    gdouble     whitelist   = 0.;       //!< Removing element factories not in StartupSettings::features
+    gdouble     total       = 0.;       //!< All of the above
+    gdouble     waited      = 0.;       //!< Callers blocked waiting for a background initialization
+    guint       plugins     = 0;        //!< Plugins in the registry
+    guint       features    = 0;        //!< Features left in the registry
+    bool        pinned      = false;    //!< Flag, indicating the registry was loaded without scanning
+    bool        background  = false;    //!< Flag, indicating initialization ran on a background thread
+};
+
+/*!
+ * Configures how GStreamer initializes, call before anything else of NSVR.
+ * With a registry set, the plugins listed are linked into a directory next
+ * to it (copied where links are not supported) and only that directory is
+ * scanned. Once built, the registry is pinned: later runs load it without
+ * scanning until the list of plugins or their files change. Returns false
+ * if GStreamer already initialized.
+ */
+bool            setStartup(const StartupSettings& settings);
+
+//! prepares the registry and environment, then initializes GStreamer on a background thread and returns, the first Player waits for it
+void            startInBackground();
+
+//! initializes GStreamer unless it is or waits for the background thread to do. Returns true on success
+bool            waitForStartup();
+
+//! answers breakdown of the time GStreamer took to initialize
+StartupStats    getStartupStats();
+
+}
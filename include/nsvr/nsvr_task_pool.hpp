@@ -0,0 +1,82 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <string>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  TaskPoolSettings
+ * @brief   Where and how threads of a TaskPool run.
+ */
+struct TaskPoolSettings
+{
+    std::vector<guint>  streamingCpus;      //!< CPUs streaming threads run on, empty for all. Leave out the render thread's
+    std::vector<guint>  sinkCpus;           //!< CPUs sink threads run on, empty for streamingCpus
+    gint                sinkPriority = 0;   //!< SCHED_FIFO priority of sink threads between [ 1 , 99 ], 0 leaves them SCHED_OTHER
+    guint               maxIdle      = 8;   //!< Idle threads kept around for tasks started next
+};
+
+/*!
+ * @struct  TaskThreadStats
+ * @brief   Utilisation of one thread of a TaskPool.
+ */
+struct TaskThreadStats
+{
+    std::string     owner;                  //!< Element the thread streams for, empty if idle
+    gdouble         lifetime    = 0.;       //!< Seconds since the thread started
+    gdouble         busy        = 0.;       //!< Seconds running tasks
+    gdouble         cpu         = 0.;       //!< Seconds of processor time, 0 where unknown
+    gdouble         utilisation = 0.;       //!< Processor time per lifetime, 1. being one core
+    guint64         tasks       = 0;        //!< Tasks run so far
+    bool            sink        = false;    //!< Flag, indicating the thread runs a sink task (or did last)
+    bool            idle        = true;     //!< Flag, indicating the thread waits for a task
+};
+
+/*!
+ * @class   TaskPool
+ * @brief   GstTaskPool shared by the pipelines of several Players, so their
+ *          streaming threads are reused instead of created per pipeline, and
+ *          placed on chosen CPUs.
+ * @details Installed on every task a pipeline creates, through its
+ *          stream-status messages. Streaming threads are bound to
+ *          streamingCpus, threads streaming for sinks (audio ring buffers,
+ *          queues in sink bins) to sinkCpus at sinkPriority; threads the pool
+ *          does not own (audio ring buffers) are placed as they enter too.
+ *          A task runs until its pad stops, so threads are as many as tasks
+ *          running at once; those that finish wait for the next task.
+ *          SCHED_FIFO needs CAP_SYS_NICE (or an rtprio limit), placement is
+ *          Linux only.
+ */
+class TaskPool
+{
+public:
+    explicit TaskPool(const TaskPoolSettings& settings = TaskPoolSettings());
+    ~TaskPool();
+
+    //! sets where threads run, applied to threads as they pick up their next task
+    void            setSettings(const TaskPoolSettings& settings);
+
+    //! answers where threads run
+    TaskPoolSettings getSettings() const;
+
+    //! answers utilisation of every thread of the pool
+    std::vector<TaskThreadStats> getStats() const;
+
+    //! installs the pool on the task of a stream-status "message" and places the thread entering. Call from a sync bus handler
+    void            handleStreamStatus(GstMessage* message);
+
+    //! answers the GstTaskPool, for tasks set up by hand
+    GstTaskPool*    getTaskPool() const;
+
+private:
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    GstTaskPool     *mPool;                 //!< Threads and settings, outlives the TaskPool while tasks hold it
+};
+
+}
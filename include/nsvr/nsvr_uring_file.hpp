@@ -0,0 +1,107 @@
+#pragma once
+
+#include "nsvr/nsvr_read_ahead.hpp"
+
+#include <gst/gst.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nsvr
+{
+
+/*!
+ * @class   UringFile
+ * @brief   File read by one reader (a source's streaming thread) through
+ *          io_uring, keeping up to "depth" block aligned reads in flight
+ *          ahead of it.
+ * @details Blocks are read into buffers registered with the ring, read()
+ *          hands them out wrapped in GstMemory without copying. Blocks still
+ *          held downstream are not reused, reads fall back to copies from a
+ *          plain descriptor when none is free. Optionally opens with O_DIRECT,
+ *          bypassing the page cache. Linux 5.1+ only, open() fails elsewhere.
+ */
+class UringFile
+{
+public:
+    UringFile();
+    ~UringFile();
+
+    //! answers true if the kernel supports io_uring
+    static bool         isSupported();
+
+    //! opens file at "path", keeping "depth" reads of "block" bytes in flight, O_DIRECT if "direct". Returns true on success
+    bool                open(const std::string& path, guint depth, gsize block, bool direct);
+
+    //! waits for reads in flight and closes the file. Buffers handed out stay valid
+    void                close();
+
+    //! answers true if a file is open
+    bool                isOpen() const;
+
+    //! answers size of the file in bytes
+    guint64             getSize() const;
+
+    //! answers true if opened with O_DIRECT
+    bool                getDirect() const;
+
+    //! reads up to "size" bytes at "offset" into a new "buffer", GstBaseSrc::create() alike
+    GstFlowReturn       read(guint64 offset, guint size, GstBuffer** buffer);
+
+    //! answers outcome so far, "warmed" is always 0
+    ReadAheadStats      getStats() const;
+
+private:
+    struct Ring;
+    struct Blocks;
+
+    //! answers slot holding or reading "block", -1 if none
+    gint                findSlot(guint64 block) const;
+
+    //! answers a slot free to read into, keeping blocks "first" to "last". -1 if none
+    gint                findFreeSlot(guint64 first, guint64 last) const;
+
+    //! queues a read of "block" into "slot", submitted by the next reap(). Returns false if the ring is full
+    bool                queue(gint slot, guint64 block);
+
+    //! submits queued reads and reaps completed ones, waiting for one at least if "wait". Returns false on failure
+    bool                reap(bool wait);
+
+    //! reads "size" bytes at "offset" into a new buffer from the plain descriptor
+    GstFlowReturn       copy(guint64 offset, gsize size, GstBuffer** buffer);
+
+    UringFile(const UringFile&) = delete;
+    UringFile& operator=(const UringFile&) = delete;
+
+    /*!
+     * @struct  Slot
+     * @brief   One block sized buffer registered with the ring.
+     */
+    struct Slot
+    {
+        enum State { FREE, READING, READY, FAILED };
+
+        State           state   = FREE;     //!< What the slot holds
+        guint64         block   = 0;        //!< Index of the block held or read
+        gsize           length  = 0;        //!< Bytes read into the slot
+    };
+
+    std::unique_ptr<Ring>   mRing;          //!< Submission and completion queues, nullptr if closed
+    Blocks                  *mBlocks;       //!< Memory of the slots, shared with buffers handed out
+    std::vector<Slot>       mSlots;         //!< State of every slot
+    gint                    mFile;          //!< Descriptor reads are queued on, -1 if closed
+    gint                    mPlainFile;     //!< Descriptor without O_DIRECT, copies are read from
+    guint64                 mSize;          //!< Size of the file in bytes
+    gsize                   mBlock;         //!< Bytes of a block
+    guint                   mQueued;        //!< Reads queued and not submitted yet
+    guint                   mInFlight;      //!< Reads queued and not reaped yet
+    bool                    mDirect;        //!< Flag, indicating the file was opened with O_DIRECT
+    bool                    mFixed;         //!< Flag, indicating slots are registered with the ring
+
+    mutable std::mutex      mMutex;         //!< Guards mStats
+    ReadAheadStats          mStats;         //!< Outcome so far
+};
+
+}
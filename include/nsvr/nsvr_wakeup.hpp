@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glib.h>
+
+namespace nsvr
+{
+
+/*!
+ * @class   Wakeup
+ * @brief   A pollable file descriptor (an eventfd, a pipe or a Win32 event)
+ *          that becomes readable once signal() is called, until acknowledged.
+ * @details getPollFd() can be handed to g_poll(), a GSource, epoll, etc.
+ *          On Windows the descriptor is an event handle, as GLib expects.
+ * @note    signal() is MT safe. acknowledge() and wait() are meant for the
+ *          single thread consuming the events.
+ */
+class Wakeup
+{
+public:
+    Wakeup();
+    ~Wakeup();
+
+    //! makes the descriptor readable. Callable from any thread
+    void            signal();
+
+    //! makes the descriptor non-readable again
+    void            acknowledge();
+
+    //! blocks until signaled or "timeout" microseconds pass (negative waits forever). Answers true if signaled
+    bool            wait(gint64 timeout);
+
+    //! answers the descriptor, polled for G_IO_IN
+    GPollFD         getPollFd() const;
+
+private:
+    Wakeup(const Wakeup&) = delete;
+    Wakeup& operator=(const Wakeup&) = delete;
+
+#ifdef _WIN32
+    gpointer        mEvent;             //!< Manual reset event
+#else
+    gint            mReadFd;            //!< Read end (same as mWriteFd for an eventfd)
+    gint            mWriteFd;           //!< Write end
+#endif
+};
+
+}
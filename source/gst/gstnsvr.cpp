@@ -0,0 +1,23 @@
+#include "gstnsvrsink.hpp"
+#include "gstnsvrclock.hpp"
+
+#ifndef PACKAGE
+#   define PACKAGE "nsvr"
+#endif
+
+static gboolean plugin_init(GstPlugin* plugin)
+{
+    return gst_element_register(plugin, "nsvrsink", GST_RANK_NONE, GST_TYPE_NSVR_SINK)
+        && gst_element_register(plugin, "nsvrclock", GST_RANK_NONE, GST_TYPE_NSVR_CLOCK);
+}
+
+GST_PLUGIN_DEFINE(
+    GST_VERSION_MAJOR,
+    GST_VERSION_MINOR,
+    nsvr,
+    "Network synchronized video rendering",
+    plugin_init,
+    "1.0",
+    "LGPL",
+    "nsvr",
+    "Unknown package origin")
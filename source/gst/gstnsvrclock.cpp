@@ -0,0 +1,88 @@
+#include "gstnsvrclock.hpp"
+#include "gstnsvrsync.hpp"
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+#define gst_nsvr_clock_parent_class parent_class
+G_DEFINE_TYPE(GstNsvrClock, gst_nsvr_clock, GST_TYPE_BASE_TRANSFORM);
+
+static void gst_nsvr_clock_finalize(GObject* object)
+{
+    delete GST_NSVR_CLOCK(object)->sync;
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+static void gst_nsvr_clock_set_property(GObject* object, guint id, const GValue* value, GParamSpec* pspec)
+{
+    if (!GST_NSVR_CLOCK(object)->sync->setProperty(id, value))
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, id, pspec);
+}
+
+static void gst_nsvr_clock_get_property(GObject* object, guint id, GValue* value, GParamSpec* pspec)
+{
+    if (!GST_NSVR_CLOCK(object)->sync->getProperty(id, value))
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, id, pspec);
+}
+
+static GstStateChangeReturn gst_nsvr_clock_change_state(GstElement* element, GstStateChange transition)
+{
+    GstNsvrClock *clock = GST_NSVR_CLOCK(element);
+
+    if (transition == GST_STATE_CHANGE_NULL_TO_READY)
+    {
+        if (!clock->sync->start())
+        {
+            GST_ELEMENT_ERROR(element, RESOURCE, OPEN_READ_WRITE, ("Unable to set up network synchronization."), (nullptr));
+            return GST_STATE_CHANGE_FAILURE;
+        }
+
+        clock->sync->attach();
+    }
+
+    GstStateChangeReturn result = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
+
+    if (transition == GST_STATE_CHANGE_READY_TO_NULL)
+        clock->sync->stop();
+
+    return result;
+}
+
+static GstClock* gst_nsvr_clock_provide_clock(GstElement* element)
+{
+    return GST_NSVR_CLOCK(element)->sync->getClock();
+}
+
+static void gst_nsvr_clock_class_init(GstNsvrClockClass* klass)
+{
+    GObjectClass        *object_class   = G_OBJECT_CLASS(klass);
+    GstElementClass     *element_class  = GST_ELEMENT_CLASS(klass);
+
+    object_class->finalize      = gst_nsvr_clock_finalize;
+    object_class->set_property  = gst_nsvr_clock_set_property;
+    object_class->get_property  = gst_nsvr_clock_get_property;
+
+    nsvr::NetSync::installProperties(object_class);
+
+    gst_element_class_set_static_metadata(element_class,
+        "Network synchronized clock", "Generic",
+        "Passes buffers through and provides a clock shared over the network",
+        "nsvr");
+
+    gst_element_class_add_pad_template(element_class, gst_static_pad_template_get(&sink_template));
+    gst_element_class_add_pad_template(element_class, gst_static_pad_template_get(&src_template));
+
+    element_class->change_state = gst_nsvr_clock_change_state;
+    element_class->provide_clock = gst_nsvr_clock_provide_clock;
+}
+
+static void gst_nsvr_clock_init(GstNsvrClock* clock)
+{
+    clock->sync = new nsvr::NetSync(GST_ELEMENT(clock));
+
+    GST_OBJECT_FLAG_SET(clock, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
+    gst_base_transform_set_passthrough(GST_BASE_TRANSFORM(clock), TRUE);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+
+namespace nsvr { class NetSync; }
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NSVR_CLOCK         (gst_nsvr_clock_get_type())
+#define GST_NSVR_CLOCK(obj)         (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_NSVR_CLOCK, GstNsvrClock))
+#define GST_NSVR_CLOCK_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_NSVR_CLOCK, GstNsvrClockClass))
+#define GST_IS_NSVR_CLOCK(obj)      (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_NSVR_CLOCK))
+
+/*!
+ * @struct  GstNsvrClock
+ * @brief   Pass-through element providing a clock shared over the network to
+ *          its pipeline, for pipelines keeping their own sinks.
+ * @details Same modes and properties as nsvrsink, without frame handoff.
+ */
+struct GstNsvrClock
+{
+    GstBaseTransform parent;
+
+    nsvr::NetSync   *sync;              //!< Network side
+};
+
+struct GstNsvrClockClass
+{
+    GstBaseTransformClass parent_class;
+};
+
+GType gst_nsvr_clock_get_type(void);
+
+G_END_DECLS
@@ -0,0 +1,128 @@
+#include "gstnsvrsink.hpp"
+#include "gstnsvrsync.hpp"
+
+enum
+{
+    PROP_SIGNAL_HANDOFFS = nsvr::NetSync::PROP_LAST
+};
+
+enum
+{
+    SIGNAL_HANDOFF,
+    SIGNAL_LAST
+};
+
+static guint gst_nsvr_sink_signals[SIGNAL_LAST] = { 0 };
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+#define gst_nsvr_sink_parent_class parent_class
+G_DEFINE_TYPE(GstNsvrSink, gst_nsvr_sink, GST_TYPE_BASE_SINK);
+
+static void gst_nsvr_sink_finalize(GObject* object)
+{
+    delete GST_NSVR_SINK(object)->sync;
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+static void gst_nsvr_sink_set_property(GObject* object, guint id, const GValue* value, GParamSpec* pspec)
+{
+    GstNsvrSink *sink = GST_NSVR_SINK(object);
+
+    if (id == PROP_SIGNAL_HANDOFFS)
+        sink->signal_handoffs = g_value_get_boolean(value);
+    else if (!sink->sync->setProperty(id, value))
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, id, pspec);
+}
+
+static void gst_nsvr_sink_get_property(GObject* object, guint id, GValue* value, GParamSpec* pspec)
+{
+    GstNsvrSink *sink = GST_NSVR_SINK(object);
+
+    if (id == PROP_SIGNAL_HANDOFFS)
+        g_value_set_boolean(value, sink->signal_handoffs);
+    else if (!sink->sync->getProperty(id, value))
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, id, pspec);
+}
+
+static GstStateChangeReturn gst_nsvr_sink_change_state(GstElement* element, GstStateChange transition)
+{
+    GstNsvrSink *sink = GST_NSVR_SINK(element);
+
+    if (transition == GST_STATE_CHANGE_NULL_TO_READY)
+    {
+        if (!sink->sync->start())
+        {
+            GST_ELEMENT_ERROR(element, RESOURCE, OPEN_READ_WRITE, ("Unable to set up network synchronization."), (nullptr));
+            return GST_STATE_CHANGE_FAILURE;
+        }
+
+        sink->sync->attach();
+    }
+
+    GstStateChangeReturn result = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
+
+    if (transition == GST_STATE_CHANGE_READY_TO_NULL)
+        sink->sync->stop();
+
+    return result;
+}
+
+static GstClock* gst_nsvr_sink_provide_clock(GstElement* element)
+{
+    return GST_NSVR_SINK(element)->sync->getClock();
+}
+
+static GstFlowReturn gst_nsvr_sink_render(GstBaseSink* base_sink, GstBuffer* buffer)
+{
+    GstNsvrSink *sink = GST_NSVR_SINK(base_sink);
+
+    if (sink->signal_handoffs)
+        g_signal_emit(sink, gst_nsvr_sink_signals[SIGNAL_HANDOFF], 0, buffer, base_sink->sinkpad);
+
+    return GST_FLOW_OK;
+}
+
+static void gst_nsvr_sink_class_init(GstNsvrSinkClass* klass)
+{
+    GObjectClass        *object_class   = G_OBJECT_CLASS(klass);
+    GstElementClass     *element_class  = GST_ELEMENT_CLASS(klass);
+    GstBaseSinkClass    *base_class     = GST_BASE_SINK_CLASS(klass);
+
+    object_class->finalize      = gst_nsvr_sink_finalize;
+    object_class->set_property  = gst_nsvr_sink_set_property;
+    object_class->get_property  = gst_nsvr_sink_get_property;
+
+    nsvr::NetSync::installProperties(object_class);
+
+    g_object_class_install_property(object_class, PROP_SIGNAL_HANDOFFS,
+        g_param_spec_boolean("signal-handoffs", "Signal handoffs", "Emit \"handoff\" for every rendered buffer",
+            FALSE, GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    gst_nsvr_sink_signals[SIGNAL_HANDOFF] = g_signal_new("handoff",
+        G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST,
+        G_STRUCT_OFFSET(GstNsvrSinkClass, handoff), nullptr, nullptr,
+        g_cclosure_marshal_generic, G_TYPE_NONE, 2,
+        GST_TYPE_BUFFER | G_SIGNAL_TYPE_STATIC_SCOPE, GST_TYPE_PAD);
+
+    gst_element_class_set_static_metadata(element_class,
+        "Network synchronized sink", "Sink",
+        "Renders on a clock shared over the network and hands buffers off",
+        "nsvr");
+
+    gst_element_class_add_pad_template(element_class, gst_static_pad_template_get(&sink_template));
+
+    element_class->change_state = gst_nsvr_sink_change_state;
+    element_class->provide_clock = gst_nsvr_sink_provide_clock;
+    base_class->render = gst_nsvr_sink_render;
+}
+
+static void gst_nsvr_sink_init(GstNsvrSink* sink)
+{
+    sink->sync = new nsvr::NetSync(GST_ELEMENT(sink));
+    sink->signal_handoffs = FALSE;
+
+    GST_OBJECT_FLAG_SET(sink, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
+    gst_base_sink_set_sync(GST_BASE_SINK(sink), TRUE);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+
+namespace nsvr { class NetSync; }
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_NSVR_SINK          (gst_nsvr_sink_get_type())
+#define GST_NSVR_SINK(obj)          (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_NSVR_SINK, GstNsvrSink))
+#define GST_NSVR_SINK_CLASS(klass)  (G_TYPE_CHECK_CLASS_CAST((klass), GST_TYPE_NSVR_SINK, GstNsvrSinkClass))
+#define GST_IS_NSVR_SINK(obj)       (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_NSVR_SINK))
+
+/*!
+ * @struct  GstNsvrSink
+ * @brief   Sink rendering on a clock shared over the network. Hands buffers
+ *          off through its "handoff" signal, like fakesink does.
+ * @details In server mode it publishes its clock and broadcasts heartbeats.
+ *          In client mode it slaves the pipeline to a server clock, follows
+ *          its base time and requests its state from the application.
+ */
+struct GstNsvrSink
+{
+    GstBaseSink     parent;
+
+    nsvr::NetSync   *sync;              //!< Network side
+    gboolean        signal_handoffs;    //!< Emit "handoff" for every rendered buffer
+};
+
+struct GstNsvrSinkClass
+{
+    GstBaseSinkClass parent_class;
+
+    //! signal emitted for every rendered buffer if "signal-handoffs" is set
+    void (*handoff)(GstElement* element, GstBuffer* buffer, GstPad* pad);
+};
+
+GType gst_nsvr_sink_get_type(void);
+
+G_END_DECLS
@@ -0,0 +1,375 @@
+#include "gstnsvrsync.hpp"
+#include "../nsvr/nsvr_internal.hpp"
+
+#include "nsvr/nsvr_client.hpp"
+#include "nsvr/nsvr_server.hpp"
+#include "nsvr/nsvr_packet_handler.hpp"
+
+#include <gst/net/net.h>
+
+GType gst_nsvr_mode_get_type(void)
+{
+    static gsize mode_type = 0;
+
+    if (g_once_init_enter(&mode_type))
+    {
+        static const GEnumValue modes[] =
+        {
+            { GST_NSVR_MODE_SERVER, "Publish clock and heartbeats", "server" },
+            { GST_NSVR_MODE_CLIENT, "Follow a server", "client" },
+            { 0, nullptr, nullptr }
+        };
+
+        g_once_init_leave(&mode_type, g_enum_register_static("GstNsvrMode", modes));
+    }
+
+    return mode_type;
+}
+
+namespace nsvr
+{
+
+namespace {
+
+const GstNsvrMode   kDefaultMode        = GST_NSVR_MODE_CLIENT;
+const gchar*        kDefaultAddress     = "127.0.0.1";
+const gint          kDefaultPort        = 5000;
+const guint         kDefaultHeartbeat   = 500;
+
+}
+
+class NetSync::SyncClient : public Client
+{
+public:
+    explicit SyncClient(NetSync& sync) : mSync(sync) {}
+
+protected:
+    void onMessage(const std::string& message) override { mSync.onPacket(message); }
+
+private:
+    NetSync         &mSync;
+};
+
+NetSync::NetSync(GstElement* element)
+    : mElement(element)
+    , mMode(kDefaultMode)
+    , mAddress(kDefaultAddress)
+    , mPort(kDefaultPort)
+    , mHeartbeat(kDefaultHeartbeat)
+    , mClock(nullptr)
+    , mProvider(nullptr)
+    , mContext(nullptr)
+    , mLoop(nullptr)
+    , mTimer(nullptr)
+    , mBase(GST_CLOCK_TIME_NONE)
+    , mFollowed(GST_STATE_VOID_PENDING)
+    , mConnected(false)
+{}
+
+NetSync::~NetSync()
+{
+    stop();
+}
+
+void NetSync::installProperties(GObjectClass* klass)
+{
+    g_object_class_install_property(klass, PROP_MODE,
+        g_param_spec_enum("mode", "Mode", "Publish the clock (server) or follow one (client)",
+            GST_TYPE_NSVR_MODE, kDefaultMode,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(klass, PROP_ADDRESS,
+        g_param_spec_string("address", "Address", "Address to listen at (server) or of the server (client)",
+            kDefaultAddress,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(klass, PROP_PORT,
+        g_param_spec_int("port", "Port", "Port of the server, its clock is published on the next one",
+            1, G_MAXINT16 - 1, kDefaultPort,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(klass, PROP_HEARTBEAT,
+        g_param_spec_uint("heartbeat", "Heartbeat", "Milliseconds in between two heartbeats of a server",
+            10, G_MAXUINT, kDefaultHeartbeat,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+}
+
+bool NetSync::setProperty(guint id, const GValue* value)
+{
+    switch (id)
+    {
+    case PROP_MODE:
+        mMode = GstNsvrMode(g_value_get_enum(value));
+        return true;
+    case PROP_ADDRESS:
+        mAddress = g_value_get_string(value) ? g_value_get_string(value) : kDefaultAddress;
+        return true;
+    case PROP_PORT:
+        mPort = g_value_get_int(value);
+        return true;
+    case PROP_HEARTBEAT:
+        mHeartbeat = g_value_get_uint(value);
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool NetSync::getProperty(guint id, GValue* value) const
+{
+    switch (id)
+    {
+    case PROP_MODE:
+        g_value_set_enum(value, mMode);
+        return true;
+    case PROP_ADDRESS:
+        g_value_set_string(value, mAddress.c_str());
+        return true;
+    case PROP_PORT:
+        g_value_set_int(value, mPort);
+        return true;
+    case PROP_HEARTBEAT:
+        g_value_set_uint(value, mHeartbeat);
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool NetSync::start()
+{
+    stop();
+
+    const short port        = short(mPort);
+    const short clock_port  = internal::getClockPort(port);
+
+    if (mMode == GST_NSVR_MODE_SERVER)
+    {
+        mClock      = gst_system_clock_obtain();
+        mProvider   = GST_OBJECT(gst_net_time_provider_new(mClock, mAddress.c_str(), clock_port));
+
+        if (mProvider == nullptr)
+        {
+            NSVR_LOG("Unable to publish clock at " << mAddress << ":" << clock_port);
+            stop();
+            return false;
+        }
+
+        mContext    = g_main_context_new();
+        mServer.reset(new Server);
+
+        // Server dispatches incoming connections from the thread-default context
+        g_main_context_push_thread_default(mContext);
+        const bool listening = mServer->listen(mAddress, port);
+        g_main_context_pop_thread_default(mContext);
+
+        if (!listening)
+        {
+            stop();
+            return false;
+        }
+    }
+    else
+    {
+        mClient.reset(new SyncClient(*this));
+
+        if (!mClient->connect(mAddress, port))
+        {
+            stop();
+            return false;
+        }
+
+        mClock = gst_net_client_clock_new(nullptr, mAddress.c_str(), clock_port, 0);
+
+        if (mClock == nullptr)
+        {
+            NSVR_LOG("Unable to follow clock at " << mAddress << ":" << clock_port);
+            stop();
+            return false;
+        }
+
+        gst_clock_set_timeout(mClock, 100 * GST_MSECOND);
+        mContext = g_main_context_ref(mClient->getContext());
+    }
+
+    mBase       = GST_CLOCK_TIME_NONE;
+    mFollowed   = GST_STATE_VOID_PENDING;
+    mConnected  = false;
+    mLoop       = g_main_loop_new(mContext, FALSE);
+    mTimer      = g_timeout_source_new(mHeartbeat);
+
+    g_source_set_callback(mTimer, onHeartbeat, this, nullptr);
+    g_source_attach(mTimer, mContext);
+
+    mThread = std::thread([this]
+    {
+        g_main_context_push_thread_default(mContext);
+        g_main_loop_run(mLoop);
+        g_main_context_pop_thread_default(mContext);
+    });
+
+    return true;
+}
+
+void NetSync::stop()
+{
+    if (mLoop != nullptr)
+    {
+        g_main_loop_quit(mLoop);
+
+        if (mThread.joinable())
+            mThread.join();
+
+        g_main_loop_unref(mLoop);
+        mLoop = nullptr;
+    }
+
+    if (mTimer != nullptr)
+    {
+        g_source_destroy(mTimer);
+        g_source_unref(mTimer);
+        mTimer = nullptr;
+    }
+
+    mServer.reset();
+    mClient.reset();
+
+    if (mContext != nullptr)
+    {
+        g_main_context_unref(mContext);
+        mContext = nullptr;
+    }
+
+    if (mProvider != nullptr)
+    {
+        gst_object_unref(mProvider);
+        mProvider = nullptr;
+    }
+
+    if (mClock != nullptr)
+    {
+        gst_object_unref(mClock);
+        mClock = nullptr;
+    }
+}
+
+void NetSync::attach()
+{
+    g_return_if_fail(mClock != nullptr);
+
+    GstElement *pipeline = getPipeline();
+    BIND_TO_SCOPE(pipeline);
+
+    if (pipeline == nullptr)
+    {
+        NSVR_LOG("Element is not within a pipeline, its clock is only provided.");
+        return;
+    }
+
+    // Other clock providers (audio sinks) must not take over the network clock
+    gst_pipeline_use_clock(GST_PIPELINE(pipeline), mClock);
+}
+
+GstClock* NetSync::getClock() const
+{
+    return mClock != nullptr ? GST_CLOCK(gst_object_ref(mClock)) : nullptr;
+}
+
+GstElement* NetSync::getPipeline() const
+{
+    GstObject *top = GST_OBJECT(gst_object_ref(mElement));
+
+    while (GstObject *parent = gst_object_get_parent(top))
+    {
+        gst_object_unref(top);
+        top = parent;
+    }
+
+    if (!GST_IS_PIPELINE(top))
+    {
+        gst_object_unref(top);
+        return nullptr;
+    }
+
+    return GST_ELEMENT(top);
+}
+
+void NetSync::dispatchHeartbeat()
+{
+    GstElement *pipeline = getPipeline();
+    BIND_TO_SCOPE(pipeline);
+
+    if (pipeline == nullptr)
+        return;
+
+    gint64 position = 0;
+
+    Packet packet;
+    packet.time     = gst_element_query_position(pipeline, GST_FORMAT_TIME, &position) ? position / gdouble(GST_SECOND) : 0.;
+    packet.volume   = 1.;
+    packet.mute     = FALSE;
+    packet.state    = GST_STATE(pipeline);
+    packet.base     = gst_element_get_base_time(pipeline);
+
+    mServer->broadcastToClients(PacketHandler::serialize(packet));
+}
+
+void NetSync::onPacket(const std::string& message)
+{
+    Packet packet;
+
+    if (message.empty() || !PacketHandler::parse(message, packet))
+        return;
+
+    mConnected = true;
+
+    GstElement *pipeline = getPipeline();
+    BIND_TO_SCOPE(pipeline);
+
+    if (pipeline == nullptr)
+        return;
+
+    // Base time of a server is only meaningful while it is playing
+    if (packet.state == GST_STATE_PLAYING && GST_CLOCK_TIME_IS_VALID(packet.base) && packet.base != mBase)
+    {
+        NSVR_LOG("Client element received a new base time.");
+
+        mBase = packet.base;
+
+        // Pipeline keeps the base from now on, running elements are moved right away
+        gst_element_set_start_time(pipeline, GST_CLOCK_TIME_NONE);
+        gst_element_set_base_time(pipeline, packet.base);
+
+        if (GstIterator *elements = gst_bin_iterate_recurse(GST_BIN(pipeline)))
+        {
+            gst_iterator_foreach(elements, [](const GValue* item, gpointer base)
+            {
+                gst_element_set_base_time(GST_ELEMENT(g_value_get_object(item)), *static_cast<GstClockTime*>(base));
+            }, &packet.base);
+
+            gst_iterator_free(elements);
+        }
+    }
+
+    if (packet.state != mFollowed && packet.state >= GST_STATE_READY)
+    {
+        mFollowed = packet.state;
+
+        // Applications (gst-launch included) change the pipeline state on request
+        gst_element_post_message(mElement, gst_message_new_request_state(GST_OBJECT(mElement), packet.state));
+    }
+}
+
+gboolean NetSync::onHeartbeat(gpointer data)
+{
+    auto sync = static_cast<NetSync*>(data);
+
+    if (sync->mServer)
+        sync->dispatchHeartbeat();
+    else if (sync->mClient && !sync->mConnected)
+        sync->mClient->sendToServer("nsvr");   // Servers only know clients which said hello
+
+    return G_SOURCE_CONTINUE;
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+G_BEGIN_DECLS
+
+//! Role of an nsvr element within a synchronized group
+typedef enum
+{
+    GST_NSVR_MODE_SERVER,       //!< Publishes its clock and broadcasts heartbeats
+    GST_NSVR_MODE_CLIENT        //!< Slaves its pipeline to a server
+} GstNsvrMode;
+
+#define GST_TYPE_NSVR_MODE (gst_nsvr_mode_get_type())
+GType gst_nsvr_mode_get_type(void);
+
+G_END_DECLS
+
+namespace nsvr
+{
+
+class Client;
+class Server;
+
+/*!
+ * @class   NetSync
+ * @brief   Network side shared by nsvrsink and nsvrclock. A server publishes
+ *          the clock of its pipeline and broadcasts heartbeats of it, the
+ *          way PlayerServer does. A client slaves its pipeline to the server
+ *          clock and follows its base time and state, the way PlayerClient does.
+ * @note    Network events are processed on a thread of its own, between
+ *          start() and stop(). Settings are applied on the next start().
+ */
+class NetSync
+{
+public:
+    //! property identifiers installed by installProperties()
+    enum Property
+    {
+        PROP_MODE = 1,
+        PROP_ADDRESS,
+        PROP_PORT,
+        PROP_HEARTBEAT,
+        PROP_LAST
+    };
+
+    //! "element" is the nsvr element owning this instance
+    explicit NetSync(GstElement* element);
+    ~NetSync();
+
+    //! installs mode, address, port and heartbeat properties on "klass"
+    static void     installProperties(GObjectClass* klass);
+
+    //! sets a property installed by installProperties(). Answers false if "id" is not one
+    bool            setProperty(guint id, const GValue* value);
+
+    //! gets a property installed by installProperties(). Answers false if "id" is not one
+    bool            getProperty(guint id, GValue* value) const;
+
+    //! starts networking and obtains the clock. Answers false on failure
+    bool            start();
+
+    //! stops networking and releases the clock. No-op if not started
+    void            stop();
+
+    //! makes the pipeline of the element run on the network clock
+    void            attach();
+
+    //! answers the network clock (new reference), nullptr if not started
+    GstClock*       getClock() const;
+
+private:
+    class SyncClient;
+
+    //! answers the top-level pipeline of the element (new reference), nullptr if none
+    GstElement*     getPipeline() const;
+
+    //! broadcasts position, state and base time of the pipeline
+    void            dispatchHeartbeat();
+
+    //! follows base time and state of a server heartbeat
+    void            onPacket(const std::string& message);
+
+    //! Called by GLib every heartbeat interval on the network thread
+    static gboolean onHeartbeat(gpointer data);
+
+    NetSync(const NetSync&) = delete;
+    NetSync& operator=(const NetSync&) = delete;
+
+    GstElement                  *mElement;      //!< Owning element
+    GstNsvrMode                 mMode;          //!< Server or client
+    std::string                 mAddress;       //!< Address to listen at (server) or connect to (client)
+    gint                        mPort;          //!< Server port, clock is published at internal::getClockPort()
+    guint                       mHeartbeat;     //!< Milliseconds in between two heartbeats
+    GstClock                    *mClock;        //!< Published (server) or slaved (client) clock
+    GstObject                   *mProvider;     //!< Net time provider publishing mClock (server)
+    std::unique_ptr<Server>     mServer;        //!< Heartbeat broadcaster (server)
+    std::unique_ptr<SyncClient> mClient;        //!< Heartbeat receiver (client)
+    GMainContext                *mContext;      //!< Context of the network thread
+    GMainLoop                   *mLoop;         //!< Loop of the network thread
+    GSource                     *mTimer;        //!< Heartbeat timer, attached to mContext
+    std::thread                 mThread;        //!< Network thread
+    std::atomic<GstClockTime>   mBase;          //!< Base time last followed (client)
+    GstState                    mFollowed;      //!< Server state last followed (client)
+    bool                        mConnected;     //!< A heartbeat was received (client)
+};
+
+}
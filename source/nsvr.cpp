@@ -100,4 +100,15 @@ void listModules()
 #endif
 }
 
+bool registerElements()
+{
+    if (!internal::gstreamerInitialized())
+    {
+        NSVR_LOG("GStreamer could not be initialized.");
+        return false;
+    }
+
+    return internal::registerFileSource();
+}
+
 }
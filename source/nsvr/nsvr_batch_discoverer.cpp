@@ -0,0 +1,285 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_batch_discoverer.hpp"
+
+#include <gst/pbutils/gstdiscoverer.h>
+
+#include <thread>
+
+namespace nsvr
+{
+
+/*!
+ * @struct  BatchDiscoverer::Worker
+ * @brief   Thread running one GstDiscoverer on a main context of its own.
+ */
+struct BatchDiscoverer::Worker
+{
+    BatchDiscoverer *owner      = nullptr;
+    GMainContext    *context    = nullptr;  //!< Context the discoverer signals on
+    GMainLoop       *loop       = nullptr;  //!< Run while a file is discovered
+    std::thread     thread;
+    std::string     path;                   //!< File being discovered
+    std::string     uri;                    //!< URI of path
+    bool            answered    = false;    //!< Flag, indicating path was answered
+
+    ~Worker()
+    {
+        if (loop != nullptr)
+            g_main_loop_unref(loop);
+
+        if (context != nullptr)
+            g_main_context_unref(context);
+    }
+
+    //! Called by the discoverer on the worker thread once path is done
+    static void onDiscovered(GstDiscoverer* discoverer, GstDiscovererInfo* info, GError* error, Worker* worker)
+    {
+        Discoverer result;
+        result.mMediaUri = worker->uri;
+
+        const bool success  = info != nullptr && result.read(info);
+        const bool timeout  = info != nullptr && gst_discoverer_info_get_result(info) == GST_DISCOVERER_TIMEOUT;
+
+        if (success)
+            result.store();
+        else if (error != nullptr)
+            NSVR_LOG("Unable to discover " << worker->path << " [" << error->message << "].");
+
+        worker->answered = true;
+        worker->owner->answer(worker->path, result, success, timeout, false);
+    }
+
+    //! Called by the discoverer on the worker thread once no file is pending
+    static void onFinished(GstDiscoverer* discoverer, Worker* worker)
+    {
+        g_main_loop_quit(worker->loop);
+    }
+
+    //! Attached by cancel(), quits the loop of the file in flight
+    static gboolean onCancel(gpointer loop)
+    {
+        g_main_loop_quit(static_cast<GMainLoop*>(loop));
+        return G_SOURCE_REMOVE;
+    }
+};
+
+BatchDiscoverer::BatchDiscoverer()
+    : mWorkerCount(std::max(1u, g_get_num_processors()))
+    , mTimeout(10.)
+    , mNext(0)
+    , mCancelled(false)
+    , mStarted(0)
+    , mActive(0)
+{}
+
+BatchDiscoverer::~BatchDiscoverer()
+{
+    cancel();
+    wait();
+}
+
+void BatchDiscoverer::setWorkerCount(guint count)
+{
+    mWorkerCount = std::max(1u, count);
+}
+
+guint BatchDiscoverer::getWorkerCount() const
+{
+    return mWorkerCount;
+}
+
+void BatchDiscoverer::setTimeout(gdouble seconds)
+{
+    mTimeout = seconds;
+}
+
+gdouble BatchDiscoverer::getTimeout() const
+{
+    return mTimeout;
+}
+
+bool BatchDiscoverer::start(const std::vector<std::string>& paths, const Callback& callback)
+{
+    if (isRunning())
+    {
+        NSVR_LOG("BatchDiscoverer is already running.");
+        return false;
+    }
+
+    if (!internal::gstreamerInitialized())
+    {
+        NSVR_LOG("BatchDiscoverer requires GStreamer to be initialized.");
+        return false;
+    }
+
+    // Joins workers of the last run
+    wait();
+
+    mPaths      = paths;
+    mCallback   = callback;
+    mNext       = 0;
+    mCancelled  = false;
+
+    const guint count = guint(std::min<gsize>(mWorkerCount, paths.size()));
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mStats          = BatchDiscoveryStats();
+        mStats.files    = paths.size();
+        mStarted        = g_get_monotonic_time();
+        mActive         = count;
+    }
+
+    NSVR_LOG("About to discover " << paths.size() << " files, " << count << " at once with timeout " << mTimeout << " seconds.");
+
+    for (guint i = 0; i < count; ++i)
+    {
+        std::unique_ptr<Worker> worker(new Worker);
+
+        worker->owner   = this;
+        worker->context = g_main_context_new();
+        worker->loop    = g_main_loop_new(worker->context, FALSE);
+        worker->thread  = std::thread(&BatchDiscoverer::work, this, worker.get());
+
+        mWorkers.push_back(std::move(worker));
+    }
+
+    return true;
+}
+
+void BatchDiscoverer::wait()
+{
+    for (auto& worker : mWorkers)
+        worker->thread.join();
+
+    mWorkers.clear();
+}
+
+void BatchDiscoverer::cancel()
+{
+    mCancelled = true;
+
+    for (auto& worker : mWorkers)
+    {
+        // Quits the loop once it runs, in case it does not yet
+        GSource *source = g_idle_source_new();
+        g_source_set_callback(source, &Worker::onCancel, worker->loop, nullptr);
+        g_source_attach(source, worker->context);
+        g_source_unref(source);
+    }
+}
+
+bool BatchDiscoverer::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mActive > 0;
+}
+
+BatchDiscoveryStats BatchDiscoverer::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    BatchDiscoveryStats stats = mStats;
+
+    if (mActive > 0)
+        stats.elapsed = (g_get_monotonic_time() - mStarted) / gdouble(G_USEC_PER_SEC);
+
+    if (stats.elapsed > 0.)
+        stats.filesPerSecond = stats.done / stats.elapsed;
+
+    return stats;
+}
+
+void BatchDiscoverer::work(Worker* worker)
+{
+    g_main_context_push_thread_default(worker->context);
+
+    GError          *error      = nullptr;
+    GstDiscoverer   *discoverer = gst_discoverer_new(GstClockTime(mTimeout * GST_SECOND), &error);
+
+    BIND_TO_SCOPE(error);
+
+    if (discoverer != nullptr)
+    {
+        BIND_TO_SCOPE(discoverer);
+
+        g_signal_connect(discoverer, "discovered", G_CALLBACK(Worker::onDiscovered), worker);
+        g_signal_connect(discoverer, "finished", G_CALLBACK(Worker::onFinished), worker);
+
+        // One file per start() and stop(), so stop() aborts only the file in flight on cancel()
+        while (claim(worker->path, worker->uri))
+        {
+            worker->answered = false;
+
+            gst_discoverer_start(discoverer);
+
+            if (gst_discoverer_discover_uri_async(discoverer, worker->uri.c_str()) != FALSE && !mCancelled)
+                g_main_loop_run(worker->loop);
+
+            gst_discoverer_stop(discoverer);
+
+            if (!worker->answered && !mCancelled)
+                answer(worker->path, Discoverer(), false, false, false);
+        }
+    }
+    else
+    {
+        NSVR_LOG("Unable to construct GstDiscoverer [" << (error ? error->message : "unknown error") << "].");
+    }
+
+    g_main_context_pop_thread_default(worker->context);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (--mActive == 0)
+    {
+        mStats.elapsed = (g_get_monotonic_time() - mStarted) / gdouble(G_USEC_PER_SEC);
+        NSVR_LOG("Discovered " << mStats.succeeded << " of " << mStats.done << " files in " << mStats.elapsed << " seconds.");
+    }
+}
+
+bool BatchDiscoverer::claim(std::string& path, std::string& uri)
+{
+    gsize index;
+
+    while (!mCancelled && (index = mNext++) < mPaths.size())
+    {
+        Discoverer discoverer;
+        discoverer.mMediaUri = internal::pathToUri(mPaths[index]);
+
+        if (discoverer.mMediaUri.empty())
+        {
+            answer(mPaths[index], discoverer, false, false, false);
+        }
+        else if (discoverer.lookup())
+        {
+            answer(mPaths[index], discoverer, true, false, true);
+        }
+        else
+        {
+            path    = mPaths[index];
+            uri     = discoverer.mMediaUri;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void BatchDiscoverer::answer(const std::string& path, const Discoverer& discoverer, bool success, bool timed_out, bool cached)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mStats.done        += 1;
+        mStats.succeeded   += success ? 1 : 0;
+        mStats.failed      += success ? 0 : 1;
+        mStats.timedOut    += timed_out ? 1 : 0;
+        mStats.cached      += cached ? 1 : 0;
+    }
+
+    if (mCallback)
+        mCallback(path, discoverer, success);
+}
+
+}
@@ -17,6 +17,7 @@ Client::Client()
     , mListenAddress(nullptr)
     , mContext(nullptr)
     , mSource(nullptr)
+    , mWatch(new internal::SocketWatch())
     , mConnected(false)
     , mServerPort(0)
 {}
@@ -72,6 +73,8 @@ bool Client::connect(const std::string& server_address, short server_port)
         g_source_set_callback(mSource, reinterpret_cast<GSourceFunc>(incomming), this, nullptr);
         g_source_set_priority(mSource, G_PRIORITY_HIGH);
         g_source_attach(mSource, mContext);
+
+        mWatch->watch(mReceiveSocket);
     }
     else
     {
@@ -93,6 +96,8 @@ void Client::disconnect()
     if (!isConnected())
         return;
 
+    mWatch->watch(nullptr);
+
     g_source_unref(mSource);
     g_main_context_unref(mContext);
     
@@ -144,12 +149,37 @@ void Client::sendToServer(const std::string& message)
 }
 
 void Client::iterate()
+{
+    iterate(G_MAXINT64);
+}
+
+void Client::iterate(gint64 deadline)
 {
     if (!isConnected())
         return;
 
-    while (g_main_context_pending(mContext) != FALSE)
+    // Before dispatching, so events left behind signal again
+    mWatch->acknowledge();
+
+    // At least one event per call, so the network is never starved
+    do
+    {
+        if (g_main_context_pending(mContext) == FALSE)
+            break;
+
         g_main_context_iteration(mContext, FALSE);
+    }
+    while (g_get_monotonic_time() < deadline);
+}
+
+GMainContext* Client::getContext() const
+{
+    return mContext;
+}
+
+GPollFD Client::getPollFd() const
+{
+    return mWatch->getPollFd();
 }
 
 const std::string& Client::getServerAddress() const
@@ -184,7 +214,7 @@ gboolean Client::incomming(GSocket *socket, GIOCondition condition, gpointer sel
         }
         else if (peer->isConnected())
         {
-            peer->onMessage(buffer);
+            peer->onMessage(std::string(buffer, gsize(received_bytes)));
             source_action = G_SOURCE_CONTINUE;
         }
         else
@@ -0,0 +1,69 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_command_queue.hpp"
+
+namespace nsvr
+{
+
+CommandQueue::CommandQueue()
+    : mHead(&mStub)
+    , mTail(&mStub)
+{
+    mStub.next.store(nullptr, std::memory_order_relaxed);
+}
+
+CommandQueue::~CommandQueue()
+{
+    PlayerCommand command;
+    while (pop(command));
+}
+
+void CommandQueue::push(const PlayerCommand& command)
+{
+    Node *node = new Node;
+    node->command = command;
+    link(node);
+}
+
+bool CommandQueue::pop(PlayerCommand& command)
+{
+    Node *tail = mTail;
+    Node *next = tail->next.load(std::memory_order_acquire);
+
+    if (tail == &mStub)
+    {
+        if (next == nullptr)
+            return false;
+
+        mTail   = next;
+        tail    = next;
+        next    = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next == nullptr)
+    {
+        // A producer swapped the head but did not link it yet
+        if (tail != mHead.load(std::memory_order_acquire))
+            return false;
+
+        link(&mStub);
+        next = tail->next.load(std::memory_order_acquire);
+
+        if (next == nullptr)
+            return false;
+    }
+
+    mTail   = next;
+    command = tail->command;
+
+    delete tail;
+    return true;
+}
+
+void CommandQueue::link(Node* node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = mHead.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+}
+
+}
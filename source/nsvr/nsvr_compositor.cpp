@@ -0,0 +1,624 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_compositor.hpp"
+
+#include <gst/video/video.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define NSVR_BLEND_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   include <arm_neon.h>
+#   define NSVR_BLEND_NEON 1
+#endif
+
+namespace {
+
+const gint kBandRows = 16;      //!< Rows blended at once by a thread, a band of 4K BGRA is 240 KiB
+
+//! answers "value" / 255 rounded, exact for [ 0 , 65025 ]
+inline guint div255(guint value)
+{
+    value += 128;
+    return (value + (value >> 8)) >> 8;
+}
+
+}
+
+namespace nsvr {
+namespace internal {
+
+//! blendRow(...) one pixel at a time, SIMD paths answer the same bytes
+void blendRowScalar(guint8* dst, const guint8* src, gint count, guint alpha, bool opaque)
+{
+    for (gint i = 0; i < count; ++i)
+    {
+        const guint8    *s  = src + i * 4;
+        guint8          *d  = dst + i * 4;
+        const guint     a   = ((opaque ? 255u : s[3]) * alpha) >> 8;
+
+        d[0] = guint8(div255(s[0] * a + d[0] * (255 - a)));
+        d[1] = guint8(div255(s[1] * a + d[1] * (255 - a)));
+        d[2] = guint8(div255(s[2] * a + d[2] * (255 - a)));
+        d[3] = guint8(div255(255 * a + d[3] * (255 - a)));
+    }
+}
+
+/*!
+ * Blends "count" 32bit BGRA pixels of "src" over "dst", scaled by "alpha"
+ * between [ 0 , 256 ]. Alpha of "src" is taken as opaque if "opaque" (BGRx).
+ * Output alpha is src over dst, so a transparent background stays so.
+ */
+void blendRow(guint8* dst, const guint8* src, gint count, guint alpha, bool opaque)
+{
+    gint i = 0;
+
+#if defined(NSVR_BLEND_SSE2)
+    const __m128i zero      = _mm_setzero_si128();
+    const __m128i full      = _mm_set1_epi16(255);
+    const __m128i half      = _mm_set1_epi16(128);
+    const __m128i opaque_a  = _mm_set1_epi32(opaque ? gint(0xFF000000) : 0);
+    const __m128i alpha_a   = _mm_set1_epi32(gint(alpha));
+    const __m128i alpha_ch  = _mm_set1_epi32(gint(0xFF000000));
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4)), opaque_a);
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+
+        // Per pixel weight, broadcast to its 4 channels
+        __m128i a = _mm_srli_epi32(_mm_mullo_epi16(_mm_srli_epi32(s, 24), alpha_a), 8);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+
+        // Alpha channel blends 255 in, giving a + dst_a * (1 - a)
+        s = _mm_or_si128(s, alpha_ch);
+
+        __m128i a_lo = _mm_unpacklo_epi8(a, zero);
+        __m128i a_hi = _mm_unpackhi_epi8(a, zero);
+
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), a_lo),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, a_lo))), half);
+
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), a_hi),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, a_hi))), half);
+
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+#elif defined(NSVR_BLEND_NEON)
+    const uint32x4_t    opaque_a    = vdupq_n_u32(opaque ? 0xFF000000u : 0u);
+    const uint32x4_t    alpha_ch    = vdupq_n_u32(0xFF000000u);
+    const uint16x8_t    half        = vdupq_n_u16(128);
+    const uint8x16_t    full        = vdupq_n_u8(255);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32x4_t s = vorrq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(src + i * 4)), opaque_a);
+        uint8x16_t d = vld1q_u8(dst + i * 4);
+
+        // Per pixel weight, broadcast to its 4 channels
+        uint32x4_t a32 = vshrq_n_u32(vmulq_n_u32(vshrq_n_u32(s, 24), alpha), 8);
+        uint8x16_t a = vreinterpretq_u8_u32(vmulq_n_u32(a32, 0x01010101u));
+        uint8x16_t ia = vsubq_u8(full, a);
+
+        // Alpha channel blends 255 in, giving a + dst_a * (1 - a)
+        uint8x16_t s8 = vreinterpretq_u8_u32(vorrq_u32(s, alpha_ch));
+
+        uint16x8_t lo = vaddq_u16(vmlal_u8(vmull_u8(vget_low_u8(s8), vget_low_u8(a)), vget_low_u8(d), vget_low_u8(ia)), half);
+        uint16x8_t hi = vaddq_u16(vmlal_u8(vmull_u8(vget_high_u8(s8), vget_high_u8(a)), vget_high_u8(d), vget_high_u8(ia)), half);
+
+        vst1q_u8(dst + i * 4, vcombine_u8(
+            vshrn_n_u16(vaddq_u16(lo, vshrq_n_u16(lo, 8)), 8),
+            vshrn_n_u16(vaddq_u16(hi, vshrq_n_u16(hi, 8)), 8)));
+    }
+#endif
+
+    blendRowScalar(dst + i * 4, src + i * 4, count - i, alpha, opaque);
+}
+
+//! copyRow(...) one pixel at a time, SIMD paths answer the same bytes
+void copyRowScalar(guint8* dst, const guint8* src, gint count)
+{
+    for (gint i = 0; i < count; ++i)
+    {
+        std::memcpy(dst + i * 4, src + i * 4, 3);
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+//! copies "count" opaque pixels, forcing their alpha channel (undefined in BGRx) to 255
+void copyRow(guint8* dst, const guint8* src, gint count)
+{
+    gint i = 0;
+
+#if defined(NSVR_BLEND_SSE2)
+    const __m128i alpha_ch = _mm_set1_epi32(gint(0xFF000000));
+
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4),
+            _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4)), alpha_ch));
+#elif defined(NSVR_BLEND_NEON)
+    const uint32x4_t alpha_ch = vdupq_n_u32(0xFF000000u);
+
+    for (; i + 4 <= count; i += 4)
+        vst1q_u32(reinterpret_cast<uint32_t*>(dst + i * 4),
+            vorrq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(src + i * 4)), alpha_ch));
+#endif
+
+    copyRowScalar(dst + i * 4, src + i * 4, count - i);
+}
+
+}}
+
+namespace nsvr
+{
+
+CompositorLayer::CompositorLayer()
+{
+    std::memset(&mMapInfo, 0, sizeof(mMapInfo));
+}
+
+CompositorLayer::~CompositorLayer()
+{
+    unmap();
+
+    if (mFrame != nullptr)
+        gst_sample_unref(mFrame);
+}
+
+void CompositorLayer::setPosition(gint x, gint y)
+{
+    mX = x;
+    mY = y;
+}
+
+gint CompositorLayer::getX() const
+{
+    return mX;
+}
+
+gint CompositorLayer::getY() const
+{
+    return mY;
+}
+
+void CompositorLayer::setScale(gdouble x, gdouble y)
+{
+    mScaleX = x > 0. ? x : 0.;
+    mScaleY = y > 0. ? y : 0.;
+}
+
+gdouble CompositorLayer::getScaleX() const
+{
+    return mScaleX;
+}
+
+gdouble CompositorLayer::getScaleY() const
+{
+    return mScaleY;
+}
+
+void CompositorLayer::setAlpha(gdouble alpha)
+{
+    mAlpha = CLAMP(alpha, 0., 1.);
+}
+
+gdouble CompositorLayer::getAlpha() const
+{
+    return mAlpha;
+}
+
+void CompositorLayer::setVisible(bool on)
+{
+    mVisible = on;
+}
+
+bool CompositorLayer::getVisible() const
+{
+    return mVisible;
+}
+
+void CompositorLayer::onVideoFrame(guchar* buf, gsize size) const
+{
+    if (mFrame != nullptr)
+        gst_sample_unref(mFrame);
+
+    // Frames served from the cache come without a sample
+    if (mCurrentSample != nullptr)
+    {
+        mFrame = gst_sample_ref(mCurrentSample);
+        mCopy.clear();
+
+        // Cached frames are copies of decoded ones, in the same format
+        GstVideoInfo info;
+
+        if (gst_video_info_from_caps(&info, gst_sample_get_caps(mFrame)) != FALSE)
+            mCopyAlpha = GST_VIDEO_INFO_FORMAT(&info) != GST_VIDEO_FORMAT_BGRx;
+    }
+    else
+    {
+        mFrame = nullptr;
+        mCopy.assign(buf, buf + size);
+    }
+}
+
+bool CompositorLayer::map(Frame& frame)
+{
+    unmap();
+
+    if (mFrame == nullptr)
+    {
+        // A cached frame is a copy of one decoded in the format opened
+        if (mCopy.empty() || mCopy.size() != gsize(getWidth()) * getHeight() * 4)
+            return false;
+
+        frame.data      = mCopy.data();
+        frame.width     = getWidth();
+        frame.height    = getHeight();
+        frame.stride    = getWidth() * 4;
+        frame.alpha     = mCopyAlpha;
+
+        return true;
+    }
+
+    GstVideoInfo info;
+    GstBuffer *buffer = gst_sample_get_buffer(mFrame);
+
+    if (buffer == nullptr || gst_video_info_from_caps(&info, gst_sample_get_caps(mFrame)) == FALSE)
+        return false;
+
+    const GstVideoFormat format = GST_VIDEO_INFO_FORMAT(&info);
+
+    if (format != GST_VIDEO_FORMAT_BGRA && format != GST_VIDEO_FORMAT_BGRx)
+    {
+        if (!mWarned)
+            NSVR_LOG("Compositor layer skipped, frames are " << gst_video_format_to_string(format) << " rather than BGRA or BGRx.");
+
+        mWarned = true;
+        return false;
+    }
+
+    if (gst_buffer_map(buffer, &mMapInfo, GST_MAP_READ) == FALSE)
+        return false;
+
+    mMapped = buffer;
+
+    frame.data      = mMapInfo.data;
+    frame.width     = GST_VIDEO_INFO_WIDTH(&info);
+    frame.height    = GST_VIDEO_INFO_HEIGHT(&info);
+    frame.stride    = GST_VIDEO_INFO_PLANE_STRIDE(&info, 0);
+    frame.alpha     = format == GST_VIDEO_FORMAT_BGRA;
+
+    return mMapInfo.size >= gsize(frame.stride) * frame.height;
+}
+
+void CompositorLayer::unmap()
+{
+    if (mMapped != nullptr)
+        gst_buffer_unmap(mMapped, &mMapInfo);
+
+    mMapped = nullptr;
+}
+
+Compositor::Compositor()
+    : mWidth(0)
+    , mHeight(0)
+    , mBackground(0xFF000000)
+    , mBandCount(0)
+    , mNextBand(0)
+    , mWorkerCount(std::max(1u, g_get_num_processors()) - 1)
+    , mGeneration(0)
+    , mBusy(0)
+    , mStopping(false)
+{}
+
+Compositor::~Compositor()
+{
+    stopWorkers();
+}
+
+bool Compositor::setSize(gint width, gint height)
+{
+    if (width <= 0 || height <= 0)
+    {
+        NSVR_LOG("Compositor output of " << width << "x" << height << " is empty.");
+        return false;
+    }
+
+    mWidth  = width;
+    mHeight = height;
+    mOutput.assign(gsize(width) * height * 4, 0);
+
+    return true;
+}
+
+gint Compositor::getWidth() const
+{
+    return mWidth;
+}
+
+gint Compositor::getHeight() const
+{
+    return mHeight;
+}
+
+void Compositor::setBackground(guint32 argb)
+{
+    mBackground = argb;
+}
+
+guint32 Compositor::getBackground() const
+{
+    return mBackground;
+}
+
+void Compositor::setWorkerCount(guint count)
+{
+    if (count == mWorkerCount)
+        return;
+
+    stopWorkers();
+    mWorkerCount = count;
+}
+
+guint Compositor::getWorkerCount() const
+{
+    return mWorkerCount;
+}
+
+std::shared_ptr<CompositorLayer> Compositor::addLayer()
+{
+    mLayers.push_back(std::make_shared<CompositorLayer>());
+    return mLayers.back();
+}
+
+void Compositor::removeLayer(const std::shared_ptr<CompositorLayer>& layer)
+{
+    mLayers.erase(std::remove(mLayers.begin(), mLayers.end(), layer), mLayers.end());
+}
+
+const std::vector<std::shared_ptr<CompositorLayer>>& Compositor::getLayers() const
+{
+    return mLayers;
+}
+
+void Compositor::update()
+{
+    for (auto& layer : mLayers)
+        layer->update();
+}
+
+const guint8* Compositor::compose()
+{
+    if (mOutput.empty())
+        return nullptr;
+
+    const gint64 started = g_get_monotonic_time();
+
+    mJobs.clear();
+
+    for (gsize index = 0; index < mLayers.size(); ++index)
+    {
+        CompositorLayer &layer = *mLayers[index];
+        Job job;
+
+        if (!layer.mVisible || layer.mAlpha <= 0. || layer.mScaleX <= 0. || layer.mScaleY <= 0. || !layer.map(job.frame))
+            continue;
+
+        const gint width    = gint(job.frame.width * layer.mScaleX + .5);
+        const gint height   = gint(job.frame.height * layer.mScaleY + .5);
+
+        job.left    = layer.mX;
+        job.top     = layer.mY;
+        job.x0      = MAX(job.left, 0);
+        job.x1      = MIN(job.left + width, mWidth);
+        job.y0      = MAX(job.top, 0);
+        job.y1      = MIN(job.top + height, mHeight);
+        job.scaleY  = layer.mScaleY;
+        job.alpha   = guint(layer.mAlpha * 256. + .5);
+        job.direct  = width == job.frame.width;
+        job.index   = index;
+
+        if (job.x0 >= job.x1 || job.y0 >= job.y1)
+        {
+            layer.unmap();
+            continue;
+        }
+
+        if (!job.direct)
+        {
+            job.columns.resize(job.x1 - job.x0);
+
+            for (gint x = job.x0; x < job.x1; ++x)
+                job.columns[x - job.x0] = MIN(gint((x - job.left) / layer.mScaleX), job.frame.width - 1);
+        }
+
+        mJobs.push_back(std::move(job));
+    }
+
+    mBandCount = guint((mHeight + kBandRows - 1) / kBandRows);
+    mCosts.assign(gsize(mBandCount) * mJobs.size(), 0);
+    mNextBand = 0;
+
+    if (mWorkerCount > 0)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (mWorkers.empty())
+        {
+            mStopping = false;
+
+            for (guint i = 0; i < mWorkerCount; ++i)
+                mWorkers.emplace_back(&Compositor::work, this, mGeneration);
+        }
+
+        mBusy = guint(mWorkers.size());
+        ++mGeneration;
+        mWork.notify_all();
+    }
+
+    // The calling thread blends too
+    blendBands();
+
+    if (mWorkerCount > 0)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait(lock, [this] { return mBusy == 0; });
+    }
+
+    for (auto& layer : mLayers)
+        layer->unmap();
+
+    const gdouble elapsed = (g_get_monotonic_time() - started) / gdouble(G_USEC_PER_SEC);
+
+    mStats.layers.assign(mLayers.size(), 0.);
+
+    for (gsize job = 0; job < mJobs.size(); ++job)
+    {
+        for (guint band = 0; band < mBandCount; ++band)
+            mStats.layers[mJobs[job].index] += mCosts[band * mJobs.size() + job] / gdouble(G_USEC_PER_SEC);
+    }
+
+    mStats.frames  += 1;
+    mStats.last     = elapsed;
+    mStats.maximum  = MAX(mStats.maximum, elapsed);
+    mStats.average += (elapsed - mStats.average) / mStats.frames;
+
+    return mOutput.data();
+}
+
+const guint8* Compositor::getOutput() const
+{
+    return mOutput.empty() ? nullptr : mOutput.data();
+}
+
+gsize Compositor::getStride() const
+{
+    return gsize(mWidth) * 4;
+}
+
+const CompositorStats& Compositor::getStats() const
+{
+    return mStats;
+}
+
+void Compositor::blendBands()
+{
+    guint band;
+
+    while ((band = mNextBand++) < mBandCount)
+        blendBand(band);
+}
+
+void Compositor::blendBand(guint band)
+{
+    const gint      first   = gint(band) * kBandRows;
+    const gint      last    = MIN(first + kBandRows, mHeight);
+    const gsize     stride  = getStride();
+
+    // Background, in memory order B, G, R, A like the output
+    const guint8 background[4] =
+    {
+        guint8(mBackground), guint8(mBackground >> 8), guint8(mBackground >> 16), guint8(mBackground >> 24)
+    };
+
+    for (gint y = first; y < last; ++y)
+    {
+        guint8 *row = mOutput.data() + y * stride;
+
+        for (gint x = 0; x < mWidth; ++x)
+            std::memcpy(row + x * 4, background, 4);
+    }
+
+    // Columns of scaled frames are gathered here first
+    static thread_local std::vector<guint8> gathered;
+
+    for (gsize index = 0; index < mJobs.size(); ++index)
+    {
+        const Job       &job    = mJobs[index];
+        const gint      y0      = MAX(job.y0, first);
+        const gint      y1      = MIN(job.y1, last);
+
+        if (y0 >= y1)
+            continue;
+
+        const gint64    started = g_get_monotonic_time();
+        const gint      count   = job.x1 - job.x0;
+        const bool      copy    = !job.frame.alpha && job.alpha >= 256;
+
+        if (!job.direct && gathered.size() < gsize(count) * 4)
+            gathered.resize(gsize(count) * 4);
+
+        for (gint y = y0; y < y1; ++y)
+        {
+            const gint      src_y   = MIN(gint((y - job.top) / job.scaleY), job.frame.height - 1);
+            const guint8    *src    = job.frame.data + src_y * gsize(job.frame.stride);
+            guint8          *dst    = mOutput.data() + y * stride + job.x0 * 4;
+
+            if (job.direct)
+            {
+                src += (job.x0 - job.left) * 4;
+            }
+            else
+            {
+                for (gint x = 0; x < count; ++x)
+                    std::memcpy(&gathered[x * 4], src + job.columns[x] * 4, 4);
+
+                src = gathered.data();
+            }
+
+            if (copy)
+                internal::copyRow(dst, src, count);
+            else
+                internal::blendRow(dst, src, count, job.alpha, !job.frame.alpha);
+        }
+
+        mCosts[band * mJobs.size() + index] = g_get_monotonic_time() - started;
+    }
+}
+
+void Compositor::work(guint64 generation)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true)
+    {
+        mWork.wait(lock, [this, &generation] { return mStopping || mGeneration != generation; });
+
+        if (mStopping)
+            break;
+
+        generation = mGeneration;
+
+        lock.unlock();
+        blendBands();
+        lock.lock();
+
+        if (--mBusy == 0)
+            mDone.notify_all();
+    }
+}
+
+void Compositor::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+
+    mWork.notify_all();
+
+    for (auto& worker : mWorkers)
+        worker.join();
+
+    mWorkers.clear();
+}
+
+}
@@ -0,0 +1,350 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_cue_scheduler.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+namespace {
+
+const GstClockTime kGrace       = 10 * GST_MSECOND;     //!< Cues this late when armed still fire
+const GstClockTime kTolerance   = GST_MSECOND;          //!< Clock times this close are the same firing
+
+//! answers true if clock times "a" and "b" are both valid and within kTolerance
+bool isSameTime(GstClockTime a, GstClockTime b)
+{
+    if (!GST_CLOCK_TIME_IS_VALID(a) || !GST_CLOCK_TIME_IS_VALID(b))
+        return false;
+
+    return (a > b ? a - b : b - a) <= kTolerance;
+}
+
+}
+
+namespace nsvr
+{
+
+struct CueScheduler::State
+{
+    struct Entry
+    {
+        gdouble         time    = 0.;                   //!< Media time in seconds
+        GstClockID      armed   = nullptr;              //!< Clock id waited on, nullptr if not armed
+        GstClockTime    target  = GST_CLOCK_TIME_NONE;  //!< Clock time the cue is armed at
+        GstClockTime    fired   = GST_CLOCK_TIME_NONE;  //!< Clock time the cue fired at last
+    };
+
+    //! Handed to the clock with every armed id, freed once the clock is done with it
+    struct Pending
+    {
+        std::shared_ptr<State>  state;
+        std::string             id;
+        gdouble                 time;
+        GstClockTime            target;
+    };
+
+    std::mutex                      mutex;              //!< Guards everything below
+    std::condition_variable         idle;               //!< Notified once no callback runs
+    std::map<std::string, Entry>    entries;            //!< Cues by id
+    Callback                        callback;           //!< Called for every cue firing
+    GstClock                        *clock  = nullptr;  //!< Clock cues are armed on, nullptr if none
+    guint64                         version = 0;        //!< Bumped by every change of entries
+    gdouble                         offset  = 0.;       //!< Seconds cues fire ahead of their time
+    guint                           firing  = 0;        //!< Callbacks running
+    bool                            stopped = false;    //!< Flag, indicating shutdown() was called
+    CueStats                        stats;              //!< Lateness of cues fired so far
+
+    //! disarms "entry", its callback no longer fires. Call locked
+    void disarm(Entry& entry)
+    {
+        if (entry.armed != nullptr)
+        {
+            gst_clock_id_unschedule(entry.armed);
+            gst_clock_id_unref(entry.armed);
+        }
+
+        entry.armed     = nullptr;
+        entry.target    = GST_CLOCK_TIME_NONE;
+    }
+
+    //! disarms every entry and releases the clock. Call locked
+    void disarmAll()
+    {
+        for (auto& entry : entries)
+            disarm(entry.second);
+
+        if (clock != nullptr)
+        {
+            gst_object_unref(clock);
+            clock = nullptr;
+        }
+    }
+
+    //! Called on the clock thread once an armed id is due
+    static gboolean onClock(GstClock* clock, GstClockTime time, GstClockID id, gpointer data);
+};
+
+gboolean CueScheduler::State::onClock(GstClock* clock, GstClockTime time, GstClockID id, gpointer data)
+{
+    const Pending   *pending    = static_cast<const Pending*>(data);
+    State           &state      = *pending->state;
+
+    // Measured before taking the lock, so lateness is the clock's own
+    const GstClockTime fired = gst_clock_get_time(clock);
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+
+    auto entry = state.entries.find(pending->id);
+
+    // Disarmed (or re-armed) while the clock was calling
+    if (state.stopped || entry == state.entries.end() || entry->second.armed != id)
+        return TRUE;
+
+    gst_clock_id_unref(entry->second.armed);
+    entry->second.armed     = nullptr;
+    entry->second.target    = GST_CLOCK_TIME_NONE;
+    entry->second.fired     = pending->target;
+
+    CueEvent event;
+    event.id        = pending->id;
+    event.time      = pending->time;
+    event.target    = pending->target;
+    event.fired     = fired;
+    event.lateness  = GST_CLOCK_DIFF(pending->target, fired) / gdouble(GST_SECOND);
+
+    CueStats &stats = state.stats;
+    stats.fired     += 1;
+    stats.last      = event.lateness;
+    stats.maximum   = stats.fired > 1 ? std::max(stats.maximum, event.lateness) : event.lateness;
+    stats.average   += (event.lateness - stats.average) / stats.fired;
+
+    const Callback callback = state.callback;
+    ++state.firing;
+    lock.unlock();
+
+    if (callback)
+        callback(event);
+
+    lock.lock();
+
+    if (--state.firing == 0)
+        state.idle.notify_all();
+
+    return TRUE;
+}
+
+CueScheduler::CueScheduler(const Callback& callback)
+    : mState(std::make_shared<State>())
+{
+    mState->callback = callback;
+
+    // Versions of different runs differ, so clients tell a restarted server's cues apart
+    mState->version = guint64(g_get_real_time());
+}
+
+CueScheduler::~CueScheduler()
+{
+    shutdown();
+}
+
+bool CueScheduler::add(gdouble time, const std::string& id)
+{
+    if (id.empty() || time < 0.)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mState->mutex);
+
+    State::Entry &entry = mState->entries[id];
+
+    mState->disarm(entry);
+    entry.time  = time;
+    entry.fired = GST_CLOCK_TIME_NONE;
+
+    ++mState->version;
+    return true;
+}
+
+bool CueScheduler::remove(const std::string& id)
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+
+    auto entry = mState->entries.find(id);
+
+    if (entry == mState->entries.end())
+        return false;
+
+    mState->disarm(entry->second);
+    mState->entries.erase(entry);
+
+    ++mState->version;
+    return true;
+}
+
+void CueScheduler::set(const std::vector<Cue>& cues)
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+
+    std::map<std::string, State::Entry> entries;
+
+    for (const Cue& cue : cues)
+    {
+        if (cue.id.empty() || cue.time < 0.)
+            continue;
+
+        auto old = mState->entries.find(cue.id);
+
+        // Cues left as they were keep their clock id, and do not fire twice
+        if (old != mState->entries.end() && old->second.time == cue.time)
+        {
+            entries[cue.id] = old->second;
+            mState->entries.erase(old);
+        }
+        else
+        {
+            entries[cue.id].time = cue.time;
+        }
+    }
+
+    for (auto& entry : mState->entries)
+        mState->disarm(entry.second);
+
+    mState->entries.swap(entries);
+
+    ++mState->version;
+}
+
+void CueScheduler::clear()
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+
+    for (auto& entry : mState->entries)
+        mState->disarm(entry.second);
+
+    mState->entries.clear();
+
+    ++mState->version;
+}
+
+std::vector<Cue> CueScheduler::getCues() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+
+    std::vector<Cue> cues;
+    cues.reserve(mState->entries.size());
+
+    for (const auto& entry : mState->entries)
+    {
+        Cue cue;
+        cue.id      = entry.first;
+        cue.time    = entry.second.time;
+        cues.push_back(cue);
+    }
+
+    std::stable_sort(cues.begin(), cues.end(), [](const Cue& a, const Cue& b) { return a.time < b.time; });
+
+    return cues;
+}
+
+guint64 CueScheduler::getVersion() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->version;
+}
+
+void CueScheduler::setOffset(gdouble offset)
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    mState->offset = offset;
+}
+
+gdouble CueScheduler::getOffset() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->offset;
+}
+
+void CueScheduler::schedule(GstClock* clock, const std::function<GstClockTime(GstClockTime)>& map)
+{
+    g_return_if_fail(clock != nullptr);
+
+    std::lock_guard<std::mutex> lock(mState->mutex);
+
+    if (mState->stopped)
+        return;
+
+    // Ids of another clock never fire on this one
+    if (clock != mState->clock)
+    {
+        mState->disarmAll();
+        mState->clock = GST_CLOCK(gst_object_ref(clock));
+    }
+
+    const GstClockTime      now     = gst_clock_get_time(clock);
+    const GstClockTimeDiff  offset  = GstClockTimeDiff(mState->offset * GST_SECOND);
+
+    for (auto& item : mState->entries)
+    {
+        State::Entry    &entry  = item.second;
+        GstClockTime    target  = map(GstClockTime(entry.time * GST_SECOND));
+
+        if (GST_CLOCK_TIME_IS_VALID(target))
+            target = GstClockTimeDiff(target) > offset ? GstClockTime(GstClockTimeDiff(target) - offset) : 0;
+
+        // Already armed for this time
+        if (entry.armed != nullptr && isSameTime(entry.target, target))
+            continue;
+
+        mState->disarm(entry);
+
+        // Not reached, fired at this time already, or passed
+        if (!GST_CLOCK_TIME_IS_VALID(target) || isSameTime(entry.fired, target) || target + kGrace < now)
+            continue;
+
+        GstClockID id = gst_clock_new_single_shot_id(clock, target);
+
+        auto *pending = new State::Pending { mState, item.first, entry.time, target };
+        auto destroy  = [](gpointer data) { delete static_cast<State::Pending*>(data); };
+
+        if (gst_clock_id_wait_async(id, &State::onClock, pending, destroy) != GST_CLOCK_OK)
+        {
+            NSVR_LOG("Unable to schedule cue " << item.first << " on the clock.");
+            gst_clock_id_unref(id);
+            continue;
+        }
+
+        entry.armed     = id;
+        entry.target    = target;
+    }
+}
+
+void CueScheduler::unschedule()
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    mState->disarmAll();
+}
+
+void CueScheduler::quiesce()
+{
+    std::unique_lock<std::mutex> lock(mState->mutex);
+
+    mState->disarmAll();
+    mState->idle.wait(lock, [this] { return mState->firing == 0; });
+}
+
+void CueScheduler::shutdown()
+{
+    std::unique_lock<std::mutex> lock(mState->mutex);
+
+    mState->stopped = true;
+    mState->disarmAll();
+    mState->idle.wait(lock, [this] { return mState->firing == 0; });
+}
+
+CueStats CueScheduler::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mState->mutex);
+    return mState->stats;
+}
+
+}
@@ -2,11 +2,61 @@
 #include "nsvr/nsvr_discoverer.hpp"
 
 #include <gst/pbutils/gstdiscoverer.h>
+#include <glib/gstdio.h>
+
+#include <map>
+#include <mutex>
+
+namespace {
+
+/*!
+ * @struct  CacheEntry
+ * @brief   Discovery of a local file, valid while the file is unchanged.
+ */
+struct CacheEntry
+{
+    nsvr::Discoverer    discoverer;
+    goffset             size;
+    gint64              modified;   //!< Nanoseconds since the epoch
+};
+
+std::mutex                          cache_mutex;
+std::map<std::string, CacheEntry>   cache;
+bool                                cache_enabled = true;
+
+//! reads size and modification time (nanoseconds since the epoch) of the local file at "uri". Returns false if not a local file
+bool statUri(const std::string& uri, goffset& size, gint64& modified)
+{
+    gchar *filename = g_filename_from_uri(uri.c_str(), nullptr, nullptr);
+
+    if (filename == nullptr)
+        return false;
+
+    BIND_TO_SCOPE(filename);
+    GStatBuf stat;
+
+    if (g_stat(filename, &stat) != 0)
+        return false;
+
+    size     = stat.st_size;
+    modified = gint64(stat.st_mtime) * G_GINT64_CONSTANT(1000000000);
+
+    // Files rewritten within a second differ by the fraction only
+#if defined(__APPLE__)
+    modified += stat.st_mtimespec.tv_nsec;
+#elif !defined(_WIN32)
+    modified += stat.st_mtim.tv_nsec;
+#endif
+
+    return true;
+}
+
+}
 
 namespace nsvr
 {
 
-bool Discoverer::open(const std::string& path)
+bool Discoverer::open(const std::string& path, gdouble timeout)
 {
     reset();
 
@@ -23,7 +73,6 @@ bool Discoverer::open(const std::string& path)
     }
 
     auto    success = false;
-    auto    timeout = 10;
     GError* errors  = nullptr;
 
     try
@@ -36,63 +85,22 @@ bool Discoverer::open(const std::string& path)
             return false;
         }
 
+        if (lookup())
+            return true;
+
         NSVR_LOG("About to discover media: " << getMediaUri() << " with timeout " << timeout << " seconds.");
         BIND_TO_SCOPE(errors);
 
-        if (GstDiscoverer *discoverer = gst_discoverer_new(timeout * GST_SECOND, &errors))
+        if (GstDiscoverer *discoverer = gst_discoverer_new(GstClockTime(timeout * GST_SECOND), &errors))
         {
             BIND_TO_SCOPE(discoverer);
             if (GstDiscovererInfo *info = gst_discoverer_discover_uri(discoverer, mMediaUri.c_str(), &errors))
             {
                 BIND_TO_SCOPE(info);
-                if (gst_discoverer_info_get_result(info) == GST_DISCOVERER_OK)
-                {
-                    if (GList *video_streams = gst_discoverer_info_get_video_streams(info))
-                    {
-                        mHasVideo = true;
-                        BIND_TO_SCOPE(video_streams);
-
-                        for (GList *curr = video_streams; curr; curr = curr->next)
-                        {
-                            GstDiscovererStreamInfo *curr_sinfo = (GstDiscovererStreamInfo *)curr->data;
-
-                            if (GST_IS_DISCOVERER_VIDEO_INFO(curr_sinfo))
-                            {
-                                mWidth      = gst_discoverer_video_info_get_width(GST_DISCOVERER_VIDEO_INFO(curr_sinfo));
-                                mHeight     = gst_discoverer_video_info_get_height(GST_DISCOVERER_VIDEO_INFO(curr_sinfo));
-                                mFrameRate  = gst_discoverer_video_info_get_framerate_num(GST_DISCOVERER_VIDEO_INFO(curr_sinfo))
-                                    / float(gst_discoverer_video_info_get_framerate_denom(GST_DISCOVERER_VIDEO_INFO(curr_sinfo)));
-                            }
-                        }
-                    }
-                    else
-                        NSVR_LOG("No video streams found in " << getMediaUri() << ".");
-
-                    if (GList *audio_streams = gst_discoverer_info_get_audio_streams(info))
-                    {
-                        mHasAudio = true;
-                        BIND_TO_SCOPE(audio_streams);
-
-                        for (GList *curr = audio_streams; curr; curr = curr->next)
-                        {
-                            GstDiscovererStreamInfo *curr_sinfo = (GstDiscovererStreamInfo *)curr->data;
-
-                            if (GST_IS_DISCOVERER_AUDIO_INFO(curr_sinfo))
-                            {
-                                mSampleRate = gst_discoverer_audio_info_get_sample_rate(GST_DISCOVERER_AUDIO_INFO(curr_sinfo));
-                                mBitRate    = gst_discoverer_audio_info_get_bitrate(GST_DISCOVERER_AUDIO_INFO(curr_sinfo));
-                            }
-                        }
-                    }
-                    else
-                        NSVR_LOG("No audio streams found in " << getMediaUri() << ".");
-
-                    mSeekable = gst_discoverer_info_get_seekable(info) != FALSE;
-                    mDuration = gst_discoverer_info_get_duration(info) / gdouble(GST_SECOND);
-                    success = true;
-                }
-                else
-                    NSVR_LOG("GstDiscovererResult is not GST_DISCOVERER_OK.");
+                success = read(info);
+
+                if (success)
+                    store();
             }
             else
                 NSVR_LOG("Unable to constrcut GstDiscovererInfo [" << errors->message << "].");
@@ -109,6 +117,118 @@ bool Discoverer::open(const std::string& path)
     return success;
 }
 
+bool Discoverer::read(GstDiscovererInfo* info)
+{
+    if (gst_discoverer_info_get_result(info) != GST_DISCOVERER_OK)
+    {
+        NSVR_LOG("GstDiscovererResult is not GST_DISCOVERER_OK.");
+        return false;
+    }
+
+    if (GList *video_streams = gst_discoverer_info_get_video_streams(info))
+    {
+        mHasVideo = true;
+        BIND_TO_SCOPE(video_streams);
+
+        for (GList *curr = video_streams; curr; curr = curr->next)
+        {
+            GstDiscovererStreamInfo *curr_sinfo = (GstDiscovererStreamInfo *)curr->data;
+
+            if (GST_IS_DISCOVERER_VIDEO_INFO(curr_sinfo))
+            {
+                mWidth      = gst_discoverer_video_info_get_width(GST_DISCOVERER_VIDEO_INFO(curr_sinfo));
+                mHeight     = gst_discoverer_video_info_get_height(GST_DISCOVERER_VIDEO_INFO(curr_sinfo));
+                mFrameRate  = gst_discoverer_video_info_get_framerate_num(GST_DISCOVERER_VIDEO_INFO(curr_sinfo))
+                    / float(gst_discoverer_video_info_get_framerate_denom(GST_DISCOVERER_VIDEO_INFO(curr_sinfo)));
+            }
+        }
+    }
+    else
+        NSVR_LOG("No video streams found in " << getMediaUri() << ".");
+
+    if (GList *audio_streams = gst_discoverer_info_get_audio_streams(info))
+    {
+        mHasAudio = true;
+        BIND_TO_SCOPE(audio_streams);
+
+        for (GList *curr = audio_streams; curr; curr = curr->next)
+        {
+            GstDiscovererStreamInfo *curr_sinfo = (GstDiscovererStreamInfo *)curr->data;
+
+            if (GST_IS_DISCOVERER_AUDIO_INFO(curr_sinfo))
+            {
+                mSampleRate = gst_discoverer_audio_info_get_sample_rate(GST_DISCOVERER_AUDIO_INFO(curr_sinfo));
+                mBitRate    = gst_discoverer_audio_info_get_bitrate(GST_DISCOVERER_AUDIO_INFO(curr_sinfo));
+            }
+        }
+    }
+    else
+        NSVR_LOG("No audio streams found in " << getMediaUri() << ".");
+
+    mSeekable = gst_discoverer_info_get_seekable(info) != FALSE;
+    mDuration = gst_discoverer_info_get_duration(info) / gdouble(GST_SECOND);
+
+    return true;
+}
+
+bool Discoverer::lookup()
+{
+    goffset size;
+    gint64  modified;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto entry = cache.find(mMediaUri);
+
+    if (entry == cache.end())
+        return false;
+
+    // Dropped once the file changed or is gone
+    if (!statUri(mMediaUri, size, modified) || size != entry->second.size || modified != entry->second.modified)
+    {
+        cache.erase(entry);
+        return false;
+    }
+
+    *this = entry->second.discoverer;
+    return true;
+}
+
+void Discoverer::store() const
+{
+    CacheEntry entry;
+
+    if (!statUri(mMediaUri, entry.size, entry.modified))
+        return;
+
+    entry.discoverer = *this;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    if (cache_enabled)
+        cache[mMediaUri] = entry;
+}
+
+void Discoverer::setCacheEnabled(bool on)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache_enabled = on;
+
+    if (!on)
+        cache.clear();
+}
+
+bool Discoverer::getCacheEnabled()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cache_enabled;
+}
+
+void Discoverer::clearCache()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+}
+
 gint Discoverer::getWidth() const
 {
     return mWidth;
@@ -0,0 +1,396 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_read_ahead.hpp"
+#include "nsvr/nsvr_uring_file.hpp"
+
+#include <gst/base/gstbasesrc.h>
+
+#include <cstring>
+
+namespace {
+
+const gchar*    kScheme         = "nsvrfile";
+const guint64   kDefaultWindow  = 32 * 1024 * 1024;
+const guint     kDefaultBlock   = 1024 * 1024;
+
+enum
+{
+    PROP_0,
+    PROP_LOCATION,
+    PROP_READ_AHEAD,
+    PROP_IO_URING_DEPTH,
+    PROP_IO_URING_BLOCK,
+    PROP_DIRECT
+};
+
+/*!
+ * @struct  GstNsvrFileSrc
+ * @brief   filesrc alike, reading through a ReadAheadFile so a thread keeps
+ *          prefetching ahead of the demuxer pulling from it. Handles
+ *          "nsvrfile://" URIs, file:// ones are left to filesrc.
+ * @details With "io-uring-depth" set, reads go through a UringFile instead,
+ *          buffers then wrap its blocks without copying. Falls back to the
+ *          ReadAheadFile where io_uring is unavailable.
+ */
+struct GstNsvrFileSrc
+{
+    GstBaseSrc              parent;
+
+    gchar                   *location;  //!< Path of the file read
+    guint64                 window;     //!< Bytes prefetched ahead of reads
+    guint                   depth;      //!< io_uring reads in flight, 0 if disabled
+    guint                   block;      //!< Bytes of an io_uring read
+    gboolean                direct;     //!< Flag, reading io_uring with O_DIRECT
+    nsvr::ReadAheadFile     *file;      //!< Open while started, unless uring is
+    nsvr::UringFile         *uring;     //!< Open while started if depth is set and io_uring available
+};
+
+struct GstNsvrFileSrcClass
+{
+    GstBaseSrcClass         parent_class;
+};
+
+GType gst_nsvr_file_src_get_type(void);
+void gst_nsvr_file_src_uri_init(gpointer iface, gpointer data);
+
+#define GST_NSVR_FILE_SRC(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), gst_nsvr_file_src_get_type(), GstNsvrFileSrc))
+
+GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+#define gst_nsvr_file_src_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE(GstNsvrFileSrc, gst_nsvr_file_src, GST_TYPE_BASE_SRC,
+    G_IMPLEMENT_INTERFACE(GST_TYPE_URI_HANDLER, gst_nsvr_file_src_uri_init));
+
+void gst_nsvr_file_src_finalize(GObject* object)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(object);
+
+    delete src->file;
+    delete src->uring;
+    g_free(src->location);
+
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+void gst_nsvr_file_src_set_property(GObject* object, guint id, const GValue* value, GParamSpec* pspec)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(object);
+
+    switch (id)
+    {
+    case PROP_LOCATION:
+        g_free(src->location);
+        src->location = g_value_dup_string(value);
+        break;
+    case PROP_READ_AHEAD:
+        src->window = g_value_get_uint64(value);
+        break;
+    case PROP_IO_URING_DEPTH:
+        src->depth = g_value_get_uint(value);
+        break;
+    case PROP_IO_URING_BLOCK:
+        src->block = g_value_get_uint(value);
+        break;
+    case PROP_DIRECT:
+        src->direct = g_value_get_boolean(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, id, pspec);
+        break;
+    }
+}
+
+void gst_nsvr_file_src_get_property(GObject* object, guint id, GValue* value, GParamSpec* pspec)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(object);
+
+    switch (id)
+    {
+    case PROP_LOCATION:
+        g_value_set_string(value, src->location);
+        break;
+    case PROP_READ_AHEAD:
+        g_value_set_uint64(value, src->window);
+        break;
+    case PROP_IO_URING_DEPTH:
+        g_value_set_uint(value, src->depth);
+        break;
+    case PROP_IO_URING_BLOCK:
+        g_value_set_uint(value, src->block);
+        break;
+    case PROP_DIRECT:
+        g_value_set_boolean(value, src->direct);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, id, pspec);
+        break;
+    }
+}
+
+gboolean gst_nsvr_file_src_start(GstBaseSrc* base_src)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(base_src);
+
+    if (src->location != nullptr && src->depth > 0 && nsvr::UringFile::isSupported())
+    {
+        if (src->uring->open(src->location, src->depth, src->block, src->direct != FALSE))
+            return TRUE;
+
+        NSVR_LOG("Unable to read " << src->location << " through io_uring, reading ahead on a thread instead.");
+    }
+
+    if (src->location == nullptr || !src->file->open(src->location, gsize(src->window)))
+    {
+        GST_ELEMENT_ERROR(src, RESOURCE, OPEN_READ, ("Unable to open \"%s\" for reading.", src->location ? src->location : ""), (nullptr));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean gst_nsvr_file_src_stop(GstBaseSrc* base_src)
+{
+    GST_NSVR_FILE_SRC(base_src)->file->close();
+    GST_NSVR_FILE_SRC(base_src)->uring->close();
+    return TRUE;
+}
+
+gboolean gst_nsvr_file_src_get_size(GstBaseSrc* base_src, guint64* size)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(base_src);
+
+    if (src->uring->isOpen())
+        *size = src->uring->getSize();
+    else if (src->file->isOpen())
+        *size = src->file->getSize();
+    else
+        return FALSE;
+
+    return TRUE;
+}
+
+gboolean gst_nsvr_file_src_is_seekable(GstBaseSrc* base_src)
+{
+    return TRUE;
+}
+
+GstFlowReturn gst_nsvr_file_src_fill(GstBaseSrc* base_src, guint64 offset, guint length, GstBuffer* buffer)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(base_src);
+    GstMapInfo      info;
+
+    if (gst_buffer_map(buffer, &info, GST_MAP_WRITE) == FALSE)
+        return GST_FLOW_ERROR;
+
+    const gssize read = src->file->read(offset, info.data, MIN(gsize(length), info.size));
+    gst_buffer_unmap(buffer, &info);
+
+    if (read < 0)
+    {
+        GST_ELEMENT_ERROR(src, RESOURCE, READ, ("Unable to read \"%s\".", src->location), (nullptr));
+        return GST_FLOW_ERROR;
+    }
+
+    if (read == 0)
+        return GST_FLOW_EOS;
+
+    gst_buffer_resize(buffer, 0, read);
+
+    GST_BUFFER_OFFSET(buffer)       = offset;
+    GST_BUFFER_OFFSET_END(buffer)   = offset + read;
+
+    return GST_FLOW_OK;
+}
+
+GstFlowReturn gst_nsvr_file_src_create(GstBaseSrc* base_src, guint64 offset, guint length, GstBuffer** buffer)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(base_src);
+
+    // Allocates a buffer and calls fill()
+    if (!src->uring->isOpen())
+        return GST_BASE_SRC_CLASS(parent_class)->create(base_src, offset, length, buffer);
+
+    GstBuffer *read = nullptr;
+    const GstFlowReturn result = src->uring->read(offset, length, &read);
+
+    if (result == GST_FLOW_ERROR)
+        GST_ELEMENT_ERROR(src, RESOURCE, READ, ("Unable to read \"%s\".", src->location), (nullptr));
+
+    if (result != GST_FLOW_OK)
+        return result;
+
+    // Downstream pulling into a buffer of its own gets a copy
+    if (*buffer != nullptr)
+    {
+        GstMapInfo info;
+
+        if (gst_buffer_map(read, &info, GST_MAP_READ) == FALSE)
+        {
+            gst_buffer_unref(read);
+            return GST_FLOW_ERROR;
+        }
+
+        gst_buffer_set_size(*buffer, gst_buffer_fill(*buffer, 0, info.data, info.size));
+        gst_buffer_unmap(read, &info);
+        gst_buffer_unref(read);
+    }
+    else
+    {
+        *buffer = read;
+    }
+
+    GST_BUFFER_OFFSET(*buffer)      = offset;
+    GST_BUFFER_OFFSET_END(*buffer)  = offset + gst_buffer_get_size(*buffer);
+
+    return GST_FLOW_OK;
+}
+
+void gst_nsvr_file_src_class_init(GstNsvrFileSrcClass* klass)
+{
+    GObjectClass    *gobject_class  = G_OBJECT_CLASS(klass);
+    GstElementClass *element_class  = GST_ELEMENT_CLASS(klass);
+    GstBaseSrcClass *base_src_class = GST_BASE_SRC_CLASS(klass);
+
+    gobject_class->finalize     = gst_nsvr_file_src_finalize;
+    gobject_class->set_property = gst_nsvr_file_src_set_property;
+    gobject_class->get_property = gst_nsvr_file_src_get_property;
+
+    g_object_class_install_property(gobject_class, PROP_LOCATION,
+        g_param_spec_string("location", "File Location", "Location of the file to read",
+            nullptr,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_READ_AHEAD,
+        g_param_spec_uint64("read-ahead", "Read Ahead", "Bytes prefetched ahead of reads (0 disables)",
+            0, G_MAXUINT64, kDefaultWindow,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_IO_URING_DEPTH,
+        g_param_spec_uint("io-uring-depth", "io_uring Depth", "Reads kept in flight through io_uring (0 disables, Linux 5.1+)",
+            0, 1024, 0,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_IO_URING_BLOCK,
+        g_param_spec_uint("io-uring-block", "io_uring Block", "Bytes of each io_uring read, rounded up to pages",
+            1, G_MAXUINT, kDefaultBlock,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_DIRECT,
+        g_param_spec_boolean("direct", "Direct", "Reads through io_uring bypass the page cache (O_DIRECT)",
+            FALSE,
+            GParamFlags(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    gst_element_class_set_static_metadata(element_class,
+        "NSVR file source", "Source/File",
+        "Reads from a local file, prefetching ahead of the reader on a thread of its own",
+        "NSVR");
+
+    gst_element_class_add_pad_template(element_class, gst_static_pad_template_get(&src_template));
+
+    base_src_class->start       = gst_nsvr_file_src_start;
+    base_src_class->stop        = gst_nsvr_file_src_stop;
+    base_src_class->get_size    = gst_nsvr_file_src_get_size;
+    base_src_class->is_seekable = gst_nsvr_file_src_is_seekable;
+    base_src_class->create      = gst_nsvr_file_src_create;
+    base_src_class->fill        = gst_nsvr_file_src_fill;
+}
+
+void gst_nsvr_file_src_init(GstNsvrFileSrc* src)
+{
+    src->location   = nullptr;
+    src->window     = kDefaultWindow;
+    src->depth      = 0;
+    src->block      = kDefaultBlock;
+    src->direct     = FALSE;
+    src->file       = new nsvr::ReadAheadFile;
+    src->uring      = new nsvr::UringFile;
+}
+
+GstURIType gst_nsvr_file_src_uri_get_type(GType type)
+{
+    return GST_URI_SRC;
+}
+
+const gchar* const* gst_nsvr_file_src_uri_get_protocols(GType type)
+{
+    static const gchar* protocols[] = { kScheme, nullptr };
+    return protocols;
+}
+
+gchar* gst_nsvr_file_src_uri_get_uri(GstURIHandler* handler)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(handler);
+
+    if (src->location == nullptr)
+        return nullptr;
+
+    gchar *uri = g_filename_to_uri(src->location, nullptr, nullptr);
+    BIND_TO_SCOPE(uri);
+
+    return uri != nullptr ? g_strdup(nsvr::internal::getFileSourceUri(uri).c_str()) : nullptr;
+}
+
+gboolean gst_nsvr_file_src_uri_set_uri(GstURIHandler* handler, const gchar* uri, GError** error)
+{
+    GstNsvrFileSrc *src = GST_NSVR_FILE_SRC(handler);
+
+    // "nsvrfile://..." is "file://..." otherwise
+    const std::string file_uri = std::string("file") + (uri + std::strlen(kScheme));
+    gchar *location = g_filename_from_uri(file_uri.c_str(), nullptr, error);
+
+    if (location == nullptr)
+        return FALSE;
+
+    g_free(src->location);
+    src->location = location;
+
+    return TRUE;
+}
+
+void gst_nsvr_file_src_uri_init(gpointer iface, gpointer data)
+{
+    GstURIHandlerInterface *handler = static_cast<GstURIHandlerInterface*>(iface);
+
+    handler->get_type       = gst_nsvr_file_src_uri_get_type;
+    handler->get_protocols  = gst_nsvr_file_src_uri_get_protocols;
+    handler->get_uri        = gst_nsvr_file_src_uri_get_uri;
+    handler->set_uri        = gst_nsvr_file_src_uri_set_uri;
+}
+
+}
+
+namespace nsvr {
+namespace internal {
+
+bool registerFileSource()
+{
+    // Registered within the process only, as no plugin provides it
+    static const bool registered =
+        gst_element_register(nullptr, "nsvrfilesrc", GST_RANK_PRIMARY, gst_nsvr_file_src_get_type()) != FALSE;
+
+    return registered;
+}
+
+std::string getFileSourceUri(const std::string& file_uri)
+{
+    g_return_val_if_fail(file_uri.compare(0, 5, "file:") == 0, file_uri);
+    return kScheme + file_uri.substr(4);
+}
+
+ReadAheadFile* getReadAheadFile(GstElement* element)
+{
+    if (element == nullptr || !G_TYPE_CHECK_INSTANCE_TYPE(element, gst_nsvr_file_src_get_type()))
+        return nullptr;
+
+    return GST_NSVR_FILE_SRC(element)->file;
+}
+
+UringFile* getUringFile(GstElement* element)
+{
+    if (element == nullptr || !G_TYPE_CHECK_INSTANCE_TYPE(element, gst_nsvr_file_src_get_type()))
+        return nullptr;
+
+    return GST_NSVR_FILE_SRC(element)->uring;
+}
+
+}}
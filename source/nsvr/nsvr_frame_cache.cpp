@@ -0,0 +1,161 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_frame_cache.hpp"
+
+#include <algorithm>
+
+namespace nsvr
+{
+
+FrameCache::FrameCache(gsize budget)
+    : mBudget(budget)
+    , mBytes(0)
+    , mDuration(GST_CLOCK_TIME_NONE)
+    , mRecording(false)
+    , mOverflow(false)
+    , mSealed(false)
+{}
+
+void FrameCache::arm()
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+
+    if (mSealed || mOverflow)
+        return;
+
+    clear();
+    mRecording = true;
+}
+
+void FrameCache::invalidate()
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+
+    // A sealed pass stays valid for the media no matter where we seek to
+    if (mSealed)
+        return;
+
+    clear();
+    mRecording = false;
+}
+
+bool FrameCache::record(GstClockTime pts, guint64 index, const guint8* data, gsize size)
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+
+    if (!mRecording)
+        return !mOverflow;
+
+    // Pre-rolled frames are handed off twice, once as preroll and
+    // once as the first sample. Only keep frames moving forward.
+    if (!GST_CLOCK_TIME_IS_VALID(pts) || (!mFrames.empty() && pts <= mFrames.back().pts))
+        return true;
+
+    if (mBytes + size > mBudget)
+    {
+        NSVR_LOG("Frame cache exceeded its budget of " << mBudget << " bytes, caching is disabled.");
+        clear();
+        mRecording  = false;
+        mOverflow   = true;
+        return false;
+    }
+
+    Frame frame;
+    frame.pts   = pts;
+    frame.index = index;
+    frame.data.assign(data, data + size);
+
+    mFrames.push_back(std::move(frame));
+    mBytes += size;
+
+    return true;
+}
+
+bool FrameCache::seal(GstClockTime duration)
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+
+    if (mSealed)
+        return true;
+
+    if (mRecording && !mFrames.empty() && GST_CLOCK_TIME_IS_VALID(duration) && duration > 0)
+    {
+        mDuration   = duration;
+        mSealed     = true;
+    }
+
+    mRecording = false;
+    return mSealed;
+}
+
+gint FrameCache::find(GstClockTime position) const
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+
+    if (!mSealed)
+        return -1;
+
+    auto next = std::upper_bound(mFrames.cbegin(), mFrames.cend(), position,
+        [](GstClockTime pos, const Frame& frame) { return pos < frame.pts; });
+
+    return next == mFrames.cbegin() ? 0 : gint(next - mFrames.cbegin()) - 1;
+}
+
+const guint8* FrameCache::getData(gint index) const
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+    g_return_val_if_fail(mSealed && index >= 0 && index < gint(mFrames.size()), nullptr);
+    return mFrames[index].data.data();
+}
+
+gsize FrameCache::getSize(gint index) const
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+    g_return_val_if_fail(mSealed && index >= 0 && index < gint(mFrames.size()), 0);
+    return mFrames[index].data.size();
+}
+
+guint64 FrameCache::getFrameIndex(gint index) const
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+    g_return_val_if_fail(mSealed && index >= 0 && index < gint(mFrames.size()), 0);
+    return mFrames[index].index;
+}
+
+GstClockTime FrameCache::getDuration() const
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+    return mSealed ? mDuration : GST_CLOCK_TIME_NONE;
+}
+
+gsize FrameCache::getBytes() const
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+    return mBytes;
+}
+
+gsize FrameCache::getBudget() const
+{
+    return mBudget;
+}
+
+bool FrameCache::getOverflow() const
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+    return mOverflow;
+}
+
+bool FrameCache::getSealed() const
+{
+    std::lock_guard<decltype(mGuard)> lock(mGuard);
+    return mSealed;
+}
+
+void FrameCache::clear()
+{
+    mFrames.clear();
+    mFrames.shrink_to_fit();
+    mBytes      = 0;
+    mDuration   = GST_CLOCK_TIME_NONE;
+}
+
+}
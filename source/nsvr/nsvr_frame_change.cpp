@@ -0,0 +1,393 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_frame_change.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define NSVR_HASH_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   include <arm_neon.h>
+#   define NSVR_HASH_NEON 1
+#endif
+
+namespace {
+
+const gsize     kGroupBytes = 64;               //!< Bytes hashed between two scrambles of the accumulator
+const guint32   kPrime      = 0x9E3779B1u;      //!< Multiplier of the scramble
+const guint64   kSeed[2]    = { 0x27D4EB2F165667C5ull, 0x85EBCA77C2B2AE63ull };
+
+//! Keys of the 4 blocks of a group, so blocks swapped within it hash differently
+const guint64   kKeys[4][2] =
+{
+    { 0xBE4BA423396CFEB8ull, 0x1CAD21F72C81017Cull },
+    { 0xDB979083E96DD4DEull, 0x1F67B3B7A4A44072ull },
+    { 0x78E5C0CC4EE679CBull, 0x2172FFCC7DD05A82ull },
+    { 0x8E2443F7744608B8ull, 0x4C263A81E69035E0ull },
+};
+
+const guint64   kScramble[2] = { 0xCB79E64EB94BD0BBull, 0xD8ACDEA946EF1938ull };
+
+//! answers the 8 bytes at "data" as a little endian 64bit word
+inline guint64 load64(const guint8* data)
+{
+    guint64 value;
+    std::memcpy(&value, data, sizeof(value));
+    return GUINT64_FROM_LE(value);
+}
+
+}
+
+namespace nsvr {
+namespace internal {
+
+//! hashGroup(...) on 64bit integers, SIMD paths answer the same hash
+void hashGroupScalar(guint64* acc, const guint8* data)
+{
+    for (gint block = 0; block < 4; ++block)
+    {
+        const guint64 d0 = load64(data + block * 16);
+        const guint64 d1 = load64(data + block * 16 + 8);
+        const guint64 x0 = d0 ^ kKeys[block][0];
+        const guint64 x1 = d1 ^ kKeys[block][1];
+
+        acc[0] += d1 + (x0 & 0xFFFFFFFFull) * (x0 >> 32);
+        acc[1] += d0 + (x1 & 0xFFFFFFFFull) * (x1 >> 32);
+    }
+
+    for (gint lane = 0; lane < 2; ++lane)
+    {
+        guint64 a = acc[lane];
+        a ^= a >> 47;
+        a ^= kScramble[lane];
+        acc[lane] = a * kPrime;
+    }
+}
+
+/*!
+ * Accumulates the 64 bytes at "data" into the 2 lanes of "acc". Each block
+ * of 16 adds its lanes swapped plus the product of the halves of each lane
+ * xored with its key (as XXH3 does), then lanes are scrambled so groups
+ * further on weigh differently. All paths answer the same hash.
+ */
+void hashGroup(guint64* acc, const guint8* data)
+{
+#if defined(NSVR_HASH_SSE2)
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc));
+
+    for (gint block = 0; block < 4; ++block)
+    {
+        const __m128i d     = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + block * 16));
+        const __m128i xk    = _mm_xor_si128(d, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kKeys[block])));
+        const __m128i prod  = _mm_mul_epu32(xk, _mm_shuffle_epi32(xk, _MM_SHUFFLE(0, 3, 0, 1)));
+
+        a = _mm_add_epi64(a, _mm_add_epi64(_mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)), prod));
+    }
+
+    const __m128i prime = _mm_set1_epi32(gint(kPrime));
+
+    a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+    a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kScramble)));
+    a = _mm_add_epi64(_mm_mul_epu32(a, prime), _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), prime), 32));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(acc), a);
+#elif defined(NSVR_HASH_NEON)
+    uint64x2_t a = vld1q_u64(reinterpret_cast<const uint64_t*>(acc));
+
+    for (gint block = 0; block < 4; ++block)
+    {
+        const uint64x2_t d      = vreinterpretq_u64_u8(vld1q_u8(data + block * 16));
+        const uint64x2_t xk     = veorq_u64(d, vld1q_u64(reinterpret_cast<const uint64_t*>(kKeys[block])));
+        const uint64x2_t prod   = vmull_u32(vmovn_u64(xk), vshrn_n_u64(xk, 32));
+
+        a = vaddq_u64(a, vaddq_u64(vextq_u64(d, d, 1), prod));
+    }
+
+    const uint32x2_t prime = vdup_n_u32(kPrime);
+
+    a = veorq_u64(a, vshrq_n_u64(a, 47));
+    a = veorq_u64(a, vld1q_u64(reinterpret_cast<const uint64_t*>(kScramble)));
+    a = vaddq_u64(vmull_u32(vmovn_u64(a), prime), vshlq_n_u64(vmull_u32(vshrn_n_u64(a, 32), prime), 32));
+
+    vst1q_u64(reinterpret_cast<uint64_t*>(acc), a);
+#else
+    hashGroupScalar(acc, data);
+#endif
+}
+
+}}
+
+namespace {
+
+//! accumulates "length" bytes at "data" into "acc", a tail shorter than a group padded with zeros
+void hashSegment(guint64* acc, const guint8* data, gsize length)
+{
+    gsize offset = 0;
+
+    for (; offset + kGroupBytes <= length; offset += kGroupBytes)
+        nsvr::internal::hashGroup(acc, data + offset);
+
+    if (offset < length)
+    {
+        guint8 tail[kGroupBytes] = { 0 };
+        std::memcpy(tail, data + offset, length - offset);
+        nsvr::internal::hashGroup(acc, tail);
+    }
+
+    // Rows of different lengths hash differently even if padded the same
+    acc[0] ^= length;
+}
+
+}
+
+namespace nsvr
+{
+
+bool FrameChange::isTileChanged(guint column, guint row) const
+{
+    if (tiles.empty())
+        return true;
+
+    return column < columns && row < rows && tiles[row * columns + column] != 0;
+}
+
+std::vector<FrameRegion> FrameChange::getRegions() const
+{
+    std::vector<FrameRegion> regions;
+
+    if (tiles.empty())
+    {
+        if (changed && width > 0 && height > 0)
+        {
+            FrameRegion whole;
+            whole.width     = width;
+            whole.height    = height;
+            regions.push_back(whole);
+        }
+
+        return regions;
+    }
+
+    for (guint row = 0; row < rows; ++row)
+    {
+        for (guint column = 0; column < columns; ++column)
+        {
+            if (tiles[row * columns + column] == 0)
+                continue;
+
+            guint last = column;
+
+            while (last + 1 < columns && tiles[row * columns + last + 1] != 0)
+                ++last;
+
+            FrameRegion region;
+            region.x        = gint(column * tileSize);
+            region.y        = gint(row * tileSize);
+            region.width    = std::min(gint((last + 1) * tileSize), width) - region.x;
+            region.height   = std::min(gint((row + 1) * tileSize), height) - region.y;
+            regions.push_back(region);
+
+            column = last;
+        }
+    }
+
+    return regions;
+}
+
+void FrameChange::merge(const FrameChange& other)
+{
+    if (!other.changed)
+        return;
+
+    // Tiles laid out differently are not comparable, the whole frame changed
+    if (tiles.empty() || other.tiles.empty() || tiles.size() != other.tiles.size())
+    {
+        changed         = true;
+        changedTiles    = 0;
+        tiles.clear();
+        return;
+    }
+
+    changed         = true;
+    changedTiles    = 0;
+
+    for (gsize i = 0; i < tiles.size(); ++i)
+    {
+        tiles[i] |= other.tiles[i];
+        changedTiles += tiles[i];
+    }
+}
+
+FrameChangeDetector::FrameChangeDetector(guint tile_size)
+    : mTileSize((std::max(tile_size, 4u) + 3) & ~3u)
+    , mResetPending(false)
+{
+    gst_video_info_init(&mInfo);
+}
+
+FrameChangeDetector::~FrameChangeDetector()
+{
+    if (mCaps != nullptr)
+        gst_caps_unref(mCaps);
+}
+
+guint FrameChangeDetector::getTileSize() const
+{
+    return mTileSize;
+}
+
+bool FrameChangeDetector::detect(GstSample* sample, FrameChange& change)
+{
+    change = FrameChange();
+
+    GstCaps     *caps   = gst_sample_get_caps(sample);
+    GstBuffer   *buffer = gst_sample_get_buffer(sample);
+
+    if (caps == nullptr || buffer == nullptr)
+        return false;
+
+    // Caps only change on renegotiation (QoS resolution changes), parse them once
+    if (mCaps == nullptr || (caps != mCaps && gst_caps_is_equal(caps, mCaps) == FALSE))
+    {
+        mValid = gst_video_info_from_caps(&mInfo, caps) != FALSE && GST_VIDEO_INFO_WIDTH(&mInfo) > 0;
+
+        if (!mValid)
+            NSVR_LOG("Unable to detect frame changes, frames are not raw video.");
+
+        mColumns    = mValid ? (guint(GST_VIDEO_INFO_WIDTH(&mInfo)) + mTileSize - 1) / mTileSize : 0;
+        mRows       = mValid ? (guint(GST_VIDEO_INFO_HEIGHT(&mInfo)) + mTileSize - 1) / mTileSize : 0;
+
+        gst_caps_replace(&mCaps, caps);
+        mReference.clear();
+    }
+
+    if (!mValid)
+        return false;
+
+    GstVideoFrame frame;
+
+    if (gst_video_frame_map(&frame, &mInfo, buffer, GST_MAP_READ) == FALSE)
+        return false;
+
+    const gint64 started = g_get_monotonic_time();
+
+    hash(frame);
+
+    const gdouble elapsed = (g_get_monotonic_time() - started) / gdouble(G_USEC_PER_SEC);
+
+    gst_video_frame_unmap(&frame);
+
+    if (mResetPending.exchange(false))
+        mReference.clear();
+
+    change.width    = GST_VIDEO_INFO_WIDTH(&mInfo);
+    change.height   = GST_VIDEO_INFO_HEIGHT(&mInfo);
+    change.tileSize = mTileSize;
+    change.columns  = mColumns;
+    change.rows     = mRows;
+    change.tiles.assign(mColumns * mRows, 1);
+
+    if (mReference.size() == mHashes.size())
+    {
+        for (gsize tile = 0; tile < change.tiles.size(); ++tile)
+        {
+            change.tiles[tile] = mHashes[tile * 2] != mReference[tile * 2] || mHashes[tile * 2 + 1] != mReference[tile * 2 + 1];
+        }
+    }
+
+    for (guint8 tile : change.tiles)
+        change.changedTiles += tile;
+
+    change.changed = change.changedTiles > 0;
+
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+
+    mStats.hashed   += 1;
+    mStats.last     = elapsed;
+    mStats.maximum  = std::max(mStats.maximum, elapsed);
+    mStats.average  += (elapsed - mStats.average) / mStats.hashed;
+
+    if (!change.changed)
+    {
+        mStats.unchanged += 1;
+    }
+    else if (!change.tiles.empty())
+    {
+        const guint64 changed_frames = mStats.hashed - mStats.unchanged;
+        mStats.tiles += (change.changedTiles / gdouble(change.tiles.size()) - mStats.tiles) / changed_frames;
+    }
+
+    return true;
+}
+
+void FrameChangeDetector::accept()
+{
+    mReference = mHashes;
+}
+
+void FrameChangeDetector::reset()
+{
+    mResetPending = true;
+}
+
+FrameChangeStats FrameChangeDetector::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+    return mStats;
+}
+
+void FrameChangeDetector::hash(const GstVideoFrame& frame)
+{
+    const gint width    = GST_VIDEO_FRAME_WIDTH(&frame);
+    const gint height   = GST_VIDEO_FRAME_HEIGHT(&frame);
+
+    mHashes.resize(gsize(mColumns) * mRows * 2);
+
+    for (gsize tile = 0; tile < mHashes.size(); tile += 2)
+    {
+        mHashes[tile]       = kSeed[0];
+        mHashes[tile + 1]   = kSeed[1];
+    }
+
+    std::vector<gsize> bounds(mColumns + 1);
+
+    for (guint plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(&frame); ++plane)
+    {
+        // First component stored in the plane gives its size, subsampled or not
+        guint comp = 0;
+
+        while (comp + 1 < GST_VIDEO_FRAME_N_COMPONENTS(&frame) && GST_VIDEO_FRAME_COMP_PLANE(&frame, comp) != plane)
+            ++comp;
+
+        const guint8    *data           = static_cast<const guint8*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, plane));
+        const gint      stride          = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, plane);
+        const gint      plane_height    = GST_VIDEO_FRAME_COMP_HEIGHT(&frame, comp);
+        const gint      pixel_stride    = GST_VIDEO_FRAME_COMP_PSTRIDE(&frame, comp);
+
+        // Packed formats of no pixel stride (v210) are hashed up to the stride
+        const gsize row_bytes = pixel_stride > 0
+            ? gsize(GST_VIDEO_FRAME_COMP_WIDTH(&frame, comp)) * pixel_stride
+            : gsize(std::abs(stride));
+
+        // Tiles split rows proportionally, so each byte of a subsampled plane falls in one tile
+        for (guint column = 0; column <= mColumns; ++column)
+        {
+            const guint64 x = std::min(guint64(column) * mTileSize, guint64(width));
+            bounds[column] = gsize(x * row_bytes / guint64(width));
+        }
+
+        for (gint row = 0; row < plane_height; ++row)
+        {
+            const guint8    *line       = data + gssize(row) * stride;
+            const guint     tile_row    = guint(guint64(row) * height / plane_height) / mTileSize;
+            guint64         *acc        = mHashes.data() + gsize(tile_row) * mColumns * 2;
+
+            for (guint column = 0; column < mColumns; ++column)
+                hashSegment(acc + column * 2, line + bounds[column], bounds[column + 1] - bounds[column]);
+        }
+    }
+}
+
+}
@@ -0,0 +1,479 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_frame_pool.hpp"
+
+#include <gst/video/video.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/syscall.h>
+#endif
+
+#ifndef MPOL_PREFERRED
+#   define MPOL_PREFERRED 1
+#endif
+
+namespace nsvr
+{
+
+namespace {
+
+const gsize kHugePageSize = 2 * 1024 * 1024;   // Huge page size of x86-64 and most arm64 kernels
+
+/*!
+ * @struct ArenaCounters
+ * @brief  Counters shared by every arena of a FramePool.
+ */
+struct ArenaCounters
+{
+    std::atomic<guint64>    served      { 0 };
+    std::atomic<guint64>    fallbacks   { 0 };
+};
+
+/*!
+ * @class  FrameArena
+ * @brief  One mapping cut in fixed-size slots, handed out and taken back
+ *         through a free list.
+ */
+class FrameArena
+{
+public:
+    FrameArena(gsize size, guint slots, gint node, std::shared_ptr<ArenaCounters> counters);
+    ~FrameArena();
+
+    //! answers a free slot, nullptr if all are in use
+    guint8*     acquire();
+
+    //! gives "slot" back to the free list
+    void        release(guint8* slot);
+
+    //! answers true if the arena could be mapped
+    bool        isValid() const { return mData != nullptr; }
+
+    gsize       getSlotSize() const { return mSlotSize; }
+    guint       getSlotCount() const { return mSlotCount; }
+    bool        getHugePages() const { return mHugePages; }
+
+    std::shared_ptr<ArenaCounters> counters;
+
+private:
+    //! maps "size" bytes, huge pages first. Answers nullptr on failure
+    guint8*     map(gsize size);
+
+    //! binds "size" bytes at "data" to NUMA node "node"
+    void        bind(guint8* data, gsize size, gint node);
+
+    std::mutex              mMutex;
+    std::vector<guint8*>    mFree;
+    guint8                  *mData;
+    gsize                   mSize;
+    gsize                   mSlotSize;
+    guint                   mSlotCount;
+    bool                    mHugePages;
+};
+
+FrameArena::FrameArena(gsize size, guint slots, gint node, std::shared_ptr<ArenaCounters> counters)
+    : counters(counters)
+    , mData(nullptr)
+    , mSize(0)
+    , mSlotSize(0)
+    , mSlotCount(0)
+    , mHugePages(false)
+{
+    // Slots start on page boundaries, huge ones if the frame spans a huge page
+    const gsize page = size >= kHugePageSize ? kHugePageSize : internal::getPageSize();
+
+    mSlotSize   = (size + page - 1) / page * page;
+    mSlotCount  = slots;
+    mData       = map(mSlotSize * mSlotCount);
+
+    if (mData == nullptr)
+        return;
+
+    bind(mData, mSize, node);
+
+    // Pre-fault now so streaming threads never do
+    std::memset(mData, 0, mSize);
+
+    for (guint slot = mSlotCount; slot > 0; --slot)
+        mFree.push_back(mData + (slot - 1) * mSlotSize);
+}
+
+FrameArena::~FrameArena()
+{
+    if (mData == nullptr)
+        return;
+
+#ifdef _WIN32
+    ::VirtualFree(mData, 0, MEM_RELEASE);
+#else
+    ::munmap(mData, mSize);
+#endif
+}
+
+guint8* FrameArena::acquire()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mFree.empty())
+        return nullptr;
+
+    guint8 *slot = mFree.back();
+    mFree.pop_back();
+
+    return slot;
+}
+
+void FrameArena::release(guint8* slot)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFree.push_back(slot);
+}
+
+guint8* FrameArena::map(gsize size)
+{
+#ifdef _WIN32
+    // Large pages need SeLockMemoryPrivilege, which most accounts lack
+    const SIZE_T large = ::GetLargePageMinimum();
+
+    if (large > 0)
+    {
+        const gsize rounded = (size + large - 1) / large * large;
+
+        if (void *data = ::VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE))
+        {
+            mSize       = rounded;
+            mHugePages  = true;
+            return static_cast<guint8*>(data);
+        }
+    }
+
+    if (void *data = ::VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE))
+    {
+        mSize = size;
+        return static_cast<guint8*>(data);
+    }
+#else
+    const gsize rounded = (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+
+#   ifdef MAP_HUGETLB
+    // Explicit huge pages, only there if the administrator reserved some
+    void *data = ::mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (data != MAP_FAILED)
+    {
+        mSize       = rounded;
+        mHugePages  = true;
+        return static_cast<guint8*>(data);
+    }
+#   endif
+
+    data = ::mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (data != MAP_FAILED)
+    {
+        mSize = rounded;
+
+#   ifdef MADV_HUGEPAGE
+        // Transparent huge pages, if the kernel has them in "madvise" or "always" mode
+        mHugePages = ::madvise(data, rounded, MADV_HUGEPAGE) == 0;
+#   endif
+
+        return static_cast<guint8*>(data);
+    }
+#endif
+
+    NSVR_LOG("Unable to map a frame arena of " << size << " bytes.");
+    return nullptr;
+}
+
+void FrameArena::bind(guint8* data, gsize size, gint node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    if (node < 0 || node >= gint(sizeof(unsigned long) * 8))
+        return;
+
+    // Preferred rather than strict: a full node spills over instead of failing
+    unsigned long mask = 1UL << node;
+
+    if (::syscall(SYS_mbind, data, size, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0) != 0)
+        NSVR_LOG("Unable to bind frame arena to NUMA node " << node << ".");
+#endif
+}
+
+/*!
+ * @struct ArenaMemory
+ * @brief  GstMemory wrapping one slot of a FrameArena.
+ */
+struct ArenaMemory
+{
+    GstMemory       mem;
+    guint8          *data;
+};
+
+/*!
+ * @struct NsvrArenaAllocator
+ * @brief  GstAllocator handing out slots of a FrameArena, system memory
+ *         once the arena is full or the request does not fit a slot.
+ */
+struct NsvrArenaAllocator
+{
+    GstAllocator    parent;
+    FrameArena      *arena;
+};
+
+struct NsvrArenaAllocatorClass
+{
+    GstAllocatorClass parent_class;
+};
+
+GType nsvr_arena_allocator_get_type();
+
+#define nsvr_arena_allocator_parent_class parent_class
+G_DEFINE_TYPE(NsvrArenaAllocator, nsvr_arena_allocator, GST_TYPE_ALLOCATOR);
+
+GstMemory* nsvr_arena_allocator_alloc(GstAllocator* allocator, gsize size, GstAllocationParams* params)
+{
+    FrameArena *arena = reinterpret_cast<NsvrArenaAllocator*>(allocator)->arena;
+
+    const gsize total   = size + params->prefix + params->padding;
+    guint8      *slot   = total <= arena->getSlotSize() ? arena->acquire() : nullptr;
+
+    if (slot == nullptr)
+    {
+        ++arena->counters->fallbacks;
+        return gst_allocator_alloc(nullptr, size, params);
+    }
+
+    ++arena->counters->served;
+
+    ArenaMemory *memory = g_slice_new(ArenaMemory);
+    memory->data = slot;
+
+    // Slots are not shareable, sub-buffers copy instead
+    gst_memory_init(GST_MEMORY_CAST(memory),
+        GstMemoryFlags(params->flags | GST_MEMORY_FLAG_NO_SHARE),
+        allocator, nullptr, arena->getSlotSize(), 0, params->prefix, size);
+
+    return GST_MEMORY_CAST(memory);
+}
+
+void nsvr_arena_allocator_free(GstAllocator* allocator, GstMemory* mem)
+{
+    ArenaMemory *memory = reinterpret_cast<ArenaMemory*>(mem);
+
+    reinterpret_cast<NsvrArenaAllocator*>(allocator)->arena->release(memory->data);
+    g_slice_free(ArenaMemory, memory);
+}
+
+gpointer arena_memory_map(GstMemory* mem, gsize maxsize, GstMapFlags flags)
+{
+    return reinterpret_cast<ArenaMemory*>(mem)->data;
+}
+
+void arena_memory_unmap(GstMemory* mem)
+{}
+
+void nsvr_arena_allocator_finalize(GObject* object)
+{
+    delete reinterpret_cast<NsvrArenaAllocator*>(object)->arena;
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+void nsvr_arena_allocator_class_init(NsvrArenaAllocatorClass* klass)
+{
+    GST_ALLOCATOR_CLASS(klass)->alloc   = nsvr_arena_allocator_alloc;
+    GST_ALLOCATOR_CLASS(klass)->free    = nsvr_arena_allocator_free;
+    G_OBJECT_CLASS(klass)->finalize     = nsvr_arena_allocator_finalize;
+}
+
+void nsvr_arena_allocator_init(NsvrArenaAllocator* allocator)
+{
+    GstAllocator *base = GST_ALLOCATOR_CAST(allocator);
+
+    base->mem_type  = "nsvr-arena";
+    base->mem_map   = arena_memory_map;
+    base->mem_unmap = arena_memory_unmap;
+
+    allocator->arena = nullptr;
+
+    GST_OBJECT_FLAG_SET(allocator, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+}
+
+}
+
+FramePool::FramePool(guint slots)
+    : mAllocator(nullptr)
+    , mPad(nullptr)
+    , mProbe(0)
+    , mSlots(MAX(slots, 1u))
+    , mNode(getCurrentNumaNode())
+{
+    mStats.slotCount    = mSlots;
+    mStats.numaNode     = mNode;
+}
+
+FramePool::~FramePool()
+{
+    uninstall();
+
+    if (mAllocator != nullptr)
+        gst_object_unref(mAllocator);
+}
+
+bool FramePool::install(GstElement* app_sink)
+{
+    g_return_val_if_fail(app_sink != nullptr, false);
+
+    uninstall();
+
+    if ((mPad = gst_element_get_static_pad(app_sink, "sink")) == nullptr)
+    {
+        NSVR_LOG("Unable to obtain sink pad to install frame pool on.");
+        return false;
+    }
+
+    mProbe = gst_pad_add_probe(mPad, GstPadProbeType(GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM | GST_PAD_PROBE_TYPE_PUSH),
+        reinterpret_cast<GstPadProbeCallback>(onQuery), this, nullptr);
+
+    return mProbe != 0;
+}
+
+void FramePool::uninstall()
+{
+    if (mPad == nullptr)
+        return;
+
+    if (mProbe != 0)
+        gst_pad_remove_probe(mPad, mProbe);
+
+    gst_object_unref(mPad);
+
+    mPad    = nullptr;
+    mProbe  = 0;
+}
+
+GstAllocator* FramePool::getAllocator(gsize size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mAllocator != nullptr && mStats.slotSize >= size)
+        return GST_ALLOCATOR(gst_object_ref(mAllocator));
+
+    auto counters = mAllocator != nullptr
+        ? reinterpret_cast<NsvrArenaAllocator*>(mAllocator)->arena->counters
+        : std::make_shared<ArenaCounters>();
+
+    std::unique_ptr<FrameArena> arena(new FrameArena(size, mSlots, mNode, counters));
+
+    if (!arena->isValid())
+        return nullptr;
+
+    // Memories of the previous arena keep it (and its allocator) alive until freed
+    if (mAllocator != nullptr)
+        gst_object_unref(mAllocator);
+
+    mAllocator = GST_ALLOCATOR(g_object_new(nsvr_arena_allocator_get_type(), nullptr));
+    reinterpret_cast<NsvrArenaAllocator*>(mAllocator)->arena = arena.release();
+
+    mStats.slotSize     = reinterpret_cast<NsvrArenaAllocator*>(mAllocator)->arena->getSlotSize();
+    mStats.hugePages    = reinterpret_cast<NsvrArenaAllocator*>(mAllocator)->arena->getHugePages();
+    mStats.arenas++;
+
+    return GST_ALLOCATOR(gst_object_ref(mAllocator));
+}
+
+FramePoolStats FramePool::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    FramePoolStats stats = mStats;
+
+    if (mAllocator != nullptr)
+    {
+        const auto& counters = reinterpret_cast<NsvrArenaAllocator*>(mAllocator)->arena->counters;
+
+        stats.served    = counters->served;
+        stats.fallbacks = counters->fallbacks;
+    }
+
+    return stats;
+}
+
+gint FramePool::getCurrentNumaNode()
+{
+#if defined(_WIN32)
+    UCHAR node = 0;
+
+    if (::GetNumaProcessorNode(UCHAR(::GetCurrentProcessorNumber()), &node) != FALSE)
+        return node;
+#elif defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return gint(node);
+#endif
+
+    return -1;
+}
+
+GstPadProbeReturn FramePool::onQuery(GstPad* pad, GstPadProbeInfo* info, FramePool* pool)
+{
+    GstQuery *query = GST_PAD_PROBE_INFO_QUERY(info);
+
+    if (pool == nullptr || GST_QUERY_TYPE(query) != GST_QUERY_ALLOCATION)
+        return GST_PAD_PROBE_OK;
+
+    GstCaps     *caps       = nullptr;
+    gboolean    need_pool   = FALSE;
+    GstVideoInfo video_info;
+
+    gst_query_parse_allocation(query, &caps, &need_pool);
+
+    if (caps == nullptr || gst_video_info_from_caps(&video_info, caps) == FALSE)
+        return GST_PAD_PROBE_OK;
+
+    const gsize size = GST_VIDEO_INFO_SIZE(&video_info);
+
+    GstAllocator *allocator = pool->getAllocator(size);
+
+    if (allocator == nullptr)
+        return GST_PAD_PROBE_OK;
+
+    GstAllocationParams params;
+    gst_allocation_params_init(&params);
+
+    gst_query_add_allocation_param(query, allocator, &params);
+
+    if (need_pool != FALSE)
+    {
+        GstBufferPool   *buffer_pool    = gst_buffer_pool_new();
+        GstStructure    *config         = gst_buffer_pool_get_config(buffer_pool);
+
+        // Arena slots are allocated up front, buffers past them come from system memory
+        gst_buffer_pool_config_set_params(config, caps, guint(size), pool->mSlots, 0);
+        gst_buffer_pool_config_set_allocator(config, allocator, &params);
+
+        if (gst_buffer_pool_set_config(buffer_pool, config) != FALSE)
+            gst_query_add_allocation_pool(query, buffer_pool, guint(size), pool->mSlots, 0);
+
+        gst_object_unref(buffer_pool);
+    }
+
+    gst_object_unref(allocator);
+
+#if GST_CHECK_VERSION(1, 6, 0)
+    return GST_PAD_PROBE_HANDLED;
+#else
+    return GST_PAD_PROBE_OK;
+#endif
+}
+
+}
@@ -0,0 +1,531 @@
+#include "nsvr_internal.hpp"
+#include "nsvr_frame_store_header.hpp"
+#include "nsvr/nsvr_frame_store.hpp"
+#include "nsvr/nsvr_discoverer.hpp"
+
+#include <gst/app/gstappsink.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+namespace {
+
+using nsvr::internal::StoreHeader;
+using nsvr::internal::STORE_MAGIC;
+using nsvr::internal::STORE_VERSION;
+
+guint64 roundUp(guint64 value, guint64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//! stores "a" + "b" in "result". Answers false if it overflows
+bool addChecked(guint64 a, guint64 b, guint64& result)
+{
+    if (b > G_MAXUINT64 - a)
+        return false;
+
+    result = a + b;
+    return true;
+}
+
+//! stores "a" * "b" in "result". Answers false if it overflows
+bool multiplyChecked(guint64 a, guint64 b, guint64& result)
+{
+    if (a != 0 && b > G_MAXUINT64 / a)
+        return false;
+
+    result = a * b;
+    return true;
+}
+
+}
+
+namespace nsvr
+{
+
+/*!
+ * @struct FrameStore::Mapping
+ * @brief  Read-only mapping of a whole store file. Unmapped on destruction.
+ */
+struct FrameStore::Mapping
+{
+    ~Mapping();
+
+    //! maps the file at "path". Returns true on success
+    bool        map(const std::string& path);
+
+    //! asks the kernel to page in given range of the file ahead of time
+    void        advise(guint64 offset, guint64 length) const;
+
+    guint8      *data   = nullptr;
+    guint64     size    = 0;
+
+#ifdef _WIN32
+    HANDLE      file    = INVALID_HANDLE_VALUE;
+    HANDLE      handle  = nullptr;
+#endif
+};
+
+FrameStore::Mapping::~Mapping()
+{
+#ifdef _WIN32
+    if (data != nullptr)                ::UnmapViewOfFile(data);
+    if (handle != nullptr)              ::CloseHandle(handle);
+    if (file != INVALID_HANDLE_VALUE)   ::CloseHandle(file);
+#else
+    if (data != nullptr)                ::munmap(data, size);
+#endif
+}
+
+bool FrameStore::Mapping::map(const std::string& path)
+{
+#ifdef _WIN32
+    LARGE_INTEGER file_size;
+
+    if ((file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr)) == INVALID_HANDLE_VALUE ||
+        ::GetFileSizeEx(file, &file_size) == FALSE ||
+        (handle = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) == nullptr ||
+        (data = static_cast<guint8*>(::MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0))) == nullptr)
+    {
+        return false;
+    }
+
+    size = file_size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void *address = MAP_FAILED;
+
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        address = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping holds its own reference to the file
+    ::close(fd);
+
+    if (address == MAP_FAILED)
+        return false;
+
+    data = static_cast<guint8*>(address);
+    size = info.st_size;
+
+    // Playback pages in frames explicitly, see advise()
+    ::madvise(data, size, MADV_RANDOM);
+#endif
+
+    return true;
+}
+
+void FrameStore::Mapping::advise(guint64 offset, guint64 length) const
+{
+#ifndef _WIN32
+    if (data == nullptr || offset >= size)
+        return;
+
+    ::madvise(data + offset, MIN(length, size - offset), MADV_WILLNEED);
+#endif
+}
+
+FrameStore::FrameStore()
+    : mIndex(nullptr)
+    , mWidth(0)
+    , mHeight(0)
+    , mFrameRateNum(0)
+    , mFrameRateDenom(1)
+    , mFrameCount(0)
+    , mFrameSize(0)
+    , mFrameStride(0)
+    , mAdvisedBegin(0)
+    , mAdvisedEnd(0)
+    , mReadahead(8)
+{}
+
+FrameStore::~FrameStore()
+{
+    close();
+}
+
+bool FrameStore::build(const std::string& media, const std::string& store, gint width, gint height, const std::string& fmt)
+{
+    if (media.empty() || store.empty())
+    {
+        NSVR_LOG("Paths given to FrameStore are empty.");
+        return false;
+    }
+
+    if (fmt.empty() || fmt.size() >= sizeof(StoreHeader::format))
+    {
+        NSVR_LOG("Invalid format given to FrameStore: " << fmt);
+        return false;
+    }
+
+    Discoverer discoverer;
+
+    if (!discoverer.open(media) || !discoverer.getHasVideo())
+    {
+        NSVR_LOG("FrameStore requires a media with video: " << media);
+        return false;
+    }
+
+    GError* errors = nullptr;
+    BIND_TO_SCOPE(errors);
+
+    std::stringstream pipeline_cmd;
+
+    pipeline_cmd
+        << "uridecodebin uri=\""
+        << discoverer.getMediaUri()
+        << "\" ! videoconvert ! videoscale"
+        << " ! video/x-raw"
+        << ",width=" << width
+        << ",height=" << height
+        << ",format=" << fmt
+        << " ! appsink name=nsvrsink sync=false";
+
+    GstElement *pipeline = gst_parse_launch(pipeline_cmd.str().c_str(), &errors);
+    BIND_TO_SCOPE(pipeline);
+
+    if (pipeline == nullptr)
+    {
+        NSVR_LOG("Unable to launch the pipeline [" << errors->message << "].");
+        return false;
+    }
+
+    GstElement *app_sink = gst_bin_get_by_name(GST_BIN(pipeline), "nsvrsink");
+    BIND_TO_SCOPE(app_sink);
+
+    std::ofstream file(store, std::ios::binary | std::ios::trunc);
+
+    if (!file)
+    {
+        NSVR_LOG("Unable to open " << store << " for writing.");
+        return false;
+    }
+
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+    {
+        NSVR_LOG("Failed to put decoding pipeline in PLAYING state.");
+        return false;
+    }
+
+    StoreHeader             header;
+    std::vector<guint64>    index;
+    GstClockTime            first_pts = GST_CLOCK_TIME_NONE;
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    std::strncpy(header.format, fmt.c_str(), sizeof(header.format) - 1);
+
+    header.version      = STORE_VERSION;
+    header.alignment    = guint32(internal::getPageSize());
+    header.dataOffset   = roundUp(sizeof(header), header.alignment);
+
+    GstBus      *bus    = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+    GstMessage  *error  = nullptr;
+
+    BIND_TO_SCOPE(bus);
+
+    while (error == nullptr)
+    {
+#if GST_CHECK_VERSION(1, 10, 0)
+        GstSample *sample = gst_app_sink_try_pull_sample(GST_APP_SINK(app_sink), GST_SECOND);
+#else
+        GstSample *sample = gst_app_sink_pull_sample(GST_APP_SINK(app_sink));
+#endif
+        if (sample == nullptr)
+        {
+            // Either the end of the stream or decoding stopped on an error
+            if ((error = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR)) == nullptr &&
+                gst_app_sink_is_eos(GST_APP_SINK(app_sink)) != FALSE)
+                break;
+
+            continue;
+        }
+
+        BIND_TO_SCOPE(sample);
+
+        GstBuffer   *buffer = gst_sample_get_buffer(sample);
+        GstMapInfo  info;
+
+        if (buffer == nullptr || gst_buffer_map(buffer, &info, GST_MAP_READ) == FALSE)
+            continue;
+
+        if (header.frameCount == 0)
+        {
+            GstCaps         *caps   = gst_sample_get_caps(sample);
+            GstStructure    *str    = caps ? gst_caps_get_structure(caps, 0) : nullptr;
+
+            if (str != nullptr)
+            {
+                gst_structure_get_int(str, "width", &header.width);
+                gst_structure_get_int(str, "height", &header.height);
+
+                if (gst_structure_get_fraction(str, "framerate", &header.fpsNum, &header.fpsDenom) == FALSE ||
+                    header.fpsNum == 0)
+                {
+                    // Variable frame rate, fall back to the average rate
+                    header.fpsNum   = gint32(std::lround(discoverer.getFrameRate() * 1000));
+                    header.fpsDenom = 1000;
+                }
+            }
+
+            header.frameSize    = info.size;
+            header.frameStride  = roundUp(info.size, header.alignment);
+            first_pts           = GST_BUFFER_PTS(buffer);
+        }
+
+        if (info.size == header.frameSize)
+        {
+            guint64 offset  = header.dataOffset + header.frameCount * header.frameStride;
+            guint64 pts     = GST_CLOCK_TIME_IS_VALID(GST_BUFFER_PTS(buffer)) && GST_CLOCK_TIME_IS_VALID(first_pts)
+                ? GST_BUFFER_PTS(buffer) - first_pts
+                : GST_CLOCK_TIME_NONE;
+
+            file.seekp(offset);
+            file.write(reinterpret_cast<const char*>(info.data), info.size);
+
+            index.push_back(offset);
+            index.push_back(pts);
+            header.frameCount++;
+        }
+        else
+        {
+            NSVR_LOG("Skipped a frame of unexpected size " << info.size << " while building store.");
+        }
+
+        gst_buffer_unmap(buffer, &info);
+    }
+
+    if (error != nullptr)
+    {
+        BIND_TO_SCOPE(error);
+
+        GError* err = nullptr;
+        gchar*  dbg = nullptr;
+
+        BIND_TO_SCOPE(err);
+        BIND_TO_SCOPE(dbg);
+
+        gst_message_parse_error(error, &err, &dbg);
+        NSVR_LOG("Decoding pipeline encountered an error: [" << err->message << "] debug: [" << dbg << "].");
+
+        header.frameCount = 0;
+    }
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+
+    if (header.frameCount == 0 || header.fpsNum <= 0 || header.fpsDenom <= 0)
+    {
+        NSVR_LOG("No frames of a constant rate were decoded out of " << media << ".");
+        return false;
+    }
+
+    header.indexOffset = header.dataOffset + header.frameCount * header.frameStride;
+
+    file.seekp(header.indexOffset);
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(guint64));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+
+    if (!file)
+    {
+        NSVR_LOG("Failed writing frame store " << store << ".");
+        return false;
+    }
+
+    NSVR_LOG("Built frame store " << store << " with " << header.frameCount << " frames of " << header.frameSize << " bytes.");
+    return true;
+}
+
+bool FrameStore::build(const std::string& media, const std::string& store)
+{
+    Discoverer discoverer;
+    return discoverer.open(media) && build(media, store, discoverer.getWidth(), discoverer.getHeight(), "BGRA");
+}
+
+bool FrameStore::open(const std::string& store)
+{
+    close();
+
+    if (store.empty())
+    {
+        NSVR_LOG("Path given to FrameStore is empty.");
+        return false;
+    }
+
+    auto mapping = std::make_shared<Mapping>();
+
+    if (!mapping->map(store) || mapping->size < sizeof(StoreHeader))
+    {
+        NSVR_LOG("Unable to map frame store " << store << ".");
+        return false;
+    }
+
+    const StoreHeader *header = reinterpret_cast<const StoreHeader*>(mapping->data);
+
+    if (std::memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) != 0 || header->version != STORE_VERSION)
+    {
+        NSVR_LOG(store << " is not a frame store of version " << STORE_VERSION << ".");
+        return false;
+    }
+
+    guint64 data_size   = 0;
+    guint64 data_end    = 0;
+    guint64 index_size  = 0;
+    guint64 index_end   = 0;
+
+    // Sizes come from the file, none may wrap around
+    if (header->frameCount == 0 ||
+        header->frameSize == 0 ||
+        header->frameSize > header->frameStride ||
+        header->indexOffset % sizeof(guint64) != 0 ||
+        !multiplyChecked(header->frameCount, header->frameStride, data_size) ||
+        !addChecked(header->dataOffset, data_size, data_end) ||
+        data_end > header->indexOffset ||
+        !multiplyChecked(header->frameCount, 2 * sizeof(guint64), index_size) ||
+        !addChecked(header->indexOffset, index_size, index_end) ||
+        index_end > mapping->size)
+    {
+        NSVR_LOG("Frame store " << store << " is truncated or corrupt.");
+        return false;
+    }
+
+    const guint64 *index = reinterpret_cast<const guint64*>(mapping->data + header->indexOffset);
+
+    // getFrame() wraps frames as they are indexed, every one must lie within the file
+    for (guint64 i = 0; i < header->frameCount; ++i)
+    {
+        if (index[i * 2] > mapping->size || header->frameSize > mapping->size - index[i * 2])
+        {
+            NSVR_LOG("Frame store " << store << " indexes frame " << i << " past its end.");
+            return false;
+        }
+    }
+
+    if (header->alignment % internal::getPageSize() != 0)
+        NSVR_LOG("Frame store " << store << " is not page aligned on this machine, expect slower access.");
+
+    mMapping        = mapping;
+    mIndex          = index;
+    mFormat         = std::string(header->format, strnlen(header->format, sizeof(header->format)));
+    mWidth          = header->width;
+    mHeight         = header->height;
+    mFrameRateNum   = header->fpsNum;
+    mFrameRateDenom = header->fpsDenom;
+    mFrameCount     = header->frameCount;
+    mFrameSize      = header->frameSize;
+    mFrameStride    = header->frameStride;
+
+    return true;
+}
+
+void FrameStore::close()
+{
+    mMapping.reset();
+    mFormat.clear();
+
+    mIndex          = nullptr;
+    mWidth          = 0;
+    mHeight         = 0;
+    mFrameRateNum   = 0;
+    mFrameRateDenom = 1;
+    mFrameCount     = 0;
+    mFrameSize      = 0;
+    mFrameStride    = 0;
+    mAdvisedBegin   = 0;
+    mAdvisedEnd     = 0;
+}
+
+bool FrameStore::isOpen() const
+{
+    return mMapping != nullptr;
+}
+
+void FrameStore::setReadahead(guint frames)
+{
+    mReadahead = frames;
+}
+
+guint FrameStore::getReadahead() const
+{
+    return mReadahead;
+}
+
+gint FrameStore::getWidth() const
+{
+    return mWidth;
+}
+
+gint FrameStore::getHeight() const
+{
+    return mHeight;
+}
+
+const std::string& FrameStore::getFormat() const
+{
+    return mFormat;
+}
+
+gint FrameStore::getFrameRateNum() const
+{
+    return mFrameRateNum;
+}
+
+gint FrameStore::getFrameRateDenom() const
+{
+    return mFrameRateDenom;
+}
+
+guint64 FrameStore::getFrameCount() const
+{
+    return mFrameCount;
+}
+
+GstBuffer* FrameStore::getFrame(guint64 index)
+{
+    g_return_val_if_fail(mMapping != nullptr && index < mFrameCount, nullptr);
+
+    // Every buffer keeps the mapping alive, even past close()
+    auto holder = new std::shared_ptr<Mapping>(mMapping);
+
+    GstBuffer *buffer = gst_buffer_new_wrapped_full(
+        GstMemoryFlags(GST_MEMORY_FLAG_READONLY),
+        mMapping->data + mIndex[index * 2],
+        mFrameSize, 0, mFrameSize, holder,
+        [](gpointer data) { delete static_cast<std::shared_ptr<Mapping>*>(data); });
+
+    GST_BUFFER_PTS(buffer) = mIndex[index * 2 + 1];
+    return buffer;
+}
+
+void FrameStore::prefetch(guint64 index)
+{
+    if (mMapping == nullptr || mReadahead == 0 || index >= mFrameCount)
+        return;
+
+    // Only advise again once the playhead left the window or crossed its middle
+    if (index >= mAdvisedBegin && index + mReadahead / 2 < mAdvisedEnd)
+        return;
+
+    mAdvisedBegin   = index;
+    mAdvisedEnd     = MIN(index + mReadahead, mFrameCount);
+
+    mMapping->advise(mIndex[index * 2], (mAdvisedEnd - index) * mFrameStride);
+}
+
+}
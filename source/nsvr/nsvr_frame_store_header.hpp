@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glib.h>
+
+namespace nsvr {
+namespace internal {
+
+const gchar     STORE_MAGIC[8]  = { 'N', 'S', 'V', 'R', 'F', 'S', 0, 0 };
+const guint32   STORE_VERSION   = 1;
+
+/*!
+ * @struct StoreHeader
+ * @brief  First page of a frame store. All offsets are in bytes from the
+ *         beginning of the file and are multiples of "alignment".
+ */
+struct StoreHeader
+{
+    gchar       magic[8];       //!< STORE_MAGIC
+    guint32     version;        //!< STORE_VERSION
+    guint32     alignment;      //!< Page size of the machine which built the store
+    gint32      width;          //!< Width of frames
+    gint32      height;         //!< Height of frames
+    gint32      fpsNum;         //!< Numerator of frame rate
+    gint32      fpsDenom;       //!< Denominator of frame rate
+    gchar       format[16];     //!< Raw video format of frames, null terminated
+    guint64     frameCount;     //!< Number of frames
+    guint64     frameSize;      //!< Size of one frame
+    guint64     frameStride;    //!< Distance between two frames
+    guint64     dataOffset;     //!< Offset of the first frame
+    guint64     indexOffset;    //!< Offset of the frame index: [offset, time] pairs
+};
+
+}}
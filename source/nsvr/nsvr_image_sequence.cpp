@@ -0,0 +1,508 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_image_sequence.hpp"
+
+#include <gst/app/gstappsink.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+const gsize         kDefaultMemoryBudget    = 256 * 1024 * 1024;
+const GstClockTime  kDecodeTimeout          = 10 * GST_SECOND;
+
+//! answers true if "pattern" holds exactly one integer conversion ("%d", "%05d", etc.)
+bool isValidPattern(const std::string& pattern)
+{
+    guint conversions = 0;
+
+    for (auto it = pattern.begin(); it != pattern.end(); ++it)
+    {
+        if (*it != '%')
+            continue;
+
+        if (++it == pattern.end())
+            return false;
+
+        if (*it == '%')
+            continue;
+
+        // Flags and width only, anything else would not match the argument
+        while (it != pattern.end() && (std::strchr("0-+ #", *it) != nullptr || g_ascii_isdigit(*it)))
+            ++it;
+
+        if (it == pattern.end() || std::strchr("diu", *it) == nullptr)
+            return false;
+
+        ++conversions;
+    }
+
+    return conversions == 1;
+}
+
+}
+
+namespace nsvr
+{
+
+/*!
+ * @struct  ImageSequence::Decoder
+ * @brief   Pipeline decoding one image file into a raw frame, reused for
+ *          every file decoded by the same worker.
+ */
+struct ImageSequence::Decoder
+{
+    GstElement      *pipeline   = nullptr;  //!< filesrc ! decodebin ! ... ! appsink
+    GstElement      *source     = nullptr;  //!< filesrc, its location is changed per file
+    GstElement      *sink       = nullptr;  //!< appsink, holding the decoded frame as preroll
+
+    ~Decoder()
+    {
+        if (pipeline != nullptr)
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+
+        if (source != nullptr)
+            gst_object_unref(source);
+
+        if (sink != nullptr)
+            gst_object_unref(sink);
+
+        if (pipeline != nullptr)
+            gst_object_unref(pipeline);
+    }
+
+    //! builds pipeline producing frames matching "caps"
+    bool create(const std::string& caps)
+    {
+        const std::string description =
+            "filesrc name=src ! decodebin ! videoconvert ! videoscale ! " + caps +
+            " ! appsink name=sink sync=false enable-last-sample=false";
+
+        GError *errors = nullptr;
+        BIND_TO_SCOPE(errors);
+
+        pipeline = gst_parse_launch(description.c_str(), &errors);
+
+        if (pipeline == nullptr)
+        {
+            NSVR_LOG("Unable to launch the decoding pipeline [" << (errors ? errors->message : "unknown error") << "].");
+            return false;
+        }
+
+        source  = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+        sink    = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+
+        return source != nullptr && sink != nullptr;
+    }
+
+    //! answers decoded frame of "path" (new reference) and its caps (new reference) if "caps" is not null, nullptr on failure
+    GstBuffer* decode(const std::string& path, GstCaps** caps = nullptr)
+    {
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        g_object_set(source, "location", path.c_str(), nullptr);
+
+        if (gst_element_set_state(pipeline, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE ||
+            gst_element_get_state(pipeline, nullptr, nullptr, kDecodeTimeout) != GST_STATE_CHANGE_SUCCESS)
+        {
+            NSVR_LOG("Unable to decode " << path << ".");
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            return nullptr;
+        }
+
+        GstSample *sample = gst_app_sink_pull_preroll(GST_APP_SINK(sink));
+        BIND_TO_SCOPE(sample);
+
+        GstBuffer *buffer = sample != nullptr ? gst_sample_get_buffer(sample) : nullptr;
+
+        if (buffer == nullptr)
+        {
+            NSVR_LOG("No frame decoded out of " << path << ".");
+            return nullptr;
+        }
+
+        if (caps != nullptr)
+            *caps = gst_caps_ref(gst_sample_get_caps(sample));
+
+        return gst_buffer_ref(buffer);
+    }
+};
+
+ImageSequence::ImageSequence()
+    : mFormat("BGRA")
+    , mWidth(0)
+    , mHeight(0)
+    , mFrameRateNum(0)
+    , mFrameRateDenom(1)
+    , mFirstNumber(0)
+    , mFrameCount(0)
+    , mWindow(0)
+    , mWorkerCount(std::max(1u, g_get_num_processors()))
+    , mMemoryBudget(kDefaultMemoryBudget)
+    , mPlayhead(0)
+    , mScheduledEnd(0)
+    , mStopping(false)
+{}
+
+ImageSequence::~ImageSequence()
+{
+    close();
+}
+
+bool ImageSequence::open(const std::string& pattern, gint fps_num, gint fps_denom)
+{
+    return open(pattern, fps_num, fps_denom, 0, 0, "BGRA");
+}
+
+bool ImageSequence::open(const std::string& pattern, gint fps_num, gint fps_denom, gint width, gint height, const std::string& fmt)
+{
+    close();
+
+    if (!isValidPattern(pattern))
+    {
+        NSVR_LOG("Pattern " << pattern << " must hold exactly one integer conversion (e.g. %05d).");
+        return false;
+    }
+
+    if (fps_num <= 0 || fps_denom <= 0)
+    {
+        NSVR_LOG("Frame rate " << fps_num << "/" << fps_denom << " is invalid.");
+        return false;
+    }
+
+    mPattern        = pattern;
+    mFormat         = fmt;
+    mFrameRateNum   = fps_num;
+    mFrameRateDenom = fps_denom;
+
+    // Sequences are numbered from either 0 or 1
+    for (mFirstNumber = 0; mFirstNumber < 2; ++mFirstNumber)
+    {
+        if (g_file_test(getPath(0).c_str(), G_FILE_TEST_IS_REGULAR) != FALSE)
+            break;
+    }
+
+    if (mFirstNumber == 2)
+    {
+        NSVR_LOG("No frame named after " << pattern << " found.");
+        close();
+        return false;
+    }
+
+    // Sequence ends at the first gap
+    mFrameCount = 1;
+
+    while (g_file_test(getPath(mFrameCount).c_str(), G_FILE_TEST_IS_REGULAR) != FALSE)
+        ++mFrameCount;
+
+    // Size of the first frame is the size of all of them, unless told otherwise
+    std::string caps = "video/x-raw,format=" + fmt;
+
+    if (width > 0 && height > 0)
+        caps += ",width=" + std::to_string(width) + ",height=" + std::to_string(height);
+
+    std::unique_ptr<Decoder> first(new Decoder);
+    GstCaps *first_caps = nullptr;
+
+    GstBuffer *first_frame = first->create(caps) ? first->decode(getPath(0), &first_caps) : nullptr;
+    BIND_TO_SCOPE(first_caps);
+
+    if (first_frame == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    GstStructure *str = gst_caps_get_structure(first_caps, 0);
+    gst_structure_get_int(str, "width", &mWidth);
+    gst_structure_get_int(str, "height", &mHeight);
+
+    const gsize frame_size = gst_buffer_get_size(first_frame);
+
+    mWindow     = std::max<guint64>(1, mMemoryBudget / std::max<gsize>(1, frame_size));
+    mPlayhead   = 0;
+    mScheduledEnd = 0;
+    mStopping   = false;
+    mFrames[0]  = first_frame;
+
+    caps = "video/x-raw,format=" + fmt + ",width=" + std::to_string(mWidth) + ",height=" + std::to_string(mHeight);
+
+    for (guint i = 0; i < mWorkerCount; ++i)
+    {
+        std::unique_ptr<Decoder> decoder(new Decoder);
+
+        if (!decoder->create(caps))
+        {
+            close();
+            return false;
+        }
+
+        mDecoders.push_back(std::move(decoder));
+    }
+
+    for (auto& decoder : mDecoders)
+        mWorkers.emplace_back(&ImageSequence::work, this, std::ref(*decoder));
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        schedule(0);
+    }
+
+    NSVR_LOG("Opened " << mFrameCount << " frames of " << pattern << " (" << mWidth << "x" << mHeight << " " << fmt
+        << "), decoding " << mWindow << " ahead on " << mWorkerCount << " workers.");
+
+    return true;
+}
+
+void ImageSequence::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        mQueue.clear();
+    }
+
+    mWork.notify_all();
+    mDone.notify_all();
+
+    for (auto& worker : mWorkers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    mWorkers.clear();
+    mDecoders.clear();
+
+    for (auto& frame : mFrames)
+        gst_buffer_unref(frame.second);
+
+    mFrames.clear();
+    mPending.clear();
+    mFailed.clear();
+
+    mPattern.clear();
+    mWidth          = 0;
+    mHeight         = 0;
+    mFrameCount     = 0;
+    mWindow         = 0;
+    mPlayhead       = 0;
+    mScheduledEnd   = 0;
+}
+
+bool ImageSequence::isOpen() const
+{
+    return mFrameCount > 0;
+}
+
+void ImageSequence::setWorkerCount(guint count)
+{
+    mWorkerCount = std::max(1u, count);
+}
+
+guint ImageSequence::getWorkerCount() const
+{
+    return mWorkerCount;
+}
+
+void ImageSequence::setMemoryBudget(gsize bytes)
+{
+    mMemoryBudget = bytes;
+}
+
+gsize ImageSequence::getMemoryBudget() const
+{
+    return mMemoryBudget;
+}
+
+guint64 ImageSequence::getFirstNumber() const
+{
+    return mFirstNumber;
+}
+
+gint ImageSequence::getWidth() const
+{
+    return mWidth;
+}
+
+gint ImageSequence::getHeight() const
+{
+    return mHeight;
+}
+
+const std::string& ImageSequence::getFormat() const
+{
+    return mFormat;
+}
+
+gint ImageSequence::getFrameRateNum() const
+{
+    return mFrameRateNum;
+}
+
+gint ImageSequence::getFrameRateDenom() const
+{
+    return mFrameRateDenom;
+}
+
+guint64 ImageSequence::getFrameCount() const
+{
+    return mFrameCount;
+}
+
+GstBuffer* ImageSequence::getFrame(guint64 index)
+{
+    g_return_val_if_fail(index < mFrameCount, nullptr);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    schedule(index);
+
+    mDone.wait(lock, [this, index]
+    {
+        return mStopping || mFrames.count(index) > 0 || mFailed.count(index) > 0;
+    });
+
+    auto frame = mFrames.find(index);
+
+    if (frame == mFrames.end())
+        return nullptr;
+
+    // Frames share their memory, only timestamps differ
+    GstBuffer *buffer = gst_buffer_copy(frame->second);
+
+    GST_BUFFER_PTS(buffer)      = getFrameTime(index);
+    GST_BUFFER_DTS(buffer)      = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DURATION(buffer) = getFrameTime(index + 1) - getFrameTime(index);
+
+    return buffer;
+}
+
+void ImageSequence::prefetch(guint64 index)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (index < mFrameCount)
+        schedule(index);
+}
+
+std::string ImageSequence::getPath(guint64 index) const
+{
+    gchar *path = g_strdup_printf(mPattern.c_str(), gint(mFirstNumber + index));
+    BIND_TO_SCOPE(path);
+
+    return path;
+}
+
+void ImageSequence::schedule(guint64 index)
+{
+    const guint64 end       = std::min(index + mWindow, mFrameCount);
+    const guint64 old_end   = mScheduledEnd;
+
+    if (index == mPlayhead && !mQueue.empty())
+        return;
+
+    // Playing on, the window slides: frames behind the playhead go, frames past the old window are queued
+    if (index > mPlayhead && index < old_end)
+    {
+        mPlayhead       = index;
+        mScheduledEnd   = end;
+
+        for (auto it = mFrames.begin(); it != mFrames.end() && it->first < index;)
+        {
+            gst_buffer_unref(it->second);
+            it = mFrames.erase(it);
+        }
+
+        // Queued nearest first, so those passed are at the front
+        while (!mQueue.empty() && mQueue.front() < index)
+        {
+            mPending.erase(mQueue.front());
+            mQueue.pop_front();
+        }
+
+        for (guint64 i = old_end; i < end; ++i)
+        {
+            if (mFrames.count(i) == 0 && mPending.count(i) == 0 && mFailed.count(i) == 0)
+            {
+                mPending.insert(i);
+                mQueue.push_back(i);
+            }
+        }
+
+        if (!mQueue.empty())
+            mWork.notify_all();
+
+        return;
+    }
+
+    mPlayhead       = index;
+    mScheduledEnd   = end;
+
+    // Frames outside of the window only take memory (after a seek, behind the playhead)
+    for (auto it = mFrames.begin(); it != mFrames.end();)
+    {
+        if (it->first < index || it->first >= end)
+        {
+            gst_buffer_unref(it->second);
+            it = mFrames.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // Queued frames of the previous window are not wanted anymore
+    for (auto queued : mQueue)
+        mPending.erase(queued);
+
+    mQueue.clear();
+
+    for (guint64 i = index; i < end; ++i)
+    {
+        if (mFrames.count(i) == 0 && mPending.count(i) == 0 && mFailed.count(i) == 0)
+        {
+            mPending.insert(i);
+            mQueue.push_back(i);
+        }
+    }
+
+    if (!mQueue.empty())
+        mWork.notify_all();
+}
+
+void ImageSequence::work(Decoder& decoder)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true)
+    {
+        mWork.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+
+        if (mStopping)
+            break;
+
+        const guint64 index = mQueue.front();
+        mQueue.pop_front();
+
+        lock.unlock();
+        GstBuffer *buffer = decoder.decode(getPath(index));
+        lock.lock();
+
+        mPending.erase(index);
+
+        if (buffer == nullptr)
+            mFailed.insert(index);
+        else if (mStopping || index < mPlayhead || index >= mPlayhead + mWindow)
+            gst_buffer_unref(buffer);   // Playhead moved away while decoding
+        else
+            mFrames[index] = buffer;
+
+        mDone.notify_all();
+    }
+
+    // Pipeline is torn down by close(), on the thread which built it
+}
+
+}
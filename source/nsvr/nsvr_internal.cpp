@@ -2,6 +2,7 @@
 
 #include "nsvr/nsvr_discoverer.hpp"
 #include "nsvr/nsvr_player.hpp"
+#include "nsvr/nsvr_startup.hpp"
 
 #include <gst/net/net.h>
 #include <gst/gstregistry.h>
@@ -12,6 +13,8 @@
 
 #ifdef _WIN32
 #   include <windows.h>
+#else
+#   include <unistd.h>
 #endif
 
 namespace nsvr {
@@ -20,7 +23,7 @@ namespace internal {
 template<> BindToScope<gchar>::~BindToScope()                   { g_free(pointer); pointer = nullptr; }
 template<> BindToScope<GList>::~BindToScope()                   { gst_discoverer_stream_info_list_free(pointer); pointer = nullptr; }
 template<> BindToScope<GError>::~BindToScope()                  { g_error_free(pointer); pointer = nullptr; }
-template<> BindToScope<GstClock>::~BindToScope()                { gst_object_unref(pointer); pointer = nullptr; }
+template<> BindToScope<GstClock>::~BindToScope()                { if (pointer) gst_object_unref(pointer); pointer = nullptr; }
 template<> BindToScope<GstMessage>::~BindToScope()              { gst_message_unref(pointer); pointer = nullptr; }
 template<> BindToScope<GstAppSink>::~BindToScope()              { g_object_unref(pointer); pointer = nullptr; }
 template<> BindToScope<GInetAddress>::~BindToScope()            { g_object_unref(pointer); pointer = nullptr; }
@@ -31,22 +34,17 @@ template<> BindToScope<GSocketConnection>::~BindToScope()       { g_object_unref
 template<> BindToScope<GstDiscovererInfo>::~BindToScope()       { gst_discoverer_info_unref(pointer); pointer = nullptr; }
 template<> BindToScope<GstNetTimeProvider>::~BindToScope()      { gst_object_unref(pointer); pointer = nullptr; }
 template<> BindToScope<GstDiscovererStreamInfo>::~BindToScope() { gst_discoverer_stream_info_unref(pointer); pointer = nullptr; }
+template<> BindToScope<GstBus>::~BindToScope()                  { if (pointer) gst_object_unref(pointer); pointer = nullptr; }
+template<> BindToScope<GstPad>::~BindToScope()                  { if (pointer) gst_object_unref(pointer); pointer = nullptr; }
+template<> BindToScope<GstSample>::~BindToScope()               { if (pointer) gst_sample_unref(pointer); pointer = nullptr; }
+template<> BindToScope<GstElement>::~BindToScope()              { if (pointer) gst_object_unref(pointer); pointer = nullptr; }
+template<> BindToScope<GstCaps>::~BindToScope()                 { if (pointer) gst_caps_unref(pointer); pointer = nullptr; }
+template<> BindToScope<GstQuery>::~BindToScope()                { if (pointer) gst_query_unref(pointer); pointer = nullptr; }
 
 bool gstreamerInitialized()
 {
-    GError *init_error = nullptr;
-    BIND_TO_SCOPE(init_error);
-
-    if (gst_is_initialized() == FALSE &&
-        gst_init_check(nullptr, nullptr, &init_error) == FALSE)
-    {
-        NSVR_LOG("GStreamer failed to initialize [" << init_error->message << "].");
-        return false;
-    }
-    else
-    {
-        return true;
-    }
+    // Initializes as configured by setStartup(...), or waits for startInBackground() to
+    return waitForStartup();
 }
 
 std::string implode(const std::vector<std::string>& elements, const std::string& glue)
@@ -156,4 +154,87 @@ short getClockPort(short server_port)
     else return server_port + 1;
 }
 
+bool hasProperty(gpointer object, const gchar* name)
+{
+    return object != nullptr && g_object_class_find_property(G_OBJECT_GET_CLASS(object), name) != nullptr;
+}
+
+SocketWatch::SocketWatch()
+{}
+
+SocketWatch::~SocketWatch()
+{
+    watch(nullptr);
+}
+
+void SocketWatch::watch(GSocket* socket)
+{
+    if (mThread.joinable())
+    {
+        g_cancellable_cancel(mCancellable);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mAcknowledged.notify_all();
+        }
+
+        mThread.join();
+        g_clear_object(&mCancellable);
+    }
+
+    acknowledge();
+
+    if (socket == nullptr)
+        return;
+
+    mCancellable    = g_cancellable_new();
+    mThread         = std::thread(&SocketWatch::run, this, G_SOCKET(g_object_ref(socket)), G_CANCELLABLE(g_object_ref(mCancellable)));
+}
+
+void SocketWatch::acknowledge()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mSignaled = false;
+    mWakeup.acknowledge();
+    mAcknowledged.notify_all();
+}
+
+GPollFD SocketWatch::getPollFd() const
+{
+    return mWakeup.getPollFd();
+}
+
+void SocketWatch::run(GSocket* socket, GCancellable* cancellable)
+{
+    while (g_cancellable_is_cancelled(cancellable) == FALSE)
+    {
+        // Returns once readable (or closed), cancelled answers FALSE
+        if (g_socket_condition_timed_wait(socket, G_IO_IN, -1, cancellable, nullptr) == FALSE)
+            break;
+
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        mSignaled = true;
+        mWakeup.signal();
+
+        // Readable until dispatched, so wait for the consumer rather than spin
+        mAcknowledged.wait(lock, [this, cancellable] { return !mSignaled || g_cancellable_is_cancelled(cancellable) != FALSE; });
+    }
+
+    g_object_unref(cancellable);
+    g_object_unref(socket);
+}
+
+gsize getPageSize()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    ::GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return gsize(::sysconf(_SC_PAGESIZE));
+#endif
+}
+
 }}
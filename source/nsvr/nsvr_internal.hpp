@@ -1,13 +1,22 @@
 #pragma once
 
+#include "nsvr/nsvr_wakeup.hpp"
+
+#include <condition_variable>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <sstream>
 
 #include <gio/gio.h>
+#include <gst/gst.h>
 
 namespace nsvr {
+
+class ReadAheadFile;
+class UringFile;
+
 namespace internal {
 
 /*!
@@ -55,6 +64,80 @@ std::string getIp(GSocketConnection* connection);
 //! calculates clock port from server port
 short getClockPort(short server_port);
 
+//! answers true if GObject "object" has a property called "name"
+bool hasProperty(gpointer object, const gchar* name);
+
+//! answers size of a memory page of the system in bytes
+gsize getPageSize();
+
+/*!
+ * @class   SocketWatch
+ * @brief   A Wakeup signaled once a socket is readable, from a thread of its
+ *          own, so one descriptor stays valid however sources of the context
+ *          dispatching the socket come and go.
+ * @details Once signaled, the socket is watched again only after
+ *          acknowledge(), which the consumer calls before dispatching.
+ */
+class SocketWatch
+{
+public:
+    SocketWatch();
+    ~SocketWatch();
+
+    //! watches "socket" instead of the socket watched so far, nullptr stops watching
+    void            watch(GSocket* socket);
+
+    //! makes the descriptor non-readable and watches the socket again
+    void            acknowledge();
+
+    //! answers the descriptor, polled for G_IO_IN
+    GPollFD         getPollFd() const;
+
+private:
+    SocketWatch(const SocketWatch&) = delete;
+    SocketWatch& operator=(const SocketWatch&) = delete;
+
+    //! loop of the watching thread, until "cancellable" is cancelled
+    void            run(GSocket* socket, GCancellable* cancellable);
+
+    Wakeup                  mWakeup;                    //!< Signaled while the socket is readable and not acknowledged
+    std::thread             mThread;                    //!< Thread waiting on the socket
+    GCancellable            *mCancellable   = nullptr;  //!< Cancels the wait of mThread
+    std::mutex              mMutex;                     //!< Guards mSignaled
+    std::condition_variable mAcknowledged;              //!< Notified by acknowledge() and watch()
+    bool                    mSignaled       = false;    //!< Flag, indicating mWakeup is signaled
+};
+
+//! blends "count" BGRA pixels of "src" over "dst", scaled by "alpha" [ 0 , 256 ], "src" taken as opaque if "opaque" (BGRx)
+void blendRow(guint8* dst, const guint8* src, gint count, guint alpha, bool opaque);
+
+//! blendRow(...) without SIMD, SIMD paths answer the same bytes
+void blendRowScalar(guint8* dst, const guint8* src, gint count, guint alpha, bool opaque);
+
+//! copies "count" opaque pixels, forcing their alpha channel (undefined in BGRx) to 255
+void copyRow(guint8* dst, const guint8* src, gint count);
+
+//! copyRow(...) without SIMD, SIMD paths answer the same bytes
+void copyRowScalar(guint8* dst, const guint8* src, gint count);
+
+//! accumulates the 64 bytes at "data" into the 2 lanes of "acc", as frame change detection hashes tiles
+void hashGroup(guint64* acc, const guint8* data);
+
+//! hashGroup(...) without SIMD, SIMD paths answer the same hash
+void hashGroupScalar(guint64* acc, const guint8* data);
+
+//! registers nsvrfilesrc within the process, once. Returns true on success
+bool registerFileSource();
+
+//! converts a file:// URI to one read by nsvrfilesrc
+std::string getFileSourceUri(const std::string& file_uri);
+
+//! answers file read by "element" if it is a nsvrfilesrc, nullptr otherwise
+ReadAheadFile* getReadAheadFile(GstElement* element);
+
+//! answers io_uring file read by "element" if it is a nsvrfilesrc, nullptr otherwise
+UringFile* getUringFile(GstElement* element);
+
 }}
 
 /*! A convenience macro for nsvr::Logger. Input can be either string or stream
@@ -6,12 +6,55 @@ const char PACKET_DATA_SEPARATOR        = '|';
 const char SERVER_IDENTIFIER            = 's';
 const char CLIENT_IDENTIFIER            = 'c';
 const char SERVER_HEARTBEAT_IDENTIFIER  = 'h';
+const char SERVER_CUES_IDENTIFIER       = 'q';
 const char PACKET_TIME_ATT              = 't';
 const char PACKET_MUTE_ATT              = 'm';
 const char PACKET_VOLUME_ATT            = 'v';
 const char PACKET_STATE_ATT             = 's';
 const char PACKET_BASE_ATT              = 'b';
 const int  PACKET_ATT_COUNT             = 5;
+const char CUE_VERSION_ATT              = 'n';
+const char CUE_TIME_ATT                 = 't';
+const char CUE_ID_ATT                   = 'i';
+const char CUE_INDEX_ATT                = 'x';
+const char CUE_TOTAL_ATT                = 'c';
+const gsize CUE_CHUNK_SIZE              = 768;  //!< Bytes of a cue chunk at most, well within the 1 KiB clients receive
+const guint CUE_CHUNK_COUNT             = 4096; //!< Chunks of a version at most
+
+//! answers a cue as serialized within a cue packet
+std::string serializeCue(const nsvr::Cue& cue)
+{
+    std::stringstream serialized_cue;
+
+    // Ids may hold separators, they travel escaped
+    gchar *id = g_uri_escape_string(cue.id.c_str(), nullptr, FALSE);
+
+    serialized_cue << PACKET_DATA_SEPARATOR;
+    serialized_cue << CUE_TIME_ATT << guint64(cue.time * GST_SECOND + 0.5);
+    serialized_cue << PACKET_DATA_SEPARATOR;
+    serialized_cue << CUE_ID_ATT << id;
+
+    g_free(id);
+
+    return serialized_cue.str();
+}
+
+//! answers the header of a cue packet
+std::string serializeCueHeader(guint64 version, guint index, guint total)
+{
+    std::stringstream serialized_header;
+
+    serialized_header << SERVER_IDENTIFIER;
+    serialized_header << SERVER_CUES_IDENTIFIER;
+    serialized_header << PACKET_DATA_SEPARATOR;
+    serialized_header << CUE_VERSION_ATT << version;
+    serialized_header << PACKET_DATA_SEPARATOR;
+    serialized_header << CUE_INDEX_ATT << index;
+    serialized_header << PACKET_DATA_SEPARATOR;
+    serialized_header << CUE_TOTAL_ATT << total;
+
+    return serialized_header.str();
+}
 }
 
 namespace nsvr
@@ -96,4 +139,121 @@ std::string PacketHandler::serialize(const Packet& packet)
     return serialized_packet.str();
 }
 
+bool PacketHandler::parse(const std::string& buffer, CuePacket& packet)
+{
+    if (buffer.size() < 3 || buffer[0] != SERVER_IDENTIFIER || buffer[1] != SERVER_CUES_IDENTIFIER)
+        return false;
+
+    bool    has_version = false;
+    bool    has_time    = false;
+    Cue     cue;
+
+    packet = CuePacket();
+
+    try
+    {
+        auto commands = internal::explode(buffer.substr(3), PACKET_DATA_SEPARATOR);
+
+        for (const auto& command : commands)
+        {
+            if (command.empty())
+                continue;
+
+            if (command[0] == CUE_VERSION_ATT)
+            {
+                packet.version = std::stoull(command.substr(1));
+                has_version = true;
+            }
+            else if (command[0] == CUE_INDEX_ATT)
+            {
+                packet.index = guint(std::stoul(command.substr(1)));
+            }
+            else if (command[0] == CUE_TOTAL_ATT)
+            {
+                packet.total = guint(std::stoul(command.substr(1)));
+            }
+            else if (command[0] == CUE_TIME_ATT)
+            {
+                // Nanoseconds, so cue times survive the trip exactly
+                cue.time = std::stoull(command.substr(1)) / gdouble(GST_SECOND);
+                has_time = true;
+            }
+            else if (command[0] == CUE_ID_ATT && has_time)
+            {
+                gchar *id = g_uri_unescape_string(command.substr(1).c_str(), nullptr);
+
+                if (id != nullptr)
+                {
+                    cue.id = id;
+                    packet.cues.push_back(cue);
+                }
+
+                g_free(id);
+                has_time = false;
+            }
+        }
+    }
+    catch (...)
+    {
+        NSVR_LOG("Failed to parse buffer. Cue packet buffer is malformed.");
+        return false;
+    }
+
+    if (packet.total == 0 || packet.total > CUE_CHUNK_COUNT || packet.index >= packet.total)
+    {
+        NSVR_LOG("Failed to parse buffer. Cue packet chunk " << packet.index << " of " << packet.total << " is out of range.");
+        return false;
+    }
+
+    return has_version;
+}
+
+std::string PacketHandler::serialize(const CuePacket& packet)
+{
+    std::string serialized_packet = serializeCueHeader(packet.version, packet.index, packet.total);
+
+    for (const Cue& cue : packet.cues)
+        serialized_packet += serializeCue(cue);
+
+    return serialized_packet;
+}
+
+std::vector<std::string> PacketHandler::serializeChunks(const CuePacket& packet)
+{
+    // Longest header a chunk may carry, so every chunk fits whatever its index
+    const gsize header = serializeCueHeader(G_MAXUINT64, CUE_CHUNK_COUNT, CUE_CHUNK_COUNT).size();
+
+    std::vector<std::string> bodies(1);
+
+    for (const Cue& cue : packet.cues)
+    {
+        const std::string serialized_cue = serializeCue(cue);
+
+        if (header + serialized_cue.size() > CUE_CHUNK_SIZE)
+        {
+            NSVR_LOG("Cue " << cue.id << " is too long to be sent to clients.");
+            continue;
+        }
+
+        if (header + bodies.back().size() + serialized_cue.size() > CUE_CHUNK_SIZE)
+            bodies.emplace_back();
+
+        bodies.back() += serialized_cue;
+    }
+
+    if (bodies.size() > CUE_CHUNK_COUNT)
+    {
+        NSVR_LOG("Too many cues to be sent to clients, " << bodies.size() << " chunks.");
+        bodies.resize(CUE_CHUNK_COUNT);
+    }
+
+    std::vector<std::string> chunks;
+    chunks.reserve(bodies.size());
+
+    for (gsize i = 0; i < bodies.size(); ++i)
+        chunks.push_back(serializeCueHeader(packet.version, guint(i), guint(bodies.size())) + bodies[i]);
+
+    return chunks;
+}
+
 }
@@ -2,8 +2,35 @@
 
 #include "nsvr/nsvr_player.hpp"
 #include "nsvr/nsvr_discoverer.hpp"
+#include "nsvr/nsvr_frame_cache.hpp"
+#include "nsvr/nsvr_frame_source.hpp"
+#include "nsvr/nsvr_shared_decode.hpp"
+#include "nsvr/nsvr_uring_file.hpp"
 
 #include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const gint kLiveSocketBuffer = 2 * 1024 * 1024;   //!< Bytes of kernel receive buffers of live network sources
+const guint kPlayFlagDownload = 0x80;             //!< GST_PLAY_FLAG_DOWNLOAD of playbin, not in a public header
+
+//! answers true if "object" is an element classified as a video decoder
+bool isVideoDecoder(GstObject* object)
+{
+    if (object == nullptr || !GST_IS_ELEMENT(object))
+        return false;
+
+    GstElementFactory   *factory    = gst_element_get_factory(GST_ELEMENT(object));
+    const gchar         *klass      = factory ? gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS) : nullptr;
+
+    return klass != nullptr && std::strstr(klass, "Decoder") != nullptr && std::strstr(klass, "Video") != nullptr;
+}
+
+}
 
 namespace nsvr
 {
@@ -11,6 +38,7 @@ namespace nsvr
 Player::Player()
     : mLoop(false)
     , mMute(false)
+    , mCues([this](const CueEvent& event) { onCue(event); })
 {
     reset();
 
@@ -23,10 +51,36 @@ Player::Player()
 
 Player::~Player()
 {
+    // No cue may reach a Player being destroyed
+    mCues.shutdown();
     close();
 }
 
 bool Player::open(const std::string& path, gint width, gint height, const std::string& fmt)
+{
+    if (path.empty())
+    {
+        close();
+        NSVR_LOG("Path given to Player is empty.");
+        return false;
+    }
+
+    // Discovering a live source stalls until its timeout
+    if (mLive)
+        return openLive(path, width, height, fmt);
+
+    Discoverer discoverer;
+
+    if (!discoverer.open(path))
+    {
+        close();
+        return false;
+    }
+
+    return open(discoverer, width, height, fmt);
+}
+
+bool Player::open(const Discoverer& discoverer, gint width, gint height, const std::string& fmt, bool wait)
 {
     if (!internal::gstreamerInitialized())
     {
@@ -37,120 +91,265 @@ bool Player::open(const std::string& path, gint width, gint height, const std::s
     close();
     onBeforeOpen();
 
-    if (path.empty())
+    mRunOffline = mOffline;
+
+    if (mDecodeSharing && discoverer.getHasVideo())
     {
-        NSVR_LOG("Path given to Player is empty.");
-        return false;
+        // Shared decodes are keyed by URI alone, options of their own would be lost
+        const char *conflict = getSharingConflict(discoverer);
+
+        if (conflict == nullptr)
+            return openShared(discoverer, width, height, fmt, wait);
+
+        NSVR_LOG("Decode is not shared since " << conflict << ".");
     }
 
-    GError*     errors = nullptr;
-    Discoverer  discoverer;
+    GError* errors = nullptr;
     BIND_TO_SCOPE(errors);
 
-    if (discoverer.open(path))
+    std::stringstream pipeline_cmd;
+    std::string uri = discoverer.getMediaUri();
+
+    // Local media is read by nsvrfilesrc instead of filesrc, prefetching ahead of the demuxer
+    if ((mReadAheadWindow > 0 || mIoUringDepth > 0) && uri.compare(0, 5, "file:") == 0 && internal::registerFileSource())
+        uri = internal::getFileSourceUri(uri);
+
+    if (discoverer.getHasVideo())
+    {
+        pipeline_cmd
+            << "playbin uri=\""
+            << uri
+            << "\" video-sink=\"appsink " << getAppSinkProperties()
+            << " caps=video/x-raw"
+            << ",width=" << width
+            << ",height=" << height
+            << ",format=" << fmt
+            << "\"";
+
+        // Audio would pace the pipeline at wall-clock speed
+        if (mRunOffline)
+            pipeline_cmd << " audio-sink=\"fakesink sync=false\"";
+    }
+    else if (discoverer.getHasAudio())
+    {
+        pipeline_cmd
+            << "playbin uri=\""
+            << uri
+            << "\"";
+    }
+    else
     {
-        std::stringstream pipeline_cmd;
+        NSVR_LOG("Media provided does not contain neither audio nor video.");
+        return false;
+    }
 
-        if (discoverer.getHasVideo())
-        {
-            pipeline_cmd
-                << "playbin uri=\""
-                << discoverer.getMediaUri()
-                << "\" video-sink=\"appsink drop=yes async=no qos=yes sync=yes max-lateness=" << GST_SECOND
-                << " caps=video/x-raw"
-                << ",width=" << width
-                << ",height=" << height
-                << ",format=" << fmt
-                << "\"";
-        }
-        else if (discoverer.getHasAudio())
-        {
-            pipeline_cmd
-                << "playbin uri=\""
-                << discoverer.getMediaUri()
-                << "\"";
-        }
-        else
-        {
-            NSVR_LOG("Media provided does not contain neither audio nor video.");
-            return false;
-        }
+    mPipeline = gst_parse_launch(pipeline_cmd.str().c_str(), &errors);
 
-        mPipeline = gst_parse_launch(pipeline_cmd.str().c_str(), &errors);
+    if (mPipeline == nullptr)
+    {
+        close();
+        NSVR_LOG("Unable to launch the pipeline [" << errors->message << "].");
+        return false;
+    }
 
-        if (mPipeline == nullptr)
-        {
-            close();
-            NSVR_LOG("Unable to launch the pipeline [" << errors->message << "].");
-            return false;
-        }
+    if (uri != discoverer.getMediaUri())
+        g_signal_connect(mPipeline, "source-setup", G_CALLBACK(onSourceSetup), this);
+
+#if GST_CHECK_VERSION(1, 10, 0)
+    // Audio sinks are created deep within playsink, configured as they are added
+    if (discoverer.getHasAudio() && !mRunOffline)
+        g_signal_connect(mPipeline, "deep-element-added", G_CALLBACK(onAudioElement), this);
+#endif
+
+    // Network media is downloaded into a temporary file, only the last "ring" bytes are kept
+    if (mDownload && internal::hasProperty(mPipeline, "ring-buffer-max-size"))
+    {
+        guint flags = 0;
 
-        mGstBus = gst_pipeline_get_bus(GST_PIPELINE(mPipeline));
+        g_object_get(mPipeline, "flags", &flags, nullptr);
+        g_object_set(mPipeline, "flags", flags | kPlayFlagDownload, "ring-buffer-max-size", mDownloadRing, nullptr);
+    }
+
+    GstElement *app_sink = nullptr;
+    BIND_TO_SCOPE(app_sink);
+
+    if (discoverer.getHasVideo())
+    {
+        g_object_get(mPipeline, "video-sink", &app_sink, nullptr);
 
-        if (mGstBus == nullptr)
+        if (app_sink == nullptr)
         {
             close();
-            NSVR_LOG("Unable to obtain pipeline's event bus [" << errors->message << "].");
+            NSVR_LOG("Unable to obtain pipeline's video sink.");
             return false;
         }
 
-        if (discoverer.getHasVideo())
+        if (mFrameCacheBudget > 0)
         {
-            GstAppSink *app_sink = nullptr;
-            BIND_TO_SCOPE(app_sink);
-
-            g_object_get(mPipeline, "video-sink", &app_sink, nullptr);
-
-            if (app_sink == nullptr)
+            // Audio cannot be served from the cache, keep decoding
+            if (discoverer.getHasAudio())
+            {
+                NSVR_LOG("Frame cache is not used since media contains audio.");
+            }
+            else
             {
-                close();
-                NSVR_LOG("Unable to obtain pipeline's video sink.");
-                return false;
+                mFrameCache.reset(new FrameCache(mFrameCacheBudget));
+                mFrameCache->arm();
             }
+        }
+    }
 
-            GstAppSinkCallbacks     callbacks;
-            callbacks.eos           = nullptr;
-            callbacks.new_preroll   = reinterpret_cast<decltype(callbacks.new_preroll)>(onPreroll);
-            callbacks.new_sample    = reinterpret_cast<decltype(callbacks.new_sample)>(onSample);
+    if (!launch(app_sink, wait))
+        return false;
 
-            gst_app_sink_set_callbacks(scoped_app_sink.pointer, &callbacks, this, nullptr);
-        }
+    mDuration = discoverer.getDuration();
 
-        setupClock();
+    return true;
+}
 
-        // Going from NULL => READY => PAUSE forces the
-        // pipeline to pre-roll so we can get video dim
-        GstState state;
-        unsigned timeout = 10;
+bool Player::openShared(const Discoverer& discoverer, gint width, gint height, const std::string& fmt, bool wait)
+{
+    mSharedDecode = SharedDecode::acquire(discoverer.getMediaUri());
 
-        if (gst_element_set_state(mPipeline, GST_STATE_READY) != GST_STATE_CHANGE_SUCCESS)
-        {
-            if (gst_element_get_state(mPipeline, &state, nullptr, timeout * GST_SECOND) == GST_STATE_CHANGE_FAILURE ||
-                state != GST_STATE_READY)
-            {
-                close();
-                NSVR_LOG("Failed to put pipeline in READY state.");
-                return false;
-            }
-        }
+    if (!mSharedDecode)
+    {
+        close();
+        return false;
+    }
 
-        if (gst_element_set_state(mPipeline, GST_STATE_PAUSED) != GST_STATE_CHANGE_SUCCESS)
-        {
-            if (gst_element_get_state(mPipeline, &state, nullptr, timeout * GST_SECOND) == GST_STATE_CHANGE_FAILURE ||
-                state != GST_STATE_PAUSED)
-            {
-                close();
-                NSVR_LOG("Failed to put pipeline in PAUSE state.");
-                return false;
-            }
-        }
+    DecodeBranch branch;
+    branch.width        = width;
+    branch.height       = height;
+    branch.format       = fmt;
+    branch.cropLeft     = mCropLeft;
+    branch.cropTop      = mCropTop;
+    branch.cropRight    = mCropRight;
+    branch.cropBottom   = mCropBottom;
+
+    GstElement *app_sink = mSharedDecode->attach(branch, this);
+    BIND_TO_SCOPE(app_sink);
 
-        mDuration = discoverer.getDuration();
+    if (app_sink == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    mPipeline = GST_ELEMENT(gst_object_ref(mSharedDecode->getPipeline()));
+    mDuration = discoverer.getDuration();
+
+    // Callbacks must be in place before the branch sees any buffer
+    setupAppSink(app_sink);
+
+    if (!mSharedDecode->link(this))
+    {
+        close();
+        return false;
     }
 
+    GstState state = GST_STATE_NULL;
+    gst_element_get_state(mPipeline, &state, nullptr, 0);
+
+    // First consumer starts the decode, others join it as it is
+    if (state == GST_STATE_NULL)
+        return launch(nullptr, wait);
+
+    if (mSharedDecode->lead(this))
+        watchBus(gst_pipeline_get_bus(GST_PIPELINE(mPipeline)));
+
+    mState = state;
     return true;
 }
 
+bool Player::openLive(const std::string& path, gint width, gint height, const std::string& fmt)
+{
+    if (!internal::gstreamerInitialized())
+    {
+        NSVR_LOG("Player requires GStreamer to be initialized.");
+        return false;
+    }
+
+    close();
+    onBeforeOpen();
+
+    mRunLive = true;
+
+    gchar *uri = gst_uri_is_valid(path.c_str()) != FALSE
+        ? g_strdup(path.c_str())
+        : gst_filename_to_uri(path.c_str(), nullptr);
+
+    BIND_TO_SCOPE(uri);
+
+    if (uri == nullptr)
+    {
+        close();
+        NSVR_LOG("Unable to make an URI out of " << path << ".");
+        return false;
+    }
+
+    GError* errors = nullptr;
+    BIND_TO_SCOPE(errors);
+
+    std::stringstream pipeline_cmd;
+
+    // Nothing is known before the stream flows, the video is assumed
+    pipeline_cmd
+        << "playbin uri=\""
+        << uri
+        << "\" video-sink=\"appsink " << getAppSinkProperties()
+        << " caps=video/x-raw"
+        << ",format=" << fmt;
+
+    if (width > 0 && height > 0)
+        pipeline_cmd << ",width=" << width << ",height=" << height;
+
+    pipeline_cmd << "\"";
+
+    mPipeline = gst_parse_launch(pipeline_cmd.str().c_str(), &errors);
+
+    if (mPipeline == nullptr)
+    {
+        close();
+        NSVR_LOG("Unable to launch the pipeline [" << errors->message << "].");
+        return false;
+    }
+
+    // Network buffering of playbin defaults to seconds
+    if (internal::hasProperty(mPipeline, "buffer-duration"))
+        g_object_set(mPipeline, "buffer-duration", gint64(mLiveLatency * GST_SECOND), nullptr);
+
+    g_signal_connect(mPipeline, "source-setup", G_CALLBACK(+[](GstElement* bin, GstElement* source, Player* player)
+    {
+        onLiveElement(GST_BIN(bin), nullptr, source, player);
+    }), this);
+
+#if GST_CHECK_VERSION(1, 10, 0)
+    // Jitter buffers live deep within decodebin
+    g_signal_connect(mPipeline, "deep-element-added", G_CALLBACK(onLiveElement), this);
+    g_signal_connect(mPipeline, "deep-element-added", G_CALLBACK(onAudioElement), this);
+#endif
+
+#if GST_CHECK_VERSION(1, 6, 0)
+    // Sinks render "latency" after capture, instead of whatever elements report
+    gst_pipeline_set_latency(GST_PIPELINE(mPipeline), GstClockTime(mLiveLatency * GST_SECOND));
+#endif
+
+    GstElement *app_sink = nullptr;
+    BIND_TO_SCOPE(app_sink);
+
+    g_object_get(mPipeline, "video-sink", &app_sink, nullptr);
+
+    if (app_sink == nullptr)
+    {
+        close();
+        NSVR_LOG("Unable to obtain pipeline's video sink.");
+        return false;
+    }
+
+    // Pre-roll is not waited for, a live source does not produce data before PLAYING
+    return launch(app_sink, false);
+}
+
 bool Player::open(const std::string& path, gint width, gint height)
 {
     return open(path, width, height, "BGRA");
@@ -158,28 +357,134 @@ bool Player::open(const std::string& path, gint width, gint height)
 
 bool Player::open(const std::string& path, const std::string& fmt)
 {
+    if (mLive)
+        return openLive(path, 0, 0, fmt);
+
     Discoverer discoverer;
-    return discoverer.open(path) && open(path, discoverer.getWidth(), discoverer.getHeight(), fmt);
+    return discoverer.open(path) && open(discoverer, discoverer.getWidth(), discoverer.getHeight(), fmt);
 
 }
 
 bool Player::open(const std::string& path)
 {
+    if (mLive)
+        return openLive(path, 0, 0, "BGRA");
+
     Discoverer discoverer;
-    return discoverer.open(path) && open(path, discoverer.getWidth(), discoverer.getHeight());
+    return discoverer.open(path) && open(discoverer, discoverer.getWidth(), discoverer.getHeight(), "BGRA");
+}
+
+bool Player::open(std::shared_ptr<FrameSource> source)
+{
+    if (!internal::gstreamerInitialized())
+    {
+        NSVR_LOG("Player requires GStreamer to be initialized.");
+        return false;
+    }
+
+    close();
+    onBeforeOpen();
+
+    if (!source || source->getFrameCount() == 0)
+    {
+        NSVR_LOG("Frame source given to Player is empty.");
+        return false;
+    }
+
+    mRunOffline = mOffline;
+
+    GError* errors = nullptr;
+    BIND_TO_SCOPE(errors);
+
+    std::stringstream pipeline_cmd;
+
+    pipeline_cmd
+        << "appsrc name=nsvrsrc format=time stream-type=seekable"
+        << " caps=video/x-raw"
+        << ",format=" << source->getFormat()
+        << ",width=" << source->getWidth()
+        << ",height=" << source->getHeight()
+        << ",framerate=" << source->getFrameRateNum() << "/" << source->getFrameRateDenom()
+        << " ! appsink name=nsvrsink " << getAppSinkProperties();
+
+    mPipeline = gst_parse_launch(pipeline_cmd.str().c_str(), &errors);
+
+    if (mPipeline == nullptr)
+    {
+        close();
+        NSVR_LOG("Unable to launch the pipeline [" << errors->message << "].");
+        return false;
+    }
+
+    GstElement *app_src  = gst_bin_get_by_name(GST_BIN(mPipeline), "nsvrsrc");
+    GstElement *app_sink = gst_bin_get_by_name(GST_BIN(mPipeline), "nsvrsink");
+
+    BIND_TO_SCOPE(app_src);
+    BIND_TO_SCOPE(app_sink);
+
+    if (app_src == nullptr || app_sink == nullptr)
+    {
+        close();
+        NSVR_LOG("Unable to obtain pipeline's frame source or video sink.");
+        return false;
+    }
+
+    GstAppSrcCallbacks      callbacks;
+    callbacks.need_data     = reinterpret_cast<decltype(callbacks.need_data)>(onNeedData);
+    callbacks.enough_data   = nullptr;
+    callbacks.seek_data     = reinterpret_cast<decltype(callbacks.seek_data)>(onSeekData);
+
+    gst_app_src_set_callbacks(GST_APP_SRC(app_src), &callbacks, this, nullptr);
+
+    // Every (re)start of the stream begins at the first frame
+    if (GstPad *src_pad = gst_element_get_static_pad(app_src, "src"))
+    {
+        BIND_TO_SCOPE(src_pad);
+        gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+            reinterpret_cast<GstPadProbeCallback>(onSourceEvent), this, nullptr);
+    }
+
+    mFrameSource        = source;
+    mFrameSourceIndex   = 0;
+
+    if (!launch(app_sink))
+        return false;
+
+    mDuration = source->getDuration();
+    return true;
 }
 
 void Player::close()
 {
+    // Cues firing now finish before anything they may touch is torn down
+    mCues.quiesce();
+
     onBeforeClose();
 
-    stop();
+    // Other consumers of a shared decode keep it running
+    if (!mSharedDecode || mSharedDecode->getConsumerCount() <= 1)
+        stop();
+
+    if (mSharedDecode)
+        mSharedDecode->detach(this);
 
     if (mPipeline != nullptr)      gst_object_unref(mPipeline);
+    if (mGstBus != nullptr)        gst_bus_set_sync_handler(mGstBus, nullptr, nullptr, nullptr);
     if (mGstBus != nullptr)        gst_object_unref(mGstBus);
+    if (mAppSink != nullptr)       gst_object_unref(mAppSink);
+    if (mFileSource != nullptr)    gst_object_unref(mFileSource);
+    if (mAudioSink != nullptr)     gst_object_unref(mAudioSink);
+    if (mQosCaps != nullptr)       gst_caps_unref(mQosCaps);
     if (mCurrentBuffer != nullptr) gst_buffer_unmap(mCurrentBuffer, &mCurrentMapInfo);
     if (mCurrentSample != nullptr) gst_sample_unref(mCurrentSample);
 
+    mFrameCache.reset();
+    mFrameSource.reset();
+    mSharedDecode.reset();
+    mFramePool.reset();
+    mChangeDetector.reset();
+    mBusTaskPool.reset();
+    flushDisplayQueue();
     reset();
 }
 
@@ -187,20 +492,62 @@ void Player::setState(GstState state)
 {
     g_return_if_fail(mPipeline != nullptr);
 
+    if (getServingFromCache())
+    {
+        // Cache pauses in place, only stopping hands playback back to the pipeline
+        if (state >= GST_STATE_PAUSED)
+        {
+            setCachePaused(state == GST_STATE_PAUSED);
+            return;
+        }
+
+        leaveFrameCache();
+    }
+
+    // Held playback resumes once buffering is done, stopping gives up on it
+    if (mBuffering)
+    {
+        if (state >= GST_STATE_PAUSED)
+        {
+            mBufferingResume = state == GST_STATE_PLAYING;
+            return;
+        }
+
+        mBuffering = false;
+    }
+
     onBeforeSetState(state);
 
+    // Streaming thread must not hold on to a frame while the pipeline shuts down
+    const bool flushing = state <= GST_STATE_READY;
+
+    if (flushing)
+        setHandoffFlushing(true);
+
     GstState old_state = getState();
-    if (gst_element_set_state(mPipeline, state) == GST_STATE_CHANGE_SUCCESS)
+    const GstStateChangeReturn ret = gst_element_set_state(mPipeline, state);
+
+    if (flushing)
+        setHandoffFlushing(false);
+
+    if (ret == GST_STATE_CHANGE_SUCCESS)
         onStateChanged(old_state);
 }
 
 GstState Player::getState() const
 {
+    // Pipeline is parked in READY while the cache plays on its behalf
+    if (getServingFromCache())
+        return GST_CLOCK_TIME_IS_VALID(mCachePausedAt) ? GST_STATE_PAUSED : GST_STATE_PLAYING;
+
     return mState;
 }
 
 GstState Player::queryState()
 {
+    if (getServingFromCache())
+        return getState();
+
     if (gst_element_get_state(mPipeline, &mState, nullptr, GST_SECOND) == GST_STATE_CHANGE_FAILURE)
         NSVR_LOG("Failed to obtain state in specified timeout.");
 
@@ -211,6 +558,10 @@ void Player::stop()
 {
     setState(GST_STATE_NULL);
     setState(GST_STATE_READY);
+
+    // Playback starts over from the beginning, a new pass can be cached
+    if (mFrameCache)
+        mFrameCache->arm();
 }
 
 void Player::play()
@@ -233,344 +584,2143 @@ void Player::pause()
 
 void Player::update()
 {
-    onBeforeUpdate();
+    update(-1.);
+}
 
-    if (mGstBus != nullptr)
-    {
-        while (gst_bus_have_pending(mGstBus) != FALSE)
-        {
-            if (GstMessage* msg = gst_bus_pop(mGstBus))
-            {
-                BIND_TO_SCOPE(msg);
+gdouble Player::update(gdouble budget)
+{
+    mWakeup.acknowledge();
 
-                switch (GST_MESSAGE_TYPE(msg))
-                {
+    mUpdateDeadline = budget < 0.
+        ? G_MAXINT64
+        : g_get_monotonic_time() + gint64(budget * G_USEC_PER_SEC);
 
-                case GST_MESSAGE_ERROR:
-                {
-                    GError* err = nullptr;
-                    gchar*  dbg = nullptr;
-                    
-                    BIND_TO_SCOPE(err);
-                    BIND_TO_SCOPE(dbg);
+    drainCommands();
 
-                    gst_message_parse_error(msg, &err, &dbg);
+    // Frame hand off is never deferred
+    processFrame();
 
-                    NSVR_LOG("Pipeline encountered an error: [" << err->message << "] debug: [" << dbg << "].");
-                }
-                break;
+    onBeforeUpdate();
+    processBus();
+    processTasks();
+    processCues();
+    measureAudioDrift();
 
-                case GST_MESSAGE_STATE_CHANGED:
-                {
-                    if (GST_MESSAGE_SRC(msg) == GST_OBJECT(mPipeline))
-                    {
-                        GstState old_state = GST_STATE_NULL;
-                        gst_message_parse_state_changed(msg, &old_state, &mState, nullptr);
+    const gint64 overrun = g_get_monotonic_time() - mUpdateDeadline;
+    processQos(overrun > 0);
 
-                        if (old_state != mState)
-                        {
-                            onStateChanged(old_state);
-                        }
-                    }
-                }
-                break;
+    return overrun > 0 ? overrun / gdouble(G_USEC_PER_SEC) : 0.;
+}
 
-                case GST_MESSAGE_ASYNC_DONE:
-                {
-                    if (mSeekingLock)
-                    {
-                        mSeekingLock = false;
-                    }
+void Player::updateAt(GstClockTime display_time)
+{
+    mWakeup.acknowledge();
 
-                    if (mPendingSeek >= 0.)
-                    {
-                        setTime(mPendingSeek);
-                    }
+    mUpdateDeadline = G_MAXINT64;
 
-                    onSeekFinished();
-                }
-                break;
+    drainCommands();
 
-                case GST_MESSAGE_DURATION_CHANGED:
-                {
-                    queryDuration();
-                }
-                break;
+    if (mDisplayQueueDepth > 0 && !mRunOffline && !getServingFromCache())
+        processQueuedFrame(display_time);
+    else
+        processFrame();
 
-                case GST_MESSAGE_EOS:
-                {
-                    onStreamEnd();
+    onBeforeUpdate();
+    processBus();
+    processTasks();
+    processCues();
+    measureAudioDrift();
+    processQos(false);
+}
 
-                    if (getLoop())
-                    {
-                        replay();
-                    }
-                    else
-                    {
-                        pause();
-                    }
-                }
-                    break;
+void Player::processBus()
+{
+    // Followers of a shared decode take the bus over once its leader is gone
+    if (mGstBus == nullptr && mSharedDecode && mSharedDecode->lead(this))
+        watchBus(gst_pipeline_get_bus(GST_PIPELINE(mPipeline)));
 
-                case GST_MESSAGE_WARNING:
-                {
-                    GError* err = nullptr;
-                    gchar*  dbg = nullptr;
+    if (mGstBus == nullptr)
+    {
+        if (mSharedDecode)
+            mirrorState();
 
-                    BIND_TO_SCOPE(err);
-                    BIND_TO_SCOPE(dbg);
+        return;
+    }
 
-                    gst_message_parse_warning(msg, &err, &dbg);
+    // At least one message per call, so the bus is never starved
+    bool first = true;
 
-                    NSVR_LOG("Pipeline emitted warning: [" << err->message << "] debug: [" << dbg << "].");
-                }
-                    break;
+    while ((first || hasTimeLeft()) && gst_bus_have_pending(mGstBus) != FALSE)
+    {
+        first = false;
 
-                case GST_MESSAGE_INFO:
-                {
-                    GError* err = nullptr;
-                    gchar*  dbg = nullptr;
+        if (GstMessage* msg = gst_bus_pop(mGstBus))
+        {
+            BIND_TO_SCOPE(msg);
+            processMessage(msg);
+        }
+    }
+}
 
-                    BIND_TO_SCOPE(err);
-                    BIND_TO_SCOPE(dbg);
+void Player::mirrorState()
+{
+    GstState state = mState;
 
-                    gst_message_parse_info(msg, &err, &dbg);
+    if (gst_element_get_state(mPipeline, &state, nullptr, 0) == GST_STATE_CHANGE_FAILURE || state == mState)
+        return;
 
-                    NSVR_LOG("Pipeline emitted info: [" << err->message << "] debug: [" << dbg << "].");
-                }
-                break;
+    GstState old_state = mState;
+    mState = state;
 
-                default:
-                    break;
-                }
-            }
+    if (mState <= GST_STATE_READY)
+        flushDisplayQueue();
+
+    onStateChanged(old_state);
+}
+
+void Player::processQueuedFrame(GstClockTime display_time)
+{
+    g_return_if_fail(mPipeline != nullptr);
+
+    mPresentationStats.dropped += mDisplayOverflow.exchange(0);
+
+    const GstClockTime base_time = gst_element_get_base_time(mPipeline);
+
+    if (display_time < base_time)
+    {
+        ++mPresentationStats.repeated;
+        return;
+    }
+
+    const GstClockTime running_time = display_time - base_time;
+
+    GstSample       *sample = nullptr;
+    GstClockTime    end     = GST_CLOCK_TIME_NONE;
+    FrameChange     change;
+
+    {
+        std::lock_guard<std::mutex> lock(mDisplayMutex);
+
+        // Latest frame whose window started by display time wins
+        while (!mDisplayQueue.empty() && mDisplayQueue.front().begin <= running_time)
+        {
+            if (sample != nullptr)
+            {
+                gst_sample_unref(sample);
+                ++mPresentationStats.dropped;
+
+                // Tiles changed by superseded frames never reached the display either
+                mDisplayQueue.front().change.merge(change);
+            }
+
+            sample  = mDisplayQueue.front().sample;
+            end     = mDisplayQueue.front().end;
+            change  = std::move(mDisplayQueue.front().change);
+            mDisplayQueue.pop_front();
+        }
+
+        if (sample == nullptr && !mDisplayQueue.empty())
+            ++mPresentationStats.early;
+    }
+
+    if (sample == nullptr)
+    {
+        ++mPresentationStats.repeated;
+        return;
+    }
+
+    if (GST_CLOCK_TIME_IS_VALID(end) && end <= running_time)
+        ++mPresentationStats.late;
+
+    ++mPresentationStats.presented;
+
+    mFrameChange   = std::move(change);
+    mCurrentSample = sample;
+    mCurrentBuffer = gst_sample_get_buffer(sample);
+
+    if (mCurrentBuffer != nullptr && gst_buffer_map(mCurrentBuffer, &mCurrentMapInfo, GST_MAP_READ) != FALSE)
+    {
+        onVideoFrame(
+            mCurrentMapInfo.data,
+            mCurrentMapInfo.size);
+
+        gst_buffer_unmap(mCurrentBuffer, &mCurrentMapInfo);
+    }
+
+    gst_sample_unref(mCurrentSample);
+
+    mCurrentBuffer = nullptr;
+    mCurrentSample = nullptr;
+}
+
+void Player::flushDisplayQueue()
+{
+    std::lock_guard<std::mutex> lock(mDisplayMutex);
+
+    for (auto& frame : mDisplayQueue)
+        gst_sample_unref(frame.sample);
+
+    mDisplayQueue.clear();
+
+    // Queued changes are lost, the next frame is compared with nothing
+    if (mChangeDetector)
+        mChangeDetector->reset();
+}
+
+void Player::setHandoffFlushing(bool on)
+{
+    {
+        std::lock_guard<std::mutex> lock(mWaitMutex);
+        mHandoffFlushing = on;
+
+        // Frame held for update() belongs to what is flushed, it is never handed off
+        if (on && mBufferDirty)
+        {
+            if (mCurrentBuffer != nullptr)
+                gst_buffer_unmap(mCurrentBuffer, &mCurrentMapInfo);
+
+            if (mCurrentSample != nullptr)
+                gst_sample_unref(mCurrentSample);
+
+            mCurrentBuffer  = nullptr;
+            mCurrentSample  = nullptr;
+            mBufferDirty    = false;
+        }
+    }
+
+    mHandoffCondition.notify_all();
+}
+
+void Player::setOffline(bool on)
+{
+    mOffline = on;
+}
+
+bool Player::getOffline() const
+{
+    return mOffline;
+}
+
+guint64 Player::getFrameIndex() const
+{
+    if (getServingFromCache())
+        return mCacheIndex < 0 ? 0 : mFrameCache->getFrameIndex(mCacheIndex);
+
+    return mFrameIndex;
+}
+
+const FrameChange& Player::getFrameChange() const
+{
+    static const FrameChange whole;
+
+    if (getServingFromCache())
+        return whole;
+
+    return mFrameChange;
+}
+
+gdouble Player::getDecodeRate() const
+{
+    const guint64   frames  = mDecodedFrames;
+    const gint64    span    = mDecodeLast - mDecodeStart;
+
+    return frames > 1 && span > 0 ? (frames - 1) * gdouble(G_USEC_PER_SEC) / span : 0.;
+}
+
+void Player::setFramePool(guint slots)
+{
+    mFramePoolSlots = slots;
+}
+
+guint Player::getFramePool() const
+{
+    return mFramePoolSlots;
+}
+
+FramePoolStats Player::getFramePoolStats() const
+{
+    return mFramePool ? mFramePool->getStats() : FramePoolStats();
+}
+
+void Player::setChangeDetection(guint tile_size, bool skip_unchanged)
+{
+    mChangeTileSize = tile_size;
+    mChangeSkip     = skip_unchanged;
+}
+
+guint Player::getChangeDetection() const
+{
+    return mChangeTileSize;
+}
+
+bool Player::getSkipUnchanged() const
+{
+    return mChangeSkip;
+}
+
+FrameChangeStats Player::getFrameChangeStats() const
+{
+    FrameChangeStats stats = mChangeDetector ? mChangeDetector->getStats() : FrameChangeStats();
+    stats.skipped = mChangeSkipped;
+
+    return stats;
+}
+
+bool Player::addCue(gdouble time, const std::string& id)
+{
+    if (!mCues.add(time, id))
+    {
+        NSVR_LOG("Cue needs an id and a media time of 0 or later.");
+        return false;
+    }
+
+    onCuesChanged();
+    return true;
+}
+
+bool Player::removeCue(const std::string& id)
+{
+    if (!mCues.remove(id))
+        return false;
+
+    onCuesChanged();
+    return true;
+}
+
+void Player::setCues(const std::vector<Cue>& cues)
+{
+    mCues.set(cues);
+    onCuesChanged();
+}
+
+void Player::clearCues()
+{
+    mCues.clear();
+    onCuesChanged();
+}
+
+std::vector<Cue> Player::getCues() const
+{
+    return mCues.getCues();
+}
+
+void Player::setCueOffset(gdouble offset)
+{
+    mCues.setOffset(offset);
+}
+
+gdouble Player::getCueOffset() const
+{
+    return mCues.getOffset();
+}
+
+CueStats Player::getCueStats() const
+{
+    return mCues.getStats();
+}
+
+guint64 Player::getCueVersion() const
+{
+    return mCues.getVersion();
+}
+
+void Player::setLive(bool on, gdouble latency)
+{
+    mLive           = on;
+    mLiveLatency    = latency > 0. ? latency : 0.;
+}
+
+bool Player::getLive() const
+{
+    return mLive;
+}
+
+gdouble Player::getLiveLatency() const
+{
+    return mLiveLatency;
+}
+
+const LatencyStats& Player::getLatencyStats() const
+{
+    return mLatencyStats;
+}
+
+void Player::setDownload(bool on, guint64 ring_size)
+{
+    mDownload       = on;
+    mDownloadRing   = ring_size;
+}
+
+bool Player::getDownload() const
+{
+    return mDownload;
+}
+
+gint Player::getBufferingPercent() const
+{
+    return mBufferingPercent;
+}
+
+bool Player::getBuffering() const
+{
+    return mBuffering;
+}
+
+void Player::setReadAhead(gsize window)
+{
+    mReadAheadWindow = window;
+}
+
+gsize Player::getReadAhead() const
+{
+    return mReadAheadWindow;
+}
+
+ReadAheadStats Player::getReadAheadStats() const
+{
+    UringFile *uring = internal::getUringFile(mFileSource);
+
+    if (uring != nullptr && uring->isOpen())
+        return uring->getStats();
+
+    ReadAheadFile *file = internal::getReadAheadFile(mFileSource);
+    return file != nullptr ? file->getStats() : ReadAheadStats();
+}
+
+void Player::setIoUring(guint depth, bool direct)
+{
+    mIoUringDepth   = depth;
+    mIoUringDirect  = direct;
+}
+
+guint Player::getIoUring() const
+{
+    return mIoUringDepth;
+}
+
+void Player::setAudioSink(const AudioSinkSettings& settings)
+{
+    mAudioSinkSettings = settings;
+}
+
+const AudioSinkSettings& Player::getAudioSink() const
+{
+    return mAudioSinkSettings;
+}
+
+void Player::setTaskPool(const std::shared_ptr<TaskPool>& pool)
+{
+    mTaskPool = pool;
+}
+
+const std::shared_ptr<TaskPool>& Player::getTaskPool() const
+{
+    return mTaskPool;
+}
+
+const AudioDriftStats& Player::getAudioDriftStats() const
+{
+    return mAudioDriftStats;
+}
+
+void Player::warmSeekTarget(gdouble time)
+{
+    ReadAheadFile *file = internal::getReadAheadFile(mFileSource);
+
+    if (file == nullptr || mDuration <= 0.)
+        return;
+
+    gint64 offset = -1;
+
+    // Demuxers knowing an index answer exactly, otherwise the bit rate is assumed constant (ProRes, MJPEG)
+    if (gst_element_query_convert(mPipeline, GST_FORMAT_TIME, gint64(time * GST_SECOND), GST_FORMAT_BYTES, &offset) == FALSE || offset < 0)
+        offset = gint64(file->getSize() * CLAMP(time / mDuration, 0., 1.));
+
+    // Demuxers resume from the key frame before the target
+    const gint64 margin = gint64(mReadAheadWindow / 4);
+
+    file->warm(guint64(MAX(offset - margin, gint64(0))));
+}
+
+void Player::setDisplayQueue(guint depth, gdouble lookahead)
+{
+    mDisplayQueueDepth  = depth;
+    mDisplayLookahead   = lookahead > 0. ? lookahead : 0.;
+}
+
+void Player::setDecodeSharing(bool on)
+{
+    mDecodeSharing = on;
+}
+
+bool Player::getDecodeSharing() const
+{
+    return mDecodeSharing;
+}
+
+void Player::setCrop(gint left, gint top, gint right, gint bottom)
+{
+    mCropLeft   = left;
+    mCropTop    = top;
+    mCropRight  = right;
+    mCropBottom = bottom;
+}
+
+void Player::setQosControl(QosLevel max_level)
+{
+    mQos.setMaxLevel(max_level);
+}
+
+QosLevel Player::getQosLevel() const
+{
+    return mQos.getLevel();
+}
+
+void Player::processQos(bool overrun)
+{
+    if (mQos.getMaxLevel() == QOS_NONE || mPipeline == nullptr || mRunOffline || getServingFromCache())
+        return;
+
+    mQos.addFrames(mQosFrames.exchange(0));
+    mQos.addDrops(mQosDrops.exchange(0));
+    mQos.addUpdate(overrun);
+
+    const QosLevel  old_level = mQos.getLevel();
+    std::string     reason;
+
+    if (!mQos.evaluate(g_get_monotonic_time(), reason))
+        return;
+
+    NSVR_LOG("Quality changed from [" << getQosLevelName(old_level) << "] to [" << getQosLevelName(mQos.getLevel()) << "], " << reason << ".");
+
+    applyQosLevel(old_level);
+    onQosLevelChanged(old_level, reason);
+}
+
+void Player::applyQosLevel(QosLevel old)
+{
+    const QosLevel level = mQos.getLevel();
+
+    // Frames recorded so far may not match the new output
+    if (mFrameCache)
+        mFrameCache->invalidate();
+
+    if ((old >= QOS_HALF_RESOLUTION) != (level >= QOS_HALF_RESOLUTION) && mAppSink != nullptr && mQosCaps != nullptr)
+    {
+        GstCaps *caps = gst_caps_copy(mQosCaps);
+        BIND_TO_SCOPE(caps);
+
+        if (level >= QOS_HALF_RESOLUTION)
+        {
+            GstStructure    *str    = gst_caps_get_structure(caps, 0);
+            gint            width   = 0;
+            gint            height  = 0;
+
+            // Keep dimensions even, most raw formats subsample chroma
+            if (gst_structure_get_int(str, "width", &width) != FALSE &&
+                gst_structure_get_int(str, "height", &height) != FALSE)
+            {
+                gst_structure_set(str,
+                    "width", G_TYPE_INT, MAX(2, (width / 2) & ~1),
+                    "height", G_TYPE_INT, MAX(2, (height / 2) & ~1),
+                    nullptr);
+            }
+        }
+
+        g_object_set(mAppSink, "caps", caps, nullptr);
+    }
+
+    const bool old_trick = old >= QOS_SKIP_NON_REFERENCE;
+    const bool new_trick = level >= QOS_SKIP_NON_REFERENCE;
+
+    if (old_trick == new_trick && (old >= QOS_KEY_UNITS) == (level >= QOS_KEY_UNITS))
+        return;
+
+    // Decoders pick trick modes up from the segment, seek in place to renew it
+    gint64 position = 0;
+
+    if (mSeekingLock || gst_element_query_position(mPipeline, GST_FORMAT_TIME, &position) == FALSE)
+        return;
+
+    setHandoffFlushing(true);
+
+    const gboolean seeked = gst_element_seek(
+        mPipeline,
+        1.,
+        GST_FORMAT_TIME,
+        GstSeekFlags(GST_SEEK_FLAG_FLUSH | getQosSeekFlags()),
+        GST_SEEK_TYPE_SET,
+        position,
+        GST_SEEK_TYPE_NONE,
+        GST_CLOCK_TIME_NONE);
+
+    setHandoffFlushing(false);
+
+    if (seeked != FALSE)
+    {
+        mSeekingLock = true;
+        mQosSeeking = true;
+    }
+    else
+    {
+        NSVR_LOG("Seek applying quality level failed.");
+    }
+}
+
+GstSeekFlags Player::getQosSeekFlags() const
+{
+#if GST_CHECK_VERSION(1, 6, 0)
+    if (mQos.getLevel() >= QOS_KEY_UNITS)
+        return GstSeekFlags(GST_SEEK_FLAG_TRICKMODE | GST_SEEK_FLAG_TRICKMODE_KEY_UNITS);
+
+    if (mQos.getLevel() >= QOS_SKIP_NON_REFERENCE)
+        return GST_SEEK_FLAG_TRICKMODE;
+#endif
+
+    return GST_SEEK_FLAG_NONE;
+}
+
+guint Player::getDisplayQueueDepth() const
+{
+    return mDisplayQueueDepth;
+}
+
+const PresentationStats& Player::getPresentationStats() const
+{
+    return mPresentationStats;
+}
+
+void Player::processFrame()
+{
+    if (getServingFromCache())
+    {
+        processCachedFrame();
+    }
+    else if (mBufferDirty)
+    {
+        if (mRunLive)
+            measureLatency();
+
+        onVideoFrame(
+            mCurrentMapInfo.data,
+            mCurrentMapInfo.size);
+
+        // free current resources on previous frame
+        if (mCurrentBuffer) gst_buffer_unmap(mCurrentBuffer, &mCurrentMapInfo);
+        if (mCurrentSample) gst_sample_unref(mCurrentSample);
+
+        mCurrentBuffer = nullptr;
+        mCurrentSample = nullptr;
+
+        // Signal Streaming thread it can produce
+        mBufferDirty = false;
+
+        if (mRunOffline)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mWaitMutex);
+            }
+
+            mHandoffCondition.notify_one();
+        }
+    }
+}
+
+void Player::processMessage(GstMessage* msg)
+{
+    switch (GST_MESSAGE_TYPE(msg))
+    {
+
+    case GST_MESSAGE_ERROR:
+    {
+        GError* err = nullptr;
+        gchar*  dbg = nullptr;
+        
+        BIND_TO_SCOPE(err);
+        BIND_TO_SCOPE(dbg);
+
+        gst_message_parse_error(msg, &err, &dbg);
+
+        NSVR_LOG("Pipeline encountered an error: [" << err->message << "] debug: [" << dbg << "].");
+    }
+    break;
+
+    case GST_MESSAGE_STATE_CHANGED:
+    {
+        if (GST_MESSAGE_SRC(msg) == GST_OBJECT(mPipeline) && !getServingFromCache())
+        {
+            GstState old_state = GST_STATE_NULL;
+            gst_message_parse_state_changed(msg, &old_state, &mState, nullptr);
+
+            // Queued frames and trick modes do not survive a flush
+            if (mState <= GST_STATE_READY)
+            {
+                flushDisplayQueue();
+
+                if (mQos.getLevel() != QOS_NONE)
+                {
+                    const QosLevel old_level = mQos.getLevel();
+                    mQos.reset();
+
+                    applyQosLevel(old_level);
+                    onQosLevelChanged(old_level, "reset: pipeline stopped");
+                }
+            }
+
+            if (old_state != mState)
+            {
+                onStateChanged(old_state);
+            }
+        }
+    }
+    break;
+
+    case GST_MESSAGE_ASYNC_DONE:
+    {
+        if (mSeekingLock)
+        {
+            mSeekingLock = false;
+
+            // Finished before a pending seek takes its place
+            if (!mQosSeeking)
+                resolveSeekTicket(mSeekInFlight, true);
+        }
+
+        if (mPendingSeek >= 0.)
+        {
+            setTime(mPendingSeek);
+        }
+
+        // Seeks of the QoS controller are not the user's
+        if (mQosSeeking)
+        {
+            mQosSeeking = false;
+            break;
+        }
+
+        ++mSeekCount;
+        onSeekFinished();
+    }
+    break;
+
+    case GST_MESSAGE_QOS:
+    {
+        // Audio sinks post QoS too, only dropped video frames count
+        if (GST_MESSAGE_SRC(msg) != GST_OBJECT(mAppSink) && !isVideoDecoder(GST_MESSAGE_SRC(msg)))
+            break;
+
+        GstFormat   format      = GST_FORMAT_UNDEFINED;
+        guint64     processed   = 0;
+        guint64     dropped     = 0;
+
+        gst_message_parse_qos_stats(msg, &format, &processed, &dropped);
+
+        // Counts are totals of the element, reset by flushes. Unknown counts are one frame
+        if (format != GST_FORMAT_BUFFERS || dropped == guint64(-1))
+        {
+            ++mQosDrops;
+            break;
+        }
+
+        const std::string   name = GST_MESSAGE_SRC_NAME(msg);
+        guint64             &last = mQosDropped[name];
+
+        mQosDrops   += dropped >= last ? dropped - last : dropped;
+        last         = dropped;
+    }
+    break;
+
+    case GST_MESSAGE_DURATION_CHANGED:
+    {
+        queryDuration();
+    }
+    break;
+
+    case GST_MESSAGE_LATENCY:
+    {
+        // Posted by live elements whenever their latency changes
+        processLatency();
+    }
+    break;
+
+    case GST_MESSAGE_BUFFERING:
+    {
+        processBuffering(msg);
+    }
+    break;
+
+    case GST_MESSAGE_EOS:
+    {
+        onStreamEnd();
+
+        if (getLoop())
+        {
+            if (!enterFrameCache())
+                replay();
+        }
+        else
+        {
+            pause();
+        }
+    }
+        break;
+
+    case GST_MESSAGE_WARNING:
+    {
+        GError* err = nullptr;
+        gchar*  dbg = nullptr;
+
+        BIND_TO_SCOPE(err);
+        BIND_TO_SCOPE(dbg);
+
+        gst_message_parse_warning(msg, &err, &dbg);
+
+        NSVR_LOG("Pipeline emitted warning: [" << err->message << "] debug: [" << dbg << "].");
+    }
+        break;
+
+    case GST_MESSAGE_INFO:
+    {
+        GError* err = nullptr;
+        gchar*  dbg = nullptr;
+
+        BIND_TO_SCOPE(err);
+        BIND_TO_SCOPE(dbg);
+
+        gst_message_parse_info(msg, &err, &dbg);
+
+        NSVR_LOG("Pipeline emitted info: [" << err->message << "] debug: [" << dbg << "].");
+    }
+    break;
+
+    default:
+        break;
+    }
+}
+
+bool Player::hasTimeLeft() const
+{
+    return g_get_monotonic_time() < mUpdateDeadline;
+}
+
+gint64 Player::getUpdateDeadline() const
+{
+    return mUpdateDeadline;
+}
+
+void Player::schedule(std::function<bool()> task)
+{
+    if (task)
+        mTasks.push_back(std::move(task));
+}
+
+void Player::processTasks()
+{
+    if (mTasks.empty())
+        return;
+
+    // Tasks may schedule new tasks while being run
+    std::vector<std::function<bool()>> tasks;
+    tasks.swap(mTasks);
+
+    for (auto& task : tasks)
+    {
+        if (!task())
+            mTasks.push_back(std::move(task));
+    }
+}
+
+void Player::post(PlayerCommand::Type type, gdouble value)
+{
+    PlayerCommand command;
+    command.type        = type;
+    command.value       = value;
+    command.timestamp   = g_get_monotonic_time();
+
+    mCommands.push(command);
+    mWakeup.signal();
+}
+
+void Player::drainCommands()
+{
+    std::vector<PlayerCommand>  commands;
+    PlayerCommand               command;
+
+    while (mCommands.pop(command))
+        commands.push_back(command);
+
+    if (commands.empty())
+        return;
+
+    // Coalesce: only the latest seek and volume change are executed
+    std::size_t last_seek   = commands.size();
+    std::size_t last_volume = commands.size();
+
+    for (std::size_t index = 0; index < commands.size(); ++index)
+    {
+        if (commands[index].type == PlayerCommand::SEEK)   last_seek   = index;
+        if (commands[index].type == PlayerCommand::VOLUME) last_volume = index;
+    }
+
+    const gint64 now = g_get_monotonic_time();
+
+    for (std::size_t index = 0; index < commands.size(); ++index)
+    {
+        const PlayerCommand& cmd = commands[index];
+
+        if ((cmd.type == PlayerCommand::SEEK   && index != last_seek) ||
+            (cmd.type == PlayerCommand::VOLUME && index != last_volume))
+            continue;
+
+        mCommandLatency = (now - cmd.timestamp) / gdouble(G_USEC_PER_SEC);
+
+        switch (cmd.type)
+        {
+        case PlayerCommand::PLAY:   play();                     break;
+        case PlayerCommand::PAUSE:  pause();                    break;
+        case PlayerCommand::STOP:   stop();                     break;
+        case PlayerCommand::REPLAY: replay();                   break;
+        case PlayerCommand::SEEK:   setTime(cmd.value);         break;
+        case PlayerCommand::VOLUME: setVolume(cmd.value);       break;
+        case PlayerCommand::MUTE:   setMute(cmd.value != 0.);   break;
+        case PlayerCommand::LOOP:   setLoop(cmd.value != 0.);   break;
+        default:                                                break;
+        }
+    }
+}
+
+gdouble Player::getCommandLatency() const
+{
+    return mCommandLatency;
+}
+
+GPollFD Player::getPollFd() const
+{
+    return mWakeup.getPollFd();
+}
+
+bool Player::waitForFrame(gdouble timeout)
+{
+    if (getServingFromCache())
+        return true;
+
+    auto ready = [this]
+    {
+        if (mBufferDirty)
+            return true;
+
+        std::lock_guard<std::mutex> lock(mDisplayMutex);
+        return !mDisplayQueue.empty();
+    };
+
+    std::unique_lock<std::mutex> lock(mWaitMutex);
+
+    if (timeout < 0.)
+    {
+        mWaitCondition.wait(lock, ready);
+        return true;
+    }
+
+    return mWaitCondition.wait_for(lock, std::chrono::microseconds(gint64(timeout * G_USEC_PER_SEC)), ready);
+}
+
+guint Player::getSeekCount() const
+{
+    return mSeekCount;
+}
+
+guint Player::getSeekTicket() const
+{
+    return mSeekTicket;
+}
+
+SeekResult Player::getSeekResult(guint ticket) const
+{
+    if (ticket > mSeekResolved)
+        return SeekResult::PENDING;
+
+    return ticket == mSeekFailed ? SeekResult::FAILED : SeekResult::DONE;
+}
+
+bool Player::hasScheduledTasks() const
+{
+    return !mTasks.empty();
+}
+
+guint Player::issueSeekTicket()
+{
+    // Seeks coalesce into the one pending, so do their tickets
+    if (mPendingSeek < 0. || mPendingSeekTicket == 0)
+        mPendingSeekTicket = ++mSeekTicket;
+
+    return mPendingSeekTicket;
+}
+
+void Player::resolveSeekTicket(guint ticket, bool succeeded)
+{
+    if (ticket == 0)
+        return;
+
+    mSeekResolved = std::max(mSeekResolved, ticket);
+
+    if (!succeeded)
+        mSeekFailed = ticket;
+
+    if (ticket == mPendingSeekTicket)
+        mPendingSeekTicket = 0;
+
+    if (ticket == mSeekInFlight)
+        mSeekInFlight = 0;
+}
+
+gdouble Player::getDuration() const
+{
+    return mDuration;
+}
+
+void Player::setLoop(bool on)
+{
+    g_return_if_fail(mLoop != on);
+    mLoop = on;
+}
+
+bool Player::getLoop() const
+{
+    return mLoop;
+}
+
+void Player::setTime(gdouble time)
+{
+    g_return_if_fail(mPipeline != nullptr);
+
+    const guint ticket = issueSeekTicket();
+
+    if (getServingFromCache())
+    {
+        // Seeking within the cache is only a matter of moving its epoch, or the position paused at
+        GstClockTime now    = gst_clock_get_time(mCacheClock);
+        GstClockTime offset = GstClockTime(CLAMP(time, 0, mDuration) * GST_SECOND);
+
+        if (GST_CLOCK_TIME_IS_VALID(mCachePausedAt))
+            mCachePausedAt = offset;
+        else
+            mCacheEpoch = now > offset ? now - offset : 0;
+
+        mCacheIndex = -1;
+        resolveSeekTicket(ticket, true);
+        return;
+    }
+
+    if (mRunLive)
+    {
+        NSVR_LOG("Live media cannot be seeked.");
+        resolveSeekTicket(ticket, false);
+        return;
+    }
+
+    warmSeekTarget(time);
+    seekFrameCache(time);
+    flushDisplayQueue();
+
+    if (mSeekingLock || mDuration == 0)
+    {
+        mPendingSeek = time;
+
+        // Retried once pre-rolled, but nothing is issued now to wait for
+        if (!mSeekingLock)
+            resolveSeekTicket(ticket, false);
+
+        return;
+    }
+
+    // A streaming thread waiting on update() would keep the flush from taking the sink's preroll lock
+    setHandoffFlushing(true);
+
+    const gboolean seeked = gst_element_seek_simple(
+        mPipeline,
+        GST_FORMAT_TIME,
+        GstSeekFlags(
+            GST_SEEK_FLAG_FLUSH |
+            GST_SEEK_FLAG_ACCURATE |
+            getQosSeekFlags()),
+        gint64(CLAMP(time, 0, mDuration) * GST_SECOND));
+
+    setHandoffFlushing(false);
+
+    if (seeked != FALSE)
+    {
+        mSeekingLock        = true;
+        mPendingSeek        = -1.;
+        mPendingSeekTicket  = 0;
+        mSeekInFlight       = ticket;
+    }
+    else
+    {
+        NSVR_LOG("Flushing seek operation failed.");
+        resolveSeekTicket(ticket, false);
+    }
+}
+
+gdouble Player::getTime() const
+{
+    g_return_val_if_fail(mPipeline != nullptr, 0.);
+
+    if (getServingFromCache())
+        return mTime;
+
+    gint64 time_ns;
+    if (gst_element_query_position(mPipeline, GST_FORMAT_TIME, &time_ns) != FALSE)
+    {
+        mTime = time_ns / gdouble(GST_SECOND);
+    }
+
+    return mTime;
+}
+
+void Player::setVolume(gdouble vol)
+{
+    g_return_if_fail(mPipeline != nullptr || mVolume != vol || !getMute());
+
+    mVolume = CLAMP(vol, 0., 1.);
+    mMute = false;
+
+    if (mPipeline && internal::hasProperty(mPipeline, "volume"))
+    {
+        g_object_set(mPipeline, "volume", mVolume, nullptr);
+    }
+}
+
+gdouble Player::getVolume() const
+{
+    g_return_val_if_fail(mPipeline != nullptr, 0.);
+
+    if (mPipeline && internal::hasProperty(mPipeline, "volume"))
+    {
+        g_object_get(mPipeline, "volume", &mVolume, nullptr);
+    }
+
+    return mVolume;
+}
+
+void Player::setMute(bool on)
+{
+    static gdouble saved_volume = 1.;
+    g_return_if_fail(mPipeline != nullptr || (on && saved_volume == 0.));
+
+    if (on)
+    {
+        saved_volume = getVolume();
+        setVolume(0.);
+        mMute = true;
+    }
+    else
+    {
+        mMute = false;
+        setVolume(saved_volume);
+        saved_volume = 1.;
+    }
+}
+
+bool Player::getMute() const
+{
+    return mMute;
+}
+
+gint Player::getWidth() const
+{
+    return mWidth;
+}
+
+gint Player::getHeight() const
+{
+    return mHeight;
+}
+
+void Player::setFrameCacheBudget(gsize budget)
+{
+    mFrameCacheBudget = budget;
+}
+
+gsize Player::getFrameCacheBudget() const
+{
+    return mFrameCacheBudget;
+}
+
+bool Player::getServingFromCache() const
+{
+    return mCacheClock != nullptr;
+}
+
+void Player::leaveFrameCache()
+{
+    if (!getServingFromCache())
+        return;
+
+    gst_object_unref(mCacheClock);
+
+    // Pipeline was parked in READY by enterFrameCache()
+    mCacheClock     = nullptr;
+    mCacheIndex     = -1;
+    mCachePausedAt  = GST_CLOCK_TIME_NONE;
+    mState          = GST_STATE_READY;
+}
+
+void Player::seekFrameCache(gdouble time)
+{
+    if (!mFrameCache)
+        return;
+
+    // Seeking to the start begins a fresh pass, anywhere else breaks it
+    if (time <= 0.)
+        mFrameCache->arm();
+    else
+        mFrameCache->invalidate();
+}
+
+void Player::reset()
+{
+    mState          = GST_STATE_NULL;
+    mPipeline       = nullptr;
+    mGstBus         = nullptr;
+    mCurrentBuffer  = nullptr;
+    mCurrentSample  = nullptr;
+    mWidth          = 0;
+    mHeight         = 0;
+    mDuration       = 0;
+    mTime           = 0.;
+    mVolume         = 1.;
+    mPendingSeek    = -1.;
+    mSeekingLock    = false;
+    mBufferDirty    = false;
+
+    // Seeks of the media closed never finish
+    if (mSeekResolved < mSeekTicket)
+        resolveSeekTicket(mSeekTicket, false);
+
+    mPendingSeekTicket  = 0;
+    mSeekInFlight       = 0;
+
+    mCacheClock     = nullptr;
+    mCacheEpoch     = 0;
+    mCacheIndex     = -1;
+    mCachePausedAt  = GST_CLOCK_TIME_NONE;
+    mFrameSourceIndex = 0;
+    mDisplayOverflow = 0;
+    mFrameChange    = FrameChange();
+    mChangeSkipped  = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mCueMutex);
+        gst_segment_init(&mCueSegment, GST_FORMAT_UNDEFINED);
+        mLastFrameEnd = GST_CLOCK_TIME_NONE;
+    }
+
+    mPresentationStats = PresentationStats();
+    mAppSink        = nullptr;
+    mQosCaps        = nullptr;
+    mQosSeeking     = false;
+    mQosFrames      = 0;
+    mQosDrops       = 0;
+    mQosDropped.clear();
+    mQos.reset();
+    mRunOffline     = false;
+    mFrameIndex     = 0;
+    mDecodedFrames  = 0;
+    mDecodeStart    = 0;
+    mDecodeLast     = 0;
+    mRunLive        = false;
+    mLatencyStats   = LatencyStats();
+    mBufferingPercent = 100;
+    mBuffering      = false;
+    mBufferingResume = false;
+    mFileSource     = nullptr;
+    mAudioSink      = nullptr;
+    mAudioDriftStats = AudioDriftStats();
+    mAudioDriftNext = 0;
+    mAudioDriftInternal = GST_CLOCK_TIME_NONE;
+    mAudioDriftMaster = GST_CLOCK_TIME_NONE;
+}
+
+std::string Player::getAppSinkProperties() const
+{
+    std::stringstream properties;
+
+    // Offline, nothing is dropped and the streaming thread blocks on hand off instead
+    if (mRunOffline)
+        properties << "drop=no async=no qos=no sync=no max-buffers=1";
+    else if (mRunLive)
+        properties << "drop=yes async=no qos=no sync=yes max-buffers=1";   // Newest frame only, nothing piles up
+    else
+        properties << "drop=yes async=no qos=yes sync=yes max-lateness=" << GST_SECOND;
+
+    return properties.str();
+}
+
+bool Player::launch(GstElement* app_sink, bool wait)
+{
+    g_return_val_if_fail(mPipeline != nullptr, false);
+
+    watchBus(gst_pipeline_get_bus(GST_PIPELINE(mPipeline)));
+
+    if (mGstBus == nullptr)
+    {
+        close();
+        NSVR_LOG("Unable to obtain pipeline's event bus.");
+        return false;
+    }
+
+    if (app_sink != nullptr)
+        setupAppSink(app_sink);
+
+    setupClock();
+
+    // Going from NULL => READY => PAUSE forces the
+    // pipeline to pre-roll so we can get video dim
+    GstState state;
+    unsigned timeout = 10;
+
+    if (gst_element_set_state(mPipeline, GST_STATE_READY) != GST_STATE_CHANGE_SUCCESS)
+    {
+        if (gst_element_get_state(mPipeline, &state, nullptr, timeout * GST_SECOND) == GST_STATE_CHANGE_FAILURE ||
+            state != GST_STATE_READY)
+        {
+            close();
+            NSVR_LOG("Failed to put pipeline in READY state.");
+            return false;
+        }
+    }
+
+    const GstStateChangeReturn paused = gst_element_set_state(mPipeline, GST_STATE_PAUSED);
+
+    // Live sources only produce data while PLAYING, there is no pre-roll to wait for
+    if (paused == GST_STATE_CHANGE_NO_PREROLL)
+    {
+        mRunLive = true;
+        return true;
+    }
+
+    if (!wait)
+    {
+        // Pre-roll completes later, observed by update() as a state change
+        if (paused == GST_STATE_CHANGE_FAILURE)
+        {
+            close();
+            NSVR_LOG("Failed to put pipeline in PAUSE state.");
+            return false;
+        }
+
+        return true;
+    }
+
+    if (paused != GST_STATE_CHANGE_SUCCESS)
+    {
+        if (gst_element_get_state(mPipeline, &state, nullptr, timeout * GST_SECOND) == GST_STATE_CHANGE_FAILURE ||
+            state != GST_STATE_PAUSED)
+        {
+            close();
+            NSVR_LOG("Failed to put pipeline in PAUSE state.");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+GstBusSyncReply Player::onBusMessage(GstBus* bus, GstMessage* msg, Player* player)
+{
+    // Tasks are handed their pool as they are created, before streaming
+    if (player && player->mBusTaskPool)
+        player->mBusTaskPool->handleStreamStatus(msg);
+
+    if (player)
+        player->mWakeup.signal();
+
+    return GST_BUS_PASS;
+}
+
+void Player::notifyFrame()
+{
+    {
+        std::lock_guard<std::mutex> lock(mWaitMutex);
+    }
+
+    mWaitCondition.notify_all();
+    mWakeup.signal();
+}
+
+void Player::watchBus(GstBus* bus)
+{
+    mGstBus         = bus;
+    mBusTaskPool    = mTaskPool;
+
+    if (mGstBus != nullptr)
+    {
+        gst_bus_set_sync_handler(mGstBus, reinterpret_cast<GstBusSyncHandler>(onBusMessage), this, nullptr);
+
+        // Messages posted before the handler was in place
+        if (gst_bus_have_pending(mGstBus) != FALSE)
+            mWakeup.signal();
+    }
+}
+
+void Player::setupAppSink(GstElement* app_sink)
+{
+    GstAppSinkCallbacks     callbacks;
+    callbacks.eos           = nullptr;
+    callbacks.new_preroll   = reinterpret_cast<decltype(callbacks.new_preroll)>(onPreroll);
+    callbacks.new_sample    = reinterpret_cast<decltype(callbacks.new_sample)>(onSample);
+
+    gst_app_sink_set_callbacks(GST_APP_SINK(app_sink), &callbacks, this, nullptr);
+
+    if (mAppSink != nullptr)
+        gst_object_unref(mAppSink);
+
+    mAppSink = GST_ELEMENT(gst_object_ref(app_sink));
+
+    // Constructed on the thread opening the media, which is the one consuming frames
+    if (mFramePoolSlots > 0)
+    {
+        mFramePool.reset(new FramePool(mFramePoolSlots));
+
+        if (!mFramePool->install(app_sink))
+            mFramePool.reset();
+    }
+
+    if (mChangeTileSize > 0)
+        mChangeDetector.reset(new FrameChangeDetector(mChangeTileSize));
+
+    // Levels the QoS controller can degrade this pipeline to
+    if (mQosCaps != nullptr)
+        gst_caps_unref(mQosCaps);
+
+    mQosCaps = nullptr;
+    g_object_get(app_sink, "caps", &mQosCaps, nullptr);
+
+    bool resizable = false;
+
+    if (mQosCaps != nullptr && gst_caps_get_size(mQosCaps) > 0)
+    {
+        GstStructure *str = gst_caps_get_structure(mQosCaps, 0);
+        resizable = gst_structure_has_field(str, "width") != FALSE && gst_structure_has_field(str, "height") != FALSE;
+    }
+
+    const bool trickable = GST_CHECK_VERSION(1, 6, 0) && !mFrameSource && !mRunLive;
+
+    mQos.setAvailable(QOS_HALF_RESOLUTION, resizable);
+    mQos.setAvailable(QOS_SKIP_NON_REFERENCE, trickable);
+    mQos.setAvailable(QOS_KEY_UNITS, trickable);
+
+    // Frames queued for updateAt() are delivered ahead of their time
+    if (mDisplayQueueDepth > 0 && mDisplayLookahead > 0. && !mRunOffline && !mRunLive)
+        g_object_set(app_sink, "ts-offset", gint64(-mDisplayLookahead * GST_SECOND), nullptr);
+}
+
+GstFlowReturn Player::onPreroll(GstElement* appsink, Player* player)
+{
+    // Here's our chance to get the actual dimension of the media.
+    // The actual dimension might be slightly different from what
+    // is passed into and requested from the pipeline.
+
+    if (GstSample* sample = gst_app_sink_pull_preroll(GST_APP_SINK(appsink)))
+    {
+        if (GstCaps *caps = gst_sample_get_caps(sample))
+        {
+            if (gst_caps_is_fixed(caps) != FALSE)
+            {
+                if (GstStructure *str = gst_caps_get_structure(caps, 0))
+                {
+                    if (gst_structure_get_int(str, "width", &player->mWidth) == FALSE ||
+                        gst_structure_get_int(str, "height", &player->mHeight) == FALSE)
+                    {
+                        NSVR_LOG("No width/height information available.");
+                    }
+                }
+            }
+            else
+            {
+                NSVR_LOG("caps is not fixed for this media.");
+            }
+        }
+
+        // Offline, the pre-rolled buffer is handed off once rendered, never twice
+        if (player && !player->mRunOffline)
+            player->processSample(sample);
+        else
+            gst_sample_unref(sample);
+    }
+
+    return GST_FLOW_OK;
+}
+
+GstFlowReturn Player::onSample(GstElement* appsink, Player* player)
+{
+    if (GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(appsink)))
+    {
+        if (player)
+            player->processSample(sample);
+    }
+
+    return GST_FLOW_OK;
+}
+
+void Player::onNeedData(GstElement* appsrc, guint length, Player* player)
+{
+    if (!(player && player->mFrameSource))
+        return;
+
+    const auto& source  = player->mFrameSource;
+    guint64     index   = player->mFrameSourceIndex++;
+
+    if (index >= source->getFrameCount())
+    {
+        gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+        return;
+    }
+
+    if (GstBuffer *buffer = source->getFrame(index))
+    {
+        if (!GST_CLOCK_TIME_IS_VALID(GST_BUFFER_PTS(buffer)))
+            GST_BUFFER_PTS(buffer) = source->getFrameTime(index);
+
+        GST_BUFFER_DURATION(buffer) = source->getFrameTime(index + 1) - source->getFrameTime(index);
+
+        // Takes ownership of the buffer
+        gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer);
+        source->prefetch(index + 1);
+    }
+    else
+    {
+        NSVR_LOG("Frame source failed to provide frame " << index << ".");
+        gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+    }
+}
+
+gboolean Player::onSeekData(GstElement* appsrc, guint64 offset, Player* player)
+{
+    if (!(player && player->mFrameSource))
+        return FALSE;
+
+    // Constant time: offset is a stream time in "format=time"
+    guint64 index = player->mFrameSource->getFrameIndex(offset);
+
+    player->mFrameSourceIndex = index;
+    player->mFrameSource->prefetch(index);
+
+    return TRUE;
+}
+
+void Player::onLiveElement(GstBin* bin, GstBin* sub_bin, GstElement* element, Player* player)
+{
+    const guint latency_ms = guint(player->mLiveLatency * 1000);
+
+    GstElementFactory   *factory    = gst_element_get_factory(element);
+    const gchar         *name       = factory ? gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)) : nullptr;
+
+    // rtspsrc and rtpjitterbuffer
+    if (internal::hasProperty(element, "latency") && internal::hasProperty(element, "drop-on-latency"))
+        g_object_set(element, "latency", latency_ms, "drop-on-latency", TRUE, nullptr);
+
+    // Kernel receive buffers, large enough for bursts of key frames
+    if (g_strcmp0(name, "udpsrc") == 0)
+        g_object_set(element, "buffer-size", kLiveSocketBuffer, nullptr);
+    else if (internal::hasProperty(element, "udp-buffer-size"))
+        g_object_set(element, "udp-buffer-size", kLiveSocketBuffer, nullptr);
+}
+
+void Player::onAudioElement(GstBin* bin, GstBin* sub_bin, GstElement* element, Player* player)
+{
+    // GstAudioBaseSink, whatever autoaudiosink picked
+    if (!internal::hasProperty(element, "slave-method") || !internal::hasProperty(element, "buffer-time"))
+        return;
+
+    const AudioSinkSettings& settings = player->mAudioSinkSettings;
+
+    if (settings.bufferTime > 0.)
+        g_object_set(element, "buffer-time", gint64(settings.bufferTime * G_USEC_PER_SEC), nullptr);
+
+    if (settings.latencyTime > 0.)
+        g_object_set(element, "latency-time", gint64(settings.latencyTime * G_USEC_PER_SEC), nullptr);
+
+    g_object_set(element, "slave-method", gint(settings.slaveMethod), nullptr);
+
+    std::lock_guard<std::mutex> lock(player->mAudioMutex);
+
+    if (player->mAudioSink != nullptr)
+        gst_object_unref(player->mAudioSink);
+
+    player->mAudioSink = GST_ELEMENT(gst_object_ref(element));
+}
+
+GstPadProbeReturn Player::onSourceEvent(GstPad* pad, GstPadProbeInfo* info, Player* player)
+{
+    if (player && GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) == GST_EVENT_STREAM_START)
+    {
+        player->mFrameSourceIndex = 0;
+        player->mFrameSource->prefetch(0);
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+void Player::processSample(GstSample* const sample)
+{
+    if (const GstSegment* segment = gst_sample_get_segment(sample))
+    {
+        GstBuffer       *buffer = gst_sample_get_buffer(sample);
+        GstClockTime    end     = GST_CLOCK_TIME_NONE;
+
+        if (buffer != nullptr && GST_BUFFER_PTS_IS_VALID(buffer) && segment->format == GST_FORMAT_TIME)
+        {
+            end = GST_BUFFER_PTS(buffer) + (GST_BUFFER_DURATION_IS_VALID(buffer) ? GST_BUFFER_DURATION(buffer) : 0);
+
+            // Frames are clipped to the segment, so is their end
+            if (GST_CLOCK_TIME_IS_VALID(segment->stop) && end > segment->stop)
+                end = segment->stop;
+
+            end = gst_segment_to_running_time(segment, GST_FORMAT_TIME, end);
+        }
+
+        std::lock_guard<std::mutex> lock(mCueMutex);
+        mCueSegment     = *segment;
+        mLastFrameEnd   = end;
+    }
+
+    ++mQosFrames;
+
+    const gint64    now     = g_get_monotonic_time();
+    guint64         index   = mDecodedFrames++;
+    gint            fps_n   = 0;
+    gint            fps_d   = 1;
+
+    if (index == 0)
+        mDecodeStart = now;
+
+    mDecodeLast = now;
+
+    // Output size changes when the QoS controller changes resolution
+    if (GstCaps* caps = gst_sample_get_caps(sample))
+    {
+        if (GstStructure* str = gst_caps_get_structure(caps, 0))
+        {
+            gst_structure_get_int(str, "width", &mWidth);
+            gst_structure_get_int(str, "height", &mHeight);
+            gst_structure_get_fraction(str, "framerate", &fps_n, &fps_d);
+        }
+    }
+
+    // Frame index follows the timestamp, so it survives seeks. Variable frame rates count frames
+    GstBuffer *sample_buffer = gst_sample_get_buffer(sample);
+
+    if (fps_n > 0 && fps_d > 0 && sample_buffer != nullptr && GST_BUFFER_PTS_IS_VALID(sample_buffer))
+        index = gst_util_uint64_scale_round(GST_BUFFER_PTS(sample_buffer), fps_n, guint64(fps_d) * GST_SECOND);
+
+    if (mFrameCache)
+    {
+        GstBuffer* buffer = gst_sample_get_buffer(sample);
+        GstMapInfo info;
+
+        if (buffer != nullptr && gst_buffer_map(buffer, &info, GST_MAP_READ) != FALSE)
+        {
+            mFrameCache->record(GST_BUFFER_PTS(buffer), index, info.data, info.size);
+            gst_buffer_unmap(buffer, &info);
+        }
+    }
+
+    if (mRunOffline)
+    {
+        // Wait for update() to consume the previous frame, nothing is dropped
+        std::unique_lock<std::mutex> lock(mWaitMutex);
+
+        mHandoffCondition.wait(lock, [this] { return !mBufferDirty || mHandoffFlushing; });
+
+        // Frames arriving while flushing are dropped, the flush must not wait for update()
+        if (mHandoffFlushing)
+        {
+            gst_sample_unref(sample);
+            return;
+        }
+    }
+    else if (mDisplayQueueDepth > 0 && !mRunLive)
+    {
+        GstBuffer           *buffer     = gst_sample_get_buffer(sample);
+        const GstSegment    *segment    = gst_sample_get_segment(sample);
+        QueuedFrame         frame       = { sample, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE };
+
+        if (buffer != nullptr && segment != nullptr && GST_BUFFER_PTS_IS_VALID(buffer))
+        {
+            frame.begin = gst_segment_to_running_time(segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buffer));
+
+            if (GST_BUFFER_DURATION_IS_VALID(buffer))
+                frame.end = gst_segment_to_running_time(segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buffer) + GST_BUFFER_DURATION(buffer));
+        }
+
+        // Frames outside of the segment can never be scheduled, nor unchanged ones if skipped
+        if (!GST_CLOCK_TIME_IS_VALID(frame.begin) || !detectChange(sample, frame.change))
+        {
+            gst_sample_unref(sample);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mDisplayMutex);
+
+            if (mDisplayQueue.size() >= mDisplayQueueDepth)
+            {
+                const FrameChange overflown = std::move(mDisplayQueue.front().change);
+
+                gst_sample_unref(mDisplayQueue.front().sample);
+                mDisplayQueue.pop_front();
+                ++mDisplayOverflow;
+                ++mQosDrops;
+
+                // Frame queued next shows what the overflown one changed
+                (mDisplayQueue.empty() ? frame.change : mDisplayQueue.front().change).merge(overflown);
+            }
+
+            mDisplayQueue.push_back(std::move(frame));
         }
+
+        notifyFrame();
+        return;
+    }
+
+    // Check if UI thread has consumed the last frame
+    if (mBufferDirty)
+    {
+        // Simply, skip this sample. UI is not consuming fast enough.
+        gst_sample_unref(sample);
+        ++mQosDrops;
+    }
+    else if (!detectChange(sample, mFrameChange))
+    {
+        // Equal to the frame handed off last, nothing to consume
+        gst_sample_unref(sample);
+    }
+    else
+    {
+        // Acquire and hold onto the new frame (until UI consumes it)
+        mFrameIndex    = index;
+        mCurrentSample = sample;
+        mCurrentBuffer = gst_sample_get_buffer(sample);
+        gst_buffer_map(mCurrentBuffer, &mCurrentMapInfo, GST_MAP_READ);
+
+        // Signal UI thread it can consume
+        mBufferDirty = true;
+        notifyFrame();
+    }
+}
+
+void Player::processCues()
+{
+    if (mPipeline == nullptr)
+    {
+        mCues.unschedule();
+        return;
     }
 
-    if (mBufferDirty)
+    if (getServingFromCache())
     {
-        onVideoFrame(
-            mCurrentMapInfo.data,
-            mCurrentMapInfo.size);
+        // Nothing is due while the cached loop is paused
+        if (GST_CLOCK_TIME_IS_VALID(mCachePausedAt))
+        {
+            mCues.unschedule();
+            return;
+        }
 
-        // free current resources on previous frame
-        if (mCurrentBuffer) gst_buffer_unmap(mCurrentBuffer, &mCurrentMapInfo);
-        if (mCurrentSample) gst_sample_unref(mCurrentSample);
+        const GstClockTime duration = mFrameCache->getDuration();
+        const GstClockTime epoch    = mCacheEpoch;
+        const GstClockTime now      = gst_clock_get_time(mCacheClock);
 
-        mCurrentBuffer = nullptr;
-        mCurrentSample = nullptr;
+        // Loops of the cache start every duration since epoch on the pipeline clock
+        mCues.schedule(mCacheClock, [=](GstClockTime time) -> GstClockTime
+        {
+            if (duration == 0 || time >= duration)
+                return GST_CLOCK_TIME_NONE;
 
-        // Signal Streaming thread it can produce
-        mBufferDirty = false;
-    }
-}
+            GstClockTime target = epoch + (now > epoch ? (now - epoch) / duration * duration : 0) + time;
 
-gdouble Player::getDuration() const
-{
-    return mDuration;
-}
+            // Passed in this loop (and fired), due again in the next one
+            if (target + 100 * GST_MSECOND < now)
+                target += duration;
 
-void Player::setLoop(bool on)
-{
-    g_return_if_fail(mLoop != on);
-    mLoop = on;
-}
+            return target;
+        });
 
-bool Player::getLoop() const
-{
-    return mLoop;
-}
+        return;
+    }
 
-void Player::setTime(gdouble time)
-{
-    g_return_if_fail(mPipeline != nullptr);
+    GstClock *clock = mState == GST_STATE_PLAYING ? gst_element_get_clock(mPipeline) : nullptr;
+
+    GstSegment segment;
 
-    if (mSeekingLock || mDuration == 0)
     {
-        mPendingSeek = time;
-        return;
+        std::lock_guard<std::mutex> lock(mCueMutex);
+        segment = mCueSegment;
     }
-    else if (gst_element_seek_simple(
-        mPipeline,
-        GST_FORMAT_TIME,
-        GstSeekFlags(
-            GST_SEEK_FLAG_FLUSH |
-            GST_SEEK_FLAG_ACCURATE),
-        gint64(CLAMP(time, 0, mDuration) * GST_SECOND)) != FALSE)
+
+    // Running time only advances while playing
+    if (clock == nullptr || segment.format != GST_FORMAT_TIME)
     {
-        mSeekingLock = true;
-        mPendingSeek = -1.;
+        if (clock != nullptr)
+            gst_object_unref(clock);
+
+        mCues.unschedule();
+        return;
     }
-    else
+
+    // Frames are handed off at their running time past base time, plus latency of live media
+    const GstClockTime base_time    = gst_element_get_base_time(mPipeline);
+    const GstClockTime latency      = GstClockTime(mLatencyStats.pipeline * GST_SECOND);
+
+    mCues.schedule(clock, [&](GstClockTime time) -> GstClockTime
     {
-        NSVR_LOG("Flushing seek operation failed.");
-    }
+#if GST_CHECK_VERSION(1, 8, 0)
+        const guint64 position = gst_segment_position_from_stream_time(&segment, GST_FORMAT_TIME, time);
+#else
+        const guint64 position = time >= segment.time ? time - segment.time + segment.start : guint64(-1);
+#endif
+
+        if (position == guint64(-1))
+            return GST_CLOCK_TIME_NONE;
+
+        const guint64 running_time = gst_segment_to_running_time(&segment, GST_FORMAT_TIME, position);
+
+        return running_time != guint64(-1) ? base_time + running_time + latency : GST_CLOCK_TIME_NONE;
+    });
+
+    gst_object_unref(clock);
 }
 
-gdouble Player::getTime() const
+bool Player::detectChange(GstSample* sample, FrameChange& change)
 {
-    g_return_val_if_fail(mPipeline != nullptr, 0.);
+    if (!mChangeDetector || !mChangeDetector->detect(sample, change))
+    {
+        change = FrameChange();
+        return true;
+    }
 
-    gint64 time_ns;
-    if (gst_element_query_position(mPipeline, GST_FORMAT_TIME, &time_ns) != FALSE)
+    // Offline every frame is handed off, in order
+    if (!change.changed && mChangeSkip && !mRunOffline)
     {
-        mTime = time_ns / gdouble(GST_SECOND);
+        ++mChangeSkipped;
+        return false;
     }
 
-    return mTime;
+    mChangeDetector->accept();
+    return true;
 }
 
-void Player::setVolume(gdouble vol)
+void Player::processLatency()
 {
-    g_return_if_fail(mPipeline != nullptr || mVolume != vol || !getMute());
+    g_return_if_fail(mPipeline != nullptr);
 
-    mVolume = CLAMP(vol, 0., 1.);
-    mMute = false;
+    gst_bin_recalculate_latency(GST_BIN(mPipeline));
+
+    GstQuery *query = gst_query_new_latency();
+    BIND_TO_SCOPE(query);
+
+    gboolean        live        = FALSE;
+    GstClockTime    min_latency = 0;
 
-    if (mPipeline)
+    if (gst_element_query(mPipeline, query) != FALSE)
     {
-        g_object_set(mPipeline, "volume", mVolume, nullptr);
+        gst_query_parse_latency(query, &live, &min_latency, nullptr);
+
+#if GST_CHECK_VERSION(1, 6, 0)
+        // Configured latency overrides the reported one
+        if (GST_CLOCK_TIME_IS_VALID(gst_pipeline_get_latency(GST_PIPELINE(mPipeline))))
+            min_latency = gst_pipeline_get_latency(GST_PIPELINE(mPipeline));
+#endif
+
+        mLatencyStats.pipeline = min_latency / gdouble(GST_SECOND);
     }
 }
 
-gdouble Player::getVolume() const
+void Player::processBuffering(GstMessage* msg)
 {
-    g_return_val_if_fail(mPipeline != nullptr, 0.);
+    gint                percent = 100;
+    GstBufferingMode    mode    = GST_BUFFERING_STREAM;
+    gint64              left    = -1;
+
+    gst_message_parse_buffering(msg, &percent);
+    gst_message_parse_buffering_stats(msg, &mode, nullptr, nullptr, &left);
+
+    const gint old_percent = mBufferingPercent;
+    mBufferingPercent = percent;
+
+    if (old_percent != percent)
+        onBuffering(percent);
+
+    // Live sources cannot be paused without losing data
+    if (mRunLive)
+        return;
+
+    bool ready = percent >= 100;
+
+    // Downloads can play as soon as they finish before playback would catch up
+    if (!ready && (mode == GST_BUFFERING_DOWNLOAD || mode == GST_BUFFERING_TIMESHIFT) && left >= 0 && mDuration > 0.)
+        ready = left < gint64((mDuration - getTime()) * 1000);
 
-    if (mPipeline)
+    if (!ready && !mBuffering)
     {
-        g_object_get(mPipeline, "volume", &mVolume, nullptr);
+        const bool playing = GST_STATE_TARGET(mPipeline) == GST_STATE_PLAYING;
+
+        // Goes through onBeforeSetState(), so a PlayerServer resumes the cluster where it paused
+        if (playing)
+            setState(GST_STATE_PAUSED);
+
+        NSVR_LOG("Buffering network media, playback is held.");
+
+        mBuffering          = true;
+        mBufferingResume    = playing;
     }
+    else if (ready && mBuffering)
+    {
+        NSVR_LOG("Buffering done, playback " << (mBufferingResume ? "resumes." : "stays paused."));
 
-    return mVolume;
+        mBuffering = false;
+
+        // Base time of a PlayerClient is the server's, so it resumes in sync with the cluster
+        if (mBufferingResume)
+            setState(GST_STATE_PLAYING);
+
+        mBufferingResume = false;
+    }
 }
 
-void Player::setMute(bool on)
+void Player::onSourceSetup(GstElement* bin, GstElement* source, Player* player)
 {
-    static gdouble saved_volume = 1.;
-    g_return_if_fail(mPipeline != nullptr || (on && saved_volume == 0.));
+    if (internal::getReadAheadFile(source) == nullptr)
+        return;
+
+    g_object_set(source,
+        "read-ahead",       guint64(player->mReadAheadWindow),
+        "io-uring-depth",   player->mIoUringDepth,
+        "direct",           gboolean(player->mIoUringDirect),
+        nullptr);
+
+    if (player->mFileSource != nullptr)
+        gst_object_unref(player->mFileSource);
+
+    player->mFileSource = GST_ELEMENT(gst_object_ref(source));
+}
+
+void Player::measureAudioDrift()
+{
+    const gint64 now = g_get_monotonic_time();
+
+    if (mPipeline == nullptr || mState != GST_STATE_PLAYING || now < mAudioDriftNext)
+        return;
+
+    mAudioDriftNext = now + G_USEC_PER_SEC;
+
+    GstElement *audio_sink = nullptr;
+    BIND_TO_SCOPE(audio_sink);
 
-    if (on)
     {
-        saved_volume = getVolume();
-        setVolume(0.);
-        mMute = true;
+        std::lock_guard<std::mutex> lock(mAudioMutex);
+
+        if (mAudioSink != nullptr)
+            audio_sink = GST_ELEMENT(gst_object_ref(mAudioSink));
     }
-    else
+
+    GstClock *audio_clock = audio_sink ? gst_element_provide_clock(audio_sink) : nullptr;
+    BIND_TO_SCOPE(audio_clock);
+
+    GstClock *clock = gst_element_get_clock(mPipeline);
+    BIND_TO_SCOPE(clock);
+
+    // Nothing to drift from if the audio sink clocks the pipeline
+    if (audio_clock == nullptr || clock == nullptr || audio_clock == clock)
+        return;
+
+    // Internal time runs at the rate of the audio device, external time is what the sink slaved to the pipeline clock
+    const GstClockTime internal = gst_clock_get_internal_time(audio_clock);
+    const GstClockTime audio    = gst_clock_get_time(audio_clock);
+    const GstClockTime master   = gst_clock_get_time(clock);
+
+    if (GST_CLOCK_TIME_IS_VALID(mAudioDriftInternal) && internal > mAudioDriftInternal && master > mAudioDriftMaster)
     {
-        mMute = false;
-        setVolume(saved_volume);
-        saved_volume = 1.;
+        const gdouble rate = gdouble(internal - mAudioDriftInternal) / gdouble(master - mAudioDriftMaster);
+        mAudioDriftStats.drift = (rate - 1.) * 1e6;
     }
-}
 
-bool Player::getMute() const
-{
-    return mMute;
+    mAudioDriftInternal = internal;
+    mAudioDriftMaster   = master;
+
+    mAudioDriftStats.offset     = GST_CLOCK_DIFF(master, audio) / gdouble(GST_SECOND);
+    mAudioDriftStats.maximum    = MAX(mAudioDriftStats.maximum, ABS(mAudioDriftStats.offset));
+    mAudioDriftStats.samples   += 1;
 }
 
-gint Player::getWidth() const
+void Player::measureLatency()
 {
-    return mWidth;
+    const GstSegment *segment = mCurrentSample ? gst_sample_get_segment(mCurrentSample) : nullptr;
+
+    if (segment == nullptr || mCurrentBuffer == nullptr || !GST_BUFFER_PTS_IS_VALID(mCurrentBuffer))
+        return;
+
+    GstClock *clock = gst_element_get_clock(mPipeline);
+    BIND_TO_SCOPE(clock);
+
+    const GstClockTime running = gst_segment_to_running_time(segment, GST_FORMAT_TIME, GST_BUFFER_PTS(mCurrentBuffer));
+
+    if (clock == nullptr || !GST_CLOCK_TIME_IS_VALID(running))
+        return;
+
+    // Live sources stamp frames with the running time they were captured at
+    const GstClockTime captured = gst_element_get_base_time(mPipeline) + running;
+    const GstClockTime now      = gst_clock_get_time(clock);
+    const gdouble      latency  = now > captured ? (now - captured) / gdouble(GST_SECOND) : 0.;
+
+    ++mLatencyStats.frames;
+    mLatencyStats.last      = latency;
+    mLatencyStats.maximum   = std::max(mLatencyStats.maximum, latency);
+    mLatencyStats.average  += (latency - mLatencyStats.average) / mLatencyStats.frames;
 }
 
-gint Player::getHeight() const
+void Player::queryDuration()
 {
-    return mHeight;
+    g_return_if_fail(mPipeline != nullptr);
+
+    // Nanoseconds
+    gint64 duration_ns = 0;
+    if (gst_element_query_duration(mPipeline, GST_FORMAT_TIME, &duration_ns) != FALSE) {
+        // Seconds
+        mDuration = duration_ns / gdouble(GST_SECOND);
+    }
 }
 
-void Player::reset()
+const char* Player::getSharingConflict(const Discoverer& discoverer) const
 {
-    mState          = GST_STATE_NULL;
-    mPipeline       = nullptr;
-    mGstBus         = nullptr;
-    mCurrentBuffer  = nullptr;
-    mCurrentSample  = nullptr;
-    mWidth          = 0;
-    mHeight         = 0;
-    mDuration       = 0;
-    mTime           = 0.;
-    mVolume         = 1.;
-    mPendingSeek    = -1.;
-    mSeekingLock    = false;
-    mBufferDirty    = false;
+    const AudioSinkSettings defaults;
+
+    if (mRunOffline)
+        return "the player runs offline";
+
+    if (getOwnsClock())
+        return "the player owns a network clock";
+
+    if (mReadAheadWindow > 0 || mIoUringDepth > 0)
+        return "local media is read ahead";
+
+    if (mDownload)
+        return "network media is downloaded";
+
+    if (mFrameCacheBudget > 0)
+        return "frames are cached";
+
+    if (discoverer.getHasAudio() && (
+        mAudioSinkSettings.bufferTime   != defaults.bufferTime ||
+        mAudioSinkSettings.latencyTime  != defaults.latencyTime ||
+        mAudioSinkSettings.slaveMethod  != defaults.slaveMethod))
+        return "the audio sink is configured";
+
+    return nullptr;
 }
 
-GstFlowReturn Player::onPreroll(GstElement* appsink, Player* player)
+bool Player::enterFrameCache()
 {
-    // Here's our chance to get the actual dimension of the media.
-    // The actual dimension might be slightly different from what
-    // is passed into and requested from the pipeline.
+    g_return_val_if_fail(mPipeline != nullptr, false);
 
-    if (GstSample* sample = gst_app_sink_pull_preroll(GST_APP_SINK(appsink)))
+    if (!mFrameCache || !mFrameCache->seal(GstClockTime(mDuration * GST_SECOND)))
+        return false;
+
+    if ((mCacheClock = gst_pipeline_get_clock(GST_PIPELINE(mPipeline))) == nullptr)
     {
-        if (GstCaps *caps = gst_sample_get_caps(sample))
-        {
-            if (gst_caps_is_fixed(caps) != FALSE)
-            {
-                if (GstStructure *str = gst_caps_get_structure(caps, 0))
-                {
-                    if (gst_structure_get_int(str, "width", &player->mWidth) == FALSE ||
-                        gst_structure_get_int(str, "height", &player->mHeight) == FALSE)
-                    {
-                        NSVR_LOG("No width/height information available.");
-                    }
-                }
-            }
-            else
-            {
-                NSVR_LOG("caps is not fixed for this media.");
-            }
-        }
+        NSVR_LOG("Unable to obtain pipeline clock to serve frame cache.");
+        return false;
+    }
 
-        if (player)
-            player->processSample(sample);
+    GstClockTime end = GST_CLOCK_TIME_NONE;
+
+    {
+        std::lock_guard<std::mutex> lock(mCueMutex);
+
+        // Pass ends with its last frame, or with its segment if frames were not timed
+        if (GST_CLOCK_TIME_IS_VALID(mLastFrameEnd))
+            end = mLastFrameEnd;
+        else if (mCueSegment.format == GST_FORMAT_TIME && GST_CLOCK_TIME_IS_VALID(mCueSegment.stop))
+            end = gst_segment_to_running_time(&mCueSegment, GST_FORMAT_TIME, mCueSegment.stop);
     }
 
-    return GST_FLOW_OK;
+    // Next loop starts on the boundary of this one, as the pipeline would have shown it
+    if (GST_CLOCK_TIME_IS_VALID(end))
+        mCacheEpoch = gst_element_get_base_time(mPipeline) + end + GstClockTime(mLatencyStats.pipeline * GST_SECOND);
+    else
+        mCacheEpoch = gst_clock_get_time(mCacheClock);
+
+    mCacheIndex     = -1;
+    mCachePausedAt  = GST_CLOCK_TIME_NONE;
+
+    // READY releases the decoder along with its resources
+    setHandoffFlushing(true);
+    const GstStateChangeReturn ret = gst_element_set_state(mPipeline, GST_STATE_READY);
+    setHandoffFlushing(false);
+
+    if (ret == GST_STATE_CHANGE_FAILURE)
+    {
+        leaveFrameCache();
+        NSVR_LOG("Failed to put pipeline in READY state to serve frame cache.");
+        return false;
+    }
+
+    NSVR_LOG("Serving loop from frame cache (" << mFrameCache->getBytes() << " bytes).");
+    return true;
 }
 
-GstFlowReturn Player::onSample(GstElement* appsink, Player* player)
+void Player::processCachedFrame()
 {
-    if (GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(appsink)))
+    GstClockTime position = getCachePosition();
+
+    mTime = position / gdouble(GST_SECOND);
+
+    gint index = mFrameCache->find(position);
+
+    if (index >= 0 && index != mCacheIndex)
     {
-        if (player)
-            player->processSample(sample);
+        mCacheIndex = index;
+
+        onVideoFrame(
+            const_cast<guchar*>(mFrameCache->getData(index)),
+            mFrameCache->getSize(index));
     }
+}
 
-    return GST_FLOW_OK;
+GstClockTime Player::getCachePosition() const
+{
+    if (GST_CLOCK_TIME_IS_VALID(mCachePausedAt))
+        return mCachePausedAt;
+
+    GstClockTime duration = mFrameCache->getDuration();
+    GstClockTime now      = gst_clock_get_time(mCacheClock);
+
+    return now > mCacheEpoch && duration > 0 ? (now - mCacheEpoch) % duration : 0;
 }
 
-void Player::processSample(GstSample* const sample)
+void Player::setCachePaused(bool paused)
 {
-    // Check if UI thread has consumed the last frame
-    if (mBufferDirty)
+    if (paused == GST_CLOCK_TIME_IS_VALID(mCachePausedAt))
+        return;
+
+    onBeforeSetState(paused ? GST_STATE_PAUSED : GST_STATE_PLAYING);
+
+    GstState old_state = getState();
+
+    if (paused)
     {
-        // Simply, skip this sample. UI is not consuming fast enough.
-        gst_sample_unref(sample);
+        mCachePausedAt = getCachePosition();
     }
     else
     {
-        // Acquire and hold onto the new frame (until UI consumes it)
-        mCurrentSample = sample;
-        mCurrentBuffer = gst_sample_get_buffer(sample);
-        gst_buffer_map(mCurrentBuffer, &mCurrentMapInfo, GST_MAP_READ);
+        // Loop resumes from the position paused at, as if the clock had stopped meanwhile
+        GstClockTime now = gst_clock_get_time(mCacheClock);
 
-        // Signal UI thread it can consume
-        mBufferDirty = true;
+        mCacheEpoch     = now > mCachePausedAt ? now - mCachePausedAt : 0;
+        mCachePausedAt  = GST_CLOCK_TIME_NONE;
     }
-}
-
-void Player::queryDuration()
-{
-    g_return_if_fail(mPipeline != nullptr);
 
-    // Nanoseconds
-    gint64 duration_ns = 0;
-    if (gst_element_query_duration(mPipeline, GST_FORMAT_TIME, &duration_ns) != FALSE) {
-        // Seconds
-        mDuration = duration_ns / gdouble(GST_SECOND);
-    }
+    onStateChanged(old_state);
 }
 
 }
@@ -10,7 +10,18 @@ namespace nsvr
 PlayerClient::PlayerClient(const std::string& address, short port)
     : mBaseTime(0)
     , mNetClock(nullptr)
+    , mCueVersion(0)
+    , mCueChunksVersion(0)
 {
+    // Speakers of every client stay sample aligned: resampled to the network clock, never skipped,
+    // with a ring buffer small enough for corrections to be heard quickly
+    AudioSinkSettings audio;
+    audio.bufferTime    = 0.04;
+    audio.latencyTime   = 0.01;
+    audio.slaveMethod   = AudioSlaveMethod::RESAMPLE;
+
+    setAudioSink(audio);
+
     if (!connect(address, port))
     {
         NSVR_LOG("Client was unable to connect to server at construction.");
@@ -20,14 +31,28 @@ PlayerClient::PlayerClient(const std::string& address, short port)
     sendToServer("nsvr");
 }
 
+PlayerClient::~PlayerClient()
+{
+    // Player's destructor would close too late, with these overrides gone
+    if (mPipeline != nullptr)
+        close();
+}
+
 void PlayerClient::onMessage(const std::string& message)
 {
     if (message.empty())
         return;
 
-    Packet packet;
+    Packet      packet;
+    CuePacket   cues;
 
-    if (PacketHandler::parse(message, packet))
+    if (PacketHandler::parse(message, cues))
+    {
+        // Cues are resent with every heartbeat, only a new version replaces them
+        if (cues.version != mCueVersion)
+            receiveCues(cues);
+    }
+    else if (PacketHandler::parse(message, packet))
     {
         if (getMute() != (packet.mute != FALSE))
             setMute(packet.mute != FALSE);
@@ -43,6 +68,43 @@ void PlayerClient::onMessage(const std::string& message)
     }
 }
 
+void PlayerClient::receiveCues(const CuePacket& packet)
+{
+    // Chunks of another version are dropped, a version is applied only once complete
+    if (packet.version != mCueChunksVersion || packet.total != mCueChunks.size())
+    {
+        mCueChunksVersion = packet.version;
+        mCueChunks.assign(packet.total, std::vector<Cue>());
+        mCueChunksReceived.assign(packet.total, false);
+    }
+
+    mCueChunks[packet.index] = packet.cues;
+    mCueChunksReceived[packet.index] = true;
+
+    for (bool received : mCueChunksReceived)
+    {
+        if (!received)
+            return;
+    }
+
+    std::vector<Cue> cues;
+
+    for (const auto& chunk : mCueChunks)
+        cues.insert(cues.end(), chunk.begin(), chunk.end());
+
+    mCueVersion = packet.version;
+    mCueChunksVersion = 0;
+    mCueChunks.clear();
+    mCueChunksReceived.clear();
+
+    setCues(cues);
+}
+
+bool PlayerClient::getOwnsClock() const
+{
+    return true;
+}
+
 void PlayerClient::setupClock()
 {
     g_return_if_fail(mPipeline != nullptr);
@@ -69,13 +131,20 @@ void PlayerClient::onBeforeUpdate()
 {
     g_return_if_fail(mPipeline != nullptr);
 
-    iterate();
+    iterate(getUpdateDeadline());
 
     if (mBaseTime != 0)
     {
+        // Cached loops are scheduled against the old base, drop them
+        leaveFrameCache();
+
         if (getState() != GST_STATE_READY)
         {
-            if (gst_element_set_state(mPipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE)
+            setHandoffFlushing(true);
+            const GstStateChangeReturn ret = gst_element_set_state(mPipeline, GST_STATE_READY);
+            setHandoffFlushing(false);
+
+            if (ret == GST_STATE_CHANGE_FAILURE)
                 NSVR_LOG("Client failed to put pipeline into READY state for a pending base.")
         }
         else
@@ -23,6 +23,13 @@ PlayerServer::PlayerServer(const std::string& address, short port)
     }
 }
 
+PlayerServer::~PlayerServer()
+{
+    // Player's destructor would close too late, with these overrides gone
+    if (mPipeline != nullptr)
+        close();
+}
+
 void PlayerServer::setHeartbeatFrequency(unsigned freq)
 {
     if (freq == mHeartbeatFrequency)
@@ -39,9 +46,23 @@ unsigned PlayerServer::getHeartbeatFrequency() const
 
 void PlayerServer::setTime(gdouble time)
 {
+    // Answers PLAYING while serving from the frame cache, so query first
+    GstState state = queryState();
+
+    // Finished by the ASYNC_DONE of the state restored in onBeforeUpdate()
+    issueSeekTicket();
+    leaveFrameCache();
+    seekFrameCache(time);
+    warmSeekTarget(time);
+
     mPendingCurrentTime = gst_clock_get_time(mNetClock);
     mPendingSeek = CLAMP(time, 0, getDuration());
-    mPendingState = queryState();
+    mPendingState = state;
+}
+
+bool PlayerServer::getOwnsClock() const
+{
+    return true;
 }
 
 void PlayerServer::setupClock()
@@ -93,6 +114,23 @@ void PlayerServer::dispatchHeartbeat()
     broadcastToClients(PacketHandler::serialize(packet));
 }
 
+void PlayerServer::dispatchCues()
+{
+    // Clients fire them on the same clock and base time, so at the same instant
+    CuePacket packet;
+    packet.version  = getCueVersion();
+    packet.cues     = getCues();
+
+    // Chunked, so every datagram fits the receive buffer of clients
+    for (const std::string& chunk : PacketHandler::serializeChunks(packet))
+        broadcastToClients(chunk);
+}
+
+void PlayerServer::onCuesChanged()
+{
+    dispatchCues();
+}
+
 void PlayerServer::clearClock()
 {
     g_return_if_fail(mPipeline != nullptr);
@@ -119,11 +157,12 @@ void PlayerServer::onBeforeUpdate()
 {
     g_return_if_fail(mPipeline != nullptr);
 
-    iterate();
+    iterate(getUpdateDeadline());
 
     if (mHeartbeatCounter > mHeartbeatFrequency)
     {
         dispatchHeartbeat();
+        dispatchCues();
         mHeartbeatCounter = 0;
     }
 
@@ -131,7 +170,11 @@ void PlayerServer::onBeforeUpdate()
     {
         if (getState() != GST_STATE_READY)
         {
-            if (gst_element_set_state(mPipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE)
+            setHandoffFlushing(true);
+            const GstStateChangeReturn ret = gst_element_set_state(mPipeline, GST_STATE_READY);
+            setHandoffFlushing(false);
+
+            if (ret == GST_STATE_CHANGE_FAILURE)
                 NSVR_LOG("Server failed to put pipeline into READY state for a pending seek.")
         }
         else
@@ -142,9 +185,22 @@ void PlayerServer::onBeforeUpdate()
 
             gst_element_set_base_time(mPipeline, time_base);
 
-            if (gst_element_set_state(mPipeline, mPendingState) == GST_STATE_CHANGE_FAILURE)
+            const GstStateChangeReturn ret = gst_element_set_state(mPipeline, mPendingState);
+
+            if (ret == GST_STATE_CHANGE_FAILURE)
                 NSVR_LOG("Server failed to put pipeline into old state for a pending seek.")
 
+            if (ret == GST_STATE_CHANGE_ASYNC)
+            {
+                mSeekingLock        = true;
+                mSeekInFlight       = mPendingSeekTicket;
+                mPendingSeekTicket  = 0;
+            }
+            else
+            {
+                resolveSeekTicket(mPendingSeekTicket, ret != GST_STATE_CHANGE_FAILURE);
+            }
+
             mPendingSeek = -1.;
             mPendingState = GST_STATE_NULL;
             mPendingCurrentTime = GST_CLOCK_TIME_NONE;
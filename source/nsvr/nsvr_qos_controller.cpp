@@ -0,0 +1,146 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_qos_controller.hpp"
+
+namespace nsvr
+{
+
+namespace {
+
+const gint64    kWindow         = G_USEC_PER_SEC;   // Length of one window
+const guint     kDegradeAfter   = 2;                // Overloaded windows before degrading
+const guint     kRecoverAfter   = 5;                // Clean windows before recovering
+const gdouble   kDropRatio      = 0.05;             // Dropped frames ratio of an overloaded window
+const gdouble   kOverrunRatio   = 0.25;             // Overrun updates ratio of an overloaded window
+
+}
+
+const char* getQosLevelName(QosLevel level)
+{
+    switch (level)
+    {
+    case QOS_NONE:                  return "none";
+    case QOS_HALF_RESOLUTION:       return "half resolution";
+    case QOS_SKIP_NON_REFERENCE:    return "skip non-reference frames";
+    case QOS_KEY_UNITS:             return "key units only";
+    default:                        return "unknown";
+    }
+}
+
+QosController::QosController()
+    : mMaxLevel(QOS_NONE)
+{
+    for (auto& available : mAvailable)
+        available = true;
+
+    reset();
+}
+
+void QosController::setMaxLevel(QosLevel level)
+{
+    mMaxLevel = level;
+}
+
+QosLevel QosController::getMaxLevel() const
+{
+    return mMaxLevel;
+}
+
+void QosController::setAvailable(QosLevel level, bool on)
+{
+    if (level > QOS_NONE && level <= QOS_KEY_UNITS)
+        mAvailable[level] = on;
+}
+
+QosLevel QosController::getLevel() const
+{
+    return mLevel;
+}
+
+void QosController::addFrames(guint64 count)
+{
+    mFrames += count;
+}
+
+void QosController::addDrops(guint64 count)
+{
+    mDrops += count;
+}
+
+void QosController::addUpdate(bool overrun)
+{
+    ++mUpdates;
+
+    if (overrun)
+        ++mOverruns;
+}
+
+bool QosController::evaluate(gint64 now, std::string& reason)
+{
+    if (mWindowStart == 0)
+        mWindowStart = now;
+
+    if (now - mWindowStart < kWindow)
+        return false;
+
+    const guint64 total         = mFrames + mDrops;
+    const gdouble drop_ratio    = total > 0 ? mDrops / gdouble(total) : 0.;
+    const gdouble overrun_ratio = mUpdates > 0 ? mOverruns / gdouble(mUpdates) : 0.;
+    const bool    overloaded    = drop_ratio >= kDropRatio || overrun_ratio >= kOverrunRatio;
+
+    std::stringstream window;
+    window
+        << mDrops << " of " << total << " frames dropped, "
+        << mOverruns << " of " << mUpdates << " updates overran";
+
+    mWindowStart    = now;
+    mFrames         = 0;
+    mDrops          = 0;
+    mUpdates        = 0;
+    mOverruns       = 0;
+    mOverloaded     = overloaded ? mOverloaded + 1 : 0;
+    mClean          = overloaded ? 0 : mClean + 1;
+
+    QosLevel level = mLevel;
+
+    if (mOverloaded >= kDegradeAfter)
+        level = next(1);
+    else if (mClean >= kRecoverAfter)
+        level = next(-1);
+
+    if (level == mLevel)
+        return false;
+
+    reason = (level > mLevel ? "overloaded: " : "recovered: ") + window.str();
+
+    mLevel      = level;
+    mOverloaded = 0;
+    mClean      = 0;
+
+    return true;
+}
+
+void QosController::reset()
+{
+    mLevel          = QOS_NONE;
+    mWindowStart    = 0;
+    mFrames         = 0;
+    mDrops          = 0;
+    mUpdates        = 0;
+    mOverruns       = 0;
+    mOverloaded     = 0;
+    mClean          = 0;
+}
+
+QosLevel QosController::next(gint step) const
+{
+    for (gint level = mLevel + step; level > QOS_NONE && level <= mMaxLevel; level += step)
+    {
+        if (mAvailable[level])
+            return QosLevel(level);
+    }
+
+    // Recovering always ends at full quality
+    return step < 0 ? QOS_NONE : mLevel;
+}
+
+}
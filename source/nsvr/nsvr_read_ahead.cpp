@@ -0,0 +1,327 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_read_ahead.hpp"
+
+#include <vector>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/stat.h>
+#endif
+
+namespace {
+
+const gsize     kPrefetchChunk  = 1024 * 1024;  //!< Bytes prefetched at once, the reader's position is checked in between
+const gintptr   kNoFile         = -1;
+
+//! opens "path" for reading, answers kNoFile on failure
+gintptr openFile(const std::string& path, guint64& size)
+{
+#ifdef _WIN32
+    LARGE_INTEGER file_size;
+    HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return kNoFile;
+
+    if (::GetFileSizeEx(file, &file_size) == FALSE)
+    {
+        ::CloseHandle(file);
+        return kNoFile;
+    }
+
+    size = file_size.QuadPart;
+    return reinterpret_cast<gintptr>(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info;
+
+    if (fd < 0)
+        return kNoFile;
+
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return kNoFile;
+    }
+
+    size = info.st_size;
+
+#ifdef __linux__
+    // Kernel read-ahead of the reader's own descriptor grows too
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    return fd;
+#endif
+}
+
+void closeFile(gintptr file)
+{
+#ifdef _WIN32
+    ::CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+    ::close(int(file));
+#endif
+}
+
+//! reads up to "size" bytes at "offset" without moving any file position. Answers bytes read, -1 on failure
+gssize readAt(gintptr file, guint64 offset, guint8* data, gsize size)
+{
+#ifdef _WIN32
+    OVERLAPPED  overlapped  = {};
+    DWORD       read        = 0;
+
+    overlapped.Offset       = DWORD(offset);
+    overlapped.OffsetHigh   = DWORD(offset >> 32);
+
+    if (::ReadFile(reinterpret_cast<HANDLE>(file), data, DWORD(size), &read, &overlapped) == FALSE)
+        return ::GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+
+    return gssize(read);
+#else
+    gsize done = 0;
+
+    while (done < size)
+    {
+        const ssize_t result = ::pread(int(file), data + done, size - done, off_t(offset + done));
+
+        if (result < 0 && errno == EINTR)
+            continue;
+
+        if (result < 0)
+            return -1;
+
+        if (result == 0)
+            break;
+
+        done += result;
+    }
+
+    return gssize(done);
+#endif
+}
+
+}
+
+namespace nsvr
+{
+
+ReadAheadFile::ReadAheadFile()
+    : mFile(kNoFile)
+    , mSize(0)
+    , mWindow(0)
+    , mBegin(0)
+    , mEnd(0)
+    , mTarget(0)
+    , mWarmBegin(0)
+    , mWarmNext(0)
+    , mWarmTarget(0)
+    , mStopping(false)
+{}
+
+ReadAheadFile::~ReadAheadFile()
+{
+    close();
+}
+
+bool ReadAheadFile::open(const std::string& path, gsize window)
+{
+    close();
+
+    if ((mFile = openFile(path, mSize)) == kNoFile)
+    {
+        NSVR_LOG("Unable to open " << path << " for reading.");
+        return false;
+    }
+
+    mWindow     = window;
+    mBegin      = 0;
+    mEnd        = 0;
+    mTarget     = 0;
+    mWarmBegin  = 0;
+    mWarmNext   = 0;
+    mWarmTarget = 0;
+    mStopping   = false;
+    mStats      = ReadAheadStats();
+
+    if (mWindow > 0)
+        mThread = std::thread(&ReadAheadFile::run, this);
+
+    return true;
+}
+
+void ReadAheadFile::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+
+    mWake.notify_all();
+
+    if (mThread.joinable())
+        mThread.join();
+
+    if (mFile != kNoFile)
+    {
+        closeFile(mFile);
+        mFile = kNoFile;
+    }
+
+    mSize = 0;
+}
+
+bool ReadAheadFile::isOpen() const
+{
+    return mFile != kNoFile;
+}
+
+guint64 ReadAheadFile::getSize() const
+{
+    return mSize;
+}
+
+gssize ReadAheadFile::read(guint64 offset, guint8* data, gsize size)
+{
+    g_return_val_if_fail(mFile != kNoFile, -1);
+
+    if (offset >= mSize)
+        return 0;
+
+    const guint64 end = MIN(offset + size, mSize);
+    bool hit = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        hit = (offset >= mBegin && end <= mEnd) || (offset >= mWarmBegin && end <= mWarmNext);
+
+        // Reader jumped: a warmed seek target is taken over, anywhere else prefetching starts over
+        if (offset < mBegin || offset > mEnd)
+        {
+            if (offset >= mWarmBegin && offset <= mWarmNext)
+            {
+                mBegin      = mWarmBegin;
+                mEnd        = mWarmNext;
+                mWarmTarget = mWarmNext;
+            }
+            else
+            {
+                mBegin  = offset;
+                mEnd    = offset;
+            }
+        }
+
+        mTarget = MIN(end + mWindow, mSize);
+    }
+
+    mWake.notify_one();
+
+    const gint64 started = g_get_monotonic_time();
+    const gssize result = readAt(mFile, offset, data, gsize(end - offset));
+    const gint64 elapsed = g_get_monotonic_time() - started;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (hit)
+    {
+        ++mStats.hits;
+    }
+    else
+    {
+        ++mStats.misses;
+        mStats.stalled += elapsed / gdouble(G_USEC_PER_SEC);
+    }
+
+    return result;
+}
+
+void ReadAheadFile::warm(guint64 offset)
+{
+    if (mWindow == 0 || offset >= mSize)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Already prefetched or being warmed
+        if ((offset >= mBegin && offset < mEnd) || (offset >= mWarmBegin && offset < mWarmTarget))
+            return;
+
+        mWarmBegin  = offset;
+        mWarmNext   = offset;
+        mWarmTarget = MIN(offset + mWindow, mSize);
+    }
+
+    mWake.notify_one();
+}
+
+ReadAheadStats ReadAheadFile::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void ReadAheadFile::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true)
+    {
+        mWake.wait(lock, [this] { return mStopping || mWarmNext < mWarmTarget || mEnd < mTarget; });
+
+        if (mStopping)
+            break;
+
+        // Seek targets go first, the reader is about to jump there
+        const bool      warming = mWarmNext < mWarmTarget;
+        const guint64   offset  = warming ? mWarmNext : mEnd;
+        const gsize     size    = gsize(MIN(guint64(kPrefetchChunk), (warming ? mWarmTarget : mTarget) - offset));
+
+        lock.unlock();
+        const bool prefetched = prefetch(offset, size);
+        lock.lock();
+
+        if (!prefetched)
+        {
+            // Given up until the reader moves again
+            if (warming)
+                mWarmTarget = mWarmNext;
+            else
+                mTarget = mEnd;
+        }
+        else if (warming && mWarmNext == offset)
+        {
+            mWarmNext += size;
+            mStats.warmed += size;
+        }
+        else if (!warming && mEnd == offset)
+        {
+            mEnd += size;
+            mStats.prefetched += size;
+        }
+    }
+}
+
+bool ReadAheadFile::prefetch(guint64 offset, gsize size)
+{
+#ifdef __linux__
+    // Fails on file systems without page cache read-ahead (some network ones), read them instead
+    if (::readahead(int(mFile), off64_t(offset), size) == 0)
+        return true;
+#endif
+
+    // Reading populates the system cache everywhere
+    static thread_local std::vector<guint8> scratch(kPrefetchChunk);
+
+    if (scratch.size() < size)
+        scratch.resize(size);
+
+    return readAt(mFile, offset, scratch.data(), size) >= 0;
+}
+
+}
@@ -5,6 +5,9 @@ namespace nsvr {
 
 Server::Server()
     : mSocketService(nullptr)
+    , mListenSocket(nullptr)
+    , mWatch(new internal::SocketWatch())
+    , mContext(nullptr)
     , mListenPort(0)
 {}
 
@@ -12,6 +15,9 @@ Server::~Server()
 {
     if (isListening())
         shutdown();
+
+    if (mContext != nullptr)
+        g_main_context_unref(mContext);
 }
 
 bool Server::listen(const std::string& listen_address, short listen_port)
@@ -22,6 +28,12 @@ bool Server::listen(const std::string& listen_address, short listen_port)
     mListenAddress = listen_address;
     mListenPort = listen_port;
 
+    // Incoming connections are dispatched from the thread-default context
+    if (mContext != nullptr)
+        g_main_context_unref(mContext);
+
+    mContext = g_main_context_ref_thread_default();
+
     GError *errors = nullptr;
     BIND_TO_SCOPE(errors);
     
@@ -31,18 +43,27 @@ bool Server::listen(const std::string& listen_address, short listen_port)
 
         if (mSocketService = g_socket_service_new())
         {
-            if (g_socket_listener_add_address(
-                reinterpret_cast<GSocketListener*>(mSocketService),
-                inet_addr, GSocketType::G_SOCKET_TYPE_STREAM,
+            mListenSocket = g_socket_new(
+                g_socket_address_get_family(inet_addr),
+                GSocketType::G_SOCKET_TYPE_STREAM,
                 GSocketProtocol::G_SOCKET_PROTOCOL_TCP,
-                nullptr, nullptr, &errors) == FALSE)
+                &errors);
+
+            // Socket is ours rather than the listener's, so connections pending can be watched
+            if (mListenSocket == nullptr ||
+                g_socket_bind(mListenSocket, inet_addr, TRUE, &errors) == FALSE ||
+                g_socket_listen(mListenSocket, &errors) == FALSE ||
+                g_socket_listener_add_socket(reinterpret_cast<GSocketListener*>(mSocketService), mListenSocket, nullptr, &errors) == FALSE)
             {
                 NSVR_LOG("Unable to bind Server to address " << listen_address << ":" << listen_port);
+                g_clear_object(&mListenSocket);
                 return false;
             }
 
             g_signal_connect(mSocketService, "incoming", G_CALLBACK(incoming), this);
             g_socket_service_start(mSocketService);
+
+            mWatch->watch(mListenSocket);
         }
         else
         {
@@ -61,8 +82,33 @@ bool Server::listen(const std::string& listen_address, short listen_port)
 
 void Server::iterate()
 {
-    while (g_main_context_pending(g_main_context_default()) != FALSE)
-        g_main_context_iteration(g_main_context_default(), FALSE);
+    iterate(G_MAXINT64);
+}
+
+void Server::iterate(gint64 deadline)
+{
+    // Before dispatching, so connections left behind signal again
+    mWatch->acknowledge();
+
+    // At least one event per call, so the network is never starved
+    do
+    {
+        if (g_main_context_pending(getContext()) == FALSE)
+            break;
+
+        g_main_context_iteration(getContext(), FALSE);
+    }
+    while (g_get_monotonic_time() < deadline);
+}
+
+GMainContext* Server::getContext() const
+{
+    return mContext != nullptr ? mContext : g_main_context_default();
+}
+
+GPollFD Server::getPollFd() const
+{
+    return mWatch->getPollFd();
 }
 
 bool Server::isListening()
@@ -75,7 +121,10 @@ void Server::shutdown()
     if (!isListening())
         return;
 
+    mWatch->watch(nullptr);
+
     g_socket_service_stop(mSocketService);
+    g_clear_object(&mListenSocket);
     mSocketService = nullptr;
     mListenPort = 0;
 }
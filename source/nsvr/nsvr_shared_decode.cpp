@@ -0,0 +1,303 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_shared_decode.hpp"
+
+#include <condition_variable>
+#include <unordered_map>
+
+namespace nsvr
+{
+
+namespace {
+
+struct Unlink
+{
+    std::mutex              mutex;
+    std::condition_variable condition;
+    bool                    done = false;
+};
+
+}
+
+SharedDecode::SharedDecode()
+    : mPipeline(nullptr)
+    , mVideoBin(nullptr)
+    , mTee(nullptr)
+    , mLeader(nullptr)
+{}
+
+SharedDecode::~SharedDecode()
+{
+    while (!mConsumers.empty())
+        detach(mConsumers.back().owner);
+
+    if (mPipeline != nullptr)
+    {
+        gst_element_set_state(mPipeline, GST_STATE_NULL);
+        gst_object_unref(mPipeline);
+    }
+}
+
+std::shared_ptr<SharedDecode> SharedDecode::acquire(const std::string& uri)
+{
+    static std::mutex registry_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<SharedDecode>> registry;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    for (auto iter = registry.begin(); iter != registry.end();)
+    {
+        if (auto decode = iter->second.lock())
+        {
+            if (iter->first == uri)
+                return decode;
+
+            ++iter;
+        }
+        else
+        {
+            iter = registry.erase(iter);
+        }
+    }
+
+    std::shared_ptr<SharedDecode> decode(new SharedDecode);
+
+    if (!decode->launch(uri))
+        return nullptr;
+
+    registry[uri] = decode;
+    return decode;
+}
+
+GstElement* SharedDecode::attach(const DecodeBranch& branch, const void* owner)
+{
+    g_return_val_if_fail(mVideoBin != nullptr, nullptr);
+
+    std::stringstream branch_cmd;
+
+    branch_cmd << "queue leaky=downstream max-size-buffers=3 ! videoconvert";
+
+    if (branch.cropLeft > 0 || branch.cropTop > 0 || branch.cropRight > 0 || branch.cropBottom > 0)
+    {
+        branch_cmd
+            << " ! videocrop"
+            << " left=" << branch.cropLeft
+            << " top=" << branch.cropTop
+            << " right=" << branch.cropRight
+            << " bottom=" << branch.cropBottom;
+    }
+
+    branch_cmd << " ! videoscale ! video/x-raw";
+
+    if (branch.width > 0)   branch_cmd << ",width=" << branch.width;
+    if (branch.height > 0)  branch_cmd << ",height=" << branch.height;
+
+    branch_cmd
+        << ",format=" << branch.format
+        << " ! appsink name=nsvrsink drop=yes async=no qos=yes sync=yes max-lateness=" << GST_SECOND;
+
+    GError* errors = nullptr;
+    BIND_TO_SCOPE(errors);
+
+    GstElement *bin = gst_parse_bin_from_description(branch_cmd.str().c_str(), TRUE, &errors);
+
+    if (bin == nullptr)
+    {
+        NSVR_LOG("Unable to construct shared decode branch [" << (errors ? errors->message : "unknown") << "].");
+        return nullptr;
+    }
+
+    GstElement *app_sink = gst_bin_get_by_name(GST_BIN(bin), "nsvrsink");
+
+    if (app_sink == nullptr)
+    {
+        gst_object_unref(bin);
+        NSVR_LOG("Unable to obtain shared decode branch's sink.");
+        return nullptr;
+    }
+
+    gst_object_ref(bin);
+    gst_bin_add(GST_BIN(mVideoBin), bin);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mLeader == nullptr)
+        mLeader = owner;
+
+    mConsumers.push_back(Consumer{ owner, bin, nullptr });
+    return app_sink;
+}
+
+bool SharedDecode::link(const void* owner)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Consumer *consumer = find(owner);
+
+    if (consumer == nullptr)
+        return false;
+
+    if (consumer->teePad != nullptr)
+        return true;
+
+    GstPad *sink_pad    = gst_element_get_static_pad(consumer->branch, "sink");
+    GstPad *tee_pad     = gst_element_get_request_pad(mTee, "src_%u");
+    BIND_TO_SCOPE(sink_pad);
+
+    if (sink_pad == nullptr || tee_pad == nullptr || gst_pad_link(tee_pad, sink_pad) != GST_PAD_LINK_OK)
+    {
+        if (tee_pad != nullptr)
+        {
+            gst_element_release_request_pad(mTee, tee_pad);
+            gst_object_unref(tee_pad);
+        }
+
+        NSVR_LOG("Unable to link shared decode branch.");
+        return false;
+    }
+
+    consumer->teePad = tee_pad;
+    gst_element_sync_state_with_parent(consumer->branch);
+
+    return true;
+}
+
+void SharedDecode::detach(const void* owner)
+{
+    Consumer consumer;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        Consumer *found = find(owner);
+
+        if (found == nullptr)
+            return;
+
+        consumer = *found;
+        mConsumers.erase(mConsumers.begin() + (found - mConsumers.data()));
+
+        if (mLeader == owner)
+            mLeader = nullptr;
+    }
+
+    if (consumer.teePad != nullptr)
+    {
+        // Unlink only in between two buffers, never in the middle of a push
+        auto unlink = std::make_shared<Unlink>();
+
+        gst_pad_add_probe(
+            consumer.teePad,
+            GST_PAD_PROBE_TYPE_IDLE,
+            onUnlink,
+            new std::shared_ptr<Unlink>(unlink),
+            [](gpointer data) { delete static_cast<std::shared_ptr<Unlink>*>(data); });
+
+        std::unique_lock<std::mutex> lock(unlink->mutex);
+
+        if (!unlink->condition.wait_for(lock, std::chrono::seconds(1), [&unlink] { return unlink->done; }))
+            NSVR_LOG("Shared decode branch did not go idle, dropping it anyway.");
+
+        gst_element_release_request_pad(mTee, consumer.teePad);
+        gst_object_unref(consumer.teePad);
+    }
+
+    gst_element_set_state(consumer.branch, GST_STATE_NULL);
+    gst_bin_remove(GST_BIN(mVideoBin), consumer.branch);
+    gst_object_unref(consumer.branch);
+}
+
+bool SharedDecode::lead(const void* owner)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mLeader == nullptr && find(owner) != nullptr)
+        mLeader = owner;
+
+    return mLeader == owner;
+}
+
+GstElement* SharedDecode::getPipeline() const
+{
+    return mPipeline;
+}
+
+gsize SharedDecode::getConsumerCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mConsumers.size();
+}
+
+const std::string& SharedDecode::getUri() const
+{
+    return mUri;
+}
+
+bool SharedDecode::launch(const std::string& uri)
+{
+    mUri        = uri;
+    mPipeline   = gst_element_factory_make("playbin", nullptr);
+
+    if (mPipeline == nullptr)
+    {
+        NSVR_LOG("Unable to construct shared decode pipeline.");
+        return false;
+    }
+
+    mVideoBin   = gst_bin_new(nullptr);
+    mTee        = gst_element_factory_make("tee", nullptr);
+
+    if (mTee == nullptr)
+    {
+        gst_object_unref(mVideoBin);
+        mVideoBin = nullptr;
+
+        NSVR_LOG("Unable to construct shared decode tee.");
+        return false;
+    }
+
+    // Consumers come and go, a moment without any is not an error
+    if (internal::hasProperty(mTee, "allow-not-linked"))
+        g_object_set(mTee, "allow-not-linked", TRUE, nullptr);
+
+    gst_bin_add(GST_BIN(mVideoBin), mTee);
+
+    GstPad *tee_pad = gst_element_get_static_pad(mTee, "sink");
+    BIND_TO_SCOPE(tee_pad);
+
+    gst_element_add_pad(mVideoBin, gst_ghost_pad_new("sink", tee_pad));
+    g_object_set(mPipeline, "uri", uri.c_str(), "video-sink", mVideoBin, nullptr);
+
+    return true;
+}
+
+SharedDecode::Consumer* SharedDecode::find(const void* owner)
+{
+    for (auto& consumer : mConsumers)
+    {
+        if (consumer.owner == owner)
+            return &consumer;
+    }
+
+    return nullptr;
+}
+
+GstPadProbeReturn SharedDecode::onUnlink(GstPad* pad, GstPadProbeInfo* info, gpointer data)
+{
+    if (GstPad* peer = gst_pad_get_peer(pad))
+    {
+        gst_pad_unlink(pad, peer);
+        gst_object_unref(peer);
+    }
+
+    auto& unlink = *static_cast<std::shared_ptr<Unlink>*>(data);
+
+    {
+        std::lock_guard<std::mutex> lock(unlink->mutex);
+        unlink->done = true;
+    }
+
+    unlink->condition.notify_one();
+    return GST_PAD_PROBE_REMOVE;
+}
+
+}
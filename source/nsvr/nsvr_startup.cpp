@@ -0,0 +1,410 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_startup.hpp"
+
+#include <glib/gstdio.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+
+namespace {
+
+enum class State { IDLE, RUNNING, DONE };
+
+std::mutex                  startup_mutex;
+std::condition_variable     startup_done;
+State                       startup_state       = State::IDLE;
+bool                        startup_succeeded   = false;
+bool                        startup_configured  = false;
+nsvr::StartupSettings       startup_settings;
+nsvr::StartupStats          startup_stats;
+
+//! answers seconds passed since monotonic time "since"
+gdouble secondsSince(gint64 since)
+{
+    return (g_get_monotonic_time() - since) / gdouble(G_USEC_PER_SEC);
+}
+
+//! appends directories listed by environment variable "name" to "paths"
+void appendEnvironmentPaths(const gchar* name, std::vector<std::string>& paths)
+{
+    if (const gchar *value = g_getenv(name))
+    {
+        gchar **dirs = g_strsplit(value, G_SEARCHPATH_SEPARATOR_S, -1);
+
+        for (gchar **dir = dirs; *dir != nullptr; ++dir)
+        {
+            if (**dir != '\0')
+                paths.push_back(*dir);
+        }
+
+        g_strfreev(dirs);
+    }
+}
+
+//! answers directories plugins are looked up in, "settings" first
+std::vector<std::string> getPluginPaths(const nsvr::StartupSettings& settings)
+{
+    std::vector<std::string> paths = settings.pluginPaths;
+
+    if (!paths.empty())
+        return paths;
+
+    appendEnvironmentPaths("GST_PLUGIN_PATH_1_0", paths);
+    appendEnvironmentPaths("GST_PLUGIN_PATH", paths);
+    appendEnvironmentPaths("GST_PLUGIN_SYSTEM_PATH_1_0", paths);
+    appendEnvironmentPaths("GST_PLUGIN_SYSTEM_PATH", paths);
+
+    // Same variables the SDK is found with at build time
+    for (const gchar *root : { "GSTREAMER_1_0_ROOT_X86_64", "GSTREAMER_1_0_ROOT_X86", "GSTREAMER_ROOT" })
+    {
+        if (const gchar *value = g_getenv(root))
+        {
+            gchar *dir = g_build_filename(value, "lib", "gstreamer-1.0", nullptr);
+            paths.push_back(dir);
+            g_free(dir);
+        }
+    }
+
+    for (const gchar *dir : { "/usr/lib/x86_64-linux-gnu/gstreamer-1.0", "/usr/lib/aarch64-linux-gnu/gstreamer-1.0",
+                              "/usr/lib64/gstreamer-1.0", "/usr/lib/gstreamer-1.0", "/usr/local/lib/gstreamer-1.0" })
+    {
+        paths.push_back(dir);
+    }
+
+    return paths;
+}
+
+//! answers file of plugin "name" within "paths", empty if not found
+std::string findPlugin(const std::string& name, const std::vector<std::string>& paths)
+{
+    for (const std::string& path : paths)
+    {
+        for (const gchar *format : { "libgst%s.so", "libgst%s.dylib", "gst%s.dll", "libgst%s.dll" })
+        {
+            gchar *basename = g_strdup_printf(format, name.c_str());
+            gchar *filename = g_build_filename(path.c_str(), basename, nullptr);
+            const std::string found = g_file_test(filename, G_FILE_TEST_IS_REGULAR) ? filename : "";
+
+            g_free(basename);
+            g_free(filename);
+
+            if (!found.empty())
+                return found;
+        }
+    }
+
+    return "";
+}
+
+//! links "target" at "link", copying it if links are not supported. Returns true on success
+bool linkPlugin(const std::string& target, const std::string& link)
+{
+    GFile   *file   = g_file_new_for_path(link.c_str());
+    bool    linked  = g_file_make_symbolic_link(file, target.c_str(), nullptr, nullptr) != FALSE;
+
+    if (!linked)
+    {
+        GFile   *source = g_file_new_for_path(target.c_str());
+        GError  *error  = nullptr;
+
+        linked = g_file_copy(source, file, G_FILE_COPY_OVERWRITE, nullptr, nullptr, nullptr, &error) != FALSE;
+
+        if (!linked)
+            NSVR_LOG("Unable to link plug-in " << target << " [" << error->message << "].");
+
+        g_clear_error(&error);
+        g_object_unref(source);
+    }
+
+    g_object_unref(file);
+
+    return linked;
+}
+
+//! answers contents of a file, empty if not readable
+std::string readFile(const std::string& path)
+{
+    gchar       *contents   = nullptr;
+    std::string text;
+
+    if (g_file_get_contents(path.c_str(), &contents, nullptr, nullptr) != FALSE)
+        text = contents;
+
+    g_free(contents);
+    return text;
+}
+
+/*!
+ * Links plugins of "settings" into a directory next to the registry and
+ * points GStreamer at both. "pinned" is set if the registry is up to date
+ * with the plugins, so it is loaded without scanning.
+ */
+void prepareRegistry(const nsvr::StartupSettings& settings, bool& pinned)
+{
+    const std::string   directory   = settings.registry + ".d";
+    const std::string   manifest    = settings.registry + ".manifest";
+    const auto          paths       = getPluginPaths(settings);
+
+    std::vector<std::string>    files;
+    std::ostringstream          listing;
+
+    // Plugins by name, file, size and modification time, an update of any rebuilds the registry
+    for (const std::string& name : settings.plugins)
+    {
+        const std::string file = findPlugin(name, paths);
+        GStatBuf stat;
+
+        if (file.empty() || g_stat(file.c_str(), &stat) != 0)
+            continue;
+
+        files.push_back(file);
+        listing << name << "\t" << file << "\t" << stat.st_size << "\t" << stat.st_mtime << "\n";
+    }
+
+    pinned = g_file_test(settings.registry.c_str(), G_FILE_TEST_IS_REGULAR) && readFile(manifest) == listing.str();
+
+    if (!pinned)
+    {
+        NSVR_LOG("Building registry " << settings.registry << " of " << files.size() << " plug-ins out of " << settings.plugins.size() << ".");
+
+        gchar *parent = g_path_get_dirname(settings.registry.c_str());
+        g_mkdir_with_parents(parent, 0755);
+        g_free(parent);
+
+        g_mkdir_with_parents(directory.c_str(), 0755);
+
+        // Links of plugins no longer listed would stay in the registry
+        if (GDir *dir = g_dir_open(directory.c_str(), 0, nullptr))
+        {
+            while (const gchar *name = g_dir_read_name(dir))
+            {
+                gchar *filename = g_build_filename(directory.c_str(), name, nullptr);
+                g_remove(filename);
+                g_free(filename);
+            }
+
+            g_dir_close(dir);
+        }
+
+        for (const std::string& file : files)
+        {
+            gchar *basename = g_path_get_basename(file.c_str());
+            gchar *link     = g_build_filename(directory.c_str(), basename, nullptr);
+
+            linkPlugin(file, link);
+
+            g_free(basename);
+            g_free(link);
+        }
+
+        g_remove(settings.registry.c_str());
+
+        if (g_file_set_contents(manifest.c_str(), listing.str().c_str(), -1, nullptr) == FALSE)
+            NSVR_LOG("Unable to write " << manifest << ", the registry will be rebuilt next time.");
+    }
+
+    g_setenv("GST_REGISTRY", settings.registry.c_str(), TRUE);
+    g_setenv("GST_REGISTRY_1_0", settings.registry.c_str(), TRUE);
+    g_setenv("GST_REGISTRY_UPDATE", pinned ? "no" : "yes", TRUE);
+    g_setenv("GST_PLUGIN_SYSTEM_PATH", directory.c_str(), TRUE);
+    g_setenv("GST_PLUGIN_SYSTEM_PATH_1_0", directory.c_str(), TRUE);
+    g_unsetenv("GST_PLUGIN_PATH");
+    g_unsetenv("GST_PLUGIN_PATH_1_0");
+}
+
+//! removes element factories of the registry not listed in "features"
+void whitelistFeatures(const std::vector<std::string>& features)
+{
+    GstRegistry *registry = gst_registry_get();
+    GList       *factories = gst_registry_get_feature_list(registry, GST_TYPE_ELEMENT_FACTORY);
+
+    for (GList *curr = factories; curr; curr = curr->next)
+    {
+        GstPluginFeature *feature = GST_PLUGIN_FEATURE(curr->data);
+
+        if (std::find(features.begin(), features.end(), gst_plugin_feature_get_name(feature)) == features.end())
+            gst_registry_remove_feature(registry, feature);
+    }
+
+    gst_plugin_feature_list_free(factories);
+}
+
+//! prepares the registry and the environment GStreamer reads, filling "stats". Not MT safe, call before any thread may read the environment
+void prepare(const nsvr::StartupSettings& settings, bool configured, nsvr::StartupStats& stats)
+{
+    const gint64 started = g_get_monotonic_time();
+
+    if (gst_is_initialized() != FALSE)
+        return;
+
+    if (configured)
+    {
+        if (!settings.registry.empty())
+            prepareRegistry(settings, stats.pinned);
+
+        gst_registry_fork_set_enabled(settings.fork ? TRUE : FALSE);
+    }
+
+    stats.prepare = secondsSince(started);
+}
+
+//! initializes GStreamer as configured and prepared, filling "stats". Returns true on success
+bool initialize(const nsvr::StartupSettings& settings, bool configured, nsvr::StartupStats& stats)
+{
+    const gint64 started = g_get_monotonic_time();
+
+    if (gst_is_initialized() != FALSE)
+        return true;
+
+    GError *init_error = nullptr;
+    BIND_TO_SCOPE(init_error);
+
+    const gint64 init_started = g_get_monotonic_time();
+
+    if (gst_init_check(nullptr, nullptr, &init_error) == FALSE)
+    {
+        NSVR_LOG("GStreamer failed to initialize [" << init_error->message << "].");
+        return false;
+    }
+
+    stats.init = secondsSince(init_started);
+
+    const gint64 whitelist_started = g_get_monotonic_time();
+
+    if (configured && !settings.features.empty())
+        whitelistFeatures(settings.features);
+
+    stats.whitelist = secondsSince(whitelist_started);
+
+    GstRegistry *registry   = gst_registry_get();
+    GList       *plugins    = gst_registry_get_plugin_list(registry);
+
+    for (GList *curr = plugins; curr; curr = curr->next)
+    {
+        GList *features = gst_registry_get_feature_list_by_plugin(registry, gst_plugin_get_name(GST_PLUGIN(curr->data)));
+
+        stats.plugins  += 1;
+        stats.features += g_list_length(features);
+
+        gst_plugin_feature_list_free(features);
+    }
+
+    gst_plugin_list_free(plugins);
+
+    stats.total = stats.prepare + secondsSince(started);
+
+    NSVR_LOG("GStreamer initialized in " << stats.total << " seconds (prepare " << stats.prepare << ", init " << stats.init
+        << ", whitelist " << stats.whitelist << ") with " << stats.plugins << " plug-ins and " << stats.features << " features"
+        << (stats.pinned ? " from a pinned registry" : "") << (stats.background ? " in the background." : "."));
+
+    return true;
+}
+
+//! claims startup and prepares it on the calling thread. Returns false if already running or done
+bool begin(bool background, nsvr::StartupSettings& settings, bool& configured, nsvr::StartupStats& stats)
+{
+    {
+        std::lock_guard<std::mutex> lock(startup_mutex);
+
+        if (startup_state != State::IDLE)
+            return false;
+
+        settings        = startup_settings;
+        configured      = startup_configured;
+        startup_state   = State::RUNNING;
+    }
+
+    stats.background = background;
+
+    // Environment is written while no other thread of ours reads it
+    prepare(settings, configured, stats);
+
+    return true;
+}
+
+//! initializes GStreamer on the calling thread once begin() succeeded
+void finish(nsvr::StartupSettings settings, bool configured, nsvr::StartupStats stats)
+{
+    const bool succeeded = initialize(settings, configured, stats);
+
+    std::lock_guard<std::mutex> lock(startup_mutex);
+
+    stats.waited        = startup_stats.waited;
+    startup_stats       = stats;
+    startup_succeeded   = succeeded;
+    startup_state       = State::DONE;
+    startup_done.notify_all();
+}
+
+}
+
+namespace nsvr
+{
+
+bool setStartup(const StartupSettings& settings)
+{
+    std::lock_guard<std::mutex> lock(startup_mutex);
+
+    if (startup_state != State::IDLE || gst_is_initialized() != FALSE)
+    {
+        NSVR_LOG("Startup cannot be configured, GStreamer already initialized.");
+        return false;
+    }
+
+    startup_settings    = settings;
+    startup_configured  = true;
+
+    return true;
+}
+
+void startInBackground()
+{
+    StartupSettings settings;
+    StartupStats    stats;
+    bool            configured = false;
+
+    // Only gst_init() and the whitelist run in the background
+    if (begin(true, settings, configured, stats))
+        std::thread(finish, settings, configured, stats).detach();
+}
+
+bool waitForStartup()
+{
+    std::unique_lock<std::mutex> lock(startup_mutex);
+
+    if (startup_state == State::DONE)
+        return startup_succeeded;
+
+    if (startup_state == State::IDLE)
+    {
+        StartupSettings settings;
+        StartupStats    stats;
+        bool            configured = false;
+
+        lock.unlock();
+
+        if (begin(false, settings, configured, stats))
+            finish(settings, configured, stats);
+
+        lock.lock();
+    }
+
+    const gint64 started = g_get_monotonic_time();
+
+    if (startup_state != State::DONE)
+    {
+        startup_done.wait(lock, [] { return startup_state == State::DONE; });
+        startup_stats.waited += secondsSince(started);
+    }
+
+    return startup_succeeded;
+}
+
+StartupStats getStartupStats()
+{
+    std::lock_guard<std::mutex> lock(startup_mutex);
+    return startup_stats;
+}
+
+}
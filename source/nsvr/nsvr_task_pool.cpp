@@ -0,0 +1,445 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_task_pool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <thread>
+
+#ifdef __linux__
+#   include <pthread.h>
+#   include <sched.h>
+#   include <time.h>
+#endif
+
+namespace {
+
+/*!
+ * @struct  PoolThread
+ * @brief   One thread of the pool, running one task at a time.
+ */
+struct PoolThread
+{
+    std::thread             thread;
+    GstTaskPoolFunction     func        = nullptr;  //!< Task to run, nullptr while idle
+    gpointer                data        = nullptr;  //!< Argument of func
+    guint64                 pushed      = 0;        //!< Tasks handed to the thread so far
+    guint64                 finished    = 0;        //!< Tasks the thread returned from so far
+    bool                    quit        = false;    //!< Flag, telling the thread to exit once idle
+    bool                    exited      = false;    //!< Flag, indicating the thread left its loop
+    bool                    sink        = false;    //!< Flag, indicating the task streams for a sink
+    std::string             owner;                  //!< Element the task streams for
+    gint64                  created     = 0;        //!< Monotonic time the thread started
+    gint64                  busySince   = 0;        //!< Monotonic time the current task started, 0 if idle
+    gint64                  busy        = 0;        //!< Microseconds spent in tasks finished
+    std::condition_variable wake;                   //!< Notified when a task is handed or the pool quits
+};
+
+/*!
+ * @struct  Handle
+ * @brief   Task as answered by push(), for join() to wait for.
+ */
+struct Handle
+{
+    std::shared_ptr<PoolThread> thread;
+    guint64                     task;
+};
+
+/*!
+ * @struct  Core
+ * @brief   Threads and settings of a pool, shared by its GstTaskPool and every thread running.
+ */
+struct Core
+{
+    std::mutex                              mutex;      //!< Guards everything below
+    std::condition_variable                 finished;   //!< Notified when a thread returns from a task
+    std::list<std::shared_ptr<PoolThread>>  threads;    //!< Threads started and not reaped yet
+    nsvr::TaskPoolSettings                  settings;   //!< Where threads run
+#ifdef __linux__
+    cpu_set_t                               cpus;       //!< Affinity of the process, for threads without a choice
+#endif
+};
+
+thread_local PoolThread *current_thread = nullptr;      //!< Thread of a pool the calling thread is, if any
+thread_local Core       *current_core   = nullptr;      //!< Pool of current_thread
+std::atomic<bool>       placement_warned(false);        //!< Flag, indicating a failed placement was logged
+
+//! binds the calling thread to the CPUs and priority of its role
+void place(const Core& core, const nsvr::TaskPoolSettings& settings, bool sink)
+{
+#ifdef __linux__
+    const std::vector<guint> &cpus = sink && !settings.sinkCpus.empty() ? settings.sinkCpus : settings.streamingCpus;
+
+    cpu_set_t set = core.cpus;
+
+    if (!cpus.empty())
+    {
+        CPU_ZERO(&set);
+
+        for (guint cpu : cpus)
+        {
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        }
+    }
+
+    sched_param param;
+    param.sched_priority = sink ? CLAMP(settings.sinkPriority, 0, 99) : 0;
+
+    const gint policy = param.sched_priority > 0 ? SCHED_FIFO : SCHED_OTHER;
+
+    if ((pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0 ||
+         pthread_setschedparam(pthread_self(), policy, &param) != 0) && !placement_warned.exchange(true))
+    {
+        NSVR_LOG("Unable to place streaming thread" << (policy == SCHED_FIFO ? ", SCHED_FIFO requires CAP_SYS_NICE." : "."));
+    }
+#endif
+}
+
+//! loop of one thread of the pool, "core" kept alive until the thread left (a thread dropping the pool outlives it)
+void run(std::shared_ptr<Core> core, std::shared_ptr<PoolThread> self)
+{
+    current_thread  = self.get();
+    current_core    = core.get();
+
+    std::unique_lock<std::mutex> lock(core->mutex);
+
+    while (true)
+    {
+        self->wake.wait(lock, [&self] { return self->quit || self->func != nullptr; });
+
+        if (self->func == nullptr)
+            break;
+
+        const GstTaskPoolFunction       func        = self->func;
+        const gpointer                  data        = self->data;
+        const nsvr::TaskPoolSettings    settings    = core->settings;
+
+        self->busySince = g_get_monotonic_time();
+        self->sink      = false;
+        lock.unlock();
+
+        place(*core, settings, false);
+        func(data);
+
+        // Sink threads leave their priority behind
+        if (self->sink)
+            place(*core, settings, false);
+
+        lock.lock();
+
+        self->busy     += g_get_monotonic_time() - self->busySince;
+        self->busySince = 0;
+        self->func      = nullptr;
+        self->data      = nullptr;
+        self->finished += 1;
+        self->owner.clear();
+
+        core->finished.notify_all();
+
+        guint idle = 0;
+
+        for (const auto& thread : core->threads)
+        {
+            if (thread->func == nullptr && !thread->exited)
+                idle += 1;
+        }
+
+        if (idle > core->settings.maxIdle)
+            break;
+    }
+
+    self->exited = true;
+}
+
+/*!
+ * @struct  NsvrTaskPool
+ * @brief   GstTaskPool running tasks on threads of a Core.
+ */
+struct NsvrTaskPool
+{
+    GstTaskPool             parent;
+    std::shared_ptr<Core>   *core;
+};
+
+struct NsvrTaskPoolClass
+{
+    GstTaskPoolClass parent_class;
+};
+
+GType nsvr_task_pool_get_type();
+
+#define NSVR_TASK_POOL_CORE(pool) (reinterpret_cast<NsvrTaskPool*>(pool)->core->get())
+
+#define nsvr_task_pool_parent_class parent_class
+G_DEFINE_TYPE(NsvrTaskPool, nsvr_task_pool, GST_TYPE_TASK_POOL);
+
+void nsvr_task_pool_prepare(GstTaskPool* pool, GError** error)
+{}
+
+void nsvr_task_pool_cleanup(GstTaskPool* pool)
+{}
+
+gpointer nsvr_task_pool_push(GstTaskPool* pool, GstTaskPoolFunction func, gpointer data, GError** error)
+{
+    Core *core = NSVR_TASK_POOL_CORE(pool);
+    std::lock_guard<std::mutex> lock(core->mutex);
+    std::shared_ptr<PoolThread> chosen;
+
+    for (auto it = core->threads.begin(); it != core->threads.end();)
+    {
+        // Reaps threads that left, they touch nothing after flagging so
+        if ((*it)->exited)
+        {
+            (*it)->thread.join();
+            it = core->threads.erase(it);
+            continue;
+        }
+
+        if (!chosen && (*it)->func == nullptr && !(*it)->quit)
+            chosen = *it;
+
+        ++it;
+    }
+
+    if (!chosen)
+    {
+        chosen = std::make_shared<PoolThread>();
+        chosen->created = g_get_monotonic_time();
+        chosen->thread  = std::thread(run, *reinterpret_cast<NsvrTaskPool*>(pool)->core, chosen);
+
+        core->threads.push_back(chosen);
+    }
+
+    chosen->func    = func;
+    chosen->data    = data;
+    chosen->pushed += 1;
+    chosen->wake.notify_one();
+
+    return new Handle { chosen, chosen->pushed };
+}
+
+void nsvr_task_pool_join(GstTaskPool* pool, gpointer id)
+{
+    Core    *core   = NSVR_TASK_POOL_CORE(pool);
+    Handle  *handle = static_cast<Handle*>(id);
+
+    {
+        std::unique_lock<std::mutex> lock(core->mutex);
+        core->finished.wait(lock, [handle] { return handle->thread->finished >= handle->task; });
+    }
+
+    delete handle;
+}
+
+#if GST_CHECK_VERSION(1, 20, 0)
+void nsvr_task_pool_dispose_handle(GstTaskPool* pool, gpointer id)
+{
+    delete static_cast<Handle*>(id);
+}
+#endif
+
+void nsvr_task_pool_finalize(GObject* object)
+{
+    Core *core = NSVR_TASK_POOL_CORE(object);
+
+    {
+        std::lock_guard<std::mutex> lock(core->mutex);
+
+        for (auto& thread : core->threads)
+        {
+            thread->quit = true;
+            thread->wake.notify_one();
+        }
+    }
+
+    for (auto& thread : core->threads)
+    {
+        // Dropped by a task of its own, which returns soon and releases the core last
+        if (thread->thread.get_id() == std::this_thread::get_id())
+            thread->thread.detach();
+        else
+            thread->thread.join();
+    }
+
+    delete reinterpret_cast<NsvrTaskPool*>(object)->core;
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+void nsvr_task_pool_class_init(NsvrTaskPoolClass* klass)
+{
+    GST_TASK_POOL_CLASS(klass)->prepare         = nsvr_task_pool_prepare;
+    GST_TASK_POOL_CLASS(klass)->cleanup         = nsvr_task_pool_cleanup;
+    GST_TASK_POOL_CLASS(klass)->push            = nsvr_task_pool_push;
+    GST_TASK_POOL_CLASS(klass)->join            = nsvr_task_pool_join;
+#if GST_CHECK_VERSION(1, 20, 0)
+    GST_TASK_POOL_CLASS(klass)->dispose_handle  = nsvr_task_pool_dispose_handle;
+#endif
+    G_OBJECT_CLASS(klass)->finalize             = nsvr_task_pool_finalize;
+}
+
+void nsvr_task_pool_init(NsvrTaskPool* pool)
+{
+    pool->core = new std::shared_ptr<Core>(std::make_shared<Core>());
+
+#ifdef __linux__
+    Core *core = pool->core->get();
+
+    if (sched_getaffinity(0, sizeof(core->cpus), &core->cpus) != 0)
+    {
+        CPU_ZERO(&core->cpus);
+
+        for (guint cpu = 0; cpu < g_get_num_processors() && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &core->cpus);
+    }
+#endif
+}
+
+//! answers true if "element" or a bin holding it is a sink
+bool isSink(GstElement* element)
+{
+    GstObject *object = element ? GST_OBJECT(gst_object_ref(element)) : nullptr;
+    bool sink = false;
+
+    while (object != nullptr && !sink)
+    {
+        sink = GST_OBJECT_FLAG_IS_SET(object, GST_ELEMENT_FLAG_SINK);
+
+        GstObject *parent = gst_object_get_parent(object);
+        gst_object_unref(object);
+        object = parent;
+    }
+
+    if (object != nullptr)
+        gst_object_unref(object);
+
+    return sink;
+}
+
+}
+
+namespace nsvr
+{
+
+TaskPool::TaskPool(const TaskPoolSettings& settings)
+    : mPool(nullptr)
+{
+    internal::gstreamerInitialized();
+
+    mPool = GST_TASK_POOL(gst_object_ref_sink(g_object_new(nsvr_task_pool_get_type(), nullptr)));
+    NSVR_TASK_POOL_CORE(mPool)->settings = settings;
+}
+
+TaskPool::~TaskPool()
+{
+    gst_object_unref(mPool);
+}
+
+void TaskPool::setSettings(const TaskPoolSettings& settings)
+{
+    Core *core = NSVR_TASK_POOL_CORE(mPool);
+    std::lock_guard<std::mutex> lock(core->mutex);
+
+    core->settings = settings;
+}
+
+TaskPoolSettings TaskPool::getSettings() const
+{
+    Core *core = NSVR_TASK_POOL_CORE(mPool);
+    std::lock_guard<std::mutex> lock(core->mutex);
+
+    return core->settings;
+}
+
+std::vector<TaskThreadStats> TaskPool::getStats() const
+{
+    Core            *core   = NSVR_TASK_POOL_CORE(mPool);
+    const gint64    now     = g_get_monotonic_time();
+
+    std::lock_guard<std::mutex> lock(core->mutex);
+    std::vector<TaskThreadStats> stats;
+
+    for (const auto& thread : core->threads)
+    {
+        if (thread->exited)
+            continue;
+
+        TaskThreadStats entry;
+
+        entry.owner     = thread->owner;
+        entry.lifetime  = (now - thread->created) / gdouble(G_USEC_PER_SEC);
+        entry.busy      = (thread->busy + (thread->busySince > 0 ? now - thread->busySince : 0)) / gdouble(G_USEC_PER_SEC);
+        entry.tasks     = thread->finished + (thread->func != nullptr ? 1 : 0);
+        entry.sink      = thread->sink;
+        entry.idle      = thread->func == nullptr;
+
+#ifdef __linux__
+        clockid_t   clock;
+        timespec    time;
+
+        if (pthread_getcpuclockid(const_cast<std::thread&>(thread->thread).native_handle(), &clock) == 0 &&
+            clock_gettime(clock, &time) == 0)
+        {
+            entry.cpu = time.tv_sec + time.tv_nsec / 1e9;
+        }
+#endif
+
+        if (entry.lifetime > 0.)
+            entry.utilisation = entry.cpu / entry.lifetime;
+
+        stats.push_back(entry);
+    }
+
+    return stats;
+}
+
+void TaskPool::handleStreamStatus(GstMessage* message)
+{
+    if (GST_MESSAGE_TYPE(message) != GST_MESSAGE_STREAM_STATUS)
+        return;
+
+    GstStreamStatusType type;
+    GstElement          *owner = nullptr;
+
+    gst_message_parse_stream_status(message, &type, &owner);
+
+    if (type == GST_STREAM_STATUS_TYPE_CREATE)
+    {
+        const GValue *value = gst_message_get_stream_status_object(message);
+
+        if (value != nullptr && G_VALUE_HOLDS_OBJECT(value) && GST_IS_TASK(g_value_get_object(value)))
+            gst_task_set_pool(GST_TASK(g_value_get_object(value)), mPool);
+    }
+    else if (type == GST_STREAM_STATUS_TYPE_ENTER)
+    {
+        // Posted by the thread entering, threads not of the pool are placed too
+        Core                    *core   = NSVR_TASK_POOL_CORE(mPool);
+        const bool              sink    = isSink(owner);
+        TaskPoolSettings        settings;
+
+        {
+            std::lock_guard<std::mutex> lock(core->mutex);
+            settings = core->settings;
+
+            if (current_core == core)
+            {
+                gchar *name = owner ? gst_object_get_name(GST_OBJECT(owner)) : nullptr;
+
+                current_thread->owner   = name ? name : "";
+                current_thread->sink    = sink;
+
+                g_free(name);
+            }
+        }
+
+        place(*core, settings, sink);
+    }
+}
+
+GstTaskPool* TaskPool::getTaskPool() const
+{
+    return mPool;
+}
+
+}
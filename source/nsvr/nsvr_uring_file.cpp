@@ -0,0 +1,622 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_uring_file.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <sys/syscall.h>
+#   include <sys/uio.h>
+#   ifdef __has_include
+#       if __has_include(<linux/io_uring.h>)
+#           include <linux/io_uring.h>
+#           if defined(SYS_io_uring_setup) && defined(SYS_io_uring_enter) && defined(SYS_io_uring_register)
+#               define NSVR_IO_URING 1
+#           endif
+#       endif
+#   endif
+#endif
+
+namespace nsvr
+{
+
+/*!
+ * @struct  UringFile::Ring
+ * @brief   Queues of an io_uring instance, mapped from the kernel.
+ */
+struct UringFile::Ring
+{
+#ifdef NSVR_IO_URING
+    gint                fd          = -1;
+    io_uring_params     params      = {};
+    void                *sq         = MAP_FAILED;
+    gsize               sqSize      = 0;
+    void                *cq         = MAP_FAILED;
+    gsize               cqSize      = 0;
+    void                *sqes       = MAP_FAILED;
+    gsize               sqesSize    = 0;
+
+    unsigned            *sqHead     = nullptr;
+    unsigned            *sqTail     = nullptr;
+    unsigned            *sqMask     = nullptr;
+    unsigned            *sqArray    = nullptr;
+    unsigned            *cqHead     = nullptr;
+    unsigned            *cqTail     = nullptr;
+    unsigned            *cqMask     = nullptr;
+    io_uring_cqe        *cqes       = nullptr;
+
+    std::vector<iovec>  iovecs;     //!< One per slot, for unregistered reads
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED)             ::munmap(sqes, sqesSize);
+        if (cq != MAP_FAILED && cq != sq)   ::munmap(cq, cqSize);
+        if (sq != MAP_FAILED)               ::munmap(sq, sqSize);
+        if (fd >= 0)                        ::close(fd);
+    }
+
+    //! sets up a ring of "entries", returns false on failure
+    bool setup(guint entries)
+    {
+        fd = gint(::syscall(SYS_io_uring_setup, entries, &params));
+
+        if (fd < 0)
+            return false;
+
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+#ifdef IORING_FEAT_SINGLE_MMAP
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            sqSize = cqSize = MAX(sqSize, cqSize);
+#endif
+
+        sq = ::mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+        if (sq == MAP_FAILED)
+            return false;
+
+#ifdef IORING_FEAT_SINGLE_MMAP
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            cq = sq;
+        else
+#endif
+            cq = ::mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+        if (cq == MAP_FAILED || sqes == MAP_FAILED)
+            return false;
+
+        guint8 *sq_ring = static_cast<guint8*>(sq);
+        guint8 *cq_ring = static_cast<guint8*>(cq);
+
+        sqHead  = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.head);
+        sqTail  = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+        sqMask  = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+        cqHead  = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+        cqTail  = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+        cqMask  = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+        cqes    = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+        return true;
+    }
+#endif
+};
+
+/*!
+ * @struct  UringFile::Blocks
+ * @brief   Memory of all slots, freed once the file and every buffer
+ *          handed out let go of it.
+ */
+struct UringFile::Blocks
+{
+    std::atomic<gint>                       refs;   //!< One for the file, one per memory handed out
+    guint8                                  *data;  //!< Page aligned, one block per slot
+    std::unique_ptr<std::atomic<gint>[]>    lent;   //!< Memories handed out per slot
+
+    /*!
+     * @struct  Lent
+     * @brief   Slot wrapped by one GstMemory handed out.
+     */
+    struct Lent
+    {
+        Blocks      *blocks;
+        guint       slot;
+    };
+
+    //! GDestroyNotify of memories handed out
+    static void onReturned(gpointer data)
+    {
+        Lent *lent = static_cast<Lent*>(data);
+
+        --lent->blocks->lent[lent->slot];
+        release(lent->blocks);
+
+        delete lent;
+    }
+
+    static void release(Blocks* blocks)
+    {
+        if (--blocks->refs == 0)
+        {
+            std::free(blocks->data);
+            delete blocks;
+        }
+    }
+};
+
+UringFile::UringFile()
+    : mBlocks(nullptr)
+    , mFile(-1)
+    , mPlainFile(-1)
+    , mSize(0)
+    , mBlock(0)
+    , mQueued(0)
+    , mInFlight(0)
+    , mDirect(false)
+    , mFixed(false)
+{}
+
+UringFile::~UringFile()
+{
+    close();
+}
+
+bool UringFile::isSupported()
+{
+#ifdef NSVR_IO_URING
+    // Missing before 5.1, may also be disabled (kernel.io_uring_disabled) or filtered by seccomp
+    static const bool supported = []
+    {
+        Ring ring;
+        return ring.setup(1);
+    }();
+
+    return supported;
+#else
+    return false;
+#endif
+}
+
+bool UringFile::open(const std::string& path, guint depth, gsize block, bool direct)
+{
+    close();
+
+#ifdef NSVR_IO_URING
+    const gsize page = internal::getPageSize();
+    struct stat info;
+
+    // O_DIRECT needs offsets, sizes and memory aligned, pages are enough for every common device
+    depth   = MAX(depth, 1u);
+    mBlock  = MAX((block + page - 1) / page * page, page);
+
+    if ((mPlainFile = ::open(path.c_str(), O_RDONLY | O_CLOEXEC)) < 0 || ::fstat(mPlainFile, &info) != 0)
+    {
+        NSVR_LOG("Unable to open " << path << " for reading.");
+        close();
+        return false;
+    }
+
+    mSize   = info.st_size;
+    mFile   = mPlainFile;
+    mDirect = false;
+
+    if (direct)
+    {
+        const gint file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+
+        // tmpfs and some network file systems refuse O_DIRECT
+        if (file < 0)
+        {
+            NSVR_LOG("Unable to open " << path << " with O_DIRECT, reading through the page cache.");
+        }
+        else
+        {
+            mFile   = file;
+            mDirect = true;
+        }
+    }
+
+    std::unique_ptr<Ring> ring(new Ring);
+
+    if (!ring->setup(depth))
+    {
+        NSVR_LOG("Unable to set up io_uring [" << g_strerror(errno) << "].");
+        close();
+        return false;
+    }
+
+    void *data = nullptr;
+
+    if (::posix_memalign(&data, page, mBlock * depth) != 0)
+    {
+        NSVR_LOG("Unable to allocate " << mBlock * depth << " bytes for io_uring reads.");
+        close();
+        return false;
+    }
+
+    mBlocks = new Blocks;
+    mBlocks->refs = 1;
+    mBlocks->data = static_cast<guint8*>(data);
+    mBlocks->lent.reset(new std::atomic<gint>[depth]);
+
+    ring->iovecs.resize(depth);
+
+    for (guint slot = 0; slot < depth; ++slot)
+    {
+        mBlocks->lent[slot] = 0;
+        ring->iovecs[slot].iov_base = mBlocks->data + slot * mBlock;
+        ring->iovecs[slot].iov_len  = mBlock;
+    }
+
+    // Registered buffers are pinned once instead of on every read, this counts against RLIMIT_MEMLOCK though
+    mFixed = ::syscall(SYS_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, ring->iovecs.data(), depth) == 0;
+
+    if (!mFixed)
+        NSVR_LOG("Unable to register " << mBlock * depth << " bytes with io_uring, reading into them unregistered.");
+
+    mRing = std::move(ring);
+    mSlots.assign(depth, Slot());
+    mQueued     = 0;
+    mInFlight   = 0;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats = ReadAheadStats();
+
+    return true;
+#else
+    NSVR_LOG("io_uring is unavailable, unable to open " << path << ".");
+    return false;
+#endif
+}
+
+void UringFile::close()
+{
+#ifdef NSVR_IO_URING
+    // Kernel writes into the slots of reads in flight
+    while (mRing != nullptr && mInFlight > 0 && reap(true)) {}
+
+    mRing.reset();
+
+    if (mFile >= 0 && mFile != mPlainFile)
+        ::close(mFile);
+
+    if (mPlainFile >= 0)
+        ::close(mPlainFile);
+#endif
+
+    if (mBlocks != nullptr)
+        Blocks::release(mBlocks);
+
+    mBlocks     = nullptr;
+    mFile       = -1;
+    mPlainFile  = -1;
+    mSize       = 0;
+    mQueued     = 0;
+    mInFlight   = 0;
+    mDirect     = false;
+    mFixed      = false;
+    mSlots.clear();
+}
+
+bool UringFile::isOpen() const
+{
+    return mRing != nullptr;
+}
+
+guint64 UringFile::getSize() const
+{
+    return mSize;
+}
+
+bool UringFile::getDirect() const
+{
+    return mDirect;
+}
+
+GstFlowReturn UringFile::read(guint64 offset, guint size, GstBuffer** buffer)
+{
+    g_return_val_if_fail(mRing != nullptr, GST_FLOW_ERROR);
+
+    if (offset >= mSize)
+        return GST_FLOW_EOS;
+
+    const guint64 end       = MIN(offset + size, mSize);
+    const guint64 first     = offset / mBlock;
+    const guint64 last      = (end - 1) / mBlock;
+    const guint64 window    = MIN(first + mSlots.size(), (mSize + mBlock - 1) / mBlock) - 1;
+
+    // More than all slots hold
+    if (last > window)
+        return copy(offset, gsize(end - offset), buffer);
+
+    // Blocks asked for go first, then as many following as slots are free
+    bool queued = true;
+
+    for (guint64 block = first; block <= window; ++block)
+    {
+        if (findSlot(block) >= 0)
+            continue;
+
+        const gint slot = findFreeSlot(first, window);
+
+        if (slot < 0 || !queue(slot, block))
+        {
+            queued = block > last;
+            break;
+        }
+    }
+
+    if (!reap(false))
+        return GST_FLOW_ERROR;
+
+    if (!queued)
+        return copy(offset, gsize(end - offset), buffer);
+
+    const gint64 started = g_get_monotonic_time();
+    bool waited = false;
+
+    for (guint64 block = first; block <= last; ++block)
+    {
+        gint slot;
+
+        while ((slot = findSlot(block)) >= 0 && mSlots[slot].state == Slot::READING)
+        {
+            waited = true;
+
+            if (!reap(true))
+                return GST_FLOW_ERROR;
+        }
+
+        const guint64 needed = MIN(end, (block + 1) * mBlock) - block * mBlock;
+
+        // Failed or came up short (file shrunk), the plain descriptor tells which
+        if (slot < 0 || mSlots[slot].length < needed)
+            return copy(offset, gsize(end - offset), buffer);
+    }
+
+    GstBuffer *result = gst_buffer_new();
+
+    for (guint64 block = first; block <= last; ++block)
+    {
+        const gint      slot    = findSlot(block);
+        const guint64   begin   = MAX(offset, block * mBlock);
+        const guint64   stop    = MIN(end, (block + 1) * mBlock);
+
+        ++mBlocks->lent[slot];
+        ++mBlocks->refs;
+
+        gst_buffer_append_memory(result, gst_memory_new_wrapped(GST_MEMORY_FLAG_READONLY,
+            mBlocks->data + slot * mBlock, mBlock, gsize(begin - block * mBlock), gsize(stop - begin),
+            new Blocks::Lent { mBlocks, guint(slot) }, Blocks::onReturned));
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (waited)
+    {
+        ++mStats.misses;
+        mStats.stalled += (g_get_monotonic_time() - started) / gdouble(G_USEC_PER_SEC);
+    }
+    else
+    {
+        ++mStats.hits;
+    }
+
+    *buffer = result;
+    return GST_FLOW_OK;
+}
+
+ReadAheadStats UringFile::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+gint UringFile::findSlot(guint64 block) const
+{
+    for (gsize slot = 0; slot < mSlots.size(); ++slot)
+    {
+        const Slot& candidate = mSlots[slot];
+
+        if (candidate.block == block && (candidate.state == Slot::READING || candidate.state == Slot::READY))
+            return gint(slot);
+    }
+
+    return -1;
+}
+
+gint UringFile::findFreeSlot(guint64 first, guint64 last) const
+{
+    gint found = -1;
+
+    for (gsize slot = 0; slot < mSlots.size(); ++slot)
+    {
+        const Slot& candidate = mSlots[slot];
+
+        if (candidate.state == Slot::FREE)
+            return gint(slot);
+
+        // Blocks still held downstream or within the window are kept
+        if (candidate.state != Slot::READING && mBlocks->lent[slot] == 0 && (candidate.block < first || candidate.block > last))
+            found = gint(slot);
+    }
+
+    return found;
+}
+
+bool UringFile::queue(gint slot, guint64 block)
+{
+#ifdef NSVR_IO_URING
+    Ring &ring = *mRing;
+
+    // Only this thread moves the tail, the kernel moves the head
+    const unsigned tail = *ring.sqTail;
+
+    if (tail - __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE) >= ring.params.sq_entries)
+        return false;
+
+    const unsigned  index   = tail & *ring.sqMask;
+    io_uring_sqe    *sqe    = static_cast<io_uring_sqe*>(ring.sqes) + index;
+
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+
+    if (mFixed)
+    {
+        sqe->opcode     = IORING_OP_READ_FIXED;
+        sqe->addr       = guint64(reinterpret_cast<guintptr>(mBlocks->data + slot * mBlock));
+        sqe->len        = guint32(mBlock);
+        sqe->buf_index  = guint16(slot);
+    }
+    else
+    {
+        sqe->opcode     = IORING_OP_READV;
+        sqe->addr       = guint64(reinterpret_cast<guintptr>(&ring.iovecs[slot]));
+        sqe->len        = 1;
+    }
+
+    sqe->fd         = mFile;
+    sqe->off        = block * mBlock;
+    sqe->user_data  = guint64(slot);
+
+    ring.sqArray[index] = index;
+    __atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    mSlots[slot].state  = Slot::READING;
+    mSlots[slot].block  = block;
+    mSlots[slot].length = 0;
+
+    ++mQueued;
+    ++mInFlight;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool UringFile::reap(bool wait)
+{
+#ifdef NSVR_IO_URING
+    Ring &ring = *mRing;
+
+    if (mQueued > 0 || wait)
+    {
+        const long entered = ::syscall(SYS_io_uring_enter, ring.fd, mQueued, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+        if (entered < 0 && errno != EINTR)
+        {
+            NSVR_LOG("Unable to submit io_uring reads [" << g_strerror(errno) << "].");
+            return false;
+        }
+
+        // Whatever was not consumed stays queued for the next call
+        if (entered > 0)
+            mQueued -= MIN(guint(entered), mQueued);
+    }
+
+    unsigned head = *ring.cqHead;
+    guint64 completed = 0;
+
+    while (head != __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE))
+    {
+        const io_uring_cqe &cqe = ring.cqes[head & *ring.cqMask];
+        Slot &slot = mSlots[gsize(cqe.user_data)];
+
+        if (cqe.res < 0)
+        {
+            slot.state = Slot::FAILED;
+        }
+        else
+        {
+            slot.state  = Slot::READY;
+            slot.length = gsize(cqe.res);
+            completed  += guint64(cqe.res);
+        }
+
+        --mInFlight;
+        ++head;
+    }
+
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+
+    if (completed > 0)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.prefetched += completed;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+GstFlowReturn UringFile::copy(guint64 offset, gsize size, GstBuffer** buffer)
+{
+#ifdef NSVR_IO_URING
+    GstBuffer   *result = gst_buffer_new_allocate(nullptr, size, nullptr);
+    GstMapInfo  info;
+
+    if (result == nullptr || gst_buffer_map(result, &info, GST_MAP_WRITE) == FALSE)
+    {
+        if (result != nullptr)
+            gst_buffer_unref(result);
+
+        return GST_FLOW_ERROR;
+    }
+
+    const gint64 started = g_get_monotonic_time();
+    gsize done = 0;
+    bool failed = false;
+
+    while (done < size)
+    {
+        const ssize_t read = ::pread(mPlainFile, info.data + done, size - done, off_t(offset + done));
+
+        if (read < 0 && errno == EINTR)
+            continue;
+
+        if (read <= 0)
+        {
+            failed = read < 0;
+            break;
+        }
+
+        done += read;
+    }
+
+    gst_buffer_unmap(result, &info);
+
+    if (failed || done == 0)
+    {
+        gst_buffer_unref(result);
+        return failed ? GST_FLOW_ERROR : GST_FLOW_EOS;
+    }
+
+    gst_buffer_resize(result, 0, done);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        ++mStats.misses;
+        mStats.stalled += (g_get_monotonic_time() - started) / gdouble(G_USEC_PER_SEC);
+    }
+
+    *buffer = result;
+    return GST_FLOW_OK;
+#else
+    return GST_FLOW_ERROR;
+#endif
+}
+
+}
@@ -0,0 +1,117 @@
+#include "nsvr_internal.hpp"
+#include "nsvr/nsvr_wakeup.hpp"
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   ifdef __linux__
+#       include <sys/eventfd.h>
+#   endif
+#endif
+
+namespace nsvr
+{
+
+Wakeup::Wakeup()
+{
+#ifdef _WIN32
+    mEvent = ::CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+    if (mEvent == nullptr)
+        NSVR_LOG("Unable to create wakeup event.");
+#elif defined(__linux__)
+    mReadFd = mWriteFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (mReadFd < 0)
+        NSVR_LOG("Unable to create wakeup eventfd.");
+#else
+    gint fds[2] = { -1, -1 };
+
+    if (::pipe(fds) == 0)
+    {
+        for (gint fd : fds)
+        {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    else
+    {
+        NSVR_LOG("Unable to create wakeup pipe.");
+    }
+
+    mReadFd     = fds[0];
+    mWriteFd    = fds[1];
+#endif
+}
+
+Wakeup::~Wakeup()
+{
+#ifdef _WIN32
+    if (mEvent != nullptr)
+        ::CloseHandle(mEvent);
+#else
+    if (mReadFd >= 0)
+        ::close(mReadFd);
+
+    if (mWriteFd >= 0 && mWriteFd != mReadFd)
+        ::close(mWriteFd);
+#endif
+}
+
+void Wakeup::signal()
+{
+#ifdef _WIN32
+    ::SetEvent(mEvent);
+#elif defined(__linux__)
+    guint64 one = 1;
+
+    // Fails only if the counter would overflow, it is signaled then anyway
+    if (::write(mWriteFd, &one, sizeof(one)) < 0) {}
+#else
+    const gchar one = 1;
+
+    // Fails only if the pipe is full, it is signaled then anyway
+    if (::write(mWriteFd, &one, sizeof(one)) < 0) {}
+#endif
+}
+
+void Wakeup::acknowledge()
+{
+#ifdef _WIN32
+    ::ResetEvent(mEvent);
+#else
+    gchar buffer[64];
+    while (::read(mReadFd, buffer, sizeof(buffer)) > 0);
+#endif
+}
+
+bool Wakeup::wait(gint64 timeout)
+{
+    GPollFD fd = getPollFd();
+
+    const gint timeout_ms = timeout < 0
+        ? -1
+        : gint((MIN(timeout, gint64(G_MAXINT) * 1000) + 999) / 1000);
+
+    return g_poll(&fd, 1, timeout_ms) > 0;
+}
+
+GPollFD Wakeup::getPollFd() const
+{
+    GPollFD fd;
+
+#ifdef _WIN32
+    fd.fd       = gintptr(mEvent);
+#else
+    fd.fd       = mReadFd;
+#endif
+    fd.events   = G_IO_IN;
+    fd.revents  = 0;
+
+    return fd;
+}
+
+}
@@ -0,0 +1,142 @@
+#include "unit.hpp"
+#include "nsvr.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+using namespace nsvr;
+using unit::check;
+
+namespace {
+
+/*!
+ * @class   Recorder
+ * @brief   Keeps every cue fired, so the test thread waits for them.
+ */
+class Recorder
+{
+public:
+    //! callback handed to CueScheduler
+    CueScheduler::Callback getCallback()
+    {
+        return [this](const CueEvent& event)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mEvents.push_back(event);
+            mFired.notify_all();
+        };
+    }
+
+    //! waits up to "seconds" for "count" cues fired in all. Answers cues fired by then
+    std::vector<CueEvent> waitFor(gsize count, gdouble seconds)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        mFired.wait_for(lock, std::chrono::duration<gdouble>(seconds), [this, count] { return mEvents.size() >= count; });
+        return mEvents;
+    }
+
+private:
+    std::mutex              mMutex;
+    std::condition_variable mFired;
+    std::vector<CueEvent>   mEvents;
+};
+
+//! answers a map of media time to "base" on the clock, as a player playing from 0 at rate 1
+std::function<GstClockTime(GstClockTime)> mapFrom(GstClockTime base)
+{
+    return [base](GstClockTime time) { return base + time; };
+}
+
+void testRearm(GstClock* clock)
+{
+    Recorder        recorder;
+    CueScheduler    cues(recorder.getCallback());
+
+    cues.add(0.05, "a");
+
+    // Scheduled twice on the same map, armed once
+    const GstClockTime first = gst_clock_get_time(clock);
+
+    cues.schedule(clock, mapFrom(first));
+    cues.schedule(clock, mapFrom(first));
+
+    std::vector<CueEvent> events = recorder.waitFor(1, 2.);
+    check(events.size() == 1 && events[0].id == "a", "cue does not fire");
+    check(events.size() == 1 && events[0].target == first + 50 * GST_MSECOND, "cue fires for another time");
+
+    // Same pass over its time, not fired again
+    cues.schedule(clock, mapFrom(first));
+    check(recorder.waitFor(2, .2).size() == 1, "cue fires twice for the same time");
+
+    // Looped, its time maps anew and it fires again
+    const GstClockTime second = gst_clock_get_time(clock);
+
+    cues.schedule(clock, mapFrom(second));
+
+    events = recorder.waitFor(2, 2.);
+    check(events.size() == 2 && events[1].target == second + 50 * GST_MSECOND, "cue does not fire again once looped");
+
+    // Moved before it fired (a seek), it fires once at its new time
+    cues.remove("a");
+    cues.add(0.2, "b");
+
+    const GstClockTime third = gst_clock_get_time(clock);
+
+    cues.schedule(clock, mapFrom(third));
+    cues.schedule(clock, mapFrom(third + 100 * GST_MSECOND));
+
+    events = recorder.waitFor(3, 2.);
+    check(events.size() == 3 && events[2].id == "b" && events[2].target == third + 300 * GST_MSECOND,
+        "moved cue does not fire at its new time");
+
+    check(recorder.waitFor(4, .4).size() == 3, "moved cue fires at its old time too");
+
+    // No longer reached, disarmed
+    cues.remove("b");
+    cues.add(0.1, "c");
+    cues.schedule(clock, mapFrom(gst_clock_get_time(clock)));
+    cues.schedule(clock, [](GstClockTime) { return GST_CLOCK_TIME_NONE; });
+
+    check(recorder.waitFor(4, .3).size() == 3, "cue no longer reached fires");
+
+    const CueStats stats = cues.getStats();
+    check(stats.fired == 3, "stats count " + std::to_string(stats.fired) + " cues fired, not 3");
+}
+
+void testQuiesce(GstClock* clock)
+{
+    Recorder        recorder;
+    CueScheduler    cues(recorder.getCallback());
+
+    cues.add(0.05, "a");
+    cues.schedule(clock, mapFrom(gst_clock_get_time(clock)));
+    cues.quiesce();
+
+    check(recorder.waitFor(1, .2).empty(), "cue fires once quiesced");
+
+    // Unlike shutdown(), scheduling again arms cues again
+    cues.schedule(clock, mapFrom(gst_clock_get_time(clock)));
+    check(recorder.waitFor(1, 2.).size() == 1, "cue does not fire once scheduled after quiesce()");
+
+    cues.shutdown();
+    cues.schedule(clock, mapFrom(gst_clock_get_time(clock)));
+    check(recorder.waitFor(2, .2).size() == 1, "cue fires once shut down");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    gst_init(&argc, &argv);
+
+    GstClock *clock = gst_system_clock_obtain();
+
+    testRearm(clock);
+    testQuiesce(clock);
+
+    gst_object_unref(clock);
+
+    return unit::report("Cues re-arm as their times move.");
+}
@@ -0,0 +1,172 @@
+#include "unit.hpp"
+#include "nsvr.hpp"
+#include "nsvr_frame_store_header.hpp"
+
+#include <glib/gstdio.h>
+
+#include <cstring>
+#include <functional>
+
+using namespace nsvr;
+using internal::StoreHeader;
+using unit::check;
+
+namespace {
+
+const guint64 kAlignment    = 4096;     //!< Alignment of the stores written here
+const guint64 kFrameSize    = 2 * 2 * 4;//!< A 2x2 BGRA frame
+const guint64 kFrameCount   = 2;
+
+//! answers bytes of a valid store of kFrameCount frames, frame "i" filled with "i"
+std::string buildStore()
+{
+    StoreHeader header;
+    std::memset(&header, 0, sizeof(header));
+
+    std::memcpy(header.magic, internal::STORE_MAGIC, sizeof(header.magic));
+    std::strcpy(header.format, "BGRA");
+
+    header.version      = internal::STORE_VERSION;
+    header.alignment    = guint32(kAlignment);
+    header.width        = 2;
+    header.height       = 2;
+    header.fpsNum       = 25;
+    header.fpsDenom     = 1;
+    header.frameCount   = kFrameCount;
+    header.frameSize    = kFrameSize;
+    header.frameStride  = kAlignment;
+    header.dataOffset   = kAlignment;
+    header.indexOffset  = header.dataOffset + header.frameCount * header.frameStride;
+
+    std::string store(header.indexOffset + header.frameCount * 2 * sizeof(guint64), '\0');
+    std::memcpy(&store[0], &header, sizeof(header));
+
+    for (guint64 i = 0; i < kFrameCount; ++i)
+    {
+        const guint64 entry[2] = { header.dataOffset + i * header.frameStride, i * GST_SECOND / 25 };
+
+        std::memset(&store[entry[0]], gint(i), kFrameSize);
+        std::memcpy(&store[header.indexOffset + i * sizeof(entry)], entry, sizeof(entry));
+    }
+
+    return store;
+}
+
+//! answers header of "store" to be changed in place
+StoreHeader* getHeader(std::string& store)
+{
+    return reinterpret_cast<StoreHeader*>(&store[0]);
+}
+
+//! answers index entries of "store" to be changed in place
+guint64* getIndex(std::string& store)
+{
+    return reinterpret_cast<guint64*>(&store[getHeader(store)->indexOffset]);
+}
+
+//! writes "store" to "path" and answers whether FrameStore opens it
+bool opens(const std::string& path, const std::string& store)
+{
+    if (g_file_set_contents(path.c_str(), store.data(), gssize(store.size()), nullptr) == FALSE)
+    {
+        std::cout << "Unable to write " << path << "." << std::endl;
+        return false;
+    }
+
+    FrameStore frames;
+    return frames.open(path);
+}
+
+void testValid(const std::string& path)
+{
+    const std::string store = buildStore();
+
+    FrameStore frames;
+
+    check(g_file_set_contents(path.c_str(), store.data(), gssize(store.size()), nullptr) != FALSE && frames.open(path),
+        "valid store does not open");
+
+    if (!frames.isOpen())
+        return;
+
+    check(frames.getFrameCount() == kFrameCount && frames.getWidth() == 2 && frames.getHeight() == 2 && frames.getFormat() == "BGRA",
+        "valid store opens with a wrong header");
+
+    GstBuffer *frame = frames.getFrame(1);
+
+    if (frame == nullptr)
+    {
+        check(false, "frame of a valid store is not handed out");
+        return;
+    }
+
+    guint8 bytes[kFrameSize];
+
+    check(gst_buffer_get_size(frame) == kFrameSize &&
+          gst_buffer_extract(frame, 0, bytes, sizeof(bytes)) == sizeof(bytes) &&
+          bytes[0] == 1 && bytes[kFrameSize - 1] == 1, "frame of a valid store holds wrong bytes");
+    check(GST_BUFFER_PTS(frame) == GST_SECOND / 25, "frame of a valid store has a wrong time");
+
+    gst_buffer_unref(frame);
+}
+
+void testCorrupt(const std::string& path)
+{
+    struct Corruption
+    {
+        const gchar                         *what;
+        std::function<void(std::string&)>  apply;
+    };
+
+    const Corruption corruptions[] =
+    {
+        { "a file shorter than a header",   [](std::string& s) { s.resize(sizeof(StoreHeader) - 1); } },
+        { "another magic",                  [](std::string& s) { getHeader(s)->magic[0] = 'X'; } },
+        { "another version",                [](std::string& s) { getHeader(s)->version = internal::STORE_VERSION + 1; } },
+        { "no frames",                      [](std::string& s) { getHeader(s)->frameCount = 0; } },
+        { "empty frames",                   [](std::string& s) { getHeader(s)->frameSize = 0; } },
+        { "frames larger than their stride",[](std::string& s) { getHeader(s)->frameSize = kAlignment + 1; } },
+        { "a misaligned index",             [](std::string& s) { getHeader(s)->indexOffset += 1; } },
+        { "a truncated index",              [](std::string& s) { s.resize(s.size() - 1); } },
+        { "frames overlapping the index",   [](std::string& s) { getHeader(s)->indexOffset -= kAlignment; } },
+        { "a frame count wrapping the data size", [](std::string& s) { getHeader(s)->frameCount = G_MAXUINT64 / kAlignment + 2; } },
+        { "a data offset wrapping around",  [](std::string& s) { getHeader(s)->dataOffset = G_MAXUINT64 - kAlignment; } },
+        { "an index offset wrapping around",[](std::string& s) { getHeader(s)->indexOffset = G_MAXUINT64 - 7; } },
+        { "a frame indexed past the end",   [](std::string& s) { getIndex(s)[2] = s.size() - kFrameSize + 1; } },
+        { "a frame indexed far past the end", [](std::string& s) { getIndex(s)[0] = G_MAXUINT64 - 1; } },
+    };
+
+    for (const Corruption& corruption : corruptions)
+    {
+        std::string store = buildStore();
+        corruption.apply(store);
+
+        check(!opens(path, store), std::string("store of ") + corruption.what + " opens");
+    }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    gst_init(&argc, &argv);
+
+    gchar   *path   = nullptr;
+    gint    fd      = g_file_open_tmp("nsvr.unit.XXXXXX.store", &path, nullptr);
+
+    if (fd < 0)
+    {
+        std::cout << "Unable to create a temporary file." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    g_close(fd, nullptr);
+
+    testValid(path);
+    testCorrupt(path);
+
+    g_remove(path);
+    g_free(path);
+
+    return unit::report("Frame stores are validated.");
+}
@@ -0,0 +1,90 @@
+#include "unit.hpp"
+#include "nsvr_internal.hpp"
+
+#include <cstring>
+#include <vector>
+
+using namespace nsvr;
+using unit::check;
+
+namespace {
+
+//! answers "count" bytes of noise
+std::vector<guint8> noise(GRand* rand, gsize count)
+{
+    std::vector<guint8> bytes(count);
+
+    for (gsize i = 0; i < count; ++i)
+        bytes[i] = guint8(g_rand_int(rand));
+
+    return bytes;
+}
+
+void testHash(GRand* rand)
+{
+    const guint64 seeds[][2] =
+    {
+        { 0, 0 },
+        { 0x27D4EB2F165667C5ull, 0x85EBCA77C2B2AE63ull },
+        { G_MAXUINT64, G_MAXUINT64 },
+    };
+
+    for (const auto& seed : seeds)
+    {
+        // Groups chained, as tiles are hashed row after row
+        const std::vector<guint8> data = noise(rand, 64 * 32 + 1);
+
+        guint64 simd[2]     = { seed[0], seed[1] };
+        guint64 scalar[2]   = { seed[0], seed[1] };
+
+        for (gsize offset = 1; offset + 64 <= data.size(); offset += 64)
+        {
+            internal::hashGroup(simd, data.data() + offset);
+            internal::hashGroupScalar(scalar, data.data() + offset);
+
+            check(simd[0] == scalar[0] && simd[1] == scalar[1], "hashGroup of group at " + std::to_string(offset) + " differs from scalar");
+        }
+    }
+
+    // Edges of the multiplies: all bits set, none set
+    guint8 ones[64];
+    guint8 zeros[64];
+    std::memset(ones, 0xFF, sizeof(ones));
+    std::memset(zeros, 0, sizeof(zeros));
+
+    for (const guint8* group : { ones, zeros })
+    {
+        guint64 simd[2]     = { 1, 2 };
+        guint64 scalar[2]   = { 1, 2 };
+
+        internal::hashGroup(simd, group);
+        internal::hashGroupScalar(scalar, group);
+
+        check(simd[0] == scalar[0] && simd[1] == scalar[1], "hashGroup of a uniform group differs from scalar");
+    }
+
+    // A single bit changes the hash
+    std::vector<guint8> data = noise(rand, 64);
+
+    guint64 before[2] = { 0, 0 };
+    guint64 after[2]  = { 0, 0 };
+
+    internal::hashGroup(before, data.data());
+    data[17] ^= 0x10;
+    internal::hashGroup(after, data.data());
+
+    check(before[0] != after[0] || before[1] != after[1], "hashGroup misses a flipped bit");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    GRand *rand = g_rand_new_with_seed(0x4E535652);
+
+    testHash(rand);
+
+    g_rand_free(rand);
+
+    return unit::report("SIMD tile hash matches the scalar one.");
+}
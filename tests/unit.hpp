@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glib.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/*!
+ * @namespace   unit
+ * @brief       Checks shared by the unit tests. A test calls check() for
+ *              every expectation and returns report() out of main().
+ */
+namespace unit
+{
+
+//! answers number of checks failed so far
+inline gint& failures()
+{
+    static gint count = 0;
+    return count;
+}
+
+//! reports "what" as failed unless "ok"
+inline void check(bool ok, const std::string& what)
+{
+    if (!ok)
+    {
+        std::cout << "FAILED: " << what << std::endl;
+        ++failures();
+    }
+}
+
+//! prints "success" if no check failed, the number failed otherwise. Answers the exit code of the test
+inline int report(const std::string& success)
+{
+    if (failures() > 0)
+    {
+        std::cout << failures() << " checks failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << success << std::endl;
+    return EXIT_SUCCESS;
+}
+
+}
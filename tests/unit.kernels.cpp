@@ -0,0 +1,100 @@
+#include "unit.hpp"
+#include "nsvr_internal.hpp"
+
+#include <vector>
+
+using namespace nsvr;
+using unit::check;
+
+namespace {
+
+//! answers "count" bytes of noise, alpha channels spread over the edges (0, 255) and between
+std::vector<guint8> noise(GRand* rand, gsize count)
+{
+    std::vector<guint8> bytes(count);
+
+    for (gsize i = 0; i < count; ++i)
+        bytes[i] = guint8(g_rand_int(rand));
+
+    for (gsize i = 3; i < count; i += 4)
+    {
+        const guint32 pick = g_rand_int_range(rand, 0, 4);
+        bytes[i] = pick == 0 ? 0 : pick == 1 ? 255 : bytes[i];
+    }
+
+    return bytes;
+}
+
+void testBlend(GRand* rand)
+{
+    const guint alphas[] = { 0, 1, 128, 255, 256 };
+
+    // Counts around the 4 pixels SIMD blends at once, and offsets so loads are unaligned
+    for (gint count = 0; count <= 37; ++count)
+    {
+        for (guint alpha : alphas)
+        {
+            for (gint opaque = 0; opaque < 2; ++opaque)
+            {
+                const std::vector<guint8> src = noise(rand, count * 4 + 1);
+                const std::vector<guint8> dst = noise(rand, count * 4 + 3);
+
+                std::vector<guint8> simd    = dst;
+                std::vector<guint8> scalar  = dst;
+
+                internal::blendRow(simd.data() + 3, src.data() + 1, count, alpha, opaque != 0);
+                internal::blendRowScalar(scalar.data() + 3, src.data() + 1, count, alpha, opaque != 0);
+
+                check(simd == scalar, "blendRow of " + std::to_string(count) + " pixels at alpha " +
+                    std::to_string(alpha) + (opaque ? ", opaque" : "") + " differs from scalar");
+            }
+        }
+    }
+
+    // Fully weighted opaque pixels replace, zero weight leaves dst alone
+    const std::vector<guint8> src = noise(rand, 64);
+    const std::vector<guint8> dst = noise(rand, 64);
+
+    std::vector<guint8> replaced = dst;
+    internal::blendRow(replaced.data(), src.data(), 16, 256, true);
+
+    for (gsize i = 0; i < replaced.size(); ++i)
+        check(replaced[i] == (i % 4 == 3 ? 255 : src[i]), "opaque blend at full alpha does not replace byte " + std::to_string(i));
+
+    std::vector<guint8> kept = dst;
+    internal::blendRow(kept.data(), src.data(), 16, 0, false);
+    check(kept == dst, "blend at zero alpha changes dst");
+}
+
+void testCopy(GRand* rand)
+{
+    for (gint count = 0; count <= 37; ++count)
+    {
+        const std::vector<guint8> src = noise(rand, count * 4 + 1);
+
+        std::vector<guint8> simd(count * 4 + 2, 0);
+        std::vector<guint8> scalar(count * 4 + 2, 0);
+
+        internal::copyRow(simd.data() + 2, src.data() + 1, count);
+        internal::copyRowScalar(scalar.data() + 2, src.data() + 1, count);
+
+        check(simd == scalar, "copyRow of " + std::to_string(count) + " pixels differs from scalar");
+
+        for (gint i = 0; i < count; ++i)
+            check(scalar[2 + i * 4 + 3] == 255, "copyRow leaves alpha of pixel " + std::to_string(i) + " unset");
+    }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    GRand *rand = g_rand_new_with_seed(0x4E535652);
+
+    testBlend(rand);
+    testCopy(rand);
+
+    g_rand_free(rand);
+
+    return unit::report("SIMD blend and copy kernels match scalar ones.");
+}
@@ -0,0 +1,155 @@
+#include "unit.hpp"
+#include "nsvr.hpp"
+
+using namespace nsvr;
+using unit::check;
+
+namespace {
+
+const gsize kClientBuffer = 1024;   //!< Bytes PlayerClient receives a datagram into
+
+//! answers "time" in nanoseconds, as cues travel
+guint64 toNanoseconds(gdouble time)
+{
+    return guint64(time * GST_SECOND + 0.5);
+}
+
+//! answers true if "a" and "b" hold the same cues in the same order
+bool isSame(const std::vector<Cue>& a, const std::vector<Cue>& b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (gsize i = 0; i < a.size(); ++i)
+    {
+        if (a[i].id != b[i].id || toNanoseconds(a[i].time) != toNanoseconds(b[i].time))
+            return false;
+    }
+
+    return true;
+}
+
+void testRoundTrip()
+{
+    CuePacket packet;
+    packet.version  = G_GUINT64_CONSTANT(1700000000000000);
+    packet.index    = 2;
+    packet.total    = 3;
+
+    // Ids holding separators and multibyte characters travel escaped
+    const char* ids[] = { "intro", "a|b", "100%", "t12", "lumière", " spaced out " };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(ids); ++i)
+    {
+        Cue cue;
+        cue.id      = ids[i];
+        cue.time    = i * 1.25 + 0.000000001 * i;
+        packet.cues.push_back(cue);
+    }
+
+    CuePacket parsed;
+
+    check(PacketHandler::parse(PacketHandler::serialize(packet), parsed), "cue packet does not parse back");
+    check(parsed.version == packet.version, "cue packet version changes on the way");
+    check(parsed.index == packet.index && parsed.total == packet.total, "cue packet chunk changes on the way");
+    check(isSame(parsed.cues, packet.cues), "cues change on the way");
+
+    // No cues at all is a version too, clearing those of clients
+    CuePacket empty;
+    empty.version = 7;
+
+    check(PacketHandler::parse(PacketHandler::serialize(empty), parsed) && parsed.version == 7 && parsed.cues.empty(),
+        "empty cue packet does not parse back");
+}
+
+void testChunks()
+{
+    CuePacket packet;
+    packet.version = 42;
+
+    for (gint i = 0; i < 500; ++i)
+    {
+        Cue cue;
+        cue.id      = "cue number " + std::to_string(i);
+        cue.time    = i * 0.04;
+        packet.cues.push_back(cue);
+    }
+
+    // Too long for any chunk, dropped alone
+    Cue oversized;
+    oversized.id    = std::string(kClientBuffer, 'x');
+    oversized.time  = 1.;
+
+    std::vector<Cue> expected = packet.cues;
+    packet.cues.insert(packet.cues.begin() + 10, oversized);
+
+    const std::vector<std::string> chunks = PacketHandler::serializeChunks(packet);
+
+    check(chunks.size() > 1, "500 cues fit a single chunk");
+
+    std::vector<Cue> received;
+
+    for (gsize i = 0; i < chunks.size(); ++i)
+    {
+        CuePacket chunk;
+
+        check(chunks[i].size() < kClientBuffer, "chunk " + std::to_string(i) + " does not fit the client's buffer");
+        check(PacketHandler::parse(chunks[i], chunk), "chunk " + std::to_string(i) + " does not parse back");
+        check(chunk.version == packet.version, "chunk " + std::to_string(i) + " lost its version");
+        check(chunk.index == i && chunk.total == chunks.size(), "chunk " + std::to_string(i) + " is numbered wrong");
+
+        received.insert(received.end(), chunk.cues.begin(), chunk.cues.end());
+    }
+
+    check(isSame(received, expected), "cues reassembled from chunks differ from those sent");
+
+    // No cues still sends one chunk, so clients clear theirs
+    CuePacket empty;
+    empty.version = 43;
+
+    check(PacketHandler::serializeChunks(empty).size() == 1, "no cues is not sent as one chunk");
+}
+
+void testMalformed()
+{
+    CuePacket packet;
+    packet.version  = 1;
+    packet.index    = 3;
+    packet.total    = 3;
+
+    CuePacket parsed;
+
+    check(!PacketHandler::parse(PacketHandler::serialize(packet), parsed), "chunk past the total parses");
+
+    packet.index    = 0;
+    packet.total    = 0;
+    check(!PacketHandler::parse(PacketHandler::serialize(packet), parsed), "chunk of no total parses");
+
+    check(!PacketHandler::parse(std::string("sq|nnot a number"), parsed), "malformed version parses");
+    check(!PacketHandler::parse(std::string("sq|t5"), parsed), "cue packet without version parses");
+
+    // Heartbeats are not cue packets, nor the other way around
+    Packet heartbeat;
+    heartbeat.time  = 12.5;
+    heartbeat.state = GST_STATE_PLAYING;
+    heartbeat.base  = 1000;
+
+    check(!PacketHandler::parse(PacketHandler::serialize(heartbeat), parsed), "heartbeat parses as cue packet");
+
+    Packet parsed_heartbeat;
+
+    check(!PacketHandler::parse(PacketHandler::serialize(CuePacket()), parsed_heartbeat), "cue packet parses as heartbeat");
+    check(PacketHandler::parse(PacketHandler::serialize(heartbeat), parsed_heartbeat) &&
+        parsed_heartbeat.time == heartbeat.time && parsed_heartbeat.base == heartbeat.base, "heartbeat does not parse back");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    testRoundTrip();
+    testChunks();
+    testMalformed();
+
+    return unit::report("Cue packets survive the trip.");
+}
@@ -0,0 +1,177 @@
+#include "nsvr.hpp"
+
+#include <gio/gio.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace nsvr;
+
+namespace {
+
+/*!
+ * @struct  ThrottledServer
+ * @brief   Minimal HTTP server, answering every GET with one file sent at
+ *          "rate" bytes per second. Stands in for a slow media server.
+ */
+struct ThrottledServer
+{
+    std::vector<char>   content;        //!< File served
+    gsize               rate = 0;       //!< Bytes per second
+
+    //! Called by GIO on a thread of its own for every connection
+    static gboolean onRun(GThreadedSocketService* service, GSocketConnection* connection, GObject* source, ThrottledServer* server)
+    {
+        GInputStream    *input  = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+        GOutputStream   *output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+        gchar           request[4096];
+
+        // Request itself does not matter, the file is always sent whole
+        if (g_input_stream_read(input, request, sizeof(request), nullptr, nullptr) <= 0)
+            return FALSE;
+
+        gchar *header = g_strdup_printf(
+            "HTTP/1.1 200 OK\r\nContent-Length: %" G_GSIZE_FORMAT "\r\nContent-Type: application/octet-stream\r\nConnection: close\r\n\r\n",
+            server->content.size());
+
+        const bool sent = g_output_stream_write_all(output, header, std::strlen(header), nullptr, nullptr, nullptr) != FALSE;
+        g_free(header);
+
+        // Ten chunks a second
+        const gsize chunk = std::max<gsize>(1, server->rate / 10);
+
+        for (gsize offset = 0; sent && offset < server->content.size(); offset += chunk)
+        {
+            const gsize size = std::min(chunk, server->content.size() - offset);
+
+            if (g_output_stream_write_all(output, server->content.data() + offset, size, nullptr, nullptr, nullptr) == FALSE)
+                break;  // Client went away
+
+            g_usleep(G_USEC_PER_SEC / 10);
+        }
+
+        return FALSE;
+    }
+};
+
+class BufferingPlayer : public Player
+{
+public:
+    bool            ended   = false;
+
+protected:
+    void onStreamEnd() override { ended = true; }
+
+    void onBuffering(gint percent) override
+    {
+        std::cout << "  buffering " << percent << "%" << std::endl;
+    }
+};
+
+bool run(const std::string& uri, bool download, gint seconds)
+{
+    BufferingPlayer player;
+    player.setDownload(download);
+
+    std::cout << (download ? "download into a ring on disk" : "stream buffering in memory") << std::endl;
+
+    if (!player.open(uri))
+        return false;
+
+    player.play();
+
+    const gint64 started = g_get_monotonic_time();
+    gint64       held    = 0;
+
+    while (!player.ended && g_get_monotonic_time() < started + seconds * G_USEC_PER_SEC)
+    {
+        const gint64 before = g_get_monotonic_time();
+
+        player.waitForFrame(0.1);
+        player.update();
+
+        if (player.getBuffering())
+            held += g_get_monotonic_time() - before;
+    }
+
+    std::cout << "  reached " << player.getTime() << "s of " << player.getDuration() << "s, held "
+              << held / gdouble(G_USEC_PER_SEC) << "s for buffering" << std::endl;
+
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 4)
+    {
+        std::cout << "Serves a media file over a throttled local HTTP server and plays it, reporting buffering." << std::endl;
+        std::cout << "Usage: " << argv[0] << " <media> [<bytes per second> [<seconds>]]" << std::endl;
+        std::cout << "Default: 256 KiB/s, 20s. Media needs its index up front (e.g. MP4 with faststart, MKV, TS)." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ThrottledServer server;
+    server.rate = argc > 2 ? gsize(std::atol(argv[2])) : 256 * 1024;
+
+    const gint seconds = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    std::ifstream file(argv[1], std::ios::binary);
+    server.content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    if (server.content.empty())
+    {
+        std::cout << "Unable to read " << argv[1] << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Initializes GStreamer before anything else
+    Player init;
+
+    GSocketService *service = g_threaded_socket_service_new(4);
+    guint16         port    = g_socket_listener_add_any_inet_port(G_SOCKET_LISTENER(service), nullptr, nullptr);
+
+    if (port == 0)
+    {
+        std::cout << "Unable to listen for HTTP." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Connections are accepted from a main loop of their own, served on threads of the service
+    GMainContext    *context    = g_main_context_new();
+    GMainLoop       *loop       = g_main_loop_new(context, FALSE);
+
+    g_signal_connect(service, "run", G_CALLBACK(ThrottledServer::onRun), &server);
+
+    g_main_context_push_thread_default(context);
+    g_socket_service_start(service);
+    g_main_context_pop_thread_default(context);
+
+    std::thread acceptor([loop, context]
+    {
+        g_main_context_push_thread_default(context);
+        g_main_loop_run(loop);
+        g_main_context_pop_thread_default(context);
+    });
+
+    const std::string uri = "http://127.0.0.1:" + std::to_string(port) + "/media";
+
+    const bool succeeded = run(uri, false, seconds) && run(uri, true, seconds);
+
+    g_socket_service_stop(service);
+    g_socket_listener_close(G_SOCKET_LISTENER(service));
+    g_object_unref(service);
+
+    g_main_loop_quit(loop);
+    acceptor.join();
+    g_main_loop_unref(loop);
+    g_main_context_unref(context);
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,87 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace nsvr;
+
+namespace {
+
+class ChangePlayer : public Player
+{
+public:
+    mutable guint64 frames      = 0;
+    mutable guint64 regions     = 0;
+    mutable gdouble uploaded    = 0.;
+    bool            ended       = false;
+
+protected:
+    void onVideoFrame(guchar* buf, gsize size) const override
+    {
+        const FrameChange& change = getFrameChange();
+
+        // Bytes an uploader of changed regions only would copy
+        gint64 area = 0;
+
+        for (const FrameRegion& region : change.getRegions())
+        {
+            area += gint64(region.width) * region.height;
+            ++regions;
+        }
+
+        if (change.width > 0 && change.height > 0)
+            uploaded += size * (area / (gdouble(change.width) * change.height));
+        else
+            uploaded += size;
+
+        ++frames;
+    }
+
+    void onStreamEnd() override { ended = true; }
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 4)
+    {
+        std::cout << "Plays a media and reports frames and tiles unchanged from one frame to the next." << std::endl;
+        std::cout << "Usage: " << argv[0] << " <media> [<tile size> [<seconds>]]" << std::endl;
+        std::cout << "Default: 64 pixels tiles, 10 seconds. Unchanged frames are not handed off." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const guint     tile_size   = argc > 2 ? guint(std::atoi(argv[2])) : 64;
+    const gint64    seconds     = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    ChangePlayer player;
+    player.setChangeDetection(tile_size, true);
+
+    if (!player.open(argv[1], -1, -1))
+    {
+        std::cout << "Unable to open " << argv[1] << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    player.play();
+
+    const gint64 until = g_get_monotonic_time() + seconds * G_USEC_PER_SEC;
+
+    while (!player.ended && g_get_monotonic_time() < until)
+    {
+        player.waitForFrame(0.1);
+        player.update();
+    }
+
+    const FrameChangeStats stats = player.getFrameChangeStats();
+
+    std::cout << "hashed     " << stats.hashed << " frames, " << stats.average * 1000. << "ms average, "
+              << stats.maximum * 1000. << "ms at most" << std::endl;
+    std::cout << "unchanged  " << stats.unchanged << " frames, " << stats.skipped << " never handed off" << std::endl;
+    std::cout << "handed off " << player.frames << " frames, " << player.regions << " changed regions, "
+              << stats.tiles * 100. << "% of tiles changed on average" << std::endl;
+    std::cout << "uploaded   " << player.uploaded / (1024. * 1024.) << " MiB of changed regions" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+
+using namespace nsvr;
+
+namespace {
+
+class CuePlayer : public Player
+{
+public:
+    bool            ended   = false;
+
+protected:
+    void onCue(const CueEvent& event) override
+    {
+        // Runs on the clock thread, alongside update()
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::cout << "cue " << event.id << " at " << event.time << "s, " << event.lateness * 1000. << "ms late" << std::endl;
+    }
+
+    void onStreamEnd() override { ended = true; }
+
+private:
+    std::mutex      mMutex;
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 4)
+    {
+        std::cout << "Plays a media with a cue every interval and prints how late each one fires." << std::endl;
+        std::cout << "Usage: " << argv[0] << " <media> [<interval> [<seconds>]]" << std::endl;
+        std::cout << "Default: a cue every second, 10 seconds." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const gdouble   interval    = argc > 2 ? std::atof(argv[2]) : 1.;
+    const gint64    seconds     = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    if (interval <= 0.)
+    {
+        std::cout << "Interval must be positive." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    CuePlayer player;
+
+    if (!player.open(argv[1], -1, -1))
+    {
+        std::cout << "Unable to open " << argv[1] << "." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (gdouble time = interval; time < player.getDuration(); time += interval)
+        player.addCue(time, "at " + std::to_string(time));
+
+    player.play();
+
+    const gint64 until = g_get_monotonic_time() + seconds * G_USEC_PER_SEC;
+
+    while (!player.ended && g_get_monotonic_time() < until)
+    {
+        player.waitForFrame(0.1);
+        player.update();
+    }
+
+    const CueStats stats = player.getCueStats();
+
+    std::cout << stats.fired << " cues fired, lateness " << stats.average * 1000. << "ms average, "
+              << stats.maximum * 1000. << "ms at most" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,26 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace nsvr;
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3 && argc != 5 && argc != 6)
+    {
+        std::cout << "Pre-decodes a media file into a memory-mapped frame store." << std::endl;
+        std::cout << "Usage: " << argv[0] << " <media> <store> [<width> <height> [<format>]]" << std::endl;
+        std::cout << "Default: size of the media, BGRA format." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bool built = false;
+
+    if (argc == 3)
+        built = FrameStore::build(argv[1], argv[2]);
+    else
+        built = FrameStore::build(argv[1], argv[2], std::atoi(argv[3]), std::atoi(argv[4]), argc == 6 ? argv[5] : "BGRA");
+
+    return built ? EXIT_SUCCESS : EXIT_FAILURE;
+}
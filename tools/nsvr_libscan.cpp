@@ -0,0 +1,97 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace nsvr;
+
+namespace {
+
+//! appends files below "directory" to "paths", recursively
+void listFiles(const std::string& directory, std::vector<std::string>& paths)
+{
+    GDir *dir = g_dir_open(directory.c_str(), 0, nullptr);
+
+    if (dir == nullptr)
+        return;
+
+    while (const gchar *name = g_dir_read_name(dir))
+    {
+        gchar *path = g_build_filename(directory.c_str(), name, nullptr);
+
+        if (g_file_test(path, G_FILE_TEST_IS_DIR))
+            listFiles(path, paths);
+        else if (g_file_test(path, G_FILE_TEST_IS_REGULAR))
+            paths.push_back(path);
+
+        g_free(path);
+    }
+
+    g_dir_close(dir);
+}
+
+void print(const std::string& name, const BatchDiscoveryStats& stats)
+{
+    std::cout << "  " << name << ": " << stats.done << "/" << stats.files << " files in " << stats.elapsed << "s, "
+              << stats.filesPerSecond << " files/s (" << stats.succeeded << " discovered, " << stats.failed << " failed, "
+              << stats.timedOut << " timed out, " << stats.cached << " cached)" << std::endl;
+}
+
+void scan(BatchDiscoverer& batch, const std::vector<std::string>& paths, const std::string& name)
+{
+    batch.start(paths, nullptr);
+
+    while (batch.isRunning())
+    {
+        g_usleep(G_USEC_PER_SEC);
+
+        const BatchDiscoveryStats stats = batch.getStats();
+        std::cout << "\r  " << stats.done << "/" << stats.files << ", " << stats.filesPerSecond << " files/s   " << std::flush;
+    }
+
+    batch.wait();
+
+    std::cout << "\r";
+    print(name, batch.getStats());
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 4)
+    {
+        std::cout << "Discovers every file below a directory one by one, then in parallel, then again from the cache." << std::endl;
+        std::cout << "Usage: " << argv[0] << " <directory> [<files at once> [<timeout in seconds>]]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> paths;
+    listFiles(argv[1], paths);
+
+    // Initializes GStreamer before anything else
+    Player init;
+
+    std::cout << paths.size() << " files" << std::endl;
+
+    BatchDiscoverer batch;
+
+    if (argc > 2)
+        batch.setWorkerCount(guint(std::atoi(argv[2])));
+
+    if (argc > 3)
+        batch.setTimeout(std::atof(argv[3]));
+
+    const guint workers = batch.getWorkerCount();
+
+    Discoverer::setCacheEnabled(false);
+    batch.setWorkerCount(1);
+    scan(batch, paths, "one at a time");
+
+    Discoverer::setCacheEnabled(true);
+    batch.setWorkerCount(workers);
+    scan(batch, paths, std::to_string(workers) + " at once");
+    scan(batch, paths, "cached");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace nsvr;
+
+namespace {
+
+//! Local stand-in for a network encoder, streaming MPEG-TS over UDP
+const gchar* kSender =
+    "videotestsrc is-live=true pattern=ball ! video/x-raw,width=1280,height=720,framerate=30/1 ! "
+    "x264enc tune=zerolatency speed-preset=ultrafast key-int-max=30 ! mpegtsmux ! "
+    "udpsink host=127.0.0.1 port=%d sync=false async=false";
+
+class LivePlayer : public Player
+{
+public:
+    mutable guint64 frames = 0;
+
+protected:
+    void onVideoFrame(guchar* buf, gsize size) const override { ++frames; }
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 4)
+    {
+        std::cout << "Plays a live source and reports its latency, from capture to hand off." << std::endl;
+        std::cout << "Usage: " << argv[0] << " [<uri> [<latency> [<seconds>]]]" << std::endl;
+        std::cout << "Default: streams a local test source to udp://127.0.0.1:5004, 0.1s latency, 10s." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string   uri     = argc > 1 ? argv[1] : "udp://127.0.0.1:5004";
+    const gdouble       latency = argc > 2 ? std::atof(argv[2]) : 0.1;
+    const gint          seconds = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    // Initializes GStreamer for the sender too
+    LivePlayer player;
+    player.setLive(true, latency);
+
+    GstElement *sender = nullptr;
+
+    if (argc == 1)
+    {
+        gchar *description = g_strdup_printf(kSender, 5004);
+        GError *error = nullptr;
+
+        sender = gst_parse_launch(description, &error);
+        g_free(description);
+
+        if (sender == nullptr)
+        {
+            std::cout << "Unable to launch the sender [" << (error ? error->message : "unknown error") << "]." << std::endl;
+            g_clear_error(&error);
+            return EXIT_FAILURE;
+        }
+
+        gst_element_set_state(sender, GST_STATE_PLAYING);
+    }
+
+    const gint64 opened = g_get_monotonic_time();
+
+    if (!player.open(uri))
+        return EXIT_FAILURE;
+
+    player.play();
+
+    gint64 first    = 0;
+    gint64 report   = opened + G_USEC_PER_SEC;
+
+    while (g_get_monotonic_time() < opened + seconds * G_USEC_PER_SEC)
+    {
+        player.waitForFrame(0.1);
+        player.update();
+
+        if (first == 0 && player.frames > 0)
+        {
+            first = g_get_monotonic_time();
+            std::cout << "first frame after " << (first - opened) / gdouble(G_USEC_PER_SEC) << "s" << std::endl;
+        }
+
+        if (g_get_monotonic_time() >= report)
+        {
+            const LatencyStats& stats = player.getLatencyStats();
+
+            std::cout << "frames: " << stats.frames
+                      << "  pipeline: " << stats.pipeline * 1000 << "ms"
+                      << "  last: " << stats.last * 1000 << "ms"
+                      << "  average: " << stats.average * 1000 << "ms"
+                      << "  maximum: " << stats.maximum * 1000 << "ms" << std::endl;
+
+            report += G_USEC_PER_SEC;
+        }
+    }
+
+    player.close();
+
+    if (sender != nullptr)
+    {
+        gst_element_set_state(sender, GST_STATE_NULL);
+        gst_object_unref(sender);
+    }
+
+    return player.frames > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,133 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#   include <windows.h>
+#   include <psapi.h>
+#   pragma comment(lib, "psapi.lib")
+#else
+#   include <sys/resource.h>
+#endif
+
+using namespace nsvr;
+
+namespace {
+
+struct Faults
+{
+    guint64 minor = 0;      //!< Faults served without I/O (first touch of a page included)
+    guint64 major = 0;      //!< Faults which needed I/O
+};
+
+Faults getFaults()
+{
+    Faults faults;
+
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    // Windows does not tell both kinds apart
+    if (::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)) != FALSE)
+        faults.minor = counters.PageFaultCount;
+#else
+    struct rusage usage;
+
+    if (::getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        faults.minor = usage.ru_minflt;
+        faults.major = usage.ru_majflt;
+    }
+#endif
+
+    return faults;
+}
+
+//! answers pages of "page" bytes needed to map "bytes" bytes, one TLB entry each
+gsize getPageCount(gsize bytes, gsize page)
+{
+    return (bytes + page - 1) / page;
+}
+
+class BenchPlayer : public Player
+{
+public:
+    mutable guint64 frames  = 0;
+    bool            ended   = false;
+
+protected:
+    void onVideoFrame(guchar* buf, gsize size) const override
+    {
+        // Touch the frame like a consumer would
+        volatile guchar sink = size > 0 ? buf[size - 1] : 0;
+        (void)sink;
+        ++frames;
+    }
+
+    void onStreamEnd() override { ended = true; }
+};
+
+bool run(const std::string& media, guint slots)
+{
+    BenchPlayer player;
+    player.setOffline(true);
+    player.setFramePool(slots);
+
+    // Faults of building the arena are accounted too
+    const Faults    before  = getFaults();
+    const gint64    started = g_get_monotonic_time();
+
+    if (!player.open(media))
+        return false;
+
+    player.play();
+
+    while (!player.ended)
+    {
+        player.waitForFrame(0.1);
+        player.update();
+    }
+
+    const gint64    elapsed = g_get_monotonic_time() - started;
+    const Faults    after   = getFaults();
+    const auto      stats   = player.getFramePoolStats();
+
+    std::cout << (slots > 0 ? "frame pool (" : "default allocator (") << slots << " slots)" << std::endl;
+    std::cout << "  frames:          " << player.frames << " in " << elapsed / gdouble(G_USEC_PER_SEC) << "s" << std::endl;
+    std::cout << "  decode rate:     " << player.getDecodeRate() << " fps" << std::endl;
+    std::cout << "  page faults:     " << after.minor - before.minor << " minor, " << after.major - before.major << " major" << std::endl;
+
+    if (slots > 0)
+    {
+        const gsize small   = getPageCount(stats.slotSize, 4096);
+        const gsize huge    = getPageCount(stats.slotSize, 2 * 1024 * 1024);
+
+        std::cout << "  arena:           " << stats.slotCount << " x " << stats.slotSize << " bytes, "
+                  << (stats.hugePages ? "huge pages" : "regular pages") << ", NUMA node " << stats.numaNode << std::endl;
+        std::cout << "  served:          " << stats.served << " from the arena, " << stats.fallbacks << " from system memory" << std::endl;
+        std::cout << "  TLB entries:     " << (stats.hugePages ? huge : small) << " per frame (" << small << " with 4 KiB pages)" << std::endl;
+    }
+
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2 && argc != 3)
+    {
+        std::cout << "Decodes a media file offline with and without the frame pool, reporting page faults." << std::endl;
+        std::cout << "Usage: " << argv[0] << " <media> [<slots>]" << std::endl;
+        std::cout << "Default: 8 slots." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const guint slots = argc == 3 ? guint(std::atoi(argv[2])) : 8;
+
+    if (!run(argv[1], 0) || !run(argv[1], slots))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
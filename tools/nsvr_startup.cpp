@@ -0,0 +1,48 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace nsvr;
+
+int main(int argc, char* argv[])
+{
+    if (argc > 3)
+    {
+        std::cout << "Initializes GStreamer and prints how long it took, run twice to see a pinned registry." << std::endl;
+        std::cout << "Usage: " << argv[0] << " [<registry file> [<media to open>]]" << std::endl;
+        std::cout << "Without a registry GStreamer's own is used, with one only the plug-ins NSVR needs." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const gint64 started = g_get_monotonic_time();
+
+    if (argc > 1)
+    {
+        StartupSettings settings;
+        settings.registry = argv[1];
+        setStartup(settings);
+    }
+
+    startInBackground();
+
+    // Stands in for the rest of an application starting up meanwhile
+    g_usleep(G_USEC_PER_SEC / 10);
+
+    Player player;
+
+    if (argc > 2 && !player.open(argv[2], -1, -1))
+        std::cout << "Unable to open " << argv[2] << "." << std::endl;
+
+    const StartupStats stats = getStartupStats();
+
+    std::cout << "prepare   " << stats.prepare << "s" << std::endl;
+    std::cout << "init      " << stats.init << "s" << (stats.pinned ? " (pinned)" : "") << std::endl;
+    std::cout << "whitelist " << stats.whitelist << "s" << std::endl;
+    std::cout << "total     " << stats.total << "s" << (stats.background ? " in the background" : "") << std::endl;
+    std::cout << "waited    " << stats.waited << "s" << std::endl;
+    std::cout << "ready     " << (g_get_monotonic_time() - started) / gdouble(G_USEC_PER_SEC) << "s after start, "
+              << stats.plugins << " plug-ins, " << stats.features << " features" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+using namespace nsvr;
+
+namespace {
+
+//! parses CPUs listed as "0,2-5", empty if none
+std::vector<guint> parseCpus(const std::string& list)
+{
+    std::vector<guint>  cpus;
+    std::istringstream  stream(list);
+    std::string         range;
+
+    while (std::getline(stream, range, ','))
+    {
+        const auto  dash    = range.find('-');
+        const guint first   = guint(std::atoi(range.c_str()));
+        const guint last    = dash != std::string::npos ? guint(std::atoi(range.c_str() + dash + 1)) : first;
+
+        for (guint cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 6)
+    {
+        std::cout << "Plays a media on several Players sharing one task pool and prints its threads." << std::endl;
+        std::cout << "Usage: " << argv[0] << " <media> [<players> [<streaming cpus> [<sink cpus> [<sink priority>]]]]" << std::endl;
+        std::cout << "CPUs are listed as 1-7 or 1,3,5, e.g. 1-15 keeps CPU 0 for rendering." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const guint count = argc > 2 ? guint(std::atoi(argv[2])) : 4;
+
+    TaskPoolSettings settings;
+
+    if (argc > 3) settings.streamingCpus   = parseCpus(argv[3]);
+    if (argc > 4) settings.sinkCpus        = parseCpus(argv[4]);
+    if (argc > 5) settings.sinkPriority    = std::atoi(argv[5]);
+
+    auto pool = std::make_shared<TaskPool>(settings);
+    std::vector<std::unique_ptr<Player>> players;
+
+    for (guint i = 0; i < count; ++i)
+    {
+        std::unique_ptr<Player> player(new Player);
+        player->setTaskPool(pool);
+
+        if (!player->open(argv[1], -1, -1))
+        {
+            std::cout << "Unable to open " << argv[1] << "." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        player->setLoop(true);
+        player->play();
+        players.push_back(std::move(player));
+    }
+
+    for (gint second = 0; second < 10; ++second)
+    {
+        const gint64 until = g_get_monotonic_time() + G_USEC_PER_SEC;
+
+        while (g_get_monotonic_time() < until)
+        {
+            for (auto& player : players)
+                player->update();
+
+            g_usleep(G_USEC_PER_SEC / 100);
+        }
+    }
+
+    const auto stats = pool->getStats();
+    std::cout << count << " players on " << stats.size() << " pooled threads" << std::endl;
+
+    for (const TaskThreadStats& thread : stats)
+    {
+        std::cout << "  " << (thread.owner.empty() ? "(idle)" : thread.owner) << (thread.sink ? " [sink]" : "")
+                  << ": utilisation " << thread.utilisation * 100. << "%, cpu " << thread.cpu << "s, busy "
+                  << thread.busy << "s of " << thread.lifetime << "s, " << thread.tasks << " tasks" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,190 @@
+#include "nsvr.hpp"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+#ifdef __linux__
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+using namespace nsvr;
+
+namespace {
+
+/*!
+ * @struct  Source
+ * @brief   Source element benchmarked, "%s" is the location, "%u" the bytes per read.
+ */
+struct Source
+{
+    const gchar     *name;
+    const gchar     *description;
+};
+
+const Source kSources[] =
+{
+    { "filesrc",            "filesrc location=\"%s\" blocksize=%u" },
+    { "read-ahead",         "nsvrfilesrc location=\"%s\" blocksize=%u read-ahead=67108864" },
+    { "io_uring",           "nsvrfilesrc location=\"%s\" blocksize=%u io-uring-depth=16 io-uring-block=%u" },
+    { "io_uring direct",    "nsvrfilesrc location=\"%s\" blocksize=%u io-uring-depth=16 io-uring-block=%u direct=true" },
+};
+
+//! Bit rates consumed at in Mbit/s, 0 as fast as possible. 8K intraframe runs from about 1 to 6 Gbit/s
+const guint kBitRates[] = { 0, 400, 1000, 2500, 6000 };
+
+/*!
+ * @struct  Consumer
+ * @brief   Stands in for a decoder taking buffers at a fixed bit rate,
+ *          recording how late the source delivered them.
+ */
+struct Consumer
+{
+    guint       rate        = 0;    //!< Mbit/s, 0 if not paced
+    gint64      started     = 0;    //!< Monotonic time of the first buffer
+    guint64     bytes       = 0;    //!< Bytes taken so far
+    guint64     buffers     = 0;    //!< Buffers taken so far
+    guint64     late        = 0;    //!< Buffers delivered past their due time
+    gint64      maxLate     = 0;    //!< Microseconds the latest buffer was due before
+
+    //! Called by fakesink on the streaming thread
+    static void onHandoff(GstElement* sink, GstBuffer* buffer, GstPad* pad, Consumer* consumer)
+    {
+        const gint64 now = g_get_monotonic_time();
+
+        if (consumer->started == 0)
+            consumer->started = now;
+
+        if (consumer->rate > 0)
+        {
+            const gint64 due = consumer->started + gint64(consumer->bytes * 8 / consumer->rate);
+
+            // A millisecond of slack, the scheduler alone may take as much
+            if (now > due + 1000)
+            {
+                consumer->late += 1;
+                consumer->maxLate = MAX(consumer->maxLate, now - due);
+            }
+            else if (due > now)
+            {
+                g_usleep(gulong(due - now));
+            }
+        }
+
+        consumer->bytes += gst_buffer_get_size(buffer);
+        consumer->buffers += 1;
+    }
+};
+
+//! drops the file from the page cache so every run reads from storage
+void evict(const std::string& path)
+{
+#ifdef __linux__
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd >= 0)
+    {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#endif
+}
+
+bool run(const Source& source, const std::string& path, guint block, guint rate, gint seconds)
+{
+    gchar *description = g_strdup_printf(source.description, path.c_str(), block, block);
+    const std::string pipeline_cmd = std::string(description) + " ! fakesink name=sink sync=false signal-handoffs=true";
+    g_free(description);
+
+    GError      *error      = nullptr;
+    GstElement  *pipeline   = gst_parse_launch(pipeline_cmd.c_str(), &error);
+
+    if (pipeline == nullptr)
+    {
+        std::cout << "Unable to launch " << source.name << " [" << (error ? error->message : "unknown error") << "]." << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    Consumer consumer;
+    consumer.rate = rate;
+
+    GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    g_signal_connect(sink, "handoff", G_CALLBACK(Consumer::onHandoff), &consumer);
+    gst_object_unref(sink);
+
+    evict(path);
+
+    const std::clock_t  cpu     = std::clock();
+    const gint64        started = g_get_monotonic_time();
+
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+    GstBus      *bus        = gst_element_get_bus(pipeline);
+    GstMessage  *message    = gst_bus_timed_pop_filtered(bus, seconds * GST_SECOND, GstMessageType(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    const bool  failed      = message != nullptr && GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR;
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+
+    const gdouble elapsed   = (g_get_monotonic_time() - started) / gdouble(G_USEC_PER_SEC);
+    const gdouble cpu_time  = gdouble(std::clock() - cpu) / CLOCKS_PER_SEC;
+
+    if (message != nullptr)
+        gst_message_unref(message);
+
+    gst_object_unref(bus);
+    gst_object_unref(pipeline);
+
+    if (failed)
+    {
+        std::cout << "  " << source.name << ": failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "  " << source.name << ": " << consumer.bytes / elapsed / (1024 * 1024) << " MiB/s"
+              << ", cpu " << cpu_time << "s for " << consumer.bytes / (1024 * 1024) << " MiB";
+
+    if (rate > 0)
+        std::cout << ", late " << consumer.late << "/" << consumer.buffers << " buffers, by " << consumer.maxLate / 1000. << "ms at most";
+
+    std::cout << std::endl;
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 4)
+    {
+        std::cout << "Reads a file through filesrc, read-ahead and io_uring nsvrfilesrc at several bit rates." << std::endl;
+        std::cout << "Usage: " << argv[0] << " <file> [<bytes per read> [<seconds per run>]]" << std::endl;
+        std::cout << "Default: 4 MiB reads (a frame of 8K intraframe), 10s. Use a file larger than the page cache" << std::endl;
+        std::cout << "keeps if it cannot be evicted (not Linux)." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string   path    = argv[1];
+    const guint         block   = argc > 2 ? guint(std::atol(argv[2])) : 4 * 1024 * 1024;
+    const gint          seconds = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    // Initializes GStreamer before anything else
+    Player init;
+
+    if (!registerElements())
+        return EXIT_FAILURE;
+
+    for (guint rate : kBitRates)
+    {
+        if (rate > 0)
+            std::cout << rate << " Mbit/s" << std::endl;
+        else
+            std::cout << "unpaced" << std::endl;
+
+        for (const Source& source : kSources)
+            run(source, path, block, rate, seconds);
+    }
+
+    return EXIT_SUCCESS;
+}